@@ -5,8 +5,13 @@
 #include <memory>
 #include <sstream>
 #include <cmath>
+#include <chrono>
+#include <fstream>
 
 #include "/home/laplace/things/ConceptDatabase.hpp"
+#include "/home/laplace/things/BatchPipeline.hpp"
+#include "/home/laplace/things/Logger.hpp"
+#include "/home/laplace/things/QueryTrace.hpp"
 
 using namespace std;
 
@@ -15,28 +20,104 @@ unique_ptr<ConceptDatabase> g_database;
 
 // 解析逗号分隔的输入字符串
 vector<string> parseCommaInput(const string& input) {
-    vector<string> result;
-    stringstream ss(input);
-    string item;
+    // 与库中的切分规则相同：单遍扫描，去除前后空格，跳过空项
+    return splitCommaList(input);
+}
 
-    while (getline(ss, item, ',')) {
-        // 去除前后空格
-        size_t start = item.find_first_not_of(" \t");
-        if (start == string::npos) continue; // 空字符串
+// 批量模式：approacher --batch <输入.tsv|-> [--out <输出.tsv|->] [--fuzzy] [--threshold x] [--depth n] [--threads n] [--params 文件] [--stats 文件] [--snapshot 文件]
+// 输入每行 A<TAB>B，输出按输入顺序每行 partial_a_to_b、partial_b_to_a、main 和匹配数；"-"表示标准输入/输出
+// 输出表头之后的第N行对应输入的第N行（空行和#注释行输出空行，格式错误的行输出空结果）
+// 批量模式只读数据库，不加载example.txt；--stats 把各阶段耗时和计数以JSON写入文件；--snapshot 映射导出的快照文件代替由数据库构建
+int runBatchMode(int argc, char* argv[]) {
+    string input_path = "-";
+    string output_path = "-";
+    string params_path;
+    string stats_path;
+    string snapshot_path;
+    BatchConfig config;
+
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--batch" && has_value) input_path = argv[++i];
+        else if (arg == "--out" && has_value) output_path = argv[++i];
+        else if (arg == "--params" && has_value) params_path = argv[++i];
+        else if (arg == "--fuzzy") config.options.use_fuzzy_matching = true;
+        else if (arg == "--threshold" && has_value) config.options.fuzzy_threshold = atof(argv[++i]);
+        else if (arg == "--depth" && has_value) config.options.max_recursive_depth = atoi(argv[++i]);
+        else if (arg == "--threads" && has_value) config.match_threads = atoi(argv[++i]);
+        else if (arg == "--stats" && has_value) stats_path = argv[++i];
+        else if (arg == "--snapshot" && has_value) snapshot_path = argv[++i];
+        else {
+            cerr << "用法: approacher --batch <输入.tsv|-> [--out <输出.tsv|->] [--fuzzy] [--threshold x] [--depth n] [--threads n] [--params 文件] [--stats 文件] [--snapshot 文件]" << endl;
+            return 1;
+        }
+    }
 
-        size_t end = item.find_last_not_of(" \t");
-        item = item.substr(start, end - start + 1);
+    // 标准输出可能用于数据，日志一律写stderr
+    Logger::instance().setStderrOnly(true);
+    ios::sync_with_stdio(false);
+    cin.tie(nullptr);
 
-        if (!item.empty()) {
-            result.push_back(item);
+    g_database = make_unique<ConceptDatabase>();
+    if (!g_database->initialize("/home/laplace/things/concepts-db")) {
+        cerr << "数据库初始化失败！" << endl;
+        return 1;
+    }
+    if (!params_path.empty() && !g_database->loadParameters(params_path)) {
+        return 1;
+    }
+    if (!snapshot_path.empty() && !g_database->loadSnapshotFile(snapshot_path)) {
+        return 1;
+    }
+
+    ifstream input_file;
+    if (input_path != "-") {
+        input_file.open(input_path);
+        if (!input_file.is_open()) {
+            cerr << "无法打开输入文件 " << input_path << endl;
+            return 1;
+        }
+    }
+    ofstream output_file;
+    if (output_path != "-") {
+        output_file.open(output_path);
+        if (!output_file.is_open()) {
+            cerr << "无法打开输出文件 " << output_path << endl;
+            return 1;
         }
     }
 
-    return result;
+    istream& in = input_path == "-" ? cin : input_file;
+    ostream& out = output_path == "-" ? cout : output_file;
+    BatchStats stats = runBatchScoring(*g_database, in, out, config);
+
+    LOG_INFO("批量评分完成：" << stats.rows << " 行，成功 " << stats.scored << " 行，格式错误 " << stats.errors
+             << " 行，耗时 " << stats.seconds << " 秒，速率 " << (stats.seconds > 0 ? stats.rows / stats.seconds : 0.0) << " 行/秒",
+             {"rows", stats.rows}, {"errors", stats.errors}, {"seconds", stats.seconds});
+    if (!stats_path.empty()) {
+        ofstream stats_file(stats_path);
+        stats_file << QueryProfiler::instance().formatJson() << endl;
+        if (!stats_file.good()) {
+            LOG_ERROR("无法写出统计文件", {"file", stats_path});
+        }
+    }
+    Logger::instance().flush();
+    return out.good() ? 0 : 1;
 }
 
-int main()
+int main(int argc, char* argv[])
 {
+    string snapshot_path;
+    for (int i = 1; i < argc; i++) {
+        if (string(argv[i]) == "--batch") {
+            return runBatchMode(argc, argv);
+        }
+        if (string(argv[i]) == "--snapshot" && i + 1 < argc) {
+            snapshot_path = argv[++i];
+        }
+    }
+
     cout << "Approacher 概念相似度分析器 (ObjectBox版)" << endl;
 
     // 初始化数据库
@@ -46,8 +127,13 @@ int main()
         return 1;
     }
 
-    // 加载测试数据
-    if (!g_database->loadFromFile("/home/laplace/things/example.txt")) {
+    // 指定了快照文件时直接映射（不加载测试数据、不由数据库构建快照），否则加载测试数据
+    if (!snapshot_path.empty()) {
+        if (!g_database->loadSnapshotFile(snapshot_path)) {
+            cerr << "加载快照文件失败！" << endl;
+            return 1;
+        }
+    } else if (!g_database->loadFromFile("/home/laplace/things/example.txt")) {
         cerr << "加载测试数据失败！" << endl;
         return 1;
     }
@@ -60,6 +146,17 @@ int main()
     cout << "特殊命令:" << endl;
     cout << "  'fuzzy' - 切换模糊匹配模式" << endl;
     cout << "  'params' - 参数学习模式" << endl;
+    cout << "  'online' - 切换在线学习（每个样本立即更新参数）" << endl;
+    cout << "  'import <文件>' - 从TSV/JSONL文件批量导入训练样本" << endl;
+    cout << "  'optimize' - 用已有训练样本优化参数" << endl;
+    cout << "  'cv [k]' - 对已有训练样本做k折交叉验证（默认5折）" << endl;
+    cout << "  'topk [k] <特征列表>' - 检索与特征列表最接近的k个概念（默认10个）" << endl;
+    cout << "  'explain <特征列表A> [| <特征列表B>]' - 显示查询计划及其估计和实际代价（按当前匹配模式）" << endl;
+    cout << "  'reload' - 重新读取概念库并替换内存快照（查询不中断）" << endl;
+    cout << "  'apply <文件>' - 在一个事务中应用概念增量文件（+新增 / -删除 / =替换）" << endl;
+    cout << "  'export <文件>' - 导出当前快照，之后可用 --snapshot <文件> 启动（映射文件，不重建索引）" << endl;
+    cout << "  'stats [json|reset]' - 查看各阶段耗时直方图和工作量计数" << endl;
+    cout << "  'trace <毫秒> [目录]' / 'trace off' - 超过阈值的查询导出Chrome trace文件" << endl;
     cout << "  'save' - 保存参数" << endl;
     cout << "  'load' - 加载参数" << endl;
     cout << "  'quit' 或 'exit' - 退出程序" << endl;
@@ -67,6 +164,7 @@ int main()
     bool use_fuzzy_matching = false;
     double fuzzy_threshold = 0.6;
     int recursive_depth = 2;
+    bool online_learning = false;
 
     string line_a, line_b;
     while (true) {
@@ -83,6 +181,13 @@ int main()
                 cout << "模糊阈值: " << fuzzy_threshold << ", 递归深度: " << recursive_depth << endl;
             }
             continue;
+        } else if (line_a == "online") {
+            online_learning = !online_learning;
+            cout << "在线学习模式: " << (online_learning ? "开启" : "关闭") << endl;
+            if (online_learning) {
+                g_database->resetOnlineLearning();
+            }
+            continue;
         } else if (line_a == "params") {
             cout << "进入参数学习模式..." << endl;
             cout << "输入训练样本数量: ";
@@ -121,20 +226,194 @@ int main()
                             sample.expected_similarity = expected_sim;
                             sample.confidence = confidence;
 
-                            g_database->addTrainingSample(sample);
-                            cout << "样本已添加" << endl;
+                            if (online_learning) {
+                                // 在线学习：每个样本立即做一次梯度更新
+                                auto start = chrono::steady_clock::now();
+                                double error = g_database->onlineUpdate(sample);
+                                auto elapsed = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start);
+                                cout << "样本已学习，更新前误差: " << error << " (耗时 " << elapsed.count() << " 微秒)" << endl;
+                            } else {
+                                g_database->addTrainingSample(sample);
+                                cout << "样本已添加" << endl;
+                            }
                         } catch (const exception& e) {
                             cout << "输入格式错误: " << e.what() << endl;
                         }
                     }
 
-                    cout << "\n开始参数优化..." << endl;
-                    g_database->optimizeParameters();
+                    if (!online_learning) {
+                        cout << "\n开始参数优化..." << endl;
+                        g_database->optimizeParameters();
+                    }
                 } catch (const exception& e) {
                     cout << "输入错误: " << e.what() << endl;
                 }
             }
             continue;
+        } else if (line_a.rfind("import ", 0) == 0) {
+            string filename = line_a.substr(7);
+            size_t start = filename.find_first_not_of(" \t");
+            filename = start == string::npos ? "" : filename.substr(start);
+            if (filename.empty()) {
+                cout << "用法: import <文件>" << endl;
+            } else {
+                g_database->importTrainingSamples(filename);
+            }
+            continue;
+        } else if (line_a == "stats" || line_a == "stats json" || line_a == "stats reset") {
+            QueryProfiler& profiler = QueryProfiler::instance();
+            if (line_a == "stats reset") {
+                profiler.reset();
+                cout << "统计已清零" << endl;
+            } else if (line_a == "stats json") {
+                cout << profiler.formatJson() << endl;
+            } else {
+                cout << profiler.formatText();
+            }
+            continue;
+        } else if (line_a == "trace" || line_a.rfind("trace ", 0) == 0) {
+            // trace <毫秒> [目录] / trace off
+            stringstream args(line_a.substr(5));
+            string threshold_text, directory;
+            args >> threshold_text >> directory;
+            if (threshold_text == "off") {
+                QueryProfiler::instance().setSlowQueryTrace(0);
+                cout << "慢查询trace已关闭" << endl;
+                continue;
+            }
+            double threshold_ms = 0;
+            try {
+                threshold_ms = stod(threshold_text);
+            } catch (const exception& e) {
+                threshold_ms = 0;
+            }
+            if (threshold_ms <= 0) {
+                cout << "用法: trace <毫秒> [目录] 或 trace off" << endl;
+                continue;
+            }
+            QueryProfiler::instance().setSlowQueryTrace(threshold_ms, directory);
+            cout << "耗时不少于 " << threshold_ms << " ms 的查询将导出Chrome trace" << endl;
+            continue;
+        } else if (line_a == "reload") {
+            auto current = g_database->reloadSnapshot();
+            cout << "概念库快照版本 " << current->version << "，共 " << current->conceptCount() << " 个概念" << endl;
+            continue;
+        } else if (line_a.rfind("apply ", 0) == 0) {
+            string filename = line_a.substr(6);
+            size_t start = filename.find_first_not_of(" \t");
+            filename = start == string::npos ? "" : filename.substr(start);
+            if (filename.empty()) {
+                cout << "用法: apply <文件>" << endl;
+                continue;
+            }
+            int changed = g_database->applyDelta(filename);
+            if (changed < 0) {
+                cout << "增量未应用，概念库保持不变" << endl;
+            } else {
+                auto current = g_database->getSnapshot();
+                cout << "已修改 " << changed << " 个概念，快照版本 " << current->version
+                     << "，共 " << current->conceptCount() << " 个概念" << endl;
+            }
+            continue;
+        } else if (line_a.rfind("export ", 0) == 0) {
+            string filename = line_a.substr(7);
+            size_t start = filename.find_first_not_of(" \t");
+            filename = start == string::npos ? "" : filename.substr(start);
+            if (filename.empty()) {
+                cout << "用法: export <文件>" << endl;
+                continue;
+            }
+            if (g_database->exportSnapshot(filename)) {
+                auto current = g_database->getSnapshot();
+                cout << "已导出快照版本 " << current->version << "（" << current->conceptCount() << " 个概念）到 " << filename << endl;
+            } else {
+                cout << "导出失败" << endl;
+            }
+            continue;
+        } else if (line_a.rfind("topk ", 0) == 0) {
+            // topk [k] <特征列表>
+            stringstream args(line_a.substr(5));
+            string first, rest;
+            args >> first;
+            getline(args, rest);
+            size_t k = 10;
+            string feature_text = line_a.substr(5);
+            if (!first.empty() && first.find_first_not_of("0123456789") == string::npos) {
+                try {
+                    k = stoul(first);
+                } catch (const exception& e) {
+                    cout << "用法: topk [k] <特征列表>（k超出范围）" << endl;
+                    continue;
+                }
+                feature_text = rest;
+            }
+
+            auto query = parseCommaInput(feature_text);
+            if (query.empty() || k == 0) {
+                cout << "用法: topk [k] <特征列表>" << endl;
+                continue;
+            }
+
+            TopKStats stats;
+            auto start_time = chrono::steady_clock::now();
+            auto top = g_database->findTopKConcepts(parseFeatureList(query), k, &stats);
+            double elapsed_ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start_time).count();
+
+            cout << "\n=== Top-" << k << " 概念 ===" << endl;
+            for (size_t i = 0; i < top.size(); i++) {
+                auto concept = g_database->findById(top[i].concept_id);
+                string features;
+                if (concept) {
+                    for (size_t j = 0; j < concept->feature_keys.size() && j < concept->feature_values.size(); j++) {
+                        if (j > 0) features += ",";
+                        features += concept->feature_keys[j] + ":" + concept->feature_values[j];
+                    }
+                }
+                cout << (i + 1) << ". 概念 " << top[i].concept_id << "  得分 " << top[i].score
+                     << "  命中 " << top[i].match_count << "  [" << features << "]" << endl;
+            }
+            if (top.empty()) {
+                cout << "没有匹配的概念" << endl;
+            }
+            cout << "查询项 " << stats.terms << " 个，倒排列表共 " << stats.postings_total << " 项，完整评分 "
+                 << stats.candidates_scored << " 个概念，耗时 " << elapsed_ms << " ms" << endl;
+            continue;
+        } else if (line_a.rfind("explain ", 0) == 0) {
+            // explain <特征列表A> [| <特征列表B>]
+            string query_text = line_a.substr(8);
+            size_t bar = query_text.find('|');
+            auto query_a = parseCommaInput(query_text.substr(0, bar));
+            vector<string> query_b;
+            if (bar != string::npos) {
+                query_b = parseCommaInput(query_text.substr(bar + 1));
+            }
+            if (query_a.empty() || (bar != string::npos && query_b.empty())) {
+                cout << "用法: explain <特征列表A> [| <特征列表B>]" << endl;
+                continue;
+            }
+
+            SimilarityOptions options;
+            options.use_fuzzy_matching = use_fuzzy_matching;
+            options.fuzzy_threshold = fuzzy_threshold;
+            options.max_recursive_depth = recursive_depth;
+            QueryPlan plan = g_database->explainQuery(parseFeatureList(query_a), parseFeatureList(query_b), options);
+            cout << formatQueryPlan(plan);
+            continue;
+        } else if (line_a == "optimize") {
+            g_database->optimizeParameters();
+            continue;
+        } else if (line_a == "cv" || line_a.rfind("cv ", 0) == 0) {
+            int fold_count = 5;
+            if (line_a.size() > 3) {
+                try {
+                    fold_count = stoi(line_a.substr(3));
+                } catch (const exception& e) {
+                    cout << "用法: cv [折数]" << endl;
+                    continue;
+                }
+            }
+            g_database->crossValidate(fold_count);
+            continue;
         } else if (line_a == "save") {
             if (g_database->saveParameters("/home/laplace/things/parameters.txt")) {
                 cout << "参数保存成功" << endl;
@@ -162,31 +441,24 @@ int main()
             continue;
         }
 
-        // 转换为特征列表
-        auto features_a = parseFeatureList(input_a);
-        auto features_b = parseFeatureList(input_b);
-
-        // 直接使用calculateMainSimilarity函数计算
-        double main_similarity = g_database->calculateMainSimilarity(features_a, features_b, g_similarity_params);
-
-        if (main_similarity == 0.0) {
-            cout << "无重合概念，相似度为 0" << endl;
+        // 建立查询上下文（解析特征并取得当前发布的参数表）后计算
+        SimilarityOptions options;
+        options.use_fuzzy_matching = use_fuzzy_matching;
+        options.fuzzy_threshold = fuzzy_threshold;
+        options.max_recursive_depth = recursive_depth;
+        QueryContext query = makeQueryContext(input_a, input_b, options);
+        try {
+            g_database->computeSimilarity(query);
+        } catch (const exception& e) {
+            cout << "相似度计算失败: " << e.what() << endl;
             continue;
         }
+        const SimilarityResult& result = query.result;
 
-        // 为了显示分相似度，还是需要手动计算一次
-        auto matches_a = g_database->findMatchingConcepts(features_a, use_fuzzy_matching, fuzzy_threshold, recursive_depth);
-        auto matches_b = g_database->findMatchingConcepts(features_b, use_fuzzy_matching, fuzzy_threshold, recursive_depth);
-        int total_matches = 0;
-        auto overlap_map = g_database->analyzeOverlap(matches_a, matches_b, features_a.size(), features_b.size(), total_matches);
-
-        double partial_a_to_b = g_database->calculatePartialSimilarity(overlap_map, matches_a.size(), g_similarity_params);
-        map<pair<int,int>, int> overlap_map_b;
-        for (const auto& entry : overlap_map) {
-            pair<int,int> swapped_pair(entry.first.second, entry.first.first);
-            overlap_map_b[swapped_pair] = entry.second;
+        if (result.main_similarity == 0.0) {
+            cout << "无重合概念，相似度为 0" << endl;
+            continue;
         }
-        double partial_b_to_a = g_database->calculatePartialSimilarity(overlap_map_b, matches_b.size(), g_similarity_params);
 
         // 构建显示字符串
         string display_a = "[";
@@ -209,10 +481,10 @@ int main()
         if (use_fuzzy_matching) {
             cout << "模糊阈值: " << fuzzy_threshold << ", 递归深度: " << recursive_depth << endl;
         }
-        cout << "匹配概念数 - A: " << matches_a.size() << ", B: " << matches_b.size() << ", 重合: " << total_matches << endl;
-        cout << display_a << "->" << display_b << " : " << partial_a_to_b << endl;
-        cout << display_a << "<-" << display_b << " : " << partial_b_to_a << endl;
-        cout << display_a << "<->" << display_b << " : " << main_similarity << endl;
+        cout << "匹配概念数 - A: " << result.matches_A_count << ", B: " << result.matches_B_count << ", 重合: " << result.total_matches << endl;
+        cout << display_a << "->" << display_b << " : " << result.partial_a_to_b << endl;
+        cout << display_a << "<-" << display_b << " : " << result.partial_b_to_a << endl;
+        cout << display_a << "<->" << display_b << " : " << result.main_similarity << endl;
     }
 
     cout << "程序结束。" << endl;
@@ -0,0 +1,566 @@
+// Approacher 基准测试：用确定性的合成概念库测量核心函数和端到端查询的性能
+// 合成库：N个概念，键和值按Zipf分布抽取，含复合词；查询带无键特征、拼写错误和拆开的复合词
+// 结果以表格打印，并可写成JSON（--json），用 --compare 与之前的结果对比
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <memory>
+#include <functional>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <filesystem>
+#include <cstdio>
+#include <cstdlib>
+#include <atomic>
+#include <new>
+
+#include "/home/laplace/things/ConceptDatabase.hpp"
+#include "/home/laplace/things/SyntheticLibrary.hpp"
+#include "/home/laplace/things/Logger.hpp"
+#include "/home/laplace/things/QueryTrace.hpp"
+#include "/home/laplace/things/QueryArena.hpp"
+#include "/home/laplace/things/FeatureIdMatch.hpp"
+#include "/home/laplace/things/SimpleJson.hpp"
+#include "/home/laplace/things/SnapshotFile.hpp"
+
+using namespace std;
+
+// 基准测试配置
+struct BenchConfig {
+    SyntheticConfig library;
+    size_t query_count = 2000;         // 生成的查询对数
+    size_t small_concept_count = 300;  // 递归匹配和模糊端到端使用的小概念库
+    size_t training_samples = 200;     // 参数优化使用的样本数
+    int optimize_iterations = 10;      // 每次参数优化的迭代数
+    double min_time = 1.0;             // 每项测试的最短计时（秒）
+    string db_path = "/tmp/approacher-bench-db";
+    string json_path;                  // 写出JSON结果，"-"表示标准输出
+    string compare_path;               // 与之前的JSON结果对比
+    string only;                       // 只运行名称包含该子串的测试
+    string generate_dir;               // 只生成合成库和查询文件到该目录
+    bool trace = false;                // 保留阶段计时（默认关闭以测量引擎本身）
+};
+
+// 一项测试的结果（时间单位：纳秒/次）
+struct BenchResult {
+    string name;
+    uint64_t ops = 0;
+    double seconds = 0.0;
+    double mean_ns = 0.0;
+    double p50_ns = 0.0;
+    double p90_ns = 0.0;
+    double min_ns = 0.0;
+    double ops_per_second = 0.0;
+    double allocs_per_op = 0.0;  // 平均每次操作的堆分配次数（operator new）
+};
+
+// 防止被测调用的结果被优化掉
+volatile double g_sink = 0.0;
+
+// 统计堆分配次数：替换全局operator new，计时区间内的增量除以操作数即为每次操作的分配数
+static atomic<uint64_t> g_allocations(0);
+
+void* operator new(size_t size) {
+    g_allocations.fetch_add(1, memory_order_relaxed);
+    if (void* pointer = malloc(size ? size : 1)) return pointer;
+    throw bad_alloc();
+}
+void operator delete(void* pointer) noexcept { free(pointer); }
+void operator delete(void* pointer, size_t) noexcept { free(pointer); }
+
+// 计时运行：先预热一次，按单次耗时选择每批次数（每批约1毫秒），
+// 至少运行min_time秒和5批（单次很慢时最多运行5倍min_time），统计每批的平均单次耗时
+BenchResult runBenchmark(const string& name, double min_time, const function<void(size_t)>& op) {
+    using clock = chrono::steady_clock;
+    BenchResult result;
+    result.name = name;
+
+    auto warm_start = clock::now();
+    op(0);
+    double single_ns = max(1.0, chrono::duration<double, nano>(clock::now() - warm_start).count());
+    size_t batch = (size_t)max(1.0, min(100000.0, 1e6 / single_ns));
+
+    vector<double> samples;
+    samples.reserve(4096);
+    size_t index = 1;
+    uint64_t allocations_before = g_allocations.load(memory_order_relaxed);
+    auto start = clock::now();
+    double elapsed = 0.0;
+    while (true) {
+        auto batch_start = clock::now();
+        for (size_t i = 0; i < batch; i++) {
+            op(index++);
+        }
+        auto batch_end = clock::now();
+        samples.push_back(chrono::duration<double, nano>(batch_end - batch_start).count() / batch);
+        result.ops += batch;
+        elapsed = chrono::duration<double>(batch_end - start).count();
+        if (elapsed >= min_time && samples.size() >= 5) break;
+        if (elapsed >= min_time * 5 && samples.size() >= 1) break;
+    }
+
+    uint64_t allocations = g_allocations.load(memory_order_relaxed) - allocations_before;
+
+    sort(samples.begin(), samples.end());
+    result.seconds = elapsed;
+    result.mean_ns = elapsed * 1e9 / result.ops;
+    result.p50_ns = samples[samples.size() / 2];
+    result.p90_ns = samples[min(samples.size() - 1, samples.size() * 9 / 10)];
+    result.min_ns = samples.front();
+    result.ops_per_second = result.ops / elapsed;
+    result.allocs_per_op = (double)allocations / result.ops;
+    return result;
+}
+
+// 把合成概念写入一个新建的数据库（单个写事务），返回是否成功
+bool buildDatabase(ConceptDatabase& database, const string& path, const vector<SyntheticConcept>& concepts) {
+    error_code ec;
+    filesystem::remove_all(path, ec);
+    if (!database.initialize(path)) {
+        return false;
+    }
+    string delta_path = path + ".delta";
+    if (!writeSyntheticConcepts(concepts, delta_path, true)) {
+        return false;
+    }
+    int added = database.applyDelta(delta_path);
+    filesystem::remove(delta_path, ec);
+    return added == (int)concepts.size();
+}
+
+vector<Feature> toFeatures(const vector<string>& items) {
+    return parseFeatureList(items);
+}
+
+// 格式化一行结果
+void printResult(ostream& out, const BenchResult& result) {
+    auto format_time = [](double ns) {
+        char buffer[32];
+        if (ns >= 1e6) snprintf(buffer, sizeof(buffer), "%.2f ms", ns / 1e6);
+        else if (ns >= 1e3) snprintf(buffer, sizeof(buffer), "%.2f us", ns / 1e3);
+        else snprintf(buffer, sizeof(buffer), "%.1f ns", ns);
+        return string(buffer);
+    };
+    char line[256];
+    snprintf(line, sizeof(line), "%-30s %12s %12s %12s %10llu %14.1f/s %12.2f",
+             result.name.c_str(), format_time(result.mean_ns).c_str(), format_time(result.p50_ns).c_str(),
+             format_time(result.p90_ns).c_str(), (unsigned long long)result.ops, result.ops_per_second, result.allocs_per_op);
+    out << line << endl;
+}
+
+string formatJson(const BenchConfig& config, const vector<BenchResult>& results) {
+    const SyntheticConfig& library = config.library;
+    ostringstream out;
+    out.precision(10);
+    out << "{\n  \"config\": {\"concepts\": " << library.concept_count
+        << ", \"min_features\": " << library.min_features << ", \"max_features\": " << library.max_features
+        << ", \"keys\": " << library.key_vocabulary << ", \"values\": " << library.value_vocabulary
+        << ", \"zipf\": " << library.zipf_exponent << ", \"compound_rate\": " << library.compound_rate
+        << ", \"typo_rate\": " << library.typo_rate << ", \"keyless_rate\": " << library.keyless_rate
+        << ", \"seed\": " << library.seed << ", \"queries\": " << config.query_count
+        << ", \"small_concepts\": " << config.small_concept_count << ", \"hardware_threads\": " << thread::hardware_concurrency()
+        << "},\n  \"results\": [";
+    for (size_t i = 0; i < results.size(); i++) {
+        const BenchResult& result = results[i];
+        out << (i > 0 ? "," : "") << "\n    {\"name\": " << jsonEscape(result.name) << ", \"ops\": " << result.ops
+            << ", \"seconds\": " << result.seconds << ", \"mean_ns\": " << result.mean_ns
+            << ", \"p50_ns\": " << result.p50_ns << ", \"p90_ns\": " << result.p90_ns
+            << ", \"min_ns\": " << result.min_ns << ", \"ops_per_second\": " << result.ops_per_second
+            << ", \"allocs_per_op\": " << result.allocs_per_op << "}";
+    }
+    out << "\n  ]\n}\n";
+    return out.str();
+}
+
+// 与之前的JSON结果对比：打印每项的平均耗时和变化比例
+void compareResults(const string& path, const vector<BenchResult>& results) {
+    ifstream file(path);
+    if (!file.is_open()) {
+        cerr << "无法打开对比文件 " << path << endl;
+        return;
+    }
+    stringstream buffer;
+    buffer << file.rdbuf();
+    string text = buffer.str();
+
+    JsonValue root;
+    string error;
+    JsonParser parser(text);
+    const JsonValue* old_results = nullptr;
+    if (parser.parse(root, error)) {
+        old_results = root.get("results");
+    }
+    if (!old_results || !old_results->isArray()) {
+        cerr << "对比文件格式错误 " << path << " " << error << endl;
+        return;
+    }
+
+    cout << "\n=== 与 " << path << " 对比（平均耗时） ===" << endl;
+    for (const BenchResult& result : results) {
+        for (const JsonValue& old : old_results->array_items) {
+            const JsonValue* name = old.get("name");
+            const JsonValue* mean = old.get("mean_ns");
+            if (!name || !mean || name->string_value != result.name || mean->number_value <= 0) continue;
+            char line[200];
+            double ratio = result.mean_ns / mean->number_value;
+            snprintf(line, sizeof(line), "%-30s %12.1f ns -> %12.1f ns   x%.3f %s", result.name.c_str(),
+                     mean->number_value, result.mean_ns, ratio, ratio < 0.95 ? "更快" : (ratio > 1.05 ? "更慢" : ""));
+            cout << line << endl;
+        }
+    }
+}
+
+void printUsage() {
+    cout << "用法: approacher_bench [--concepts N] [--features 最少-最多] [--keys N] [--values N] [--zipf s]" << endl;
+    cout << "                       [--compound-rate p] [--typo-rate p] [--keyless-rate p] [--seed n]" << endl;
+    cout << "                       [--queries N] [--small-concepts N] [--samples N] [--iterations N]" << endl;
+    cout << "                       [--min-time 秒] [--only 子串] [--db 目录] [--json 文件|-] [--compare 文件]" << endl;
+    cout << "                       [--generate 目录] [--trace]" << endl;
+}
+
+int main(int argc, char* argv[]) {
+    BenchConfig config;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--concepts" && has_value) config.library.concept_count = max(1L, atol(argv[++i]));
+        else if (arg == "--features" && has_value) {
+            string range = argv[++i];
+            size_t dash = range.find('-');
+            config.library.min_features = max(1, atoi(range.substr(0, dash).c_str()));
+            config.library.max_features = dash == string::npos ? config.library.min_features
+                                                                : max(config.library.min_features, atoi(range.substr(dash + 1).c_str()));
+        }
+        else if (arg == "--keys" && has_value) config.library.key_vocabulary = max(1L, atol(argv[++i]));
+        else if (arg == "--values" && has_value) config.library.value_vocabulary = max(1L, atol(argv[++i]));
+        else if (arg == "--zipf" && has_value) config.library.zipf_exponent = atof(argv[++i]);
+        else if (arg == "--compound-rate" && has_value) config.library.compound_rate = atof(argv[++i]);
+        else if (arg == "--typo-rate" && has_value) config.library.typo_rate = atof(argv[++i]);
+        else if (arg == "--keyless-rate" && has_value) config.library.keyless_rate = atof(argv[++i]);
+        else if (arg == "--seed" && has_value) config.library.seed = strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--queries" && has_value) config.query_count = max(1L, atol(argv[++i]));
+        else if (arg == "--small-concepts" && has_value) config.small_concept_count = max(1L, atol(argv[++i]));
+        else if (arg == "--samples" && has_value) config.training_samples = max(1L, atol(argv[++i]));
+        else if (arg == "--iterations" && has_value) config.optimize_iterations = max(1, atoi(argv[++i]));
+        else if (arg == "--min-time" && has_value) config.min_time = atof(argv[++i]);
+        else if (arg == "--only" && has_value) config.only = argv[++i];
+        else if (arg == "--db" && has_value) config.db_path = argv[++i];
+        else if (arg == "--json" && has_value) config.json_path = argv[++i];
+        else if (arg == "--compare" && has_value) config.compare_path = argv[++i];
+        else if (arg == "--generate" && has_value) config.generate_dir = argv[++i];
+        else if (arg == "--trace") config.trace = true;
+        else {
+            printUsage();
+            return arg == "--help" ? 0 : 1;
+        }
+    }
+
+    // 计时期间只输出警告和错误，JSON写标准输出时日志改写stderr
+    Logger::instance().setLevel(LOG_LEVEL_WARN);
+    Logger::instance().setStderrOnly(true);
+    QueryProfiler::instance().setEnabled(config.trace);
+
+    // 1. 生成合成概念库和查询
+    auto generate_start = chrono::steady_clock::now();
+    SyntheticLibraryGenerator generator(config.library);
+    vector<SyntheticConcept> concepts = generator.generateConcepts();
+    vector<SyntheticQuery> queries = generator.generateQueries(concepts, config.query_count);
+    double generate_seconds = chrono::duration<double>(chrono::steady_clock::now() - generate_start).count();
+
+    if (!config.generate_dir.empty()) {
+        string concepts_file = config.generate_dir + "/concepts.txt";
+        string queries_file = config.generate_dir + "/queries.tsv";
+        if (!writeSyntheticConcepts(concepts, concepts_file, false) || !writeSyntheticQueries(queries, queries_file)) {
+            cerr << "无法写出合成库到 " << config.generate_dir << endl;
+            return 1;
+        }
+        cout << "已生成 " << concepts.size() << " 个概念到 " << concepts_file << "，" << queries.size() << " 个查询到 " << queries_file << endl;
+        return 0;
+    }
+
+    // 2. 建立主数据库和小数据库
+    cerr << "合成库: " << concepts.size() << " 个概念, " << queries.size() << " 个查询 (生成耗时 " << generate_seconds << " 秒)" << endl;
+    ConceptDatabase database;
+    if (!buildDatabase(database, config.db_path, concepts)) {
+        cerr << "建立基准数据库失败: " << config.db_path << endl;
+        return 1;
+    }
+
+    SyntheticConfig small_library = config.library;
+    small_library.concept_count = min(config.small_concept_count, concepts.size());
+    vector<SyntheticConcept> small_concepts(concepts.begin(), concepts.begin() + small_library.concept_count);
+    vector<SyntheticQuery> small_queries = generator.generateQueries(small_concepts, min<size_t>(config.query_count, 200), 2);
+    ConceptDatabase small_database;
+    if (!buildDatabase(small_database, config.db_path + "-small", small_concepts)) {
+        cerr << "建立小基准数据库失败: " << config.db_path << "-small" << endl;
+        return 1;
+    }
+    // 查询重复出现，各项默认不经过匹配结果缓存和并发查询合并，两者单独测（见 cache/*、burst/*）
+    database.setMatchCacheCapacity(0);
+    small_database.setMatchCacheCapacity(0);
+    database.setSingleFlightEnabled(false);
+    small_database.setSingleFlightEnabled(false);
+
+    auto snapshot = database.getSnapshot();
+    vector<vector<Feature>> query_features;
+    for (const SyntheticQuery& query : queries) {
+        query_features.push_back(toFeatures(query.a));
+    }
+    // 查询的原始输入行（与交互输入和批量文件相同的逗号分隔格式）
+    vector<pair<string, string>> query_lines;
+    for (const SyntheticQuery& query : queries) {
+        string line_a, line_b;
+        for (const string& item : query.a) line_a += (line_a.empty() ? "" : ", ") + item;
+        for (const string& item : query.b) line_b += (line_b.empty() ? "" : ", ") + item;
+        query_lines.emplace_back(line_a, line_b);
+    }
+    vector<vector<Feature>> small_query_features;
+    for (const SyntheticQuery& query : small_queries) {
+        small_query_features.push_back(toFeatures(query.a));
+    }
+
+    // 编辑距离的输入：单词与其拼写错误变体，以及随机单词对
+    SyntheticRandom random(config.library.seed + 7);
+    const vector<string>& words = generator.valueWords();
+    vector<pair<string, string>> typo_pairs, random_pairs;
+    for (size_t i = 0; i < 1024; i++) {
+        const string& word = words[random.below(words.size())];
+        typo_pairs.emplace_back(word, SyntheticLibraryGenerator::addTypo(word, random));
+        random_pairs.emplace_back(words[random.below(words.size())], words[random.below(words.size())]);
+    }
+
+    // JSON写标准输出时表格改写stderr
+    ostream& table = config.json_path == "-" ? cerr : cout;
+    vector<BenchResult> results;
+    auto run = [&](const string& name, const function<void(size_t)>& op) {
+        if (!config.only.empty() && name.find(config.only) == string::npos) return;
+        results.push_back(runBenchmark(name, config.min_time, op));
+        printResult(table, results.back());
+    };
+
+    char header[200];
+    snprintf(header, sizeof(header), "%-30s %12s %12s %12s %10s %16s %12s", "benchmark", "mean", "p50", "p90", "ops", "throughput", "allocs/op");
+    table << header << endl;
+
+    // 3. 微基准
+    run("string_distance/typo", [&](size_t i) {
+        const auto& pair = typo_pairs[i % typo_pairs.size()];
+        g_sink = g_sink + database.calculateStringDistance(pair.first, pair.second);
+    });
+    run("string_distance/random", [&](size_t i) {
+        const auto& pair = random_pairs[i % random_pairs.size()];
+        g_sink = g_sink + database.calculateStringDistance(pair.first, pair.second);
+    });
+    run("parse/strings", [&](size_t i) {
+        g_sink = g_sink + parseFeatureList(splitCommaList(query_lines[i % query_lines.size()].first)).size();
+    });
+    vector<FeatureView> views_A, views_B;
+    run("parse/views", [&](size_t i) {
+        views_A.clear();
+        parseFeatureViews(query_lines[i % query_lines.size()].first, views_A);
+        g_sink = g_sink + views_A.size();
+    });
+    vector<Concept> sample_concepts;
+    for (uint32_t pos = 0; pos < snapshot->conceptCount() && sample_concepts.size() < 4096; pos += 1 + snapshot->conceptCount() / 4096) {
+        sample_concepts.push_back(snapshot->conceptAt(pos));
+    }
+    run("match_concept_exact", [&](size_t i) {
+        const Concept& concept = sample_concepts[(i * 7919) % sample_concepts.size()];
+        g_sink = g_sink + database.matchConceptExact(query_features[i % query_features.size()], concept).match_count;
+    });
+    run("match_exact/compact", [&](size_t i) {
+        QueryArenaScope arena_scope;
+        CompactMatchList matches(arena_scope.resource());
+        database.findMatchingConceptsCompact(*snapshot, query_features[i % query_features.size()], matches);
+        g_sink = g_sink + matches.size();
+    });
+    // 不走倒排列表的全量扫描，逐个比较CPU支持的特征ID内核
+    IdMatchKernel default_kernel = activeIdMatchKernel();
+    for (int kernel = 0; kernel < ID_KERNEL_COUNT; kernel++) {
+        if (!selectIdMatchKernel((IdMatchKernel)kernel)) continue;
+        run(string("scan_exact/") + idMatchKernelName((IdMatchKernel)kernel), [&](size_t i) {
+            QueryArenaScope arena_scope;
+            CompactMatchList matches(arena_scope.resource());
+            database.scanMatchingConceptsCompact(*snapshot, query_features[i % query_features.size()], matches);
+            g_sink = g_sink + matches.size();
+        });
+    }
+    selectIdMatchKernel(default_kernel);
+    run("match_exact/results", [&](size_t i) {
+        g_sink = g_sink + database.findMatchingConcepts(*snapshot, query_features[i % query_features.size()]).size();
+    });
+    run("match_fuzzy", [&](size_t i) {
+        g_sink = g_sink + database.findMatchingConcepts(query_features[i % query_features.size()], true, 0.6, 1).size();
+    });
+    run("find_by_value", [&](size_t i) {
+        const auto& features = query_features[i % query_features.size()];
+        g_sink = g_sink + database.findByValue(features[0].value).size();
+    });
+    // 全库遍历：一次性读成对象与分批流式读取
+    run("scan/get_all", [&](size_t) {
+        for (const auto& concept : database.getAllConcepts()) {
+            g_sink = g_sink + concept->feature_values.size();
+        }
+    });
+    run("scan/stream", [&](size_t) {
+        database.forEachConcept([](const Concept& concept) {
+            g_sink = g_sink + concept.feature_values.size();
+            return true;
+        });
+    });
+    // 启动：由数据库构建快照（流式读全部概念、编号、建索引）与映射导出的快照文件
+    run("snapshot/build", [&](size_t) {
+        g_sink = g_sink + database.buildSnapshot()->conceptCount();
+    });
+    string snapshot_file = config.db_path + ".snap";
+    if (database.exportSnapshot(snapshot_file)) {
+        run("snapshot/open", [&](size_t) {
+            string error;
+            g_sink = g_sink + openSnapshotFile(snapshot_file, false, error)->conceptCount();
+        });
+        run("snapshot/open_verified", [&](size_t) {
+            string error;
+            g_sink = g_sink + openSnapshotFile(snapshot_file, true, error)->conceptCount();
+        });
+    }
+    run("find_similar_values", [&](size_t i) {
+        const auto& features = query_features[i % query_features.size()];
+        g_sink = g_sink + database.findSimilarValues(features[0].value, 0.6).size();
+    });
+    run("recursive_match/small", [&](size_t i) {
+        g_sink = g_sink + small_database.recursiveMatch(small_query_features[i % small_query_features.size()], 2, 0.6).size();
+    });
+
+    // 参数优化：每次从默认参数开始，在主库上的训练样本上迭代
+    if (config.only.empty() || string("optimize_parameters").find(config.only) != string::npos) {
+        vector<SyntheticQuery> training = generator.generateQueries(concepts, config.training_samples, 3);
+        for (const SyntheticQuery& query : training) {
+            TrainingSample sample(query.expected, 1.0);
+            sample.features_A = toFeatures(query.a);
+            sample.features_B = toFeatures(query.b);
+            database.addTrainingSample(sample);
+        }
+    }
+    run("optimize_parameters", [&](size_t) {
+        publishParameters(getDefaultParameters(), "bench");
+        database.optimizeParameters(config.optimize_iterations, 0.01);
+    });
+    publishParameters(getDefaultParameters(), "bench");
+
+    // 4. 端到端查询
+    run("e2e/histogram_exact", [&](size_t i) {
+        g_sink = g_sink + database.computeMatchHistogram(query_features[i % query_features.size()],
+                                                         query_features[(i + 1) % query_features.size()]).total_matches;
+    });
+    run("e2e/similarity_exact", [&](size_t i) {
+        const SyntheticQuery& query = queries[i % queries.size()];
+        QueryContext context = makeQueryContext(query.a, query.b);
+        g_sink = g_sink + database.computeSimilarity(context).main_similarity;
+    });
+    run("e2e/similarity_views", [&](size_t i) {
+        const auto& lines = query_lines[i % query_lines.size()];
+        views_A.clear();
+        views_B.clear();
+        parseFeatureViews(lines.first, views_A);
+        parseFeatureViews(lines.second, views_B);
+        g_sink = g_sink + database.computeSimilarity(views_A, views_B, SimilarityOptions(), *getPublishedParameters()).main_similarity;
+    });
+    run("e2e/similarity_fuzzy/small", [&](size_t i) {
+        const SyntheticQuery& query = small_queries[i % small_queries.size()];
+        SimilarityOptions options;
+        options.use_fuzzy_matching = true;
+        options.max_recursive_depth = 1;
+        QueryContext context = makeQueryContext(query.a, query.b, options);
+        g_sink = g_sink + small_database.computeSimilarity(context).main_similarity;
+    });
+    run("e2e/topk10", [&](size_t i) {
+        g_sink = g_sink + database.findTopKConcepts(query_features[i % query_features.size()], 10).size();
+    });
+
+    // 匹配结果缓存：冷（每次先清空，含匹配和放入缓存）、热（重复查询）、两侧特征倒序（规范指纹相同）
+    database.setMatchCacheCapacity(MatchCache::DEFAULT_CAPACITY_MB << 20);
+    small_database.setMatchCacheCapacity(MatchCache::DEFAULT_CAPACITY_MB << 20);
+    vector<SyntheticQuery> reversed_queries = queries;
+    for (SyntheticQuery& query : reversed_queries) {
+        reverse(query.a.begin(), query.a.end());
+        reverse(query.b.begin(), query.b.end());
+    }
+    run("cache/similarity_exact_cold", [&](size_t i) {
+        const SyntheticQuery& query = queries[i % queries.size()];
+        database.clearMatchCache();
+        QueryContext context = makeQueryContext(query.a, query.b);
+        g_sink = g_sink + database.computeSimilarity(context).main_similarity;
+    });
+    run("cache/similarity_exact_warm", [&](size_t i) {
+        const SyntheticQuery& query = queries[i % queries.size()];
+        QueryContext context = makeQueryContext(query.a, query.b);
+        g_sink = g_sink + database.computeSimilarity(context).main_similarity;
+    });
+    run("cache/similarity_exact_reversed", [&](size_t i) {
+        const SyntheticQuery& query = reversed_queries[i % reversed_queries.size()];
+        QueryContext context = makeQueryContext(query.a, query.b);
+        g_sink = g_sink + database.computeSimilarity(context).main_similarity;
+    });
+    run("cache/similarity_fuzzy_warm/small", [&](size_t i) {
+        const SyntheticQuery& query = small_queries[i % small_queries.size()];
+        SimilarityOptions options;
+        options.use_fuzzy_matching = true;
+        options.max_recursive_depth = 1;
+        QueryContext context = makeQueryContext(query.a, query.b, options);
+        g_sink = g_sink + small_database.computeSimilarity(context).main_similarity;
+    });
+    MatchCacheStats cache_stats = database.matchCacheStats();
+    cerr << "匹配结果缓存: " << cache_stats.entries << " 项, " << cache_stats.bytes / 1024 << " KB, 命中率 "
+         << cache_stats.hitRate() * 100.0 << "%" << endl;
+
+    // 突发的相同查询：8个线程同时计算同一对模糊查询（缓存禁用），每次操作为整组完成的时间
+    small_database.setMatchCacheCapacity(0);
+    auto burst = [&](size_t i) {
+        const SyntheticQuery& query = small_queries[i % small_queries.size()];
+        SimilarityOptions options;
+        options.use_fuzzy_matching = true;
+        options.max_recursive_depth = 1;
+        double similarities[8];
+        vector<thread> threads;
+        for (int t = 0; t < 8; t++) {
+            threads.emplace_back([&, t]() {
+                QueryContext context = makeQueryContext(query.a, query.b, options);
+                similarities[t] = small_database.computeSimilarity(context).main_similarity;
+            });
+        }
+        for (thread& worker : threads) worker.join();
+        for (double similarity : similarities) g_sink = g_sink + similarity;
+    };
+    run("burst/similarity_fuzzy_x8/small", burst);
+    small_database.setSingleFlightEnabled(true);
+    run("burst/similarity_fuzzy_x8_coalesced/small", burst);
+    MatchFlightStats flight_stats = small_database.singleFlightStats();
+    cerr << "并发相同查询合并: 匹配 " << flight_stats.flights << " 次, 合并 " << flight_stats.coalesced << " 次, 省下匹配时间 "
+         << flight_stats.saved_ns / 1e6 << " 毫秒" << endl;
+
+    // 5. 输出
+    if (!config.json_path.empty()) {
+        string json = formatJson(config, results);
+        if (config.json_path == "-") {
+            cout << json;
+        } else {
+            ofstream file(config.json_path);
+            file << json;
+            if (!file.good()) {
+                cerr << "无法写出JSON结果 " << config.json_path << endl;
+                return 1;
+            }
+            cerr << "结果已写入 " << config.json_path << endl;
+        }
+    }
+    if (!config.compare_path.empty()) {
+        compareResults(config.compare_path, results);
+    }
+    if (config.trace) {
+        cerr << QueryProfiler::instance().formatText();
+    }
+    return 0;
+}
@@ -0,0 +1,691 @@
+// Approacher 差分测试：在随机生成的概念库和查询上，比较ConceptDatabase的优化实现与参考引擎（ReferenceEngine）
+// 每轮用不同的种子生成小概念库、查询对、参数表和模糊阈值，逐项检查两边的结果是否完全一致
+// 发现第一个不一致时，在保持不一致的前提下逐步删减查询特征、概念和概念特征，输出最小化的复现用例
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <memory>
+#include <functional>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <filesystem>
+#include <cmath>
+
+#include "/home/laplace/things/ConceptDatabase.hpp"
+#include "/home/laplace/things/ReferenceEngine.hpp"
+#include "/home/laplace/things/SyntheticLibrary.hpp"
+#include "/home/laplace/things/Logger.hpp"
+#include "/home/laplace/things/QueryTrace.hpp"
+
+using namespace std;
+
+// 差分测试配置
+struct DiffConfig {
+    int trials = 50;                 // 轮数（每轮一个新概念库）
+    uint64_t seed = 1;               // 第一轮的种子，之后每轮加1
+    size_t max_concepts = 60;        // 每轮概念库的最大概念数
+    size_t queries = 20;             // 每轮的查询对数
+    size_t recursive_concepts = 25;  // 递归匹配只在不超过该规模的库上检查（代价随库大小平方增长）
+    string only;                     // 只运行名称包含该子串的检查
+    string db_path = "/tmp/approacher-difftest-db";
+    string repro_dir = "/tmp/approacher-difftest-repro";
+    bool verbose = false;
+};
+
+// 一个测试用例：概念库、一对查询、参数表和模糊阈值
+struct DiffCase {
+    vector<SyntheticConcept> concepts;
+    vector<string> a;
+    vector<string> b;
+    unordered_map<string, double> params;
+    double fuzzy_threshold = 0.6;
+};
+
+// 一项检查：返回空串表示两边一致，否则返回差异描述
+struct DiffCheck {
+    string name;
+    bool small_library_only;  // 只在小概念库上运行
+    function<string(ConceptDatabase&, const ReferenceEngine&, const DiffCase&)> run;
+};
+
+bool buildDatabase(ConceptDatabase& database, const string& path, const vector<SyntheticConcept>& concepts) {
+    error_code ec;
+    filesystem::remove_all(path, ec);
+    if (!database.initialize(path)) {
+        return false;
+    }
+    string delta_path = path + ".delta";
+    if (!writeSyntheticConcepts(concepts, delta_path, true)) {
+        return false;
+    }
+    int added = database.applyDelta(delta_path);
+    filesystem::remove(delta_path, ec);
+    return added == (int)concepts.size();
+}
+
+vector<Concept> readConcepts(ConceptDatabase& database) {
+    vector<Concept> concepts;
+    database.forEachConcept([&concepts](const Concept& concept) {
+        concepts.push_back(concept);
+        return true;
+    });
+    return concepts;
+}
+
+string joinItems(const vector<string>& items) {
+    string joined;
+    for (size_t i = 0; i < items.size(); i++) {
+        if (i > 0) joined += ",";
+        joined += items[i];
+    }
+    return joined;
+}
+
+string formatDouble(double value) {
+    ostringstream out;
+    out.precision(17);
+    out << value;
+    return out.str();
+}
+
+string formatMatch(const MatchResult& match, bool with_indices) {
+    string text = to_string(match.concept_id) + ":" + to_string(match.match_count);
+    if (with_indices) {
+        text += "[";
+        for (size_t i = 0; i < match.matched_indices.size(); i++) {
+            if (i > 0) text += " ";
+            text += to_string(match.matched_indices[i]);
+        }
+        text += "]";
+    }
+    return text;
+}
+
+string formatMatches(const vector<MatchResult>& matches, bool with_indices) {
+    string text = "{";
+    for (size_t i = 0; i < matches.size(); i++) {
+        if (i > 0) text += ", ";
+        text += formatMatch(matches[i], with_indices);
+    }
+    return text + "}";
+}
+
+// 比较两组匹配结果；递归匹配同一概念同分时保留哪一次匹配的下标未作规定，只比较ID和匹配数
+string compareMatches(const string& label, const vector<MatchResult>& actual, const vector<MatchResult>& expected, bool with_indices) {
+    bool same = actual.size() == expected.size();
+    for (size_t i = 0; same && i < actual.size(); i++) {
+        same = actual[i].concept_id == expected[i].concept_id && actual[i].match_count == expected[i].match_count &&
+               (!with_indices || actual[i].matched_indices == expected[i].matched_indices);
+    }
+    if (same) return "";
+    return label + "\n    优化实现: " + formatMatches(actual, with_indices) + "\n    参考实现: " + formatMatches(expected, with_indices);
+}
+
+// 浮点结果按相对误差1e-9比较（累加顺序相同，正常情况下应完全相等）
+string compareValue(const string& label, double actual, double expected) {
+    if (fabs(actual - expected) <= 1e-9 * max(1.0, fabs(expected))) return "";
+    return label + ": 优化实现 " + formatDouble(actual) + "，参考实现 " + formatDouble(expected);
+}
+
+string compareSimilarity(const SimilarityResult& actual, const SimilarityResult& expected) {
+    string detail = compareValue("partial_a_to_b", actual.partial_a_to_b, expected.partial_a_to_b);
+    if (detail.empty()) detail = compareValue("partial_b_to_a", actual.partial_b_to_a, expected.partial_b_to_a);
+    if (detail.empty()) detail = compareValue("main_similarity", actual.main_similarity, expected.main_similarity);
+    if (detail.empty() && (actual.matches_A_count != expected.matches_A_count || actual.matches_B_count != expected.matches_B_count ||
+                           actual.total_matches != expected.total_matches)) {
+        detail = "匹配数 (A, B, 重合): 优化实现 (" + to_string(actual.matches_A_count) + ", " + to_string(actual.matches_B_count) + ", " +
+                 to_string(actual.total_matches) + ")，参考实现 (" + to_string(expected.matches_A_count) + ", " +
+                 to_string(expected.matches_B_count) + ", " + to_string(expected.total_matches) + ")";
+    }
+    for (int i = 0; detail.empty() && i < 5; i++) {
+        for (int j = 0; detail.empty() && j < 5; j++) {
+            if (actual.histogram.level_counts[i][j] != expected.histogram.level_counts[i][j]) {
+                detail = "直方图 c" + to_string(i + 1) + to_string(j + 1) + ": 优化实现 " + to_string(actual.histogram.level_counts[i][j]) +
+                         "，参考实现 " + to_string(expected.histogram.level_counts[i][j]);
+            }
+        }
+    }
+    return detail;
+}
+
+// 查询两侧的所有特征值
+vector<string> queryValues(const DiffCase& c) {
+    vector<string> values;
+    for (const Feature& feature : parseFeatureList(c.a)) values.push_back(feature.value);
+    for (const Feature& feature : parseFeatureList(c.b)) values.push_back(feature.value);
+    return values;
+}
+
+SimilarityResult computeWithContext(ConceptDatabase& database, const DiffCase& c, const SimilarityOptions& options) {
+    QueryContext context = makeQueryContext(c.a, c.b, options);
+    context.params = make_shared<const unordered_map<string, double>>(c.params);
+    return database.computeSimilarity(context);
+}
+
+vector<DiffCheck> buildChecks() {
+    vector<DiffCheck> checks;
+
+    checks.push_back({"string_distance", false, [](ConceptDatabase& database, const ReferenceEngine& reference, const DiffCase& c) {
+        vector<string> values = queryValues(c);
+        vector<string> targets = values;
+        for (const Concept& concept : reference.getConcepts()) {
+            targets.insert(targets.end(), concept.feature_values.begin(), concept.feature_values.end());
+        }
+        for (const string& value : values) {
+            for (const string& target : targets) {
+                int actual = database.calculateStringDistance(value, target);
+                int expected = ReferenceEngine::stringDistance(value, target);
+                if (actual != expected) {
+                    return "distance(\"" + value + "\", \"" + target + "\"): 优化实现 " + to_string(actual) + "，参考实现 " + to_string(expected);
+                }
+                string detail = compareValue("similarity(\"" + value + "\", \"" + target + "\")",
+                                             database.calculateStringSimilarity(value, target), ReferenceEngine::stringSimilarity(value, target));
+                if (!detail.empty()) return detail;
+            }
+        }
+        return string();
+    }});
+
+    checks.push_back({"match_concept_exact", false, [](ConceptDatabase& database, const ReferenceEngine& reference, const DiffCase& c) {
+        for (const vector<string>* side : {&c.a, &c.b}) {
+            vector<Feature> features = parseFeatureList(*side);
+            for (const Concept& concept : reference.getConcepts()) {
+                string detail = compareMatches("概念" + to_string(concept.id) + " 查询[" + joinItems(*side) + "]",
+                                               {database.matchConceptExact(features, concept)},
+                                               {ReferenceEngine::matchConceptExact(features, concept)}, true);
+                if (!detail.empty()) return detail;
+            }
+        }
+        return string();
+    }});
+
+    checks.push_back({"match_concept_fuzzy", false, [](ConceptDatabase& database, const ReferenceEngine& reference, const DiffCase& c) {
+        for (const vector<string>* side : {&c.a, &c.b}) {
+            vector<Feature> features = parseFeatureList(*side);
+            for (const Concept& concept : reference.getConcepts()) {
+                unique_ptr<Concept> owned(new Concept(concept));
+                string detail = compareMatches("概念" + to_string(concept.id) + " 查询[" + joinItems(*side) + "]",
+                                               {database.matchConceptFuzzy(features, owned, c.fuzzy_threshold)},
+                                               {ReferenceEngine::matchConceptFuzzy(features, concept, c.fuzzy_threshold)}, true);
+                if (!detail.empty()) return detail;
+            }
+        }
+        return string();
+    }});
+
+    checks.push_back({"find_matching_exact", false, [](ConceptDatabase& database, const ReferenceEngine& reference, const DiffCase& c) {
+        for (const vector<string>* side : {&c.a, &c.b}) {
+            vector<Feature> features = parseFeatureList(*side);
+            string detail = compareMatches("查询[" + joinItems(*side) + "]", database.findMatchingConcepts(features),
+                                           reference.findMatchingConcepts(features), true);
+            if (!detail.empty()) return detail;
+        }
+        return string();
+    }});
+
+    // 不走倒排列表的全量扫描（特征ID内核，APPROACHER_SIMD选择实现）
+    checks.push_back({"scan_matching_exact", false, [](ConceptDatabase& database, const ReferenceEngine& reference, const DiffCase& c) {
+        auto snapshot = database.getSnapshot();
+        for (const vector<string>* side : {&c.a, &c.b}) {
+            vector<Feature> features = parseFeatureList(*side);
+            QueryArenaScope arena_scope;
+            CompactMatchList compact(arena_scope.resource());
+            database.scanMatchingConceptsCompact(*snapshot, features, compact);
+            vector<MatchResult> actual;
+            for (const CompactMatch& match : compact) {
+                MatchResult result(snapshot->conceptId(match.position), match.match_count);
+                for (size_t i = 0; i < features.size(); i++) {
+                    if (match.isMatched(i)) result.matched_indices.push_back(i);
+                }
+                actual.push_back(result);
+            }
+            string detail = compareMatches("查询[" + joinItems(*side) + "]", actual, reference.findMatchingConcepts(features), true);
+            if (!detail.empty()) return detail;
+        }
+        return string();
+    }});
+
+    checks.push_back({"find_matching_fuzzy", false, [](ConceptDatabase& database, const ReferenceEngine& reference, const DiffCase& c) {
+        for (const vector<string>* side : {&c.a, &c.b}) {
+            vector<Feature> features = parseFeatureList(*side);
+            string detail = compareMatches("查询[" + joinItems(*side) + "]", database.findMatchingConcepts(features, true, c.fuzzy_threshold, 1),
+                                           reference.fuzzyMatch(features, c.fuzzy_threshold), true);
+            if (!detail.empty()) return detail;
+        }
+        return string();
+    }});
+
+    checks.push_back({"similar_values", false, [](ConceptDatabase& database, const ReferenceEngine& reference, const DiffCase& c) {
+        for (const string& value : queryValues(c)) {
+            auto actual = database.findSimilarValues(value, c.fuzzy_threshold);
+            auto expected = reference.findSimilarValues(value, c.fuzzy_threshold);
+            if (actual != expected) {
+                auto format = [](const vector<pair<string, double>>& values) {
+                    string text;
+                    for (const auto& entry : values) text += " " + entry.first + "=" + formatDouble(entry.second);
+                    return text;
+                };
+                return "值\"" + value + "\"\n    优化实现:" + format(actual) + "\n    参考实现:" + format(expected);
+            }
+        }
+        return string();
+    }});
+
+    checks.push_back({"recursive_match", true, [](ConceptDatabase& database, const ReferenceEngine& reference, const DiffCase& c) {
+        for (const vector<string>* side : {&c.a, &c.b}) {
+            vector<Feature> features = parseFeatureList(*side);
+            string detail = compareMatches("查询[" + joinItems(*side) + "]", database.recursiveMatch(features, 2, c.fuzzy_threshold),
+                                           reference.recursiveMatch(features, 2, c.fuzzy_threshold), false);
+            if (!detail.empty()) return detail;
+        }
+        return string();
+    }});
+
+    checks.push_back({"main_similarity", false, [](ConceptDatabase& database, const ReferenceEngine& reference, const DiffCase& c) {
+        vector<Feature> features_A = parseFeatureList(c.a);
+        vector<Feature> features_B = parseFeatureList(c.b);
+        return compareValue("main_similarity", database.calculateMainSimilarity(features_A, features_B, c.params),
+                            reference.calculateMainSimilarity(features_A, features_B, c.params));
+    }});
+
+    // 相似度检查走QueryContext入口（REPL、批量模式和服务使用的路径）
+    auto similarity_check = [](bool fuzzy, int depth) {
+        return [fuzzy, depth](ConceptDatabase& database, const ReferenceEngine& reference, const DiffCase& c) {
+            SimilarityOptions options;
+            options.use_fuzzy_matching = fuzzy;
+            options.fuzzy_threshold = c.fuzzy_threshold;
+            options.max_recursive_depth = depth;
+            return compareSimilarity(computeWithContext(database, c, options),
+                                     reference.computeSimilarity(parseFeatureList(c.a), parseFeatureList(c.b), options, c.params));
+        };
+    };
+    checks.push_back({"similarity_exact", false, similarity_check(false, 1)});
+    checks.push_back({"similarity_fuzzy", false, similarity_check(true, 1)});
+    checks.push_back({"similarity_recursive", true, similarity_check(true, 2)});
+
+    // 匹配结果缓存：两侧特征倒序后再算（规范指纹与上面相同，会查到上面放入的集合；
+    // 结果与顺序有关时必须按有序指纹查找，得到倒序输入自己的结果）
+    auto reversed_check = [](bool fuzzy, int depth) {
+        return [fuzzy, depth](ConceptDatabase& database, const ReferenceEngine& reference, const DiffCase& c) {
+            SimilarityOptions options;
+            options.use_fuzzy_matching = fuzzy;
+            options.fuzzy_threshold = c.fuzzy_threshold;
+            options.max_recursive_depth = depth;
+            DiffCase reversed = c;
+            reverse(reversed.a.begin(), reversed.a.end());
+            reverse(reversed.b.begin(), reversed.b.end());
+            return compareSimilarity(computeWithContext(database, reversed, options),
+                                     reference.computeSimilarity(parseFeatureList(reversed.a), parseFeatureList(reversed.b), options, c.params));
+        };
+    };
+    checks.push_back({"reversed_exact", false, reversed_check(false, 1)});
+    checks.push_back({"reversed_fuzzy", false, reversed_check(true, 1)});
+    checks.push_back({"reversed_recursive", true, reversed_check(true, 2)});
+
+    // 并发的相同查询：清空缓存后多个线程同时计算，合并后每个线程得到的结果都要与参考实现一致
+    auto concurrent_check = [](bool fuzzy, int depth) {
+        return [fuzzy, depth](ConceptDatabase& database, const ReferenceEngine& reference, const DiffCase& c) {
+            SimilarityOptions options;
+            options.use_fuzzy_matching = fuzzy;
+            options.fuzzy_threshold = c.fuzzy_threshold;
+            options.max_recursive_depth = depth;
+            SimilarityResult expected = reference.computeSimilarity(parseFeatureList(c.a), parseFeatureList(c.b), options, c.params);
+            database.clearMatchCache();
+            vector<SimilarityResult> actual(4);
+            vector<thread> threads;
+            for (size_t t = 0; t < actual.size(); t++) {
+                threads.emplace_back([&, t]() { actual[t] = computeWithContext(database, c, options); });
+            }
+            for (thread& worker : threads) worker.join();
+            for (size_t t = 0; t < actual.size(); t++) {
+                string detail = compareSimilarity(actual[t], expected);
+                if (!detail.empty()) return "线程" + to_string(t) + ": " + detail;
+            }
+            return string();
+        };
+    };
+    checks.push_back({"concurrent_fuzzy", false, concurrent_check(true, 1)});
+    checks.push_back({"concurrent_recursive", true, concurrent_check(true, 2)});
+
+    // 特征视图入口（服务端和批量流水线使用）：输入拼成一行逗号分隔文本后在视图上解析
+    checks.push_back({"similarity_views", false, [](ConceptDatabase& database, const ReferenceEngine& reference, const DiffCase& c) {
+        string line_a = joinItems(c.a), line_b = joinItems(c.b);
+        vector<FeatureView> views_A, views_B;
+        parseFeatureViews(line_a, views_A);
+        parseFeatureViews(line_b, views_B);
+        SimilarityOptions options;
+        return compareSimilarity(database.computeSimilarity(views_A, views_B, options, c.params),
+                                 reference.computeSimilarity(parseFeatureList(c.a), parseFeatureList(c.b), options, c.params));
+    }});
+
+    // Top-K检索：与逐个概念精确匹配、按同一公式评分后排序的前k个逐项比较（k取1、3、概念数和超过概念数）
+    // a、b之外再查a+b+a，使无键特征超过10个的查询也被覆盖
+    checks.push_back({"topk", false, [](ConceptDatabase& database, const ReferenceEngine& reference, const DiffCase& c) {
+        const vector<Concept>& concepts = reference.getConcepts();
+        vector<string> combined = c.a;
+        combined.insert(combined.end(), c.b.begin(), c.b.end());
+        combined.insert(combined.end(), c.a.begin(), c.a.end());
+        for (const vector<string>* side : {&c.a, &c.b, (const vector<string>*)&combined}) {
+            vector<Feature> features = parseFeatureList(*side);
+            vector<double> weights;
+            for (const Feature& feature : features) {
+                size_t document_frequency = 0;
+                for (const Concept& concept : concepts) {
+                    for (size_t j = 0; j < concept.feature_values.size(); j++) {
+                        if (concept.feature_values[j] == feature.value && (feature.key.empty() || concept.feature_keys[j] == feature.key)) {
+                            document_frequency++;
+                            break;
+                        }
+                    }
+                }
+                weights.push_back(log(1.0 + (double)concepts.size() / (document_frequency > 0 ? document_frequency : 1.0)));
+            }
+            vector<ScoredConcept> expected;
+            for (const Concept& concept : concepts) {
+                MatchResult match = ReferenceEngine::matchConceptExact(features, concept);
+                if (match.match_count <= 0) continue;
+                double matched_weight = 0.0;
+                for (int index : match.matched_indices) matched_weight += weights[index];
+                size_t value_count = concept.feature_values.size();
+                double coverage = value_count == 0 ? 1.0 : min(1.0, (double)match.match_count / value_count);
+                ScoredConcept scored;
+                scored.concept_id = concept.id;
+                scored.score = matched_weight * sqrt(coverage);
+                scored.match_count = match.match_count;
+                expected.push_back(scored);
+            }
+            sort(expected.begin(), expected.end(), [](const ScoredConcept& a, const ScoredConcept& b) {
+                if (a.score != b.score) return a.score > b.score;
+                return a.concept_id < b.concept_id;
+            });
+
+            for (size_t k : {(size_t)1, (size_t)3, concepts.size(), concepts.size() + 5}) {
+                vector<ScoredConcept> actual = database.findTopKConcepts(features, k);
+                size_t expected_count = min(k, expected.size());
+                string label = "查询[" + joinItems(*side) + "] k=" + to_string(k);
+                if (actual.size() != expected_count) {
+                    return label + ": 优化实现 " + to_string(actual.size()) + " 个结果，逐个评分 " + to_string(expected_count) + " 个";
+                }
+                for (size_t i = 0; i < expected_count; i++) {
+                    string detail = compareValue(label + " 第" + to_string(i + 1) + "名得分", actual[i].score, expected[i].score);
+                    if (detail.empty() && (actual[i].concept_id != expected[i].concept_id || actual[i].match_count != expected[i].match_count)) {
+                        detail = label + " 第" + to_string(i + 1) + "名: 优化实现 " + to_string(actual[i].concept_id) + ":" +
+                                 to_string(actual[i].match_count) + "，逐个评分 " + to_string(expected[i].concept_id) + ":" +
+                                 to_string(expected[i].match_count);
+                    }
+                    if (!detail.empty()) return detail;
+                }
+            }
+        }
+        return string();
+    }});
+
+    return checks;
+}
+
+// 每轮的概念库配置：小词表让键值大量重复，复合词和无键特征比例较高，以覆盖复合词匹配和重合度等级的各种组合
+SyntheticConfig trialLibraryConfig(const DiffConfig& config, uint64_t trial_seed) {
+    SyntheticRandom random(trial_seed ^ 0xD1FF7E57ULL);
+    SyntheticConfig library;
+    library.concept_count = 3 + random.below(max<size_t>(1, config.max_concepts - 2));
+    library.min_features = 1;
+    library.max_features = 1 + (int)random.below(6);
+    library.key_vocabulary = 2 + random.below(8);
+    library.value_vocabulary = 8 + random.below(60);
+    library.zipf_exponent = 0.8 + random.uniform() * 0.6;
+    library.compound_rate = 0.1 + random.uniform() * 0.3;
+    library.typo_rate = 0.3;
+    library.keyless_rate = 0.6;
+    library.seed = trial_seed;
+    return library;
+}
+
+// 给查询加入边界情况：重复特征、库中没有的值、空值
+void mutateQuery(vector<string>& items, const SyntheticLibraryGenerator& generator, SyntheticRandom& random) {
+    if (!items.empty() && random.chance(0.2)) {
+        items.push_back(items[random.below(items.size())]);
+    }
+    if (random.chance(0.15)) {
+        const vector<string>& words = generator.valueWords();
+        items.push_back(SyntheticLibraryGenerator::addTypo(words[random.below(words.size())], random));
+    }
+    if (random.chance(0.05)) {
+        items.push_back(generator.keyWords()[0] + ":");
+    }
+    if (items.size() > 1 && random.chance(0.2)) {
+        swap(items[0], items[random.below(items.size())]);
+    }
+}
+
+unordered_map<string, double> trialParameters(SyntheticRandom& random) {
+    unordered_map<string, double> params = getDefaultParameters();
+    if (random.chance(0.5)) {
+        for (auto& entry : params) {
+            if (entry.first.size() == 3 && entry.first[0] == 'p') {
+                entry.second = round(random.uniform() * 2000.0) / 1000.0;
+            }
+        }
+    }
+    return params;
+}
+
+// 在新数据库上重跑一项检查，返回是否仍不一致
+bool reproduces(const DiffCheck& check, const DiffCase& c, const DiffConfig& config, string& detail) {
+    ConceptDatabase database;
+    if (!buildDatabase(database, config.db_path + "-min", c.concepts)) {
+        return false;
+    }
+    ReferenceEngine reference(readConcepts(database));
+    detail = check.run(database, reference, c);
+    return !detail.empty();
+}
+
+// 最小化复现用例：依次尝试删除查询特征、成块删除概念、删除概念特征，以及恢复默认参数，
+// 只保留删除后仍不一致的修改，直到一整遍没有任何进展
+DiffCase minimizeCase(const DiffCheck& check, DiffCase c, const DiffConfig& config, string& detail, int& attempts) {
+    const int max_attempts = 3000;
+    attempts = 0;
+    auto try_case = [&](const DiffCase& candidate) {
+        if (attempts >= max_attempts) return false;
+        attempts++;
+        string candidate_detail;
+        if (!reproduces(check, candidate, config, candidate_detail)) return false;
+        detail = candidate_detail;
+        return true;
+    };
+
+    bool progress = true;
+    while (progress && attempts < max_attempts) {
+        progress = false;
+
+        if (c.params != getDefaultParameters()) {
+            DiffCase candidate = c;
+            candidate.params = getDefaultParameters();
+            if (try_case(candidate)) { c = candidate; progress = true; }
+        }
+
+        for (vector<string> DiffCase::*side : {&DiffCase::a, &DiffCase::b}) {
+            for (size_t i = 0; (c.*side).size() > 1 && i < (c.*side).size();) {
+                DiffCase candidate = c;
+                (candidate.*side).erase((candidate.*side).begin() + i);
+                if (try_case(candidate)) { c = candidate; progress = true; }
+                else i++;
+            }
+        }
+
+        for (size_t chunk = max<size_t>(1, c.concepts.size() / 2); chunk >= 1; chunk /= 2) {
+            for (size_t start = 0; c.concepts.size() > 1 && start < c.concepts.size();) {
+                size_t end = min(c.concepts.size(), start + chunk);
+                if (end - start == c.concepts.size()) break;
+                DiffCase candidate = c;
+                candidate.concepts.erase(candidate.concepts.begin() + start, candidate.concepts.begin() + end);
+                if (try_case(candidate)) { c = candidate; progress = true; }
+                else start = end;
+            }
+            if (chunk == 1) break;
+        }
+
+        for (size_t k = 0; k < c.concepts.size(); k++) {
+            for (size_t f = 0; c.concepts[k].keys.size() > 1 && f < c.concepts[k].keys.size();) {
+                DiffCase candidate = c;
+                candidate.concepts[k].keys.erase(candidate.concepts[k].keys.begin() + f);
+                candidate.concepts[k].values.erase(candidate.concepts[k].values.begin() + f);
+                if (try_case(candidate)) { c = candidate; progress = true; }
+                else f++;
+            }
+        }
+    }
+    return c;
+}
+
+// 打印并写出复现用例：concepts.txt（loadFromFile格式）、query.tsv（A<TAB>B）、parameters.txt、case.txt（说明）
+void reportCase(const DiffCheck& check, const DiffCase& c, const string& detail, const DiffConfig& config, uint64_t trial_seed) {
+    ostringstream report;
+    report << "检查项: " << check.name << endl;
+    report << "种子: " << trial_seed << "（--seed " << trial_seed << " --trials 1 可重现原始用例）" << endl;
+    report << "模糊阈值: " << c.fuzzy_threshold << endl;
+    report << "概念库 (" << c.concepts.size() << " 个概念):" << endl;
+    for (size_t i = 0; i < c.concepts.size(); i++) {
+        report << "  " << (i + 1) << ".[";
+        for (size_t j = 0; j < c.concepts[i].keys.size(); j++) {
+            report << (j > 0 ? "," : "") << c.concepts[i].keys[j] << ":" << c.concepts[i].values[j];
+        }
+        report << "]" << endl;
+    }
+    report << "A: " << joinItems(c.a) << endl;
+    report << "B: " << joinItems(c.b) << endl;
+    if (c.params != getDefaultParameters()) {
+        vector<pair<string, double>> sorted_params(c.params.begin(), c.params.end());
+        sort(sorted_params.begin(), sorted_params.end());
+        report << "参数:";
+        for (const auto& param : sorted_params) report << " " << param.first << "=" << param.second;
+        report << endl;
+    }
+    report << "差异: " << detail << endl;
+    cout << report.str();
+
+    error_code ec;
+    filesystem::create_directories(config.repro_dir, ec);
+    writeSyntheticConcepts(c.concepts, config.repro_dir + "/concepts.txt", false);
+    ofstream(config.repro_dir + "/query.tsv") << joinItems(c.a) << "\t" << joinItems(c.b) << "\n";
+    ofstream params_file(config.repro_dir + "/parameters.txt");
+    vector<pair<string, double>> sorted_params(c.params.begin(), c.params.end());
+    sort(sorted_params.begin(), sorted_params.end());
+    for (const auto& param : sorted_params) params_file << param.first << "=" << param.second << "\n";
+    ofstream(config.repro_dir + "/case.txt") << report.str();
+    cout << "复现用例已写入 " << config.repro_dir << "/" << endl;
+}
+
+void printUsage() {
+    cout << "用法: approacher_difftest [--trials N] [--seed n] [--concepts 最大概念数] [--queries N]" << endl;
+    cout << "                          [--recursive-concepts N] [--only 检查项子串] [--db 目录] [--repro 目录] [--verbose]" << endl;
+}
+
+int main(int argc, char* argv[]) {
+    DiffConfig config;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--trials" && has_value) config.trials = max(1, atoi(argv[++i]));
+        else if (arg == "--seed" && has_value) config.seed = strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--concepts" && has_value) config.max_concepts = max(3L, atol(argv[++i]));
+        else if (arg == "--queries" && has_value) config.queries = max(1L, atol(argv[++i]));
+        else if (arg == "--recursive-concepts" && has_value) config.recursive_concepts = atol(argv[++i]);
+        else if (arg == "--only" && has_value) config.only = argv[++i];
+        else if (arg == "--db" && has_value) config.db_path = argv[++i];
+        else if (arg == "--repro" && has_value) config.repro_dir = argv[++i];
+        else if (arg == "--verbose") config.verbose = true;
+        else {
+            printUsage();
+            return arg == "--help" ? 0 : 1;
+        }
+    }
+
+    Logger::instance().setLevel(LOG_LEVEL_WARN);
+    Logger::instance().setStderrOnly(true);
+    QueryProfiler::instance().setEnabled(false);
+
+    vector<DiffCheck> checks;
+    for (DiffCheck& check : buildChecks()) {
+        if (config.only.empty() || check.name.find(config.only) != string::npos) {
+            checks.push_back(check);
+        }
+    }
+    if (checks.empty()) {
+        cerr << "没有名称包含 \"" << config.only << "\" 的检查项" << endl;
+        return 1;
+    }
+
+    auto start = chrono::steady_clock::now();
+    vector<size_t> check_counts(checks.size(), 0);
+    size_t total_queries = 0;
+
+    for (int trial = 0; trial < config.trials; trial++) {
+        uint64_t trial_seed = config.seed + trial;
+        SyntheticConfig library = trialLibraryConfig(config, trial_seed);
+        SyntheticLibraryGenerator generator(library);
+        vector<SyntheticConcept> concepts = generator.generateConcepts();
+        vector<SyntheticQuery> queries = generator.generateQueries(concepts, config.queries);
+
+        SyntheticRandom random(trial_seed ^ 0x0A11CE5ULL);
+        unordered_map<string, double> params = trialParameters(random);
+        // 常用阈值，加上边界值0（相似度为0的值不算匹配）和一个随机阈值
+        static const double thresholds[] = {0.0, 0.5, 0.6, 0.7, 0.8, -1.0};
+        double fuzzy_threshold = thresholds[random.below(6)];
+        if (fuzzy_threshold < 0) fuzzy_threshold = random.uniform();
+
+        ConceptDatabase database;
+        if (!buildDatabase(database, config.db_path, concepts)) {
+            cerr << "建立测试数据库失败: " << config.db_path << endl;
+            return 1;
+        }
+        ReferenceEngine reference(readConcepts(database));
+        bool small_library = concepts.size() <= config.recursive_concepts;
+
+        if (config.verbose) {
+            cout << "第 " << (trial + 1) << " 轮: 种子 " << trial_seed << ", " << concepts.size() << " 个概念, "
+                 << queries.size() << " 个查询, 阈值 " << fuzzy_threshold << endl;
+        }
+
+        for (SyntheticQuery& query : queries) {
+            DiffCase c;
+            c.concepts = concepts;
+            c.a = query.a;
+            c.b = query.b;
+            mutateQuery(c.a, generator, random);
+            mutateQuery(c.b, generator, random);
+            c.params = params;
+            c.fuzzy_threshold = fuzzy_threshold;
+            total_queries++;
+
+            for (size_t k = 0; k < checks.size(); k++) {
+                const DiffCheck& check = checks[k];
+                if (check.small_library_only && !small_library) continue;
+                check_counts[k]++;
+
+                string detail = check.run(database, reference, c);
+                if (detail.empty()) continue;
+
+                cout << "发现不一致（第 " << (trial + 1) << " 轮，检查项 " << check.name << "）:" << endl;
+                cout << "  " << detail << endl;
+                cout << "最小化复现用例..." << endl;
+                int attempts = 0;
+                DiffCase minimized = minimizeCase(check, c, config, detail, attempts);
+                cout << "（尝试 " << attempts << " 次，概念 " << c.concepts.size() << " → " << minimized.concepts.size()
+                     << "，查询特征 " << c.a.size() + c.b.size() << " → " << minimized.a.size() + minimized.b.size() << "）" << endl;
+                reportCase(check, minimized, detail, config, trial_seed);
+                return 1;
+            }
+        }
+    }
+
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cout << "全部一致: " << config.trials << " 轮, " << total_queries << " 个查询对, 耗时 " << seconds << " 秒" << endl;
+    for (size_t k = 0; k < checks.size(); k++) {
+        cout << "  " << checks[k].name << ": " << check_counts[k] << " 次" << endl;
+    }
+    return 0;
+}
@@ -0,0 +1,245 @@
+// Approacher 服务压测客户端
+// 多个连接并发向approacher_server发送similarity请求（每个连接保持固定数量的在途请求），
+// 统计吞吐量和延迟分布
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <cstring>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "/home/laplace/things/SimpleJson.hpp"
+
+using namespace std;
+
+// 压测配置
+struct LoadConfig {
+    string socket_path = "/tmp/approacher.sock";
+    string pairs_file;             // TSV文件，每行 A<TAB>B；为空时使用内置特征对
+    int connections = 4;           // 并发连接数
+    long total_requests = 100000;  // 总请求数
+    int pipeline_depth = 16;       // 每个连接的在途请求数
+    string op = "similarity";      // similarity / match / topk
+};
+
+// 单个连接的压测结果
+struct ConnectionResult {
+    long completed = 0;
+    long errors = 0;
+    vector<double> latencies_us;
+};
+
+// 连接到服务端，失败返回-1
+int connectToServer(const string& path) {
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+    if (connect(fd, (sockaddr*)&address, sizeof(address)) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+bool sendAll(int fd, const string& data) {
+    size_t written = 0;
+    while (written < data.size()) {
+        ssize_t n = send(fd, data.data() + written, data.size() - written, MSG_NOSIGNAL);
+        if (n <= 0) return false;
+        written += n;
+    }
+    return true;
+}
+
+// 构造第index个请求
+string buildRequest(const LoadConfig& config, const vector<pair<string, string>>& pairs, long index) {
+    const auto& item = pairs[index % pairs.size()];
+    string request = "{\"id\":" + to_string(index) + ",\"op\":\"" + config.op + "\",";
+    if (config.op == "similarity") {
+        request += "\"a\":" + jsonEscape(item.first) + ",\"b\":" + jsonEscape(item.second);
+    } else {
+        request += "\"features\":" + jsonEscape(item.first) + ",\"k\":10,\"limit\":10";
+    }
+    request += "}\n";
+    return request;
+}
+
+// 在一个连接上发送[first, last)范围内的请求
+void runConnection(const LoadConfig& config, const vector<pair<string, string>>& pairs,
+                   long first, long last, ConnectionResult& result) {
+    int fd = connectToServer(config.socket_path);
+    if (fd < 0) {
+        result.errors = last - first;
+        return;
+    }
+
+    // 按请求序号记录发送时间（响应可能乱序，按id对应）
+    vector<chrono::steady_clock::time_point> send_times(last - first);
+    result.latencies_us.reserve(last - first);
+
+    long next_to_send = first;
+    long in_flight = 0;
+    string pending;
+    char buffer[65536];
+
+    auto send_more = [&]() {
+        string batch;
+        while (in_flight < config.pipeline_depth && next_to_send < last) {
+            send_times[next_to_send - first] = chrono::steady_clock::now();
+            batch += buildRequest(config, pairs, next_to_send);
+            next_to_send++;
+            in_flight++;
+        }
+        return batch.empty() || sendAll(fd, batch);
+    };
+
+    if (!send_more()) {
+        result.errors = last - first;
+        close(fd);
+        return;
+    }
+
+    while (result.completed + result.errors < last - first) {
+        ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+        if (n <= 0) {
+            result.errors = last - first - result.completed;
+            break;
+        }
+        pending.append(buffer, n);
+
+        size_t begin = 0;
+        while (true) {
+            size_t newline = pending.find('\n', begin);
+            if (newline == string::npos) break;
+            string line = pending.substr(begin, newline - begin);
+            begin = newline + 1;
+
+            JsonValue response;
+            string error;
+            JsonParser parser(line);
+            const JsonValue* id = nullptr;
+            const JsonValue* ok = nullptr;
+            if (parser.parse(response, error)) {
+                id = response.get("id");
+                ok = response.get("ok");
+            }
+
+            long index = id && id->isNumber() ? (long)id->number_value : -1;
+            if (index >= first && index < last) {
+                double us = chrono::duration<double, micro>(chrono::steady_clock::now() - send_times[index - first]).count();
+                result.latencies_us.push_back(us);
+            }
+            if (ok && ok->bool_value) {
+                result.completed++;
+            } else {
+                result.errors++;
+            }
+            in_flight--;
+        }
+        pending.erase(0, begin);
+
+        if (!send_more()) {
+            result.errors = last - first - result.completed;
+            break;
+        }
+    }
+
+    close(fd);
+}
+
+// 读取TSV特征对
+vector<pair<string, string>> loadPairs(const string& filename) {
+    vector<pair<string, string>> pairs;
+    ifstream file(filename);
+    string line;
+    while (getline(file, line)) {
+        size_t tab = line.find('\t');
+        if (tab == string::npos) continue;
+        size_t second_tab = line.find('\t', tab + 1);
+        pairs.emplace_back(line.substr(0, tab), line.substr(tab + 1, second_tab == string::npos ? string::npos : second_tab - tab - 1));
+    }
+    return pairs;
+}
+
+double percentile(const vector<double>& sorted_values, double p) {
+    if (sorted_values.empty()) return 0.0;
+    size_t index = min(sorted_values.size() - 1, (size_t)(p * sorted_values.size()));
+    return sorted_values[index];
+}
+
+void printUsage() {
+    cout << "用法: approacher_loadgen [--socket 路径] [--pairs 文件.tsv] [--connections N]" << endl;
+    cout << "                         [--requests N] [--pipeline N] [--op similarity|match|topk]" << endl;
+}
+
+int main(int argc, char* argv[]) {
+    LoadConfig config;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--socket" && has_value) config.socket_path = argv[++i];
+        else if (arg == "--pairs" && has_value) config.pairs_file = argv[++i];
+        else if (arg == "--connections" && has_value) config.connections = max(1, atoi(argv[++i]));
+        else if (arg == "--requests" && has_value) config.total_requests = max(1L, atol(argv[++i]));
+        else if (arg == "--pipeline" && has_value) config.pipeline_depth = max(1, atoi(argv[++i]));
+        else if (arg == "--op" && has_value) config.op = argv[++i];
+        else {
+            printUsage();
+            return arg == "--help" ? 0 : 1;
+        }
+    }
+
+    vector<pair<string, string>> pairs;
+    if (!config.pairs_file.empty()) {
+        pairs = loadPairs(config.pairs_file);
+        if (pairs.empty()) {
+            cerr << "无法从 " << config.pairs_file << " 读取特征对" << endl;
+            return 1;
+        }
+    } else {
+        pairs = {{"red,apple", "apple"}, {"red", "apple"}, {"green,book", "book"},
+                 {"good_content,red", "content,apple"}, {"color:red", "red"}};
+    }
+
+    cout << "压测: " << config.total_requests << " 个" << config.op << "请求, " << config.connections
+         << " 个连接, 每连接在途 " << config.pipeline_depth << " 个" << endl;
+
+    vector<ConnectionResult> results(config.connections);
+    vector<thread> threads;
+    auto start_time = chrono::steady_clock::now();
+    for (int c = 0; c < config.connections; c++) {
+        long first = config.total_requests * c / config.connections;
+        long last = config.total_requests * (c + 1) / config.connections;
+        threads.emplace_back(runConnection, cref(config), cref(pairs), first, last, ref(results[c]));
+    }
+    for (thread& t : threads) {
+        t.join();
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start_time).count();
+
+    long completed = 0, errors = 0;
+    vector<double> latencies;
+    for (const ConnectionResult& result : results) {
+        completed += result.completed;
+        errors += result.errors;
+        latencies.insert(latencies.end(), result.latencies_us.begin(), result.latencies_us.end());
+    }
+    sort(latencies.begin(), latencies.end());
+
+    cout << "完成 " << completed << " 个, 失败 " << errors << " 个, 耗时 " << seconds << " 秒" << endl;
+    cout << "吞吐量: " << (seconds > 0 ? completed / seconds : 0.0) << " 请求/秒" << endl;
+    cout << "延迟(微秒): p50 " << percentile(latencies, 0.50) << ", p90 " << percentile(latencies, 0.90)
+         << ", p99 " << percentile(latencies, 0.99) << ", max " << (latencies.empty() ? 0.0 : latencies.back()) << endl;
+    return errors > 0 ? 1 : 0;
+}
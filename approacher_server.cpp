@@ -0,0 +1,757 @@
+// Approacher 相似度服务：常驻进程，通过Unix域套接字提供相似度查询
+// 协议：每行一个JSON请求，每行一个JSON响应（响应带回请求中的id，同一连接上流水线发送的请求可能乱序返回）
+//   {"id":1,"op":"similarity","a":"red,apple","b":"apple","fuzzy":false,"threshold":0.6,"depth":2}
+//   {"id":2,"op":"batch","pairs":[["red","apple"],{"a":"green","b":"book"}]}
+//   {"id":3,"op":"match","features":"red,apple","limit":10}
+//   {"id":4,"op":"topk","features":"red,apple","k":5}
+//   {"id":5,"op":"ping"} / {"id":6,"op":"stats"}
+//   {"id":7,"op":"reload"} / {"id":8,"op":"apply","file":"delta.txt"}
+//   （reload/apply在单独的维护线程上执行，新快照建好后原子替换，期间查询照常使用旧快照；最多16个待执行，再多时答复忙）
+#include <iostream>
+#include <vector>
+#include <string>
+#include <memory>
+#include <sstream>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <cmath>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "/home/laplace/things/ConceptDatabase.hpp"
+#include "/home/laplace/things/Logger.hpp"
+#include "/home/laplace/things/QueryTrace.hpp"
+#include "/home/laplace/things/SimpleJson.hpp"
+#include "/home/laplace/things/BoundedQueue.hpp"
+#include "/home/laplace/things/ParameterWatcher.hpp"
+
+using namespace std;
+
+// 服务配置
+struct ServerConfig {
+    string socket_path = "/tmp/approacher.sock";
+    string db_path = "/home/laplace/things/concepts-db";
+    string params_path = "/home/laplace/things/parameters.txt";
+    string snapshot_path;                // 非空时映射该快照文件，不由数据库构建快照
+    bool watch_params = true;            // 参数文件变化时自动重新加载并发布
+    int worker_count = 0;                // 0表示按CPU核数
+    size_t queue_capacity = 4096;        // 待处理请求上限，满时停止读取套接字
+    size_t max_request_bytes = 1 << 20;  // 单个请求行的最大长度
+    size_t max_pending_output = 8 << 20; // 连接上未写出的响应超过该值时暂停读取该连接
+};
+
+// 客户端连接（非阻塞套接字）：I/O线程读取请求；工作线程把响应追加到输出缓冲区并尝试写出，
+// 写不完的部分由I/O线程在套接字可写（POLLOUT）时继续写，任何线程都不会阻塞在不读取的客户端上
+struct Connection {
+    int fd = -1;
+    string read_buffer;                // 已读入、尚未放入队列的数据（I/O线程独占）
+    bool input_blocked = false;        // 队列已满，read_buffer中还有完整的请求行未放入（I/O线程独占）
+    atomic<bool> read_closed{false};   // 客户端已关闭写端，不再读取
+    atomic<int> outstanding{0};        // 已放入队列、尚未写回响应的请求数
+    mutex output_mutex;                // 保护output_buffer
+    string output_buffer;              // 尚未写出的响应
+    atomic<bool> broken{false};        // 写出失败后不再写
+
+    explicit Connection(int socket_fd) : fd(socket_fd) {}
+    ~Connection() { close(fd); }
+};
+
+// 待处理的请求
+struct Job {
+    shared_ptr<Connection> connection;
+    string line;
+};
+
+// 有界请求队列：队列满时I/O线程不再轮询该连接的POLLIN、停止读取，压力经套接字缓冲区传递给客户端
+typedef BoundedQueue<Job> JobQueue;
+
+// 服务统计
+struct ServerStats {
+    atomic<uint64_t> connections{0};
+    atomic<uint64_t> requests{0};
+    atomic<uint64_t> errors{0};
+    atomic<uint64_t> pairs_scored{0};
+    atomic<uint64_t> reloads{0};
+    chrono::steady_clock::time_point start_time = chrono::steady_clock::now();
+};
+
+// 全局状态
+unique_ptr<ConceptDatabase> g_database;
+ServerStats g_stats;
+volatile sig_atomic_t g_stop_requested = 0;
+
+// 唤醒I/O线程的管道：有响应待写出、连接可以关闭或队列腾出空间时写入一个字节，poll随即返回
+int g_wake_pipe[2] = {-1, -1};
+atomic<bool> g_queue_space_wanted{false};  // I/O线程有请求因队列已满未放入，工作线程取出请求后唤醒它
+
+void wakeIoThread() {
+    char byte = 1;
+    ssize_t n = write(g_wake_pipe[1], &byte, 1);
+    (void)n;  // 管道已满（EAGAIN）时I/O线程本来就会被唤醒
+}
+
+void handleStopSignal(int) {
+    g_stop_requested = 1;
+}
+
+// 格式化浮点数（保留足够精度以便客户端比对）
+string jsonNumber(double value) {
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%.17g", value);
+    return buffer;
+}
+
+// 从JSON值读取特征列表：逗号分隔字符串或字符串数组
+// 视图指向请求的JSON字符串，只在处理该请求期间有效
+bool readFeatureList(const JsonValue* value, vector<FeatureView>& out) {
+    out.clear();
+    if (!value) return false;
+    if (value->isString()) {
+        parseFeatureViews(value->string_value, out);
+        return true;
+    }
+    if (value->isArray()) {
+        for (const JsonValue& item : value->array_items) {
+            if (!item.isString()) return false;
+            parseFeatureViews(item.string_value, out);
+        }
+        return true;
+    }
+    return false;
+}
+
+// 递归匹配深度的上限（与approacher的默认深度相同）：代价随深度指数增长，
+// 五百个概念的库上深度2约0.3秒、深度3约50秒，客户端请求更深时按上限处理
+const int SERVER_MAX_RECURSIVE_DEPTH = 2;
+
+// 读取请求中的匹配选项（缺省与approacher默认模式一致）；数值非有限或超出范围时返回false并设置error
+bool readOptions(const JsonValue& request, SimilarityOptions& options, string& error) {
+    options = SimilarityOptions();
+    const JsonValue* fuzzy = request.get("fuzzy");
+    if (fuzzy && fuzzy->type == JsonValue::JSON_BOOL) options.use_fuzzy_matching = fuzzy->bool_value;
+    const JsonValue* threshold = request.get("threshold");
+    if (threshold && threshold->isNumber()) {
+        if (!isfinite(threshold->number_value) || threshold->number_value < 0.0 || threshold->number_value > 1.0) {
+            error = "threshold必须在0到1之间";
+            return false;
+        }
+        options.fuzzy_threshold = threshold->number_value;
+    }
+    const JsonValue* depth = request.get("depth");
+    if (depth && depth->isNumber()) {
+        if (!isfinite(depth->number_value) || depth->number_value < 1.0) {
+            error = "depth必须是不小于1的有限数";
+            return false;
+        }
+        // 先在浮点上夹到上限再转换，超大的值不会溢出int
+        options.max_recursive_depth = (int)min(depth->number_value, (double)SERVER_MAX_RECURSIVE_DEPTH);
+    }
+    return true;
+}
+
+// 读取非负整数字段，超过limit时按limit处理；非有限或为负时返回false并设置error
+bool readCount(const JsonValue& request, const string& key, size_t default_value, size_t limit, size_t& out, string& error) {
+    out = min(default_value, limit);
+    const JsonValue* value = request.get(key);
+    if (!value || !value->isNumber()) return true;
+    if (!isfinite(value->number_value) || value->number_value < 0.0) {
+        error = key + "必须是非负的有限数";
+        return false;
+    }
+    out = value->number_value >= (double)limit ? limit : (size_t)value->number_value;
+    return true;
+}
+
+// 相似度结果的JSON字段（不含外层括号）
+string formatSimilarityFields(const SimilarityResult& result) {
+    return "\"partial_a_to_b\":" + jsonNumber(result.partial_a_to_b) +
+           ",\"partial_b_to_a\":" + jsonNumber(result.partial_b_to_a) +
+           ",\"main\":" + jsonNumber(result.main_similarity) +
+           ",\"matches_a\":" + to_string(result.matches_A_count) +
+           ",\"matches_b\":" + to_string(result.matches_B_count) +
+           ",\"overlap\":" + to_string(result.total_matches);
+}
+
+// 匹配结果列表的JSON数组
+string formatMatches(const vector<MatchResult>& matches, size_t limit) {
+    string out = "[";
+    for (size_t i = 0; i < matches.size() && i < limit; i++) {
+        if (i > 0) out += ",";
+        out += "{\"id\":" + to_string(matches[i].concept_id) + ",\"count\":" + to_string(matches[i].match_count) + "}";
+    }
+    out += "]";
+    return out;
+}
+
+// 处理similarity请求
+bool handleSimilarity(const JsonValue& request, string& body, string& error) {
+    // 每个工作线程复用视图缓冲区，解析输入不复制特征字符串
+    static thread_local vector<FeatureView> input_a, input_b;
+    if (!readFeatureList(request.get("a"), input_a) || !readFeatureList(request.get("b"), input_b)) {
+        error = "缺少特征列表a或b";
+        return false;
+    }
+
+    SimilarityOptions options;
+    if (!readOptions(request, options, error)) return false;
+
+    QueryTraceScope trace("similarity");
+    body = formatSimilarityFields(g_database->computeSimilarity(input_a, input_b, options, *getPublishedParameters()));
+    g_stats.pairs_scored++;
+    return true;
+}
+
+// 处理batch请求：整批使用同一个参数表快照
+bool handleBatch(const JsonValue& request, string& body, string& error) {
+    const JsonValue* pairs = request.get("pairs");
+    if (!pairs || !pairs->isArray()) {
+        error = "缺少pairs数组";
+        return false;
+    }
+
+    SimilarityOptions options;
+    if (!readOptions(request, options, error)) return false;
+    auto params = getPublishedParameters();
+
+    body = "\"results\":[";
+    static thread_local vector<FeatureView> input_a, input_b;
+    for (size_t i = 0; i < pairs->array_items.size(); i++) {
+        const JsonValue& pair = pairs->array_items[i];
+        bool valid;
+        if (pair.isArray() && pair.array_items.size() == 2) {
+            valid = readFeatureList(&pair.array_items[0], input_a) && readFeatureList(&pair.array_items[1], input_b);
+        } else {
+            valid = readFeatureList(pair.get("a"), input_a) && readFeatureList(pair.get("b"), input_b);
+        }
+        if (!valid) {
+            error = "第" + to_string(i) + "个特征对格式错误";
+            return false;
+        }
+
+        QueryTraceScope trace("similarity");
+        if (i > 0) body += ",";
+        body += "{" + formatSimilarityFields(g_database->computeSimilarity(input_a, input_b, options, *params)) + "}";
+    }
+    body += "]";
+    g_stats.pairs_scored += pairs->array_items.size();
+    return true;
+}
+
+// 处理match请求：返回匹配的概念ID和匹配特征数
+bool handleMatch(const JsonValue& request, string& body, string& error) {
+    vector<FeatureView> input;
+    if (!readFeatureList(request.get("features"), input)) {
+        error = "缺少特征列表features";
+        return false;
+    }
+
+    SimilarityOptions options;
+    if (!readOptions(request, options, error)) return false;
+    auto matches = g_database->findMatchingConcepts(toFeatureList(input), options.use_fuzzy_matching,
+                                                    options.fuzzy_threshold, options.max_recursive_depth);
+    size_t limit;
+    if (!readCount(request, "limit", matches.size(), matches.size(), limit, error)) return false;
+    body = "\"total\":" + to_string(matches.size()) + ",\"matches\":" + formatMatches(matches, limit);
+    return true;
+}
+
+// 处理topk请求：与特征列表最接近的k个概念（WAND剪枝检索）
+bool handleTopK(const JsonValue& request, string& body, string& error) {
+    vector<FeatureView> input;
+    if (!readFeatureList(request.get("features"), input)) {
+        error = "缺少特征列表features";
+        return false;
+    }
+
+    // k与findTopKConcepts一样按概念数截断
+    size_t k;
+    if (!readCount(request, "k", 10, g_database->getSnapshot()->conceptCount(), k, error)) return false;
+
+    TopKStats stats;
+    auto top = g_database->findTopKConcepts(toFeatureList(input), k, &stats);
+    body = "\"matches\":[";
+    for (size_t i = 0; i < top.size(); i++) {
+        if (i > 0) body += ",";
+        body += "{\"id\":" + to_string(top[i].concept_id) + ",\"score\":" + jsonNumber(top[i].score) +
+                ",\"count\":" + to_string(top[i].match_count) + "}";
+    }
+    body += "],\"scored\":" + to_string(stats.candidates_scored);
+    return true;
+}
+
+// 处理reload请求：重新读取概念库并替换快照
+bool handleReload(string& body) {
+    auto current = g_database->reloadSnapshot();
+    g_stats.reloads++;
+    body = "\"snapshot_version\":" + to_string(current->version) + ",\"concepts\":" + to_string(current->conceptCount());
+    return true;
+}
+
+// 处理apply请求：在一个事务中应用增量文件，失败时概念库不变
+bool handleApply(const JsonValue& request, string& body, string& error) {
+    const JsonValue* file = request.get("file");
+    if (!file || !file->isString() || file->string_value.empty()) {
+        error = "缺少增量文件file";
+        return false;
+    }
+
+    int changed = g_database->applyDelta(file->string_value);
+    if (changed < 0) {
+        error = "增量未应用: " + file->string_value;
+        return false;
+    }
+    g_stats.reloads++;
+    auto current = g_database->getSnapshot();
+    body = "\"changed\":" + to_string(changed) + ",\"snapshot_version\":" + to_string(current->version) +
+           ",\"concepts\":" + to_string(current->conceptCount());
+    return true;
+}
+
+// 处理stats请求
+string formatStats(JobQueue& queue) {
+    double uptime = chrono::duration<double>(chrono::steady_clock::now() - g_stats.start_time).count();
+    MatchCacheStats cache = g_database->matchCacheStats();
+    MatchFlightStats flight = g_database->singleFlightStats();
+    return "\"uptime_seconds\":" + jsonNumber(uptime) +
+           ",\"connections\":" + to_string(g_stats.connections.load()) +
+           ",\"requests\":" + to_string(g_stats.requests.load()) +
+           ",\"errors\":" + to_string(g_stats.errors.load()) +
+           ",\"pairs_scored\":" + to_string(g_stats.pairs_scored.load()) +
+           ",\"queue_depth\":" + to_string(queue.size()) +
+           ",\"reloads\":" + to_string(g_stats.reloads.load()) +
+           ",\"snapshot_version\":" + to_string(g_database->getSnapshot()->version) +
+           ",\"params_version\":" + to_string(getPublishedParameterTable()->version) +
+           ",\"match_cache\":{\"entries\":" + to_string(cache.entries) + ",\"bytes\":" + to_string(cache.bytes) +
+           ",\"hits\":" + to_string(cache.hits) + ",\"misses\":" + to_string(cache.misses) +
+           ",\"hit_rate\":" + jsonNumber(cache.hitRate()) + ",\"evictions\":" + to_string(cache.evictions) +
+           ",\"invalidations\":" + to_string(cache.invalidations) + "}" +
+           ",\"single_flight\":{\"flights\":" + to_string(flight.flights) + ",\"coalesced\":" + to_string(flight.coalesced) +
+           ",\"saved_ms\":" + jsonNumber(flight.saved_ns / 1e6) + ",\"waited_ms\":" + jsonNumber(flight.waited_ns / 1e6) + "}" +
+           ",\"trace\":" + QueryProfiler::instance().formatJson();
+}
+
+// 处理一个请求，返回一行响应
+// reload/apply转交维护队列（maintenance_queue为空时表示当前就是维护线程，直接执行），此时返回空串
+string handleRequest(const Job& job, JobQueue& queue, JobQueue* maintenance_queue) {
+    const string& line = job.line;
+    if (maintenance_queue) {
+        g_stats.requests++;
+    }
+
+    JsonValue request;
+    string error;
+    string id_field;
+    string body;
+    bool ok = false;
+
+    JsonParser parser(line);
+    if (parser.parse(request, error)) {
+        const JsonValue* id = request.get("id");
+        if (id && id->isNumber()) {
+            id_field = "\"id\":" + jsonNumber(id->number_value) + ",";
+        } else if (id && id->isString()) {
+            id_field = "\"id\":" + jsonEscape(id->string_value) + ",";
+        }
+
+        const JsonValue* op = request.get("op");
+        string op_name = op && op->isString() ? op->string_value : "similarity";
+        bool maintenance_op = op_name == "reload" || op_name == "apply";
+        // 维护队列满时直接答复忙，工作线程不等待正在重建的快照
+        Job forwarded = maintenance_op && maintenance_queue ? job : Job();
+        if (maintenance_op && maintenance_queue && maintenance_queue->tryPush(forwarded)) {
+            return "";
+        }
+
+        try {
+            if (maintenance_op && maintenance_queue) {
+                error = g_stop_requested ? "服务正在停止" : "服务忙：待执行的reload/apply过多，请稍后重试";
+            } else if (op_name == "similarity") {
+                ok = handleSimilarity(request, body, error);
+            } else if (op_name == "batch") {
+                ok = handleBatch(request, body, error);
+            } else if (op_name == "match") {
+                ok = handleMatch(request, body, error);
+            } else if (op_name == "topk") {
+                ok = handleTopK(request, body, error);
+            } else if (op_name == "reload") {
+                ok = handleReload(body);
+            } else if (op_name == "apply") {
+                ok = handleApply(request, body, error);
+            } else if (op_name == "ping") {
+                ok = true;
+            } else if (op_name == "stats") {
+                body = formatStats(queue);
+                ok = true;
+            } else {
+                error = "未知操作: " + op_name;
+            }
+        } catch (const exception& e) {
+            error = e.what();
+        }
+    }
+
+    if (!ok) {
+        g_stats.errors++;
+        LOG_DEBUG("请求处理失败", {"error", error});
+        return "{" + id_field + "\"ok\":false,\"error\":" + jsonEscape(error) + "}\n";
+    }
+    return "{" + id_field + "\"ok\":true" + (body.empty() ? "" : "," + body) + "}\n";
+}
+
+// 尽量写出输出缓冲区（调用方持有output_mutex），套接字缓冲区满时留下剩余部分；失败时标记连接
+void flushOutputLocked(Connection& connection) {
+    size_t written = 0;
+    while (written < connection.output_buffer.size()) {
+        ssize_t n = send(connection.fd, connection.output_buffer.data() + written, connection.output_buffer.size() - written,
+                         MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        if (n <= 0) {
+            connection.broken = true;
+            connection.output_buffer.clear();
+            return;
+        }
+        written += n;
+    }
+    connection.output_buffer.erase(0, written);
+}
+
+// 追加一条响应并尝试写出（不阻塞）；写不完、连接出错或最后一个请求已答复时唤醒I/O线程
+void writeResponse(Connection& connection, const string& response) {
+    bool wake = false;
+    {
+        lock_guard<mutex> lock(connection.output_mutex);
+        if (!connection.broken) {
+            bool idle = connection.output_buffer.empty();
+            connection.output_buffer += response;
+            if (idle) flushOutputLocked(connection);
+        }
+        wake = !connection.output_buffer.empty() || connection.broken;
+    }
+    if (--connection.outstanding == 0 && connection.read_closed) {
+        wake = true;
+    }
+    if (wake) wakeIoThread();
+}
+
+// 工作线程：取出请求、计算、写回
+void workerLoop(JobQueue& queue, JobQueue& maintenance_queue) {
+    Job job;
+    while (queue.pop(job)) {
+        if (g_queue_space_wanted.exchange(false)) {
+            wakeIoThread();
+        }
+        string response = handleRequest(job, queue, &maintenance_queue);
+        if (!response.empty()) {
+            writeResponse(*job.connection, response);
+        }
+        job.connection.reset();
+    }
+}
+
+// 维护线程：依次执行reload/apply，重建快照不占用工作线程
+void maintenanceLoop(JobQueue& maintenance_queue, JobQueue& queue) {
+    Job job;
+    while (maintenance_queue.pop(job)) {
+        writeResponse(*job.connection, handleRequest(job, queue, nullptr));
+        job.connection.reset();
+    }
+}
+
+// 创建并监听Unix域套接字
+int openListenSocket(const string& path) {
+    if (path.size() >= sizeof(sockaddr_un::sun_path)) {
+        LOG_ERROR("套接字路径过长", {"path", path});
+        return -1;
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        LOG_ERROR("创建套接字失败", {"error", strerror(errno)});
+        return -1;
+    }
+
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+
+    unlink(path.c_str());
+    if (bind(fd, (sockaddr*)&address, sizeof(address)) < 0 || listen(fd, 128) < 0) {
+        LOG_ERROR("监听套接字失败", {"path", path}, {"error", strerror(errno)});
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// 把read_buffer中完整的请求行放入队列（不阻塞）；队列已满时留下剩余的行并设置input_blocked
+void enqueueRequests(const shared_ptr<Connection>& connection, JobQueue& queue) {
+    string& pending = connection->read_buffer;
+    size_t begin = 0;
+    connection->input_blocked = false;
+    while (true) {
+        size_t newline = pending.find('\n', begin);
+        if (newline == string::npos) break;
+
+        size_t end = newline;
+        if (end > begin && pending[end - 1] == '\r') end--;
+        if (end > begin) {
+            Job job{connection, pending.substr(begin, end - begin)};
+            connection->outstanding++;
+            if (!queue.tryPush(job)) {
+                connection->outstanding--;
+                connection->input_blocked = true;
+                break;
+            }
+        }
+        begin = newline + 1;
+    }
+    pending.erase(0, begin);
+}
+
+// 读取连接上的数据并放入队列；出错或请求行过长时返回false（客户端关闭写端不算出错，只标记read_closed）
+bool readRequests(const shared_ptr<Connection>& connection, JobQueue& queue, const ServerConfig& config) {
+    char buffer[65536];
+    ssize_t n = recv(connection->fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+    if (n < 0 && (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK)) return true;
+    if (n < 0) return false;
+    if (n == 0) {
+        connection->read_closed = true;
+        return true;
+    }
+
+    connection->read_buffer.append(buffer, n);
+    enqueueRequests(connection, queue);
+
+    if (!connection->input_blocked && connection->read_buffer.size() > config.max_request_bytes) {
+        LOG_WARN("请求行过长，关闭连接", {"bytes", connection->read_buffer.size()});
+        return false;
+    }
+    return true;
+}
+
+// 连接是否还需要保留：出错的立即关闭；客户端关闭写端后，等剩余请求都答复、响应都写出后关闭
+// （仍在队列中的请求持有连接，关闭后它们的响应不再写出）
+bool connectionFinished(Connection& connection) {
+    if (connection.broken) return true;
+    if (!connection.read_closed || connection.input_blocked || connection.outstanding > 0) return false;
+    lock_guard<mutex> lock(connection.output_mutex);
+    return connection.output_buffer.empty();
+}
+
+// I/O主循环：接受连接、读取请求、写出工作线程留下的响应，直到收到停止信号；返回停止时仍打开的连接
+// I/O线程从不阻塞（队列满时用tryPush并暂停读取该连接），每次poll最多等待200毫秒后检查停止标志
+vector<shared_ptr<Connection>> serveConnections(int listen_fd, JobQueue& queue, const ServerConfig& config) {
+    vector<shared_ptr<Connection>> connections;
+    vector<pollfd> poll_fds;
+
+    while (!g_stop_requested) {
+        // 先重试因队列已满而暂停的连接：置标志在重试之前，之后取出请求的工作线程一定会唤醒本线程
+        bool any_blocked = false;
+        for (const auto& connection : connections) {
+            any_blocked = any_blocked || connection->input_blocked;
+        }
+        if (any_blocked) {
+            g_queue_space_wanted = true;
+            for (const auto& connection : connections) {
+                if (connection->input_blocked) enqueueRequests(connection, queue);
+            }
+        }
+
+        poll_fds.clear();
+        poll_fds.push_back({g_wake_pipe[0], POLLIN, 0});
+        poll_fds.push_back({listen_fd, POLLIN, 0});
+        for (const auto& connection : connections) {
+            short events = 0;
+            size_t pending_output;
+            {
+                lock_guard<mutex> lock(connection->output_mutex);
+                pending_output = connection->output_buffer.size();
+            }
+            // 队列已满或客户端不读取响应（未写出的响应过多）时不再读取该连接
+            if (!connection->read_closed && !connection->input_blocked && pending_output < config.max_pending_output) {
+                events |= POLLIN;
+            }
+            if (pending_output > 0) {
+                events |= POLLOUT;
+            }
+            poll_fds.push_back({connection->fd, events, 0});
+        }
+
+        int ready = poll(poll_fds.data(), poll_fds.size(), 200);
+        if (ready < 0) {
+            if (errno == EINTR) continue;
+            LOG_ERROR("poll失败", {"error", strerror(errno)});
+            break;
+        }
+
+        if (poll_fds[0].revents & POLLIN) {
+            char drain[256];
+            while (read(g_wake_pipe[0], drain, sizeof(drain)) > 0) {
+            }
+        }
+
+        // 处理已有连接（倒序以便原地删除关闭的连接）
+        for (size_t i = connections.size(); i-- > 0;) {
+            Connection& connection = *connections[i];
+            short revents = poll_fds[i + 2].revents;
+            if (revents & (POLLERR | POLLNVAL)) {
+                connection.broken = true;
+            }
+            if (!connection.broken && (revents & POLLOUT)) {
+                lock_guard<mutex> lock(connection.output_mutex);
+                flushOutputLocked(connection);
+            }
+            if (!connection.broken && (revents & POLLIN)) {
+                if (!readRequests(connections[i], queue, config)) connection.broken = true;
+            } else if (!connection.broken && (revents & POLLHUP)) {
+                // 对端已完全关闭，响应无法送达
+                connection.broken = true;
+            }
+            if (connectionFinished(connection)) {
+                connections.erase(connections.begin() + i);
+            }
+        }
+
+        if (poll_fds[1].revents & POLLIN) {
+            int client_fd = accept4(listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (client_fd >= 0) {
+                connections.push_back(make_shared<Connection>(client_fd));
+                g_stats.connections++;
+            }
+        }
+    }
+    return connections;
+}
+
+// 停止时把剩余响应写出，最多等待timeout_ms（不读取的客户端不会拖住退出）
+void drainResponses(const vector<shared_ptr<Connection>>& connections, int timeout_ms) {
+    auto deadline = chrono::steady_clock::now() + chrono::milliseconds(timeout_ms);
+    vector<pollfd> poll_fds;
+    vector<Connection*> pending;
+    while (chrono::steady_clock::now() < deadline) {
+        poll_fds.clear();
+        pending.clear();
+        for (const auto& connection : connections) {
+            lock_guard<mutex> lock(connection->output_mutex);
+            if (!connection->broken && !connection->output_buffer.empty()) {
+                poll_fds.push_back({connection->fd, POLLOUT, 0});
+                pending.push_back(connection.get());
+            }
+        }
+        if (pending.empty()) return;
+
+        int remaining_ms = chrono::duration_cast<chrono::milliseconds>(deadline - chrono::steady_clock::now()).count();
+        if (poll(poll_fds.data(), poll_fds.size(), max(1, remaining_ms)) < 0 && errno != EINTR) return;
+        for (size_t i = 0; i < pending.size(); i++) {
+            if (poll_fds[i].revents & (POLLERR | POLLHUP | POLLNVAL)) {
+                pending[i]->broken = true;
+            } else if (poll_fds[i].revents & POLLOUT) {
+                lock_guard<mutex> lock(pending[i]->output_mutex);
+                flushOutputLocked(*pending[i]);
+            }
+        }
+    }
+}
+
+void printUsage() {
+    cout << "用法: approacher_server [--socket 路径] [--db 数据库目录] [--params 参数文件]" << endl;
+    cout << "                        [--workers 线程数] [--queue 队列容量] [--no-watch] [--snapshot 快照文件]" << endl;
+}
+
+int main(int argc, char* argv[]) {
+    ServerConfig config;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--socket" && has_value) config.socket_path = argv[++i];
+        else if (arg == "--db" && has_value) config.db_path = argv[++i];
+        else if (arg == "--params" && has_value) config.params_path = argv[++i];
+        else if (arg == "--workers" && has_value) config.worker_count = atoi(argv[++i]);
+        else if (arg == "--queue" && has_value) config.queue_capacity = max(1, atoi(argv[++i]));
+        else if (arg == "--no-watch") config.watch_params = false;
+        else if (arg == "--snapshot" && has_value) config.snapshot_path = argv[++i];
+        else {
+            printUsage();
+            return arg == "--help" ? 0 : 1;
+        }
+    }
+    if (config.worker_count <= 0) {
+        config.worker_count = max(1u, thread::hardware_concurrency());
+    }
+
+    // 打开数据库一次，预先建立内存快照和倒排索引（或映射导出的快照文件）
+    g_database = make_unique<ConceptDatabase>();
+    if (!g_database->initialize(config.db_path)) {
+        cerr << "数据库初始化失败！" << endl;
+        return 1;
+    }
+    g_database->loadParameters(config.params_path);
+    if (!config.snapshot_path.empty() && !g_database->loadSnapshotFile(config.snapshot_path)) {
+        cerr << "加载快照文件失败！" << endl;
+        return 1;
+    }
+    auto snapshot = g_database->getSnapshot();
+
+    // 参数文件被保存（包括其他进程的原子保存）后重新加载，评分请求不会看到更新到一半的参数表
+    unique_ptr<ParameterFileWatcher> params_watcher;
+    if (config.watch_params) {
+        params_watcher = make_unique<ParameterFileWatcher>(config.params_path, [](const string& filename) {
+            g_database->loadParameters(filename);
+        });
+    }
+
+    int listen_fd = openListenSocket(config.socket_path);
+    if (listen_fd < 0) {
+        return 1;
+    }
+    if (pipe2(g_wake_pipe, O_NONBLOCK | O_CLOEXEC) != 0) {
+        LOG_ERROR("创建唤醒管道失败", {"error", strerror(errno)});
+        return 1;
+    }
+
+    signal(SIGINT, handleStopSignal);
+    signal(SIGTERM, handleStopSignal);
+    signal(SIGPIPE, SIG_IGN);
+
+    LOG_INFO("Approacher服务已启动", {"socket", config.socket_path}, {"workers", config.worker_count},
+             {"queue", config.queue_capacity}, {"concepts", snapshot->conceptCount()});
+
+    JobQueue queue(config.queue_capacity);
+    JobQueue maintenance_queue(16);  // 满时reload/apply直接答复忙（见handleRequest）
+    vector<thread> workers;
+    for (int i = 0; i < config.worker_count; i++) {
+        workers.emplace_back(workerLoop, ref(queue), ref(maintenance_queue));
+    }
+    thread maintenance_thread(maintenanceLoop, ref(maintenance_queue), ref(queue));
+
+    vector<shared_ptr<Connection>> connections = serveConnections(listen_fd, queue, config);
+
+    // 停止：不再接受请求，等待工作线程处理完队列中剩余请求，再把剩余响应写出（最多1秒）
+    close(listen_fd);
+    unlink(config.socket_path.c_str());
+    queue.close();
+    for (thread& worker : workers) {
+        worker.join();
+    }
+    maintenance_queue.close();
+    maintenance_thread.join();
+    drainResponses(connections, 1000);
+    connections.clear();
+    close(g_wake_pipe[0]);
+    close(g_wake_pipe[1]);
+
+    LOG_INFO("Approacher服务已停止", {"requests", g_stats.requests.load()}, {"errors", g_stats.errors.load()});
+    Logger::instance().flush();
+    return 0;
+}
@@ -0,0 +1,40 @@
+#!/bin/bash
+
+# Approacher基准测试编译脚本 - 合成概念库 + 微基准 + 端到端吞吐
+echo "编译Approacher基准测试..."
+
+# 设置路径
+THINGS_DIR="/home/laplace/things"
+INCLUDE_DIR="$THINGS_DIR/include"
+LIB_DIR="$THINGS_DIR/lib"
+
+# 编译（基准测试使用-O2）
+g++ -std=c++17 -O2 \
+    -I"$INCLUDE_DIR" \
+    -L"$LIB_DIR" \
+    -o approacher_bench \
+    approacher_bench.cpp \
+    "$THINGS_DIR/ConceptDatabase.cpp" \
+    "$THINGS_DIR/concepts.obx.cpp" \
+    "$THINGS_DIR/ConceptSnapshot.cpp" \
+    "$THINGS_DIR/Logger.cpp" \
+    "$THINGS_DIR/BatchPipeline.cpp" \
+    "$THINGS_DIR/ParameterWatcher.cpp" \
+    "$THINGS_DIR/QueryTrace.cpp" \
+    "$THINGS_DIR/QueryArena.cpp" \
+    "$THINGS_DIR/CompressedPostings.cpp" \
+    "$THINGS_DIR/QueryPlanner.cpp" \
+    "$THINGS_DIR/SnapshotFile.cpp" \
+    "$THINGS_DIR/ConceptStream.cpp" \
+    "$THINGS_DIR/MatchCache.cpp" \
+    "$THINGS_DIR/FeatureIdMatch.cpp" \
+    "$THINGS_DIR/SyntheticLibrary.cpp" \
+    -lobjectbox -pthread || { echo "编译失败！"; exit 1; }
+
+echo "编译成功！"
+echo ""
+echo "运行（默认10000个概念，结果写入bench.json）："
+echo "LD_LIBRARY_PATH=\"$LIB_DIR\" ./approacher_bench --json bench.json"
+echo ""
+echo "与之前的结果对比："
+echo "LD_LIBRARY_PATH=\"$LIB_DIR\" ./approacher_bench --compare bench.json"
@@ -0,0 +1,40 @@
+#!/bin/bash
+
+# Approacher差分测试编译脚本 - 优化实现与参考引擎在随机概念库上逐项比对
+echo "编译Approacher差分测试..."
+
+# 设置路径
+THINGS_DIR="/home/laplace/things"
+INCLUDE_DIR="$THINGS_DIR/include"
+LIB_DIR="$THINGS_DIR/lib"
+
+# 编译（与正式程序相同使用-O2，以便检查优化后的代码）
+g++ -std=c++17 -O2 \
+    -I"$INCLUDE_DIR" \
+    -L"$LIB_DIR" \
+    -o approacher_difftest \
+    approacher_difftest.cpp \
+    "$THINGS_DIR/ConceptDatabase.cpp" \
+    "$THINGS_DIR/concepts.obx.cpp" \
+    "$THINGS_DIR/ConceptSnapshot.cpp" \
+    "$THINGS_DIR/Logger.cpp" \
+    "$THINGS_DIR/BatchPipeline.cpp" \
+    "$THINGS_DIR/ParameterWatcher.cpp" \
+    "$THINGS_DIR/QueryTrace.cpp" \
+    "$THINGS_DIR/QueryArena.cpp" \
+    "$THINGS_DIR/CompressedPostings.cpp" \
+    "$THINGS_DIR/QueryPlanner.cpp" \
+    "$THINGS_DIR/SnapshotFile.cpp" \
+    "$THINGS_DIR/ConceptStream.cpp" \
+    "$THINGS_DIR/MatchCache.cpp" \
+    "$THINGS_DIR/FeatureIdMatch.cpp" \
+    "$THINGS_DIR/SyntheticLibrary.cpp" \
+    "$THINGS_DIR/ReferenceEngine.cpp" \
+    -lobjectbox -pthread || { echo "编译失败！"; exit 1; }
+
+echo "编译成功！"
+echo ""
+echo "运行（默认50轮，每轮一个随机小概念库）："
+echo "LD_LIBRARY_PATH=\"$LIB_DIR\" ./approacher_difftest --trials 200"
+echo ""
+echo "发现不一致时打印最小化的复现用例，并写入 /tmp/approacher-difftest-repro/"
@@ -18,6 +18,18 @@ g++ -std=c++17 \
     semantic_approacher.cpp \
     "$THINGS_DIR/ConceptDatabase.cpp" \
     "$THINGS_DIR/concepts.obx.cpp" \
+    "$THINGS_DIR/ConceptSnapshot.cpp" \
+    "$THINGS_DIR/Logger.cpp" \
+    "$THINGS_DIR/BatchPipeline.cpp" \
+    "$THINGS_DIR/ParameterWatcher.cpp" \
+    "$THINGS_DIR/QueryTrace.cpp" \
+    "$THINGS_DIR/QueryArena.cpp" \
+    "$THINGS_DIR/CompressedPostings.cpp" \
+    "$THINGS_DIR/QueryPlanner.cpp" \
+    "$THINGS_DIR/SnapshotFile.cpp" \
+    "$THINGS_DIR/ConceptStream.cpp" \
+    "$THINGS_DIR/MatchCache.cpp" \
+    "$THINGS_DIR/FeatureIdMatch.cpp" \
     -lobjectbox -pthread
 
 if [ $? -eq 0 ]; then
@@ -32,7 +44,7 @@ if [ $? -eq 0 ]; then
     echo ""
     echo "程序功能："
     echo "- 🧠 语义预处理（框架已就绪，逻辑待填入）"
-    echo "- 🔗 调用原Approacher进行计算"
+    echo "- 🔗 进程内调用Approacher引擎计算"
     echo "- 📝 语义后处理（框架已就绪，逻辑待填入）"
     echo "- 🔄 'direct'命令可切换直接模式"
     echo ""
@@ -0,0 +1,45 @@
+#!/bin/bash
+
+# Approacher服务编译脚本 - 编译常驻服务和压测客户端
+echo "编译Approacher服务（Unix域套接字）和压测客户端..."
+
+# 设置路径
+THINGS_DIR="/home/laplace/things"
+INCLUDE_DIR="$THINGS_DIR/include"
+LIB_DIR="$THINGS_DIR/lib"
+
+# 编译服务端
+g++ -std=c++17 -O2 \
+    -I"$INCLUDE_DIR" \
+    -L"$LIB_DIR" \
+    -o approacher_server \
+    approacher_server.cpp \
+    "$THINGS_DIR/ConceptDatabase.cpp" \
+    "$THINGS_DIR/concepts.obx.cpp" \
+    "$THINGS_DIR/ConceptSnapshot.cpp" \
+    "$THINGS_DIR/Logger.cpp" \
+    "$THINGS_DIR/BatchPipeline.cpp" \
+    "$THINGS_DIR/ParameterWatcher.cpp" \
+    "$THINGS_DIR/QueryTrace.cpp" \
+    "$THINGS_DIR/QueryArena.cpp" \
+    "$THINGS_DIR/CompressedPostings.cpp" \
+    "$THINGS_DIR/QueryPlanner.cpp" \
+    "$THINGS_DIR/SnapshotFile.cpp" \
+    "$THINGS_DIR/ConceptStream.cpp" \
+    "$THINGS_DIR/MatchCache.cpp" \
+    "$THINGS_DIR/FeatureIdMatch.cpp" \
+    -lobjectbox -pthread || { echo "服务端编译失败！"; exit 1; }
+
+# 编译压测客户端（不依赖数据库）
+g++ -std=c++17 -O2 \
+    -o approacher_loadgen \
+    approacher_loadgen.cpp \
+    -pthread || { echo "压测客户端编译失败！"; exit 1; }
+
+echo "编译成功！"
+echo ""
+echo "启动服务："
+echo "LD_LIBRARY_PATH=\"$LIB_DIR\" ./approacher_server --socket /tmp/approacher.sock --workers 4"
+echo ""
+echo "压测："
+echo "./approacher_loadgen --socket /tmp/approacher.sock --connections 4 --requests 100000"
@@ -16,6 +16,18 @@ g++ -std=c++17 \
     approacher.cpp \
     "$THINGS_DIR/ConceptDatabase.cpp" \
     "$THINGS_DIR/concepts.obx.cpp" \
+    "$THINGS_DIR/ConceptSnapshot.cpp" \
+    "$THINGS_DIR/Logger.cpp" \
+    "$THINGS_DIR/BatchPipeline.cpp" \
+    "$THINGS_DIR/ParameterWatcher.cpp" \
+    "$THINGS_DIR/QueryTrace.cpp" \
+    "$THINGS_DIR/QueryArena.cpp" \
+    "$THINGS_DIR/CompressedPostings.cpp" \
+    "$THINGS_DIR/QueryPlanner.cpp" \
+    "$THINGS_DIR/SnapshotFile.cpp" \
+    "$THINGS_DIR/ConceptStream.cpp" \
+    "$THINGS_DIR/MatchCache.cpp" \
+    "$THINGS_DIR/FeatureIdMatch.cpp" \
     -lobjectbox -pthread
 
 if [ $? -eq 0 ]; then
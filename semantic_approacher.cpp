@@ -4,10 +4,9 @@
 #include <memory>
 #include <sstream>
 #include <cmath>
-#include <cstdlib>
-#include <fstream>
 
 #include "/home/laplace/things/ConceptDatabase.hpp"
+#include "/home/laplace/things/Logger.hpp"
 
 using namespace std;
 
@@ -24,55 +23,168 @@ string applyBackupPOSRules(const string& word);
 // 全局数据库实例
 unique_ptr<ConceptDatabase> g_semantic_database;
 
-// 全局语义分析结果存储
+// 语义分析结果
 struct SemanticAnalysisResult {
     string input_a;
     string input_b;
     double containment_strength_a_to_b = 0.0;  // A包含B的强度
     double containment_strength_b_to_a = 0.0;  // B包含A的强度
     bool has_semantic_enhancement = false;
-} g_semantic_result;
+};
+
+// 单次语义增强查询的上下文，在各处理阶段之间显式传递（不使用全局结果存储）
+struct SemanticRequestContext {
+    SemanticAnalysisResult semantic;  // 语义分析阶段写入，后处理阶段读取
+    QueryContext query;               // 传给approacher引擎的查询（输入、选项、参数表快照、结果）
+};
 
 // =============================================================================
 // 语义包含匹配功能 (复合词形容词+名词包含关系检测)
 // =============================================================================
 
+/**
+ * 词性词典
+ * 由概念库快照中同一概念的name/word_class特征建立，词性查询为一次哈希查找
+ * 快照版本变化（概念库更新）时重建
+ */
+struct PartOfSpeechLexicon {
+    uint64_t snapshot_version = 0;               // 建立词典时的快照版本
+    unordered_map<string, string> word_classes;  // 单词 → "adj" / "noun"
+};
+
+/**
+ * 备用规则后缀自动机
+ * 后缀按字节逆序插入字典树，从单词末尾向前走一遍即可找到匹配的后缀规则
+ */
+struct SuffixRuleAutomaton {
+    struct Node {
+        unordered_map<unsigned char, int> next;  // 逆序字节转移
+        string suffix;                           // 终止状态对应的后缀
+        string pos;                              // 终止状态对应的词性
+    };
+    vector<Node> nodes = vector<Node>(1);
+
+    void addSuffix(const string& suffix, const string& pos) {
+        int state = 0;
+        for (auto it = suffix.rbegin(); it != suffix.rend(); ++it) {
+            auto found = nodes[state].next.find((unsigned char)*it);
+            if (found == nodes[state].next.end()) {
+                nodes.emplace_back();
+                int created = nodes.size() - 1;
+                nodes[state].next[(unsigned char)*it] = created;
+                state = created;
+            } else {
+                state = found->second;
+            }
+        }
+        nodes[state].suffix = suffix;
+        nodes[state].pos = pos;
+    }
+
+    // 返回单词匹配到的最短后缀规则所在状态，未匹配返回-1
+    int match(const string& word) const {
+        int state = 0;
+        for (auto it = word.rbegin(); it != word.rend(); ++it) {
+            auto found = nodes[state].next.find((unsigned char)*it);
+            if (found == nodes[state].next.end()) {
+                return -1;
+            }
+            state = found->second;
+            if (!nodes[state].pos.empty()) {
+                return state;
+            }
+        }
+        return -1;
+    }
+};
+
+/**
+ * 备用词性规则（编译后的形式）
+ */
+struct BackupPOSRules {
+    SuffixRuleAutomaton noun_suffixes;        // 中文名词常见后缀
+    unordered_map<string, string> known_words;  // 预定义词汇 → 词性
+
+    BackupPOSRules() {
+        vector<string> suffixes = {"人", "者", "生", "师", "员", "家", "手", "工"};
+        vector<string> known_nouns = {"女孩", "学生", "老师", "汽车", "轿车", "苹果", "书", "电脑", "手机"};
+        vector<string> known_adjs = {"美丽", "温柔", "聪明", "勤奋", "快速", "红色", "新的", "优秀", "漂亮", "可爱"};
+
+        for (const string& suffix : suffixes) {
+            noun_suffixes.addSuffix(suffix, "noun");
+        }
+        for (const string& noun : known_nouns) {
+            known_words.emplace(noun, "noun");
+        }
+        for (const string& adj : known_adjs) {
+            known_words.emplace(adj, "adj");
+        }
+    }
+};
+
+// 当前词性词典，只通过atomic_load/atomic_store访问
+shared_ptr<const PartOfSpeechLexicon> g_pos_lexicon;
+
+/**
+ * 获取与当前概念库快照一致的词性词典（快照变化时重建）
+ * @return 词性词典，数据库不可用时返回nullptr
+ */
+shared_ptr<const PartOfSpeechLexicon> getPartOfSpeechLexicon() {
+    if (!g_semantic_database) {
+        return nullptr;
+    }
+
+    auto snapshot = g_semantic_database->getSnapshot();
+    auto lexicon = atomic_load(&g_pos_lexicon);
+    if (lexicon && lexicon->snapshot_version == snapshot->version) {
+        return lexicon;
+    }
+
+    auto rebuilt = make_shared<PartOfSpeechLexicon>();
+    rebuilt->snapshot_version = snapshot->version;
+
+    // 按概念ID顺序扫描，同一单词以最先出现的词性为准（特征文本直接读快照字典）
+    for (uint32_t pos = 0; pos < snapshot->conceptCount(); pos++) {
+        snapshot->forEachConceptKeyValue(pos, [&](string_view key, string_view word) {
+            if (key != "name" || rebuilt->word_classes.count(string(word))) return true;
+
+            // 在同一个概念中查找word_class字段
+            snapshot->forEachConceptKeyValue(pos, [&](string_view class_key, string_view word_class) {
+                if (class_key != "word_class") return true;
+
+                // 转换词性标记
+                if (word_class == "adjective") {
+                    rebuilt->word_classes.emplace(word, "adj");
+                    return false;
+                } else if (word_class == "noun") {
+                    rebuilt->word_classes.emplace(word, "noun");
+                    return false;
+                }
+                return true;
+            });
+            return true;
+        });
+    }
+
+    lexicon = rebuilt;
+    atomic_store(&g_pos_lexicon, lexicon);
+    return lexicon;
+}
+
 /**
  * 从数据库查询词性信息（带备用规则）
- * 通过查询概念数据库中的word_class字段获取词性，如果失败则使用备用规则
+ * 通过概念库中word_class字段建立的词性词典获取词性，如果失败则使用备用规则
  * @param word 待识别的单词
  * @return "adj" 形容词, "noun" 名词, "unknown" 未知
  */
 string identifyPartOfSpeech(const string& word) {
-    if (!g_semantic_database) {
-        return applyBackupPOSRules(word);
-    }
-
     try {
-        // 获取所有概念
-        auto all_concepts = g_semantic_database->getAllConcepts();
-
-        // 查找匹配的概念
-        for (auto& concept : all_concepts) {
-            for (size_t i = 0; i < concept->feature_keys.size(); i++) {
-                // 查找name字段匹配当前单词的概念
-                if (concept->feature_keys[i] == "name" && concept->feature_values[i] == word) {
-                    // 在同一个概念中查找word_class字段
-                    for (size_t j = 0; j < concept->feature_keys.size(); j++) {
-                        if (concept->feature_keys[j] == "word_class") {
-                            string word_class = concept->feature_values[j];
-
-                            // 转换词性标记
-                            if (word_class == "adjective") {
-                                cout << "[词性查询] \"" << word << "\" → 形容词 (数据库)" << endl;
-                                return "adj";
-                            } else if (word_class == "noun") {
-                                cout << "[词性查询] \"" << word << "\" → 名词 (数据库)" << endl;
-                                return "noun";
-                            }
-                        }
-                    }
-                }
+        auto lexicon = getPartOfSpeechLexicon();
+        if (lexicon) {
+            auto it = lexicon->word_classes.find(word);
+            if (it != lexicon->word_classes.end()) {
+                LOG_TRACE("[词性查询] \"" << word << "\" → " << (it->second == "adj" ? "形容词" : "名词"), {"source", "database"});
+                return it->second;
             }
         }
 
@@ -80,7 +192,7 @@ string identifyPartOfSpeech(const string& word) {
         return applyBackupPOSRules(word);
 
     } catch (const exception& e) {
-        cerr << "[词性查询] 查询失败: " << e.what() << endl;
+        LOG_ERROR("[词性查询] 查询失败", {"word", word}, {"error", e.what()});
         return applyBackupPOSRules(word);
     }
 }
@@ -91,41 +203,29 @@ string identifyPartOfSpeech(const string& word) {
  * @return "adj" 形容词, "noun" 名词, "unknown" 未知
  */
 string applyBackupPOSRules(const string& word) {
+    static const BackupPOSRules rules;
+
     // 中文形容词常见特征
     if (word.find("的") != string::npos && word.length() > 3) {
-        cout << "[词性查询] \"" << word << "\" → 形容词 (备用规则: 含'的')" << endl;
+        LOG_TRACE("[词性查询] \"" << word << "\" → 形容词", {"source", "backup"}, {"rule", "含'的'"});
         return "adj";
     }
 
     // 中文名词常见特征
-    vector<string> noun_suffixes = {"人", "者", "生", "师", "员", "家", "手", "工"};
-    for (const string& suffix : noun_suffixes) {
-        if (word.length() >= suffix.length() &&
-            word.substr(word.length() - suffix.length()) == suffix) {
-            cout << "[词性查询] \"" << word << "\" → 名词 (备用规则: 后缀'" << suffix << "')" << endl;
-            return "noun";
-        }
+    int state = rules.noun_suffixes.match(word);
+    if (state >= 0) {
+        LOG_TRACE("[词性查询] \"" << word << "\" → 名词", {"source", "backup"}, {"suffix", rules.noun_suffixes.nodes[state].suffix});
+        return rules.noun_suffixes.nodes[state].pos;
     }
 
     // 预定义词汇
-    vector<string> known_nouns = {"女孩", "学生", "老师", "汽车", "轿车", "苹果", "书", "电脑", "手机"};
-    vector<string> known_adjs = {"美丽", "温柔", "聪明", "勤奋", "快速", "红色", "新的", "优秀", "漂亮", "可爱"};
-
-    for (const string& noun : known_nouns) {
-        if (word == noun) {
-            cout << "[词性查询] \"" << word << "\" → 名词 (备用规则: 预定义)" << endl;
-            return "noun";
-        }
+    auto it = rules.known_words.find(word);
+    if (it != rules.known_words.end()) {
+        LOG_TRACE("[词性查询] \"" << word << "\" → " << (it->second == "adj" ? "形容词" : "名词"), {"source", "predefined"});
+        return it->second;
     }
 
-    for (const string& adj : known_adjs) {
-        if (word == adj) {
-            cout << "[词性查询] \"" << word << "\" → 形容词 (备用规则: 预定义)" << endl;
-            return "adj";
-        }
-    }
-
-    cout << "[词性查询] \"" << word << "\" → 未知 (所有规则都无法识别)" << endl;
+    LOG_TRACE("[词性查询] \"" << word << "\" → 未知 (所有规则都无法识别)");
     return "unknown";
 }
 
@@ -290,6 +390,25 @@ double checkSequenceContainment(const vector<NounSegment>& container_segments,
     return containment_strength;
 }
 
+/**
+ * 将名词段列表格式化为单行文本（用于调试日志）
+ * @param segments 名词段列表
+ * @return 形如 "女孩[美丽, 温柔]; 学生[聪明]" 的字符串
+ */
+string formatNounSegments(const vector<NounSegment>& segments) {
+    string text;
+    for (size_t i = 0; i < segments.size(); i++) {
+        if (i > 0) text += "; ";
+        text += segments[i].noun + "[";
+        for (size_t j = 0; j < segments[i].adjectives.size(); j++) {
+            if (j > 0) text += ", ";
+            text += segments[i].adjectives[j];
+        }
+        text += "]";
+    }
+    return text;
+}
+
 /**
  * 语义包含关系检测主函数
  * @param sequence1 第一个逗号分隔序列 (潜在的容器)
@@ -297,39 +416,22 @@ double checkSequenceContainment(const vector<NounSegment>& container_segments,
  * @return 包含关系强度 (0.0: 无关系, 4.0: 强包含关系)
  */
 double detectSemanticContainment(const string& sequence1, const string& sequence2) {
-    cout << "[语义分析] 检测包含关系: \"" << sequence1 << "\" vs \"" << sequence2 << "\"" << endl;
+    LOG_DEBUG("[语义分析] 检测包含关系: \"" << sequence1 << "\" vs \"" << sequence2 << "\"");
 
     // 解析两个序列为名词段
     vector<NounSegment> segments1 = parseSequenceToNounSegments(sequence1);
     vector<NounSegment> segments2 = parseSequenceToNounSegments(sequence2);
 
-    cout << "[语义分析] 序列1解析结果:" << endl;
-    for (size_t i = 0; i < segments1.size(); i++) {
-        cout << "  名词: " << segments1[i].noun << ", 形容词: [";
-        for (size_t j = 0; j < segments1[i].adjectives.size(); j++) {
-            cout << segments1[i].adjectives[j];
-            if (j < segments1[i].adjectives.size() - 1) cout << ", ";
-        }
-        cout << "]" << endl;
-    }
-
-    cout << "[语义分析] 序列2解析结果:" << endl;
-    for (size_t i = 0; i < segments2.size(); i++) {
-        cout << "  名词: " << segments2[i].noun << ", 形容词: [";
-        for (size_t j = 0; j < segments2[i].adjectives.size(); j++) {
-            cout << segments2[i].adjectives[j];
-            if (j < segments2[i].adjectives.size() - 1) cout << ", ";
-        }
-        cout << "]" << endl;
-    }
+    LOG_DEBUG("[语义分析] 序列1解析结果: " << formatNounSegments(segments1), {"segments", segments1.size()});
+    LOG_DEBUG("[语义分析] 序列2解析结果: " << formatNounSegments(segments2), {"segments", segments2.size()});
 
     // 检查包含关系
     double containment_strength = checkSequenceContainment(segments1, segments2);
 
     if (containment_strength > 0.0) {
-        cout << "[语义分析] 检测到包含关系！强度: " << containment_strength << endl;
+        LOG_DEBUG("[语义分析] 检测到包含关系！", {"strength", containment_strength});
     } else {
-        cout << "[语义分析] 未检测到包含关系" << endl;
+        LOG_DEBUG("[语义分析] 未检测到包含关系");
     }
 
     return containment_strength;
@@ -339,39 +441,32 @@ double detectSemanticContainment(const string& sequence1, const string& sequence
  * 分析两个输入序列之间的语义包含关系
  * @param input_a 输入A（逗号分隔的序列）
  * @param input_b 输入B（逗号分隔的序列）
- * @return 无返回值，结果保存在g_semantic_result中
+ * @param context 本次查询的上下文，结果保存在context.semantic中
  */
-void analyzeSemanticRelationship(const string& input_a, const string& input_b) {
+void analyzeSemanticRelationship(const string& input_a, const string& input_b, SemanticRequestContext& context) {
     cout << "\n=== 语义关系分析 ===" << endl;
 
-    // 清空之前的结果
-    g_semantic_result = SemanticAnalysisResult();
-    g_semantic_result.input_a = input_a;
-    g_semantic_result.input_b = input_b;
+    SemanticAnalysisResult& result = context.semantic;
+    result = SemanticAnalysisResult();
+    result.input_a = input_a;
+    result.input_b = input_b;
 
-    cout << "[语义分析] 分析序列包含关系..." << endl;
-    cout << "[语义分析] 序列A: \"" << input_a << "\"" << endl;
-    cout << "[语义分析] 序列B: \"" << input_b << "\"" << endl;
+    LOG_DEBUG("[语义分析] 分析序列包含关系...", {"input_a", input_a}, {"input_b", input_b});
 
     // 直接检查两个完整序列的包含关系
     double containment_a_to_b = detectSemanticContainment(input_a, input_b);
     double containment_b_to_a = detectSemanticContainment(input_b, input_a);
 
     // 保存结果
-    g_semantic_result.containment_strength_a_to_b = containment_a_to_b;
-    g_semantic_result.containment_strength_b_to_a = containment_b_to_a;
+    result.containment_strength_a_to_b = containment_a_to_b;
+    result.containment_strength_b_to_a = containment_b_to_a;
 
     if (containment_a_to_b > 0.0 || containment_b_to_a > 0.0) {
-        g_semantic_result.has_semantic_enhancement = true;
-        cout << "\n[语义分析结果] 发现语义包含关系：" << endl;
-        if (containment_a_to_b > 0.0) {
-            cout << "  A包含B的强度: " << containment_a_to_b << endl;
-        }
-        if (containment_b_to_a > 0.0) {
-            cout << "  B包含A的强度: " << containment_b_to_a << endl;
-        }
+        result.has_semantic_enhancement = true;
+        LOG_INFO("[语义分析结果] 发现语义包含关系",
+                 {"a_contains_b", containment_a_to_b}, {"b_contains_a", containment_b_to_a});
     } else {
-        cout << "\n[语义分析结果] 未发现语义包含关系" << endl;
+        LOG_INFO("[语义分析结果] 未发现语义包含关系");
     }
 }
 
@@ -393,92 +488,95 @@ string preprocessInput(const string& input) {
     // 3. 扩展同义词
     // 4. 语义增强
 
-    cout << "[语义预处理] 输入: " << input << endl;
+    LOG_DEBUG("[语义预处理] 输入: " << input);
 
     // 当前直接返回原输入，后续可在此添加逻辑
     string processed = input;
 
-    cout << "[语义预处理] 处理后: " << processed << endl;
+    LOG_DEBUG("[语义预处理] 处理后: " << processed);
     return processed;
 }
 
+/**
+ * 将特征片段列表格式化为显示字符串
+ * @param items 逗号分隔解析后的特征片段
+ * @return 显示字符串，如 "[red,apple]"
+ */
+string formatFeatureDisplay(const vector<string>& items) {
+    string display = "[";
+    for (size_t i = 0; i < items.size(); i++) {
+        if (i > 0) display += ",";
+        display += items[i];
+    }
+    display += "]";
+    return display;
+}
+
+/**
+ * 格式化相似度计算结果（与approacher的结果输出格式一致）
+ * @param query 查询上下文（提供输入和匹配选项）
+ * @param result 相似度计算结果
+ * @return 结果文本
+ */
+string formatSimilarityResult(const QueryContext& query, const SimilarityResult& result) {
+    if (result.main_similarity == 0.0) {
+        return "无重合概念，相似度为 0\n";
+    }
+
+    string display_a = formatFeatureDisplay(query.input_a);
+    string display_b = formatFeatureDisplay(query.input_b);
+
+    stringstream ss;
+    ss << "=== 计算结果 ===\n";
+    ss << "匹配模式: " << (query.options.use_fuzzy_matching ? "模糊匹配" : "精确匹配") << "\n";
+    ss << "匹配概念数 - A: " << result.matches_A_count << ", B: " << result.matches_B_count
+       << ", 重合: " << result.total_matches << "\n";
+    ss << display_a << "->" << display_b << " : " << result.partial_a_to_b << "\n";
+    ss << display_a << "<-" << display_b << " : " << result.partial_b_to_a << "\n";
+    ss << display_a << "<->" << display_b << " : " << result.main_similarity << "\n";
+    return ss.str();
+}
+
 /**
  * 输出后处理函数
- * 对approacher的输出进行后处理和增强
- * @param approacher_output approacher程序的原始输出
- * @param original_input_a 用户输入的原始对象A
- * @param original_input_b 用户输入的原始对象B
+ * 对approacher引擎的计算结果应用语义增强并生成输出
+ * @param context 本次查询的上下文（语义分析结果和approacher计算结果）
  * @return 增强后的输出
  */
-string postprocessOutput(const string& approacher_output, const string& original_input_a, const string& original_input_b) {
-    cout << "[语义后处理] 分析Approacher输出并应用语义增强..." << endl;
+string postprocessOutput(const SemanticRequestContext& context) {
+    LOG_DEBUG("[语义后处理] 分析Approacher结果并应用语义增强...");
 
-    string enhanced_output = approacher_output;
+    const SemanticAnalysisResult& semantic = context.semantic;
+    SimilarityResult enhanced = context.query.result;
 
     // 如果检测到语义包含关系，需要增强相似度
-    if (g_semantic_result.has_semantic_enhancement) {
-        cout << "[语义后处理] 检测到语义包含关系，应用相似度增强" << endl;
-
-        // 解析approacher输出中的相似度百分比
-        stringstream ss(approacher_output);
-        string line;
-        string enhanced_lines;
-
-        while (getline(ss, line)) {
-            // 查找包含相似度的行（格式如 "[apple,red]->[apple] : 1.217"）
-            size_t colon_pos = line.find(" : ");
-            if (colon_pos != string::npos) {
-                // 提取冒号后的数字
-                string score_part = line.substr(colon_pos + 3);
-
-                // 去除空格并提取数字
-                size_t score_start = score_part.find_first_not_of(" \t");
-                if (score_start != string::npos) {
-                    size_t score_end = score_part.find_first_of(" \t\n", score_start);
-                    if (score_end == string::npos) score_end = score_part.length();
-
-                    string score_str = score_part.substr(score_start, score_end - score_start);
-
-                    try {
-                        double original_score = stod(score_str);
-
-                        // 应用语义增强
-                        double enhancement_factor = max(g_semantic_result.containment_strength_a_to_b,
-                                                       g_semantic_result.containment_strength_b_to_a);
-                        double enhanced_score = original_score * enhancement_factor;
-
-                        // 替换原分数
-                        string enhanced_line = line.substr(0, colon_pos + 3) + to_string(enhanced_score);
-
-                        enhanced_lines += enhanced_line + "\n";
-
-                        cout << "[语义后处理] 相似度增强: " << original_score << " → "
-                             << enhanced_score << " (增强系数: " << enhancement_factor << ")" << endl;
-                    } catch (const exception& e) {
-                        // 如果解析失败，保持原行
-                        enhanced_lines += line + "\n";
-                    }
-                } else {
-                    enhanced_lines += line + "\n";
-                }
-            } else {
-                enhanced_lines += line + "\n";
-            }
+    if (semantic.has_semantic_enhancement) {
+        LOG_INFO("[语义后处理] 检测到语义包含关系，应用相似度增强");
+
+        double enhancement_factor = max(semantic.containment_strength_a_to_b,
+                                       semantic.containment_strength_b_to_a);
+
+        // 对分相似度和主相似度应用语义增强
+        for (double* score : {&enhanced.partial_a_to_b, &enhanced.partial_b_to_a, &enhanced.main_similarity}) {
+            double original_score = *score;
+            *score = original_score * enhancement_factor;
+            LOG_INFO("[语义后处理] 相似度增强: " << original_score << " → " << *score,
+                     {"factor", enhancement_factor});
         }
-
-        enhanced_output = enhanced_lines;
     }
 
+    string enhanced_output = formatSimilarityResult(context.query, enhanced);
+
     // 添加语义分析报告
     enhanced_output += "\n=== 语义分析报告 ===\n";
 
-    if (g_semantic_result.has_semantic_enhancement) {
+    if (semantic.has_semantic_enhancement) {
         enhanced_output += "[语义包含关系] 检测成功\n";
-        if (g_semantic_result.containment_strength_a_to_b > 0.0) {
-            enhanced_output += "  A包含B (强度: " + to_string(g_semantic_result.containment_strength_a_to_b) + ")\n";
+        if (semantic.containment_strength_a_to_b > 0.0) {
+            enhanced_output += "  A包含B (强度: " + to_string(semantic.containment_strength_a_to_b) + ")\n";
         }
-        if (g_semantic_result.containment_strength_b_to_a > 0.0) {
-            enhanced_output += "  B包含A (强度: " + to_string(g_semantic_result.containment_strength_b_to_a) + ")\n";
+        if (semantic.containment_strength_b_to_a > 0.0) {
+            enhanced_output += "  B包含A (强度: " + to_string(semantic.containment_strength_b_to_a) + ")\n";
         }
         enhanced_output += "  相似度已按包含关系进行增强\n";
     } else {
@@ -490,63 +588,25 @@ string postprocessOutput(const string& approacher_output, const string& original
 }
 
 /**
- * 调用approacher程序并获取输出
- * @param input_a 处理后的输入A
- * @param input_b 处理后的输入B
- * @return approacher的输出结果
+ * 在进程内调用approacher引擎计算相似度
+ * 直接使用已打开的概念数据库和查询上下文中的参数表快照，不再启动子进程
+ * @param query 查询上下文，结果写入query.result
+ * @return 结构化的相似度计算结果
  */
-string callApproacher(const string& input_a, const string& input_b) {
-    // 创建临时输入文件
-    string temp_input_file = "/tmp/approacher_input.txt";
-    ofstream temp_file(temp_input_file);
-    temp_file << input_a << "\n" << input_b << "\nquit\n";
-    temp_file.close();
-
-    // 调用approacher程序
-    string command = "cd /home/laplace/approacher && ";
-    command += "export LD_LIBRARY_PATH='/home/laplace/things/lib:$LD_LIBRARY_PATH' && ";
-    command += "./approacher < " + temp_input_file + " 2>&1";
-
-    // 执行命令并获取输出
-    FILE* pipe = popen(command.c_str(), "r");
-    if (!pipe) {
-        return "错误：无法调用approacher程序";
-    }
-
-    string result;
-    char buffer[256];
-    while (fgets(buffer, sizeof(buffer), pipe) != nullptr) {
-        result += buffer;
+const SimilarityResult& callApproacher(QueryContext& query) {
+    if (!g_semantic_database) {
+        LOG_ERROR("概念数据库未初始化");
+        query.result = SimilarityResult();
+        return query.result;
     }
 
-    pclose(pipe);
-
-    // 清理临时文件
-    remove(temp_input_file.c_str());
-
-    return result;
+    return g_semantic_database->computeSimilarity(query);
 }
 
 // 解析逗号分隔的输入字符串
 vector<string> parseCommaInput(const string& input) {
-    vector<string> result;
-    stringstream ss(input);
-    string item;
-
-    while (getline(ss, item, ',')) {
-        // 去除前后空格
-        size_t start = item.find_first_not_of(" \t");
-        if (start == string::npos) continue; // 空字符串
-
-        size_t end = item.find_last_not_of(" \t");
-        item = item.substr(start, end - start + 1);
-
-        if (!item.empty()) {
-            result.push_back(item);
-        }
-    }
-
-    return result;
+    // 与库中的切分规则相同：单遍扫描，去除前后空格，跳过空项
+    return splitCommaList(input);
 }
 
 /**
@@ -560,7 +620,8 @@ void runSemanticApproacher() {
     cout << "例如: good_content,red" << endl;
     cout << "      content,apple" << endl;
     cout << "特殊命令:" << endl;
-    cout << "  'direct' - 直接调用原approacher（跳过语义处理）" << endl;
+    cout << "  'direct' - 直接使用approacher引擎结果（跳过语义处理）" << endl;
+    cout << "  'log <级别>' - 设置日志级别（trace/debug/info/warn/error/off）" << endl;
     cout << "  'quit' 或 'exit' - 退出程序" << endl;
 
     bool direct_mode = false;
@@ -577,6 +638,14 @@ void runSemanticApproacher() {
             direct_mode = !direct_mode;
             cout << "直接模式: " << (direct_mode ? "开启（跳过语义处理）" : "关闭（使用语义处理）") << endl;
             continue;
+        } else if (line_a.rfind("log", 0) == 0 && (line_a.size() == 3 || line_a[3] == ' ')) {
+            string level_name = line_a.size() > 4 ? line_a.substr(4) : "";
+            LogLevel level;
+            if (Logger::parseLevel(level_name, level)) {
+                Logger::instance().setLevel(level);
+            }
+            cout << "日志级别: " << Logger::levelName(Logger::instance().getLevel()) << endl;
+            continue;
         }
 
         cout << "输入对象B: ";
@@ -590,10 +659,6 @@ void runSemanticApproacher() {
             continue;
         }
 
-        // 保存原始输入
-        string original_a = line_a;
-        string original_b = line_b;
-
         // 首先检查等号键值对的特殊情况
         cout << "\n=== 等号键值对检查阶段 ===" << endl;
         double special_case_result = handleEqualsKeyValueSpecialCases(line_a, line_b);
@@ -616,6 +681,9 @@ void runSemanticApproacher() {
         line_a = equals_processed_a;
         line_b = equals_processed_b;
 
+        // 本次查询的上下文，在各阶段之间显式传递
+        SemanticRequestContext context;
+
         // 根据模式选择处理方式
         string processed_a, processed_b;
 
@@ -627,27 +695,34 @@ void runSemanticApproacher() {
         } else {
             // 语义模式：进行语义关系分析
             cout << "\n=== 语义分析阶段 ===" << endl;
-            analyzeSemanticRelationship(line_a, line_b);
+            analyzeSemanticRelationship(line_a, line_b, context);
 
             // 预处理输入（当前直接返回原输入，语义增强在后处理阶段应用）
             processed_a = preprocessInput(line_a);
             processed_b = preprocessInput(line_b);
         }
 
-        // 调用approacher程序
+        // 在进程内调用approacher引擎（默认选项与approacher一致：精确匹配）
         cout << "\n=== 调用Approacher计算 ===" << endl;
-        string approacher_result = callApproacher(processed_a, processed_b);
+        context.query = makeQueryContext(parseCommaInput(processed_a), parseCommaInput(processed_b));
+        try {
+            callApproacher(context.query);
+        } catch (const exception& e) {
+            cout << "相似度计算失败: " << e.what() << endl;
+            continue;
+        }
 
         // 后处理输出
         string final_output;
         if (direct_mode) {
-            final_output = approacher_result;
+            final_output = formatSimilarityResult(context.query, context.query.result);
         } else {
             cout << "\n=== 语义后处理阶段 ===" << endl;
-            final_output = postprocessOutput(approacher_result, original_a, original_b);
+            final_output = postprocessOutput(context);
         }
 
-        // 显示最终结果
+        // 显示最终结果（先写完异步日志，避免与结果交错）
+        Logger::instance().flush();
         cout << "\n" << string(50, '=') << endl;
         cout << "最终结果:" << endl;
         cout << final_output << endl;
@@ -732,7 +807,7 @@ double handleEqualsKeyValueSpecialCases(const string& input_a, const string& inp
 
     // 特殊情况1: 两个完全相同的等号键值对
     if (a_is_equals_kv && b_is_equals_kv && input_a == input_b) {
-        cout << "[等号键值对] 检测到完全相同的键值对，返回固定相似度100" << endl;
+        LOG_INFO("[等号键值对] 检测到完全相同的键值对，返回固定相似度100", {"input", input_a});
         return 100.0;
     }
 
@@ -740,7 +815,7 @@ double handleEqualsKeyValueSpecialCases(const string& input_a, const string& inp
     if (a_is_equals_kv && !b_is_equals_kv) {
         string key_a = extractKeyFromEqualsKeyValue(input_a);
         if (!key_a.empty() && key_a == input_b) {
-            cout << "[等号键值对] 检测到键值对与对应键的匹配: \"" << input_a << "\" vs \"" << input_b << "\"，返回固定相似度100" << endl;
+            LOG_INFO("[等号键值对] 检测到键值对与对应键的匹配，返回固定相似度100", {"input_a", input_a}, {"input_b", input_b});
             return 100.0;
         }
     }
@@ -749,7 +824,7 @@ double handleEqualsKeyValueSpecialCases(const string& input_a, const string& inp
     if (!a_is_equals_kv && b_is_equals_kv) {
         string key_b = extractKeyFromEqualsKeyValue(input_b);
         if (!key_b.empty() && input_a == key_b) {
-            cout << "[等号键值对] 检测到键与对应键值对的匹配: \"" << input_a << "\" vs \"" << input_b << "\"，返回固定相似度100" << endl;
+            LOG_INFO("[等号键值对] 检测到键与对应键值对的匹配，返回固定相似度100", {"input_a", input_a}, {"input_b", input_b});
             return 100.0;
         }
     }
@@ -772,10 +847,10 @@ void preprocessEqualsKeyValuePairs(const string& input_a, const string& input_b,
     processed_b = convertEqualsToColonKeyValue(input_b);
 
     if (processed_a != input_a) {
-        cout << "[等号键值对] 转换: \"" << input_a << "\" → \"" << processed_a << "\"" << endl;
+        LOG_DEBUG("[等号键值对] 转换: \"" << input_a << "\" → \"" << processed_a << "\"");
     }
     if (processed_b != input_b) {
-        cout << "[等号键值对] 转换: \"" << input_b << "\" → \"" << processed_b << "\"" << endl;
+        LOG_DEBUG("[等号键值对] 转换: \"" << input_b << "\" → \"" << processed_b << "\"");
     }
 }
 
@@ -787,7 +862,7 @@ int main()
     // 初始化数据库连接用于语义分析
     g_semantic_database = make_unique<ConceptDatabase>();
     if (!g_semantic_database->initialize("/home/laplace/things/concepts-db")) {
-        cerr << "警告：无法连接到语义分析数据库，部分功能可能受限" << endl;
+        LOG_WARN("无法连接到语义分析数据库，部分功能可能受限");
     } else {
         cout << "语义分析数据库连接成功" << endl;
         g_semantic_database->printStatistics();
@@ -0,0 +1,255 @@
+#include "BatchPipeline.hpp"
+#include "BoundedQueue.hpp"
+#include "Logger.hpp"
+#include <map>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+
+using namespace std;
+
+// 一行输入在流水线中的状态
+struct BatchRow {
+    size_t line_number = 0;
+    bool valid = false;
+    bool skipped = false;           // 空行或注释行：不评分，输出一个空行以保持行对齐
+    string line;                    // 原始输入行，特征在匹配阶段直接从中解析为视图
+    size_t column_a = 0, length_a = 0;
+    size_t column_b = 0, length_b = 0;
+    vector<Feature> features_A;     // 仅模糊匹配：主相似度需要再做一次精确匹配
+    vector<Feature> features_B;
+    vector<MatchResult> matches_A;  // 仅模糊匹配
+    vector<MatchResult> matches_B;
+    MatchHistogram histogram;       // 精确匹配：匹配阶段直接统计直方图
+    SimilarityResult result;
+
+    string_view columnA() const { return string_view(line).substr(column_a, length_a); }
+    string_view columnB() const { return string_view(line).substr(column_b, length_b); }
+};
+
+// 流水线中传递的数据块（按序号重排后写出）
+struct BatchChunk {
+    size_t sequence = 0;
+    vector<BatchRow> rows;
+};
+
+// 流水线窗口：限制同时在处理中的数据块数量，写出一块后才允许读入下一块
+class ChunkWindow {
+private:
+    mutex window_mutex;
+    condition_variable window_cv;
+    size_t available;
+
+public:
+    explicit ChunkWindow(size_t size) : available(size > 0 ? size : 1) {}
+
+    void acquire() {
+        unique_lock<mutex> lock(window_mutex);
+        window_cv.wait(lock, [this]() { return available > 0; });
+        available--;
+    }
+
+    void release() {
+        lock_guard<mutex> lock(window_mutex);
+        available++;
+        window_cv.notify_one();
+    }
+};
+
+// 逗号分隔的列中是否至少有一项非空特征
+static bool hasCommaItem(string_view column) {
+    bool found = false;
+    forEachCommaItem(column, [&](string_view) { found = true; });
+    return found;
+}
+
+// 定位一行 A<TAB>B 的两列（只记录位置，不切分特征），格式错误时返回false
+static bool parseBatchRow(BatchRow& row) {
+    size_t tab = row.line.find('\t');
+    if (tab == string::npos) return false;
+    size_t second_tab = row.line.find('\t', tab + 1);
+
+    row.column_a = 0;
+    row.length_a = tab;
+    row.column_b = tab + 1;
+    row.length_b = (second_tab == string::npos ? row.line.size() : second_tab) - row.column_b;
+    return hasCommaItem(row.columnA()) && hasCommaItem(row.columnB());
+}
+
+// 格式化一行输出
+static void formatBatchRow(const BatchRow& row, string& out) {
+    if (row.skipped) {
+        out += '\n';
+        return;
+    }
+    if (!row.valid) {
+        out += "\t\t\t\t\t\n";
+        return;
+    }
+
+    char buffer[160];
+    snprintf(buffer, sizeof(buffer), "%.17g\t%.17g\t%.17g\t%d\t%d\t%d\n",
+             row.result.partial_a_to_b, row.result.partial_b_to_a, row.result.main_similarity,
+             row.result.matches_A_count, row.result.matches_B_count, row.result.total_matches);
+    out += buffer;
+}
+
+BatchStats runBatchScoring(ConceptDatabase& database, istream& in, ostream& out, const BatchConfig& config) {
+    BatchStats stats;
+    auto start_time = chrono::steady_clock::now();
+
+    int match_threads = config.match_threads > 0 ? config.match_threads : max(1u, thread::hardware_concurrency());
+    int score_threads = max(1, config.score_threads);
+    size_t chunk_rows = max<size_t>(1, config.chunk_rows);
+
+    // 整批使用同一个参数表快照，并预先建立概念库快照
+    auto params = getPublishedParameters();
+    database.getSnapshot();
+
+    BoundedQueue<BatchChunk> match_queue(config.max_chunks_in_flight);
+    BoundedQueue<BatchChunk> score_queue(config.max_chunks_in_flight);
+    BoundedQueue<BatchChunk> write_queue(config.max_chunks_in_flight);
+    ChunkWindow window(config.max_chunks_in_flight);
+
+    atomic<size_t> row_count(0);
+    atomic<size_t> error_count(0);
+
+    // 阶段1（解析）：顺序读取并解析输入行，按块放入匹配队列
+    thread parse_thread([&]() {
+        string line;
+        size_t line_number = 0;
+        size_t sequence = 0;
+        BatchChunk chunk;
+
+        auto emit = [&]() {
+            chunk.sequence = sequence++;
+            window.acquire();
+            match_queue.push(move(chunk));
+            chunk = BatchChunk();
+            chunk.rows.reserve(chunk_rows);
+        };
+
+        chunk.rows.reserve(chunk_rows);
+        while (getline(in, line)) {
+            line_number++;
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+
+            BatchRow row;
+            row.line_number = line_number;
+            if (line.empty() || line[0] == '#') {
+                row.skipped = true;
+            } else {
+                row.line = line;
+                row.valid = parseBatchRow(row);
+                if (!row.valid) {
+                    error_count++;
+                    LOG_WARN("批量输入格式错误，输出空结果", {"line", line_number});
+                }
+                row_count++;
+            }
+            chunk.rows.push_back(move(row));
+
+            if (chunk.rows.size() >= chunk_rows) {
+                emit();
+            }
+        }
+        if (!chunk.rows.empty()) {
+            emit();
+        }
+        match_queue.close();
+    });
+
+    // 阶段2（匹配）：从输入行解析特征视图，在概念库快照上匹配两侧特征
+    // 精确匹配直接在视图上统计直方图；模糊匹配需要保存特征，转为Feature后匹配
+    atomic<int> active_match_threads(match_threads);
+    vector<thread> match_workers;
+    for (int t = 0; t < match_threads; t++) {
+        match_workers.emplace_back([&]() {
+            BatchChunk chunk;
+            vector<FeatureView> views_A, views_B;
+            while (match_queue.pop(chunk)) {
+                for (BatchRow& row : chunk.rows) {
+                    if (!row.valid) continue;
+                    views_A.clear();
+                    views_B.clear();
+                    parseFeatureViews(row.columnA(), views_A);
+                    parseFeatureViews(row.columnB(), views_B);
+
+                    if (!config.options.use_fuzzy_matching) {
+                        row.histogram = database.computeMatchHistogram(views_A, views_B);
+                        continue;
+                    }
+                    row.features_A = toFeatureList(views_A);
+                    row.features_B = toFeatureList(views_B);
+                    row.matches_A = database.findMatchingConcepts(row.features_A, config.options.use_fuzzy_matching,
+                                                                  config.options.fuzzy_threshold, config.options.max_recursive_depth);
+                    row.matches_B = database.findMatchingConcepts(row.features_B, config.options.use_fuzzy_matching,
+                                                                  config.options.fuzzy_threshold, config.options.max_recursive_depth);
+                }
+                score_queue.push(move(chunk));
+            }
+            if (--active_match_threads == 0) {
+                score_queue.close();
+            }
+        });
+    }
+
+    // 阶段3（评分）：由匹配结果或直方图计算分相似度和主相似度，释放匹配结果和输入行
+    atomic<int> active_score_threads(score_threads);
+    vector<thread> score_workers;
+    for (int t = 0; t < score_threads; t++) {
+        score_workers.emplace_back([&]() {
+            BatchChunk chunk;
+            while (score_queue.pop(chunk)) {
+                for (BatchRow& row : chunk.rows) {
+                    if (!row.valid) continue;
+                    if (!config.options.use_fuzzy_matching) {
+                        row.result = database.scoreHistogram(row.histogram, *params);
+                    } else {
+                        row.result = database.scoreSimilarity(row.features_A, row.features_B, row.matches_A, row.matches_B,
+                                                              config.options, *params);
+                        row.matches_A = vector<MatchResult>();
+                        row.matches_B = vector<MatchResult>();
+                    }
+                    row.line = string();
+                }
+                write_queue.push(move(chunk));
+            }
+            if (--active_score_threads == 0) {
+                write_queue.close();
+            }
+        });
+    }
+
+    // 写出（当前线程）：按序号重排，保持输入顺序
+    out << "#partial_a_to_b\tpartial_b_to_a\tmain\tmatches_a\tmatches_b\toverlap\n";
+    map<size_t, BatchChunk> pending;
+    size_t next_sequence = 0;
+    BatchChunk chunk;
+    string buffer;
+    while (write_queue.pop(chunk)) {
+        pending.emplace(chunk.sequence, move(chunk));
+        while (!pending.empty() && pending.begin()->first == next_sequence) {
+            buffer.clear();
+            for (const BatchRow& row : pending.begin()->second.rows) {
+                formatBatchRow(row, buffer);
+            }
+            out << buffer;
+            pending.erase(pending.begin());
+            next_sequence++;
+            window.release();
+        }
+    }
+    out.flush();
+
+    parse_thread.join();
+    for (thread& worker : match_workers) worker.join();
+    for (thread& worker : score_workers) worker.join();
+
+    stats.rows = row_count;
+    stats.errors = error_count;
+    stats.scored = stats.rows - stats.errors;
+    stats.seconds = chrono::duration<double>(chrono::steady_clock::now() - start_time).count();
+    return stats;
+}
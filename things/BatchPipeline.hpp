@@ -0,0 +1,30 @@
+#pragma once
+
+#include <iostream>
+#include "ConceptDatabase.hpp"
+
+using namespace std;
+
+// 批量评分配置
+struct BatchConfig {
+    SimilarityOptions options;          // 匹配选项（整批相同）
+    int match_threads = 0;              // 匹配阶段线程数，0表示按CPU核数
+    int score_threads = 1;              // 评分阶段线程数
+    size_t chunk_rows = 256;            // 每个数据块的行数
+    size_t max_chunks_in_flight = 16;   // 同时在流水线中的数据块上限（含等待按序写出的块）
+};
+
+// 批量评分统计
+struct BatchStats {
+    size_t rows = 0;        // 读取的数据行数（不含注释和空行）
+    size_t scored = 0;      // 成功评分的行数
+    size_t errors = 0;      // 格式错误的行数（输出空结果行以保持对齐）
+    double seconds = 0.0;   // 总耗时
+};
+
+// 流式批量评分：从in逐行读取 A<TAB>B（其余列忽略，#开头为注释），
+// 经 解析 → 匹配 → 评分 三个阶段的有界多线程流水线处理，按输入顺序向out写出
+//   partial_a_to_b<TAB>partial_b_to_a<TAB>main<TAB>matches_a<TAB>matches_b<TAB>overlap
+// 输出在一行表头之后与输入逐行对应：格式错误的行输出各列为空的结果行，空行和注释行输出空行
+// 整批使用开始时发布的参数表
+BatchStats runBatchScoring(ConceptDatabase& database, istream& in, ostream& out, const BatchConfig& config);
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+
+using namespace std;
+
+// 有界阻塞队列：满时push阻塞（把压力传递给生产者），空时pop阻塞
+// close后不再接受新元素，消费者取完剩余元素后pop返回false
+template <typename T>
+class BoundedQueue {
+private:
+    mutex queue_mutex;
+    condition_variable not_empty;
+    condition_variable not_full;
+    deque<T> items;
+    size_t capacity;
+    bool closed = false;
+
+public:
+    explicit BoundedQueue(size_t max_items) : capacity(max_items > 0 ? max_items : 1) {}
+
+    // 放入元素，队列已关闭时返回false
+    bool push(T item) {
+        unique_lock<mutex> lock(queue_mutex);
+        not_full.wait(lock, [this]() { return items.size() < capacity || closed; });
+        if (closed) return false;
+        items.push_back(move(item));
+        not_empty.notify_one();
+        return true;
+    }
+
+    // 不等待地放入元素：队列已满或已关闭时返回false，item保持不变（供不能阻塞的生产者使用，例如poll循环）
+    bool tryPush(T& item) {
+        lock_guard<mutex> lock(queue_mutex);
+        if (closed || items.size() >= capacity) return false;
+        items.push_back(move(item));
+        not_empty.notify_one();
+        return true;
+    }
+
+    // 取出元素，队列已关闭且为空时返回false
+    bool pop(T& item) {
+        unique_lock<mutex> lock(queue_mutex);
+        not_empty.wait(lock, [this]() { return !items.empty() || closed; });
+        if (items.empty()) return false;
+        item = move(items.front());
+        items.pop_front();
+        not_full.notify_one();
+        return true;
+    }
+
+    void close() {
+        lock_guard<mutex> lock(queue_mutex);
+        closed = true;
+        not_empty.notify_all();
+        not_full.notify_all();
+    }
+
+    size_t size() {
+        lock_guard<mutex> lock(queue_mutex);
+        return items.size();
+    }
+};
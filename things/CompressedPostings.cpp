@@ -0,0 +1,19 @@
+#include "CompressedPostings.hpp"
+
+using namespace std;
+
+void CompressedPostings::encode(const vector<uint32_t>& positions, vector<SkipEntry>& skips, vector<uint8_t>& bytes) {
+    size_t base = bytes.size();
+    for (size_t i = 0; i < positions.size(); i++) {
+        if (i > 0 && i % BLOCK_SIZE == 0) {
+            skips.push_back({positions[i], (uint32_t)(bytes.size() - base)});
+            continue;
+        }
+        uint32_t delta = i > 0 ? positions[i] - positions[i - 1] : positions[0];
+        while (delta >= 0x80) {
+            bytes.push_back((uint8_t)(delta | 0x80));
+            delta >>= 7;
+        }
+        bytes.push_back((uint8_t)delta);
+    }
+}
@@ -0,0 +1,244 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+
+using namespace std;
+
+// 压缩倒排列表：升序的概念位置每BLOCK_SIZE个一块，相对前一个位置的差值用varint编码（每字节7位）
+// 第一块之后每块一个跳表项（块首位置和块内差值的字节偏移），按位置跳转时先在跳表上二分，再在块内顺序解码
+// 常见值的列表差值小，每个位置1-2字节，只出现一次的值只占几个字节
+// 对象本身只是描述项：编码后的数据与它放在同一块快照映像中，按相对于对象自身地址的偏移引用，
+// 映像无论在内存中构建还是从文件映射到任意地址都可以直接使用；描述项不能复制，只能在映像中原地使用
+class CompressedPostings {
+public:
+    static const uint32_t BLOCK_SIZE = 128;
+
+    struct SkipEntry {
+        uint32_t first;    // 块中第一个位置（不编码进差值；第一块的块首相对0编码在bytes开头）
+        uint32_t offset;   // 块中第二个位置的差值在bytes中的偏移
+    };
+
+    CompressedPostings() = default;
+    CompressedPostings(const CompressedPostings&) = delete;
+    CompressedPostings& operator=(const CompressedPostings&) = delete;
+
+    // 编码positions，跳表项和差值分别追加到skips和bytes
+    static void encode(const vector<uint32_t>& positions, vector<SkipEntry>& skips, vector<uint8_t>& bytes);
+
+    // 指向已写入映像的编码数据（skip_data和byte_data与本对象在同一块映像中）
+    void attach(uint32_t position_count, const SkipEntry* skip_data, uint32_t skip_entries,
+                const uint8_t* byte_data, uint32_t byte_length) {
+        count = position_count;
+        skip_count = skip_entries;
+        byte_count = byte_length;
+        skips_offset = reinterpret_cast<const char*>(skip_data) - reinterpret_cast<const char*>(this);
+        bytes_offset = reinterpret_cast<const char*>(byte_data) - reinterpret_cast<const char*>(this);
+    }
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
+    // 编码后占用的字节数
+    size_t memoryBytes() const { return byte_count + skip_count * sizeof(SkipEntry); }
+
+    // 结构检查（校验加载的快照文件时用，见SnapshotImage::verifyStructure）：跳表项数与位置数相符，跳表和差值字节落在给定的两段之内，
+    // 各跳表项的块首升序、字节偏移不超过差值字节数（最后一块只有块首时等于）；不解码差值
+    bool withinSections(const SkipEntry* skips_begin, size_t skips_available,
+                        const uint8_t* bytes_begin, size_t bytes_available) const {
+        size_t expected_skips = count == 0 ? 0 : (count - 1) / BLOCK_SIZE;
+        if (skip_count != expected_skips || (count > 0 && byte_count == 0)) return false;
+        // 按整数算地址，损坏的偏移不会产生越界指针
+        uintptr_t self = reinterpret_cast<uintptr_t>(this);
+        uintptr_t skip_address = self + (uintptr_t)skips_offset;
+        uintptr_t byte_address = self + (uintptr_t)bytes_offset;
+        uintptr_t skips_low = reinterpret_cast<uintptr_t>(skips_begin);
+        uintptr_t bytes_low = reinterpret_cast<uintptr_t>(bytes_begin);
+        if (skip_count > 0) {
+            if (skip_address < skips_low || (skip_address - skips_low) % sizeof(SkipEntry) != 0 ||
+                (skip_address - skips_low) / sizeof(SkipEntry) > skips_available ||
+                skip_count > skips_available - (skip_address - skips_low) / sizeof(SkipEntry)) {
+                return false;
+            }
+        }
+        if (byte_count > 0) {
+            if (byte_address < bytes_low || byte_address - bytes_low > bytes_available ||
+                byte_count > bytes_available - (byte_address - bytes_low)) {
+                return false;
+            }
+        }
+        const SkipEntry* skips = skipData();
+        for (uint32_t i = 0; i < skip_count; i++) {
+            if (skips[i].offset > byte_count || (i > 0 && skips[i].first <= skips[i - 1].first)) return false;
+        }
+        return true;
+    }
+
+    // 顺序游标，支持跳到第一个不小于目标的位置
+    // 解码不越过当前块的差值字节（块的范围由跳表给出，最后一块到byte_count为止）；
+    // 数据损坏、差值越界时游标提前结束，不读出列表之外
+    class Cursor {
+    public:
+        Cursor() = default;
+        explicit Cursor(const CompressedPostings& postings)
+            : skips(postings.skipData()), skips_end(postings.skipData() + postings.skip_count),
+              bytes(postings.byteData()), byte_count(postings.byte_count), count(postings.count) {
+            block_end = skips < skips_end ? min<size_t>(skips[0].offset, byte_count) : byte_count;
+            if (count > 0) value = readVarint();
+        }
+
+        bool exhausted() const { return index >= count; }
+        uint32_t current() const { return value; }
+        size_t size() const { return count; }
+
+        void next() {
+            if (++index >= count) return;
+            if (index % BLOCK_SIZE == 0) {
+                enterBlock(index / BLOCK_SIZE);
+            } else {
+                value += readVarint();
+            }
+        }
+
+        // 移到第一个不小于target的位置（已经不小于时不动）
+        void seek(uint32_t target) {
+            if (exhausted() || value >= target) return;
+            // 跳表上找最后一个块首不大于target的块，在当前块之后才跳过去（skips[i]对应第i+1块）
+            const SkipEntry* it = upper_bound(skips + block, skips_end, target,
+                                              [](uint32_t position, const SkipEntry& skip) { return position < skip.first; });
+            size_t target_block = it - skips;
+            if (target_block > block) {
+                enterBlock(target_block);
+            }
+            while (!exhausted() && value < target) {
+                next();
+            }
+        }
+
+    private:
+        const SkipEntry* skips = nullptr;
+        const SkipEntry* skips_end = nullptr;
+        const uint8_t* bytes = nullptr;
+        size_t byte_count = 0;
+        uint32_t count = 0;
+        size_t block = 0;     // 当前块
+        size_t offset = 0;    // 下一个差值在bytes中的偏移
+        size_t block_end = 0; // 当前块的差值在bytes中的结束偏移
+        uint32_t index = 0;   // 当前位置在列表中的序号
+        uint32_t value = 0;   // 当前位置
+
+        // 进入第new_block块（new_block ≥ 1）
+        void enterBlock(size_t new_block) {
+            block = new_block;
+            index = new_block * BLOCK_SIZE;
+            value = skips[new_block - 1].first;
+            offset = skips[new_block - 1].offset;
+            block_end = skips + new_block < skips_end ? min<size_t>(skips[new_block].offset, byte_count) : byte_count;
+        }
+
+        // 读一个差值；越过当前块或超过5字节（不是合法的32位varint）时游标结束
+        uint32_t readVarint() {
+            uint32_t result = 0;
+            int shift = 0;
+            uint8_t byte;
+            do {
+                if (offset >= block_end || shift > 28) {
+                    index = count;
+                    return 0;
+                }
+                byte = bytes[offset++];
+                result |= (uint32_t)(byte & 0x7F) << shift;
+                shift += 7;
+            } while (byte & 0x80);
+            return result;
+        }
+    };
+
+    Cursor cursor() const { return Cursor(*this); }
+
+    // 全部位置按升序追加到out
+    template <typename Container>
+    void appendTo(Container& out) const {
+        for (Cursor it(*this); !it.exhausted(); it.next()) {
+            out.push_back(it.current());
+        }
+    }
+
+private:
+    uint32_t count = 0;
+    uint32_t skip_count = 0;
+    uint32_t byte_count = 0;
+    uint32_t reserved = 0;
+    int64_t skips_offset = 0;   // 跳表相对于本对象地址的偏移
+    int64_t bytes_offset = 0;   // 差值字节相对于本对象地址的偏移
+
+    const SkipEntry* skipData() const {
+        return reinterpret_cast<const SkipEntry*>(reinterpret_cast<const char*>(this) + skips_offset);
+    }
+    const uint8_t* byteData() const {
+        return reinterpret_cast<const uint8_t*>(reinterpret_cast<const char*>(this) + bytes_offset);
+    }
+};
+
+// 两个列表的交集，按位置升序追加到out：遍历较短的列表，在较长的列表上按跳表跳转
+template <typename Container>
+void intersectPostings(const CompressedPostings& a, const CompressedPostings& b, Container& out) {
+    const CompressedPostings& shorter = a.size() <= b.size() ? a : b;
+    const CompressedPostings& longer = a.size() <= b.size() ? b : a;
+    CompressedPostings::Cursor probe(longer);
+    for (CompressedPostings::Cursor it(shorter); !it.exhausted() && !probe.exhausted(); it.next()) {
+        probe.seek(it.current());
+        if (!probe.exhausted() && probe.current() == it.current()) {
+            out.push_back(it.current());
+        }
+    }
+}
+
+// 多个列表的并集，按位置升序、去重后追加到out（各列表直接从压缩形式解码，不单独展开）
+// 列表不多时多路归并，输出本身有序；列表很多时全部解码后排序去重
+const size_t UNION_MERGE_LISTS = 8;
+
+template <typename Container>
+void unionPostings(const CompressedPostings* const* lists, size_t list_count, Container& out) {
+    size_t begin = out.size();
+    size_t total = 0;
+    for (size_t i = 0; i < list_count; i++) {
+        total += lists[i]->size();
+    }
+    out.reserve(begin + total);
+
+    if (list_count <= UNION_MERGE_LISTS) {
+        CompressedPostings::Cursor cursors[UNION_MERGE_LISTS];
+        size_t active = 0;
+        for (size_t i = 0; i < list_count; i++) {
+            if (!lists[i]->empty()) cursors[active++] = lists[i]->cursor();
+        }
+        while (active > 0) {
+            uint32_t smallest = cursors[0].current();
+            for (size_t j = 1; j < active; j++) {
+                smallest = min(smallest, cursors[j].current());
+            }
+            out.push_back(smallest);
+            // 前进所有位于最小位置的游标，耗尽的用最后一个填补
+            for (size_t j = 0; j < active;) {
+                if (cursors[j].current() == smallest) {
+                    cursors[j].next();
+                    if (cursors[j].exhausted()) {
+                        cursors[j] = cursors[--active];
+                        continue;
+                    }
+                }
+                j++;
+            }
+        }
+        return;
+    }
+
+    for (size_t i = 0; i < list_count; i++) {
+        lists[i]->appendTo(out);
+    }
+    sort(out.begin() + begin, out.end());
+    out.erase(unique(out.begin() + begin, out.end()), out.end());
+}
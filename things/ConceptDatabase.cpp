@@ -6,6 +6,20 @@
 #include <cmath>
 #include <set>
 #include <algorithm>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <unordered_set>
+#include <random>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <climits>
+#include "SimpleJson.hpp"
+#include "Logger.hpp"
+#include "QueryTrace.hpp"
+#include "FeatureIdMatch.hpp"
+#include "SnapshotFile.hpp"
 
 using namespace std;
 
@@ -17,15 +31,45 @@ bool ConceptDatabase::initialize(const string& dbPath) {
         conceptBox = make_unique<obx::Box<Concept>>(*store);
         return true;
     } catch (const exception& e) {
-        cerr << "数据库初始化失败: " << e.what() << endl;
+        LOG_ERROR("数据库初始化失败", {"error", e.what()});
         return false;
     }
 }
 
+// 解析概念特征字符串 "key:value,key:value,..."，格式错误的特征跳过并警告
+static void parseConceptFeatures(string_view features_str, int line_number, Concept& concept) {
+    // 单遍切分，键和值在视图上去除空白，只在存入概念时复制一次
+    forEachCommaItem(features_str, [&](string_view feature_str) {
+        size_t colon_pos = feature_str.find(':');
+        if (colon_pos == string_view::npos) {
+            LOG_WARN("特征格式错误，跳过", {"line", line_number}, {"feature", string(feature_str)});
+            return;
+        }
+
+        string_view key = trimBlank(feature_str.substr(0, colon_pos));
+        string_view value = trimBlank(feature_str.substr(colon_pos + 1));
+        if (!key.empty() && !value.empty()) {
+            concept.feature_keys.emplace_back(key);
+            concept.feature_values.emplace_back(value);
+        }
+    });
+}
+
+// 提取方括号中的特征字符串（视图指向line），缺少方括号时返回false
+static bool extractBracketedFeatures(const string& line, size_t from, string_view& features_str) {
+    size_t bracket_start = line.find('[', from);
+    size_t bracket_end = line.find(']', bracket_start);
+    if (bracket_start == string::npos || bracket_end == string::npos) {
+        return false;
+    }
+    features_str = string_view(line).substr(bracket_start + 1, bracket_end - bracket_start - 1);
+    return true;
+}
+
 bool ConceptDatabase::loadFromFile(const string& filename) {
     ifstream file(filename);
     if (!file.is_open()) {
-        cerr << "错误：无法打开文件 " << filename << endl;
+        LOG_ERROR("无法打开文件", {"file", filename});
         return false;
     }
 
@@ -42,7 +86,7 @@ bool ConceptDatabase::loadFromFile(const string& filename) {
         // 解析格式：ID.[key:value,key:value,...]
         size_t dot_pos = line.find('.');
         if (dot_pos == string::npos) {
-            cerr << "警告：第" << line_number << "行格式错误，跳过：" << line << endl;
+            LOG_WARN("概念行格式错误，跳过", {"line", line_number}, {"content", line});
             continue;
         }
 
@@ -51,71 +95,23 @@ bool ConceptDatabase::loadFromFile(const string& filename) {
         try {
             concept_id = stoi(line.substr(0, dot_pos));
         } catch (const invalid_argument& e) {
-            cerr << "警告：第" << line_number << "行ID格式错误，跳过：" << line << endl;
+            LOG_WARN("概念ID格式错误，跳过", {"line", line_number}, {"content", line});
             continue;
         }
 
-        // 查找方括号
-        size_t bracket_start = line.find('[', dot_pos);
-        size_t bracket_end = line.find(']', bracket_start);
-        if (bracket_start == string::npos || bracket_end == string::npos) {
-            cerr << "警告：第" << line_number << "行缺少方括号，跳过：" << line << endl;
+        // 提取方括号中的特征字符串
+        string_view features_str;
+        if (!extractBracketedFeatures(line, dot_pos, features_str)) {
+            LOG_WARN("概念行缺少方括号，跳过", {"line", line_number}, {"content", line});
             continue;
         }
 
-        // 提取特征字符串
-        string features_str = line.substr(bracket_start + 1, bracket_end - bracket_start - 1);
-
         // 创建概念对象
         Concept concept;
         concept.id = 0;  // ObjectBox要求新对象使用ID 0，它会自动分配唯一ID
 
         // 解析特征列表
-        if (!features_str.empty()) {
-            stringstream ss(features_str);
-            string feature_str;
-
-            while (getline(ss, feature_str, ',')) {
-                // 去除前后空格
-                size_t start = feature_str.find_first_not_of(" \t");
-                size_t end = feature_str.find_last_not_of(" \t");
-
-                if (start == string::npos) continue;
-                feature_str = feature_str.substr(start, end - start + 1);
-
-                // 解析键值对
-                size_t colon_pos = feature_str.find(':');
-                if (colon_pos == string::npos) {
-                    cerr << "警告：第" << line_number << "行特征格式错误，跳过：" << feature_str << endl;
-                    continue;
-                }
-
-                string key = feature_str.substr(0, colon_pos);
-                string value = feature_str.substr(colon_pos + 1);
-
-                // 去除key和value的空格
-                if (!key.empty()) {
-                    size_t key_start = key.find_first_not_of(" \t");
-                    size_t key_end = key.find_last_not_of(" \t");
-                    if (key_start != string::npos) {
-                        key = key.substr(key_start, key_end - key_start + 1);
-                    }
-                }
-
-                if (!value.empty()) {
-                    size_t val_start = value.find_first_not_of(" \t");
-                    size_t val_end = value.find_last_not_of(" \t");
-                    if (val_start != string::npos) {
-                        value = value.substr(val_start, val_end - val_start + 1);
-                    }
-                }
-
-                if (!key.empty() && !value.empty()) {
-                    concept.feature_keys.push_back(key);
-                    concept.feature_values.push_back(value);
-                }
-            }
-        }
+        parseConceptFeatures(features_str, line_number, concept);
 
         // 保存到ObjectBox
         if (!concept.feature_keys.empty()) {
@@ -123,13 +119,18 @@ bool ConceptDatabase::loadFromFile(const string& filename) {
                 conceptBox->put(concept);
                 loaded_count++;
             } catch (const exception& e) {
-                cerr << "警告：保存概念" << concept_id << "失败：" << e.what() << endl;
+                LOG_WARN("保存概念失败", {"concept_id", concept_id}, {"error", e.what()});
             }
         }
     }
 
     file.close();
-    cout << "成功从 " << filename << " 加载了 " << loaded_count << " 个概念到数据库" << endl;
+
+    // 已有快照时在新快照建好后替换，查询不会等待
+    if (loaded_count > 0 && atomic_load(&snapshot)) {
+        reloadSnapshot();
+    }
+    LOG_INFO("成功从 " << filename << " 加载了 " << loaded_count << " 个概念到数据库", {"file", filename}, {"count", loaded_count});
     return loaded_count > 0;
 }
 
@@ -137,26 +138,31 @@ unique_ptr<Concept> ConceptDatabase::findById(obx_id id) {
     try {
         return conceptBox->get(id);
     } catch (const exception& e) {
-        cerr << "查找概念失败: " << e.what() << endl;
+        LOG_ERROR("查找概念失败", {"error", e.what()});
         return nullptr;
     }
 }
 
+// 倒排列表中的概念依次还原为概念对象
+static vector<unique_ptr<Concept>> conceptsInList(const ConceptSnapshot& concept_snapshot, const PostingList* list) {
+    vector<unique_ptr<Concept>> results;
+    if (!list) return results;
+    traceCount(TRACE_POSTINGS_TOUCHED, list->positions.size());
+    results.reserve(list->positions.size());
+    for (CompressedPostings::Cursor it = list->positions.cursor(); !it.exhausted(); it.next()) {
+        results.push_back(make_unique<Concept>(concept_snapshot.conceptAt(it.current())));
+    }
+    return results;
+}
+
 vector<unique_ptr<Concept>> ConceptDatabase::findByValue(const string& value) {
     vector<unique_ptr<Concept>> results;
     try {
-        // 获取所有概念并手动筛选（简单实现）
-        auto all_concepts = conceptBox->getAll();
-        for (auto& concept : all_concepts) {
-            for (const auto& feature_value : concept->feature_values) {
-                if (feature_value == value) {
-                    results.push_back(make_unique<Concept>(*concept));
-                    break;
-                }
-            }
-        }
+        // 包含该值的概念就是该值的倒排列表（按ID升序）
+        auto current_snapshot = getSnapshot();
+        results = conceptsInList(*current_snapshot, current_snapshot->findValueList(value));
     } catch (const exception& e) {
-        cerr << "按值查找失败: " << e.what() << endl;
+        LOG_ERROR("按值查找失败", {"error", e.what()});
     }
     return results;
 }
@@ -164,17 +170,10 @@ vector<unique_ptr<Concept>> ConceptDatabase::findByValue(const string& value) {
 vector<unique_ptr<Concept>> ConceptDatabase::findByKeyValue(const string& key, const string& value) {
     vector<unique_ptr<Concept>> results;
     try {
-        auto all_concepts = conceptBox->getAll();
-        for (auto& concept : all_concepts) {
-            for (size_t i = 0; i < concept->feature_keys.size(); i++) {
-                if (concept->feature_keys[i] == key && concept->feature_values[i] == value) {
-                    results.push_back(make_unique<Concept>(*concept));
-                    break;
-                }
-            }
-        }
+        auto current_snapshot = getSnapshot();
+        results = conceptsInList(*current_snapshot, current_snapshot->findKeyValueList(key, value));
     } catch (const exception& e) {
-        cerr << "按键值对查找失败: " << e.what() << endl;
+        LOG_ERROR("按键值对查找失败", {"error", e.what()});
     }
     return results;
 }
@@ -184,23 +183,298 @@ vector<unique_ptr<Concept>> ConceptDatabase::getAllConcepts() {
     try {
         results = conceptBox->getAll();
     } catch (const exception& e) {
-        cerr << "获取所有概念失败: " << e.what() << endl;
+        LOG_ERROR("获取所有概念失败", {"error", e.what()});
     }
     return results;
 }
 
+ConceptStream ConceptDatabase::streamConcepts(size_t batch_size) {
+    return ConceptStream(*store, batch_size);
+}
+
+shared_ptr<const ConceptSnapshot> ConceptDatabase::buildSnapshot() {
+    ConceptSnapshotBuilder builder;
+    forEachConcept([&builder](const Concept& concept) {
+        builder.add(concept);
+        return true;
+    });
+    return builder.finish();
+}
+
 void ConceptDatabase::printStatistics() {
     try {
         auto count = conceptBox->count();
         cout << "数据库统计：" << endl;
         cout << "  概念总数: " << count << endl;
+
+        auto current_snapshot = getSnapshot();
+        const FrequencyStats& frequency = current_snapshot->frequency;
+        cout << "  快照: 版本 " << current_snapshot->version << "，" << current_snapshot->conceptCount() << " 个概念，映像 "
+             << current_snapshot->image->size() / 1024 << " KB（"
+             << (current_snapshot->image->mapped() ? "映射自 " + current_snapshot->image->path() : string("内存中构建")) << "）" << endl;
+        cout << "  值签名: " << current_snapshot->signatures.size() << " 个概念 × 8 字节";
+        if (!current_snapshot->signatures.empty()) {
+            cout << "，平均置位 " << frequency.average_signature_bits << "/64";
+        }
+        cout << endl;
+        cout << "  特征ID: " << current_snapshot->feature_id_count << " 个不同的值和键值对，概念特征ID列 "
+             << current_snapshot->feature_ids.size() * sizeof(uint32_t) / 1024 << " KB，匹配内核 "
+             << idMatchKernelName(activeIdMatchKernel()) << endl;
+        size_t posting_count = 0, posting_bytes = 0;
+        current_snapshot->postingStatistics(posting_count, posting_bytes);
+        cout << "  倒排列表: " << posting_count << " 个位置，压缩后 " << posting_bytes / 1024 << " KB";
+        if (posting_count > 0) {
+            cout << "（每个位置 " << (double)posting_bytes / posting_count << " 字节，未压缩为 " << sizeof(uint32_t) << " 字节）";
+        }
+        cout << endl;
+        cout << "  特征频率: 最常见的出现在 " << frequency.max_frequency << " 个概念中，分布";
+        for (int b = 1; b < 33; b++) {
+            if (frequency.frequency_buckets[b] == 0) continue;
+            uint64_t low = 1ULL << (b - 1);
+            cout << " [" << low << "," << (low << 1) << "):" << frequency.frequency_buckets[b];
+        }
+        cout << endl;
+        MatchCacheStats cache = match_cache.stats();
+        if (cache.capacity_bytes == 0) {
+            cout << "  匹配结果缓存: 已禁用" << endl;
+        } else {
+            cout << "  匹配结果缓存: " << cache.entries << " 项，" << cache.bytes / 1024 << " KB / " << cache.capacity_bytes / 1024
+                 << " KB，命中 " << cache.hits << " 次，未命中 " << cache.misses << " 次（命中率 " << cache.hitRate() * 100.0
+                 << "%），淘汰 " << cache.evictions << " 项，快照替换清空 " << cache.invalidations << " 次" << endl;
+        }
+        MatchFlightStats flight = match_flights.stats();
+        cout << "  并发相同查询合并: " << (match_flights.enabled() ? "启用" : "已禁用") << "，匹配 " << flight.flights
+             << " 次，合并 " << flight.coalesced << " 次，省下匹配时间 " << flight.saved_ns / 1e6 << " 毫秒" << endl;
+    } catch (const exception& e) {
+        LOG_ERROR("获取统计信息失败", {"error", e.what()});
+    }
+}
+
+MatchCacheStats ConceptDatabase::matchCacheStats() const {
+    return match_cache.stats();
+}
+
+void ConceptDatabase::resetMatchCacheStats() {
+    match_cache.resetStats();
+}
+
+void ConceptDatabase::setMatchCacheCapacity(size_t capacity_bytes) {
+    match_cache.setCapacity(capacity_bytes);
+}
+
+void ConceptDatabase::clearMatchCache() {
+    match_cache.clear();
+}
+
+MatchFlightStats ConceptDatabase::singleFlightStats() const {
+    return match_flights.stats();
+}
+
+void ConceptDatabase::resetSingleFlightStats() {
+    match_flights.resetStats();
+}
+
+void ConceptDatabase::setSingleFlightEnabled(bool enabled) {
+    match_flights.setEnabled(enabled);
+}
+
+shared_ptr<const ConceptSnapshot> ConceptDatabase::getSnapshot() {
+    auto current = atomic_load(&snapshot);
+    if (current) {
+        return current;
+    }
+
+    // 首次构建：双重检查，避免多个线程同时构建（之后的替换不经过这里，读者不再等待）
+    lock_guard<mutex> lock(reload_mutex);
+    current = atomic_load(&snapshot);
+    if (!current) {
+        const char* snapshot_env = getenv("APPROACHER_SNAPSHOT");
+        if (snapshot_env && *snapshot_env) {
+            current = openSnapshotForDatabase(snapshot_env);
+        }
+        if (!current) {
+            current = buildSnapshot();
+        }
+        atomic_store(&snapshot, current);
+    }
+    return current;
+}
+
+shared_ptr<const ConceptSnapshot> ConceptDatabase::openSnapshotForDatabase(const string& path) {
+    auto start_time = chrono::steady_clock::now();
+    string error;
+    auto opened = openSnapshotFile(path, snapshotVerifyRequested(), error);
+    if (!opened) {
+        LOG_ERROR("无法加载快照文件，由数据库构建快照", {"file", path}, {"error", error});
+        return nullptr;
+    }
+    double load_ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start_time).count();
+    LOG_INFO("已映射快照文件 " << path << "：版本 " << opened->version << "，概念数 " << opened->conceptCount()
+             << "，" << opened->image->size() / 1024 << " KB",
+             {"file", path}, {"version", opened->version}, {"concepts", opened->conceptCount()},
+             {"bytes", opened->image->size()}, {"load_ms", load_ms});
+    try {
+        uint64_t stored = conceptBox->count();
+        if (stored != opened->conceptCount()) {
+            LOG_WARN("快照文件与数据库的概念数不同，快照可能已过期（reload会由数据库重建）",
+                     {"file", path}, {"snapshot_concepts", opened->conceptCount()}, {"database_concepts", stored});
+        }
     } catch (const exception& e) {
-        cerr << "获取统计信息失败: " << e.what() << endl;
+        LOG_WARN("无法读取数据库概念数", {"error", e.what()});
+    }
+    return opened;
+}
+
+bool ConceptDatabase::loadSnapshotFile(const string& path) {
+    lock_guard<mutex> lock(reload_mutex);
+    auto opened = openSnapshotForDatabase(path);
+    if (!opened) {
+        return false;
     }
+    atomic_store(&snapshot, opened);
+    match_cache.clear();
+    return true;
 }
 
-// 全局pij参数配置
-unordered_map<string, double> g_similarity_params = {
+static bool writeFileAtomically(const string& path, string_view content, string& error);
+
+bool ConceptDatabase::exportSnapshot(const string& path) {
+    auto current = getSnapshot();
+    const SnapshotImage& image = *current->image;
+    string error;
+    if (!writeFileAtomically(path, string_view(reinterpret_cast<const char*>(image.data()), image.size()), error)) {
+        LOG_ERROR("无法写入快照文件", {"file", path}, {"error", error});
+        return false;
+    }
+    LOG_INFO("已导出快照 " << path << "：版本 " << current->version << "，概念数 " << current->conceptCount()
+             << "，" << image.size() / 1024 << " KB",
+             {"file", path}, {"version", current->version}, {"concepts", current->conceptCount()}, {"bytes", image.size()});
+    return true;
+}
+
+shared_ptr<const ConceptSnapshot> ConceptDatabase::publishRebuiltSnapshot() {
+    auto start_time = chrono::steady_clock::now();
+    auto rebuilt = buildSnapshot();
+    auto previous = atomic_load(&snapshot);
+    atomic_store(&snapshot, rebuilt);
+    match_cache.clear();
+
+    double build_ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start_time).count();
+    LOG_INFO("概念库快照已替换：版本 " << (previous ? previous->version : 0) << " → " << rebuilt->version
+             << "，概念数 " << rebuilt->conceptCount(),
+             {"version", rebuilt->version}, {"concepts", rebuilt->conceptCount()}, {"build_ms", build_ms});
+    return rebuilt;
+}
+
+shared_ptr<const ConceptSnapshot> ConceptDatabase::reloadSnapshot() {
+    lock_guard<mutex> lock(reload_mutex);
+    try {
+        return publishRebuiltSnapshot();
+    } catch (const exception& e) {
+        LOG_ERROR("重建概念库快照失败", {"error", e.what()});
+        return atomic_load(&snapshot);
+    }
+}
+
+int ConceptDatabase::applyDelta(const string& filename) {
+    ifstream file(filename);
+    if (!file.is_open()) {
+        LOG_ERROR("无法打开增量文件", {"file", filename});
+        return -1;
+    }
+
+    // 先解析全部行，任何一行格式错误则整个增量不生效
+    struct DeltaOperation {
+        char type;        // '+' 新增, '-' 删除, '=' 替换
+        obx_id id = 0;
+        Concept concept;
+    };
+    vector<DeltaOperation> operations;
+
+    string line;
+    int line_number = 0;
+    while (getline(file, line)) {
+        line_number++;
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        size_t start = line.find_first_not_of(" \t");
+        if (start == string::npos || line[start] == '#') continue;
+
+        DeltaOperation operation;
+        operation.type = line[start];
+        string rest = line.substr(start + 1);
+        bool valid = true;
+
+        try {
+            if (operation.type == '+') {
+                string_view features_str;
+                valid = extractBracketedFeatures(rest, 0, features_str);
+                if (valid) parseConceptFeatures(features_str, line_number, operation.concept);
+                valid = valid && !operation.concept.feature_keys.empty();
+            } else if (operation.type == '-') {
+                operation.id = stoull(rest);
+            } else if (operation.type == '=') {
+                size_t dot_pos = rest.find('.');
+                string_view features_str;
+                valid = dot_pos != string::npos && extractBracketedFeatures(rest, dot_pos, features_str);
+                if (valid) {
+                    operation.id = stoull(rest.substr(0, dot_pos));
+                    parseConceptFeatures(features_str, line_number, operation.concept);
+                    valid = !operation.concept.feature_keys.empty();
+                }
+            } else {
+                valid = false;
+            }
+        } catch (const exception& e) {
+            valid = false;
+        }
+
+        if (!valid || ((operation.type == '-' || operation.type == '=') && operation.id == 0)) {
+            LOG_ERROR("增量文件格式错误，未做任何修改", {"file", filename}, {"line", line_number}, {"content", line});
+            return -1;
+        }
+        operations.push_back(move(operation));
+    }
+
+    // 在一个写事务中应用全部修改，然后重建快照并替换
+    lock_guard<mutex> lock(reload_mutex);
+    int added = 0, removed = 0, replaced = 0;
+    try {
+        obx::Transaction tx = store->txWrite();
+        for (DeltaOperation& operation : operations) {
+            if (operation.type == '+') {
+                operation.concept.id = 0;
+                conceptBox->put(operation.concept);
+                added++;
+            } else if (operation.type == '-') {
+                if (!conceptBox->remove(operation.id)) {
+                    throw runtime_error("概念 " + to_string(operation.id) + " 不存在");
+                }
+                removed++;
+            } else {
+                operation.concept.id = operation.id;
+                conceptBox->put(operation.concept, OBXPutMode_UPDATE);
+                replaced++;
+            }
+        }
+        tx.success();
+    } catch (const exception& e) {
+        LOG_ERROR("应用增量失败，事务已回滚", {"file", filename}, {"error", e.what()});
+        return -1;
+    }
+
+    LOG_INFO("已应用增量 " << filename << "：新增 " << added << "，删除 " << removed << "，替换 " << replaced,
+             {"added", added}, {"removed", removed}, {"replaced", replaced});
+
+    try {
+        publishRebuiltSnapshot();
+    } catch (const exception& e) {
+        LOG_ERROR("重建概念库快照失败", {"error", e.what()});
+    }
+    return added + removed + replaced;
+}
+
+// 默认pij参数配置
+static const unordered_map<string, double> g_default_similarity_params = {
     // 等级1 (20%重合度)
     {"p11", 1.0},   // 双方都是20%重合度
     {"p12", 0.9},   // A:20%, B:40%
@@ -237,21 +511,152 @@ unordered_map<string, double> g_similarity_params = {
     {"p55", 2.0}    // A:100%, B:100%
 };
 
+// 当前发布的参数表，只通过atomic_load/atomic_store访问
+static shared_ptr<const ParameterTable> g_published_params =
+    make_shared<const ParameterTable>(ParameterTable{0, "default", g_default_similarity_params});
+static mutex g_publish_mutex;  // 串行化发布者，保证版本号与发布顺序一致
+
+const unordered_map<string, double>& getDefaultParameters() {
+    return g_default_similarity_params;
+}
+
+shared_ptr<const unordered_map<string, double>> getPublishedParameters() {
+    auto table = atomic_load(&g_published_params);
+    // 别名构造：返回的指针让整张参数表保持存活
+    return shared_ptr<const unordered_map<string, double>>(table, &table->values);
+}
+
+shared_ptr<const ParameterTable> getPublishedParameterTable() {
+    return atomic_load(&g_published_params);
+}
+
+uint64_t publishParameters(const unordered_map<string, double>& params, const string& source) {
+    lock_guard<mutex> lock(g_publish_mutex);
+    uint64_t version = atomic_load(&g_published_params)->version + 1;
+    atomic_store(&g_published_params, make_shared<const ParameterTable>(ParameterTable{version, source, params}));
+    return version;
+}
+
+uint64_t publishParametersIfCurrent(const unordered_map<string, double>& params, const string& source, uint64_t expected_version) {
+    lock_guard<mutex> lock(g_publish_mutex);
+    uint64_t current_version = atomic_load(&g_published_params)->version;
+    if (current_version != expected_version) {
+        return 0;
+    }
+    atomic_store(&g_published_params, make_shared<const ParameterTable>(ParameterTable{current_version + 1, source, params}));
+    return current_version + 1;
+}
+
 // Stage 2: 概念匹配和相似度计算功能
 
 MatchResult ConceptDatabase::matchConceptExact(const vector<Feature>& input_features, const unique_ptr<Concept>& concept) {
+    return matchConceptExact(input_features, *concept);
+}
+
+MatchResult ConceptDatabase::matchConceptExact(const vector<Feature>& input_features, const Concept& concept) {
     MatchResult result;
-    result.concept_id = concept->id;
-    result.match_count = 0;
+    result.concept_id = concept.id;
+
+    // 输入不超过256个特征时位图放在栈上
+    size_t words = (input_features.size() + 63) / 64;
+    uint64_t inline_mask[4];
+    vector<uint64_t> heap_mask;
+    uint64_t* mask = inline_mask;
+    if (words > 4) {
+        heap_mask.resize(words);
+        mask = heap_mask.data();
+    }
 
-    // 遍历每个输入特征
+    result.match_count = matchConceptExactMask(input_features, concept, mask);
     for (size_t i = 0; i < input_features.size(); i++) {
-        const Feature& input_feature = input_features[i];
+        if ((mask[i / 64] >> (i % 64)) & 1) {
+            result.matched_indices.push_back(i);
+        }
+    }
+
+    return result;
+}
+
+// 判断target是否等于若干特征值以"_"连接而成的复合词（逐段比较，不构造复合词字符串）
+// FeatureT为Feature或FeatureView
+template <typename FeatureT>
+static bool equalsCompoundWord(string_view target, const vector<FeatureT>& input_features, const int* indices, int count) {
+    size_t offset = 0;
+    for (int i = 0; i < count; i++) {
+        if (i > 0) {
+            if (offset >= target.size() || target[offset] != '_') return false;
+            offset++;
+        }
+        string_view part = input_features[indices[i]].value;
+        if (target.compare(offset, part.size(), part) != 0) return false;
+        offset += part.size();
+    }
+    return offset == target.size();
+}
+
+// 快照中的一个概念：特征文本直接指向快照字典，与Concept共用匹配代码
+struct SnapshotConcept {
+    const ConceptSnapshot& snapshot;
+    uint32_t position;
+};
+
+static obx_id conceptIdOf(const Concept& concept) { return concept.id; }
+static obx_id conceptIdOf(const SnapshotConcept& concept) { return concept.snapshot.conceptId(concept.position); }
+
+// 按特征顺序访问概念的值，visitor(string_view value)返回false时停止
+template <typename Visitor>
+static void forEachConceptValue(const Concept& concept, Visitor&& visitor) {
+    for (const string& value : concept.feature_values) {
+        if (!visitor(string_view(value))) return;
+    }
+}
+
+template <typename Visitor>
+static void forEachConceptValue(const SnapshotConcept& concept, Visitor&& visitor) {
+    concept.snapshot.forEachConceptValue(concept.position, visitor);
+}
+
+// 按特征顺序访问概念有键的特征，visitor(string_view key, string_view value)返回false时停止
+template <typename Visitor>
+static void forEachConceptKeyValue(const Concept& concept, Visitor&& visitor) {
+    for (size_t j = 0; j < concept.feature_keys.size(); j++) {
+        if (!visitor(string_view(concept.feature_keys[j]), string_view(concept.feature_values[j]))) return;
+    }
+}
+
+template <typename Visitor>
+static void forEachConceptKeyValue(const SnapshotConcept& concept, Visitor&& visitor) {
+    concept.snapshot.forEachConceptKeyValue(concept.position, visitor);
+}
+
+template <typename FeatureT>
+static int matchExactMask(const vector<FeatureT>& input_features, const Concept& concept, uint64_t* mask);
+template <typename FeatureT, typename ConceptT>
+static int matchCompoundMask(const vector<FeatureT>& input_features, const ConceptT& concept, uint64_t* mask, int match_count);
+
+int ConceptDatabase::matchConceptExactMask(const vector<Feature>& input_features, const Concept& concept, uint64_t* mask) {
+    return matchExactMask(input_features, concept, mask);
+}
+
+int ConceptDatabase::matchConceptExactMask(const vector<FeatureView>& input_features, const Concept& concept, uint64_t* mask) {
+    return matchExactMask(input_features, concept, mask);
+}
+
+// 精确匹配核心（Feature与FeatureView共用）
+template <typename FeatureT>
+static int matchExactMask(const vector<FeatureT>& input_features, const Concept& concept, uint64_t* mask) {
+    size_t feature_count = input_features.size();
+    fill(mask, mask + (feature_count + 63) / 64, 0);
+    int match_count = 0;
+
+    // 第一步：逐个特征匹配
+    for (size_t i = 0; i < feature_count; i++) {
+        const FeatureT& input_feature = input_features[i];
         bool matched = false;
 
         if (input_feature.key.empty()) {
             // 模糊匹配：只比较值
-            for (const auto& concept_value : concept->feature_values) {
+            for (const auto& concept_value : concept.feature_values) {
                 if (input_feature.value == concept_value) {
                     matched = true;
                     break;
@@ -259,9 +664,9 @@ MatchResult ConceptDatabase::matchConceptExact(const vector<Feature>& input_feat
             }
         } else {
             // 精确匹配：需要key和value都匹配
-            for (size_t j = 0; j < concept->feature_keys.size(); j++) {
-                if (concept->feature_keys[j] == input_feature.key &&
-                    concept->feature_values[j] == input_feature.value) {
+            for (size_t j = 0; j < concept.feature_keys.size(); j++) {
+                if (concept.feature_keys[j] == input_feature.key &&
+                    concept.feature_values[j] == input_feature.value) {
                     matched = true;
                     break;
                 }
@@ -269,16 +674,71 @@ MatchResult ConceptDatabase::matchConceptExact(const vector<Feature>& input_feat
         }
 
         if (matched) {
-            result.match_count++;
-            result.matched_indices.push_back(i);
+            mask[i / 64] |= 1ULL << (i % 64);
+            match_count++;
         }
     }
 
-    // 第二步：复合词匹配逻辑（只针对模糊匹配的特征）
-    int compound_matches = checkCompoundWordMatches(input_features, concept, result.matched_indices);
-    result.match_count += compound_matches;
+    // 第二步：复合词匹配
+    return matchCompoundMask(input_features, concept, mask, match_count);
+}
 
-    return result;
+// 精确匹配第二步（与checkCompoundWordMatches相同）：尚未匹配的非空无键特征取前10个，
+// 按位掩码从小到大枚举长度≥2的保持顺序的组合，与概念的值比较，命中时新匹配的特征计入
+// ConceptT为Concept或SnapshotConcept
+template <typename FeatureT, typename ConceptT>
+static int matchCompoundMask(const vector<FeatureT>& input_features, const ConceptT& concept, uint64_t* mask, int match_count) {
+    size_t feature_count = input_features.size();
+    int fuzzy_indices[10];
+    int fuzzy_count = 0;
+    for (size_t i = 0; i < feature_count && fuzzy_count < 10; i++) {
+        const FeatureT& input_feature = input_features[i];
+        if (input_feature.key.empty() && !input_feature.value.empty() && !((mask[i / 64] >> (i % 64)) & 1)) {
+            fuzzy_indices[fuzzy_count++] = i;
+        }
+    }
+    if (fuzzy_count < 2) {
+        return match_count;
+    }
+
+    int subset[10];
+    for (int subset_mask = 1; subset_mask < (1 << fuzzy_count); subset_mask++) {
+        if ((subset_mask & (subset_mask - 1)) == 0) {
+            continue;  // 单个特征已在第一步处理
+        }
+        int count = 0;
+        for (int i = 0; i < fuzzy_count; i++) {
+            if (subset_mask & (1 << i)) {
+                subset[count++] = fuzzy_indices[i];
+            }
+        }
+
+        forEachConceptValue(concept, [&](string_view concept_value) {
+            if (!equalsCompoundWord(concept_value, input_features, subset, count)) {
+                return true;
+            }
+            for (int i = 0; i < count; i++) {
+                uint64_t bit = 1ULL << (subset[i] % 64);
+                if (!(mask[subset[i] / 64] & bit)) {
+                    mask[subset[i] / 64] |= bit;
+                    match_count++;
+                }
+            }
+            return false;
+        });
+    }
+
+    return match_count;
+}
+
+// 快照上的精确匹配：第一步用特征ID内核比较（query_ids[i]为第i个输入特征的ID），第二步复合词匹配按字符串进行
+// 结果与matchExactMask相同
+template <typename FeatureT>
+static int matchSnapshotMask(const ConceptSnapshot& concept_snapshot, uint32_t position, const uint32_t* query_ids,
+                             const vector<FeatureT>& input_features, uint64_t* mask) {
+    int match_count = matchFeatureIdMask(query_ids, input_features.size(), concept_snapshot.featureIds(position),
+                                         concept_snapshot.featureIdCount(position), mask);
+    return matchCompoundMask(input_features, SnapshotConcept{concept_snapshot, position}, mask, match_count);
 }
 
 // 复合词匹配辅助函数：生成所有保持顺序的子序列索引组合
@@ -317,7 +777,15 @@ vector<vector<int>> ConceptDatabase::generateSubsequenceIndices(int n) {
 // 复合词匹配辅助函数：检查复合词匹配
 int ConceptDatabase::checkCompoundWordMatches(const vector<Feature>& input_features, const unique_ptr<Concept>& concept, vector<int>& matched_indices) {
     // 安全检查
-    if (!concept || input_features.empty()) {
+    if (!concept) {
+        return 0;
+    }
+    return checkCompoundWordMatches(input_features, *concept, matched_indices);
+}
+
+int ConceptDatabase::checkCompoundWordMatches(const vector<Feature>& input_features, const Concept& concept, vector<int>& matched_indices) {
+    // 安全检查
+    if (input_features.empty()) {
         return 0;
     }
 
@@ -367,7 +835,7 @@ int ConceptDatabase::checkCompoundWordMatches(const vector<Feature>& input_featu
 
         // 检查这个复合词是否匹配概念中的任何字段值
         bool found_match = false;
-        for (const auto& concept_value : concept->feature_values) {
+        for (const auto& concept_value : concept.feature_values) {
             if (compound_word == concept_value) {
                 found_match = true;
                 break;
@@ -393,24 +861,563 @@ vector<MatchResult> ConceptDatabase::findMatchingConcepts(const vector<Feature>&
     vector<MatchResult> results;
 
     try {
-        // 获取所有概念
-        auto all_concepts = conceptBox->getAll();
+        // 在内存快照上通过倒排索引匹配
+        auto current_snapshot = getSnapshot();
+        results = findMatchingConcepts(*current_snapshot, input_features);
+    } catch (const exception& e) {
+        LOG_ERROR("查找匹配概念失败", {"error", e.what()});
+    }
 
-        for (auto& concept : all_concepts) {
-            MatchResult match_result = matchConceptExact(input_features, concept);
+    return results;
+}
 
-            // 只保留有匹配的结果
-            if (match_result.match_count > 0) {
-                results.push_back(match_result);
+template <typename FeatureT>
+static void planExactSide(const ConceptSnapshot& concept_snapshot, const vector<FeatureT>& input_features,
+                          const QueryPlan& plan, SidePlan& side, bool detailed);
+template <typename FeatureT>
+static size_t matchSidePlanned(const ConceptSnapshot& concept_snapshot, const vector<FeatureT>& input_features,
+                               const SidePlan& side, CompactMatchList& out);
+
+vector<MatchResult> ConceptDatabase::findMatchingConcepts(const ConceptSnapshot& concept_snapshot, const vector<Feature>& input_features) {
+    QueryArenaScope arena_scope;
+    CompactMatchList compact(arena_scope.resource());
+    QueryPlan plan;
+    plan.concept_count = concept_snapshot.conceptCount();
+    planExactSide(concept_snapshot, input_features, plan, plan.sides[0], false);
+    matchSidePlanned(concept_snapshot, input_features, plan.sides[0], compact);
+
+    // 展开为对外的匹配结果
+    vector<MatchResult> results;
+    results.reserve(compact.size());
+    for (const CompactMatch& match : compact) {
+        MatchResult match_result(concept_snapshot.conceptId(match.position), match.match_count);
+        match_result.matched_indices.reserve(match.match_count);
+        for (size_t i = 0; i < input_features.size(); i++) {
+            if (match.isMatched(i)) {
+                match_result.matched_indices.push_back(i);
             }
         }
-    } catch (const exception& e) {
-        cerr << "查找匹配概念失败: " << e.what() << endl;
+        results.push_back(move(match_result));
     }
 
     return results;
 }
 
+template <typename FeatureT>
+static size_t matchSnapshotCompact(const ConceptSnapshot& concept_snapshot, const vector<FeatureT>& input_features, CompactMatchList& out);
+
+void ConceptDatabase::findMatchingConceptsCompact(const ConceptSnapshot& concept_snapshot, const vector<Feature>& input_features, CompactMatchList& out) {
+    matchSnapshotCompact(concept_snapshot, input_features, out);
+}
+
+void ConceptDatabase::findMatchingConceptsCompact(const ConceptSnapshot& concept_snapshot, const vector<FeatureView>& input_features, CompactMatchList& out) {
+    matchSnapshotCompact(concept_snapshot, input_features, out);
+}
+
+// 查找输入特征和复合词的倒排列表：lists[i]为第i个输入特征的列表（字典中不存在为nullptr），
+// 字典中存在的复合词的列表追加到compounds（compound_words不为空时同时记下复合词），返回查找的复合词数
+// 复合词由前10个无键特征按顺序组合：没有直接匹配的概念只能通过复合词匹配，
+// 此时未匹配的模糊特征就是全部模糊特征，与matchConceptExactMask的组合方式一致
+// 复合词在线程局部缓冲区中拼接，缓冲区容量保留，稳定后不再分配
+template <typename FeatureT, typename ListVector>
+static int lookupQueryPostings(const ConceptSnapshot& concept_snapshot, const vector<FeatureT>& input_features,
+                               ListVector& lists, ListVector& compounds, vector<string>* compound_words = nullptr) {
+    int fuzzy_indices[10];
+    int fuzzy_count = 0;
+    lists.assign(input_features.size(), nullptr);
+    for (size_t i = 0; i < input_features.size(); i++) {
+        const FeatureT& input_feature = input_features[i];
+        lists[i] = input_feature.key.empty()
+            ? concept_snapshot.findValueList(input_feature.value)
+            : concept_snapshot.findKeyValueList(input_feature.key, input_feature.value);
+        if (input_feature.key.empty() && !input_feature.value.empty() && fuzzy_count < 10) {
+            fuzzy_indices[fuzzy_count++] = i;
+        }
+    }
+
+    int lookups = 0;
+    if (fuzzy_count >= 2) {
+        thread_local string compound_word;
+        for (int subset_mask = 1; subset_mask < (1 << fuzzy_count); subset_mask++) {
+            if ((subset_mask & (subset_mask - 1)) == 0) continue;
+            compound_word.clear();
+            for (int i = 0; i < fuzzy_count; i++) {
+                if (subset_mask & (1 << i)) {
+                    if (!compound_word.empty()) compound_word += '_';
+                    compound_word += input_features[fuzzy_indices[i]].value;
+                }
+            }
+            lookups++;
+            const PostingList* list = concept_snapshot.findValueList(compound_word);
+            if (list) {
+                compounds.push_back(list);
+                if (compound_words) compound_words->push_back(compound_word);
+            }
+        }
+    }
+    return lookups;
+}
+
+// 把一个匹配以紧凑形式追加到out，超过64个输入特征时溢出的位图分配在arena中
+static void appendCompactMatch(CompactMatchList& out, uint32_t position, int match_count, const uint64_t* mask, size_t words) {
+    CompactMatch match;
+    match.position = position;
+    match.match_count = match_count;
+    match.matched_mask = mask[0];
+    if (words > 1) {
+        pmr::memory_resource* arena = out.get_allocator().resource();
+        uint64_t* spill = static_cast<uint64_t*>(arena->allocate((words - 1) * sizeof(uint64_t), alignof(uint64_t)));
+        copy(mask + 1, mask + words, spill);
+        match.spill_mask = spill;
+    }
+    out.push_back(match);
+}
+
+// 快照上的精确匹配（Feature与FeatureView共用），返回验证过的候选概念数
+template <typename FeatureT>
+static size_t matchSnapshotCompact(const ConceptSnapshot& concept_snapshot, const vector<FeatureT>& input_features, CompactMatchList& out) {
+    ScopedStageTimer timer(TRACE_STAGE_EXACT_MATCH);
+    pmr::memory_resource* arena = out.get_allocator().resource();
+
+    // 1. 收集候选概念：至少包含一个输入值（或键值对）或复合词的概念；同时记下每个输入特征的ID
+    //    各倒排列表先记下，最后在压缩形式上直接求并集
+    pmr::vector<const PostingList*> lists(arena);
+    pmr::vector<const PostingList*> compounds(arena);
+    lookupQueryPostings(concept_snapshot, input_features, lists, compounds);
+
+    pmr::vector<uint32_t> query_ids(input_features.size(), NO_FEATURE_ID, arena);
+    pmr::vector<const CompressedPostings*> candidate_lists(arena);
+    size_t postings_touched = 0;
+    for (size_t i = 0; i < lists.size(); i++) {
+        if (lists[i]) {
+            query_ids[i] = lists[i]->id;
+            candidate_lists.push_back(&lists[i]->positions);
+            postings_touched += lists[i]->positions.size();
+        }
+    }
+    for (const PostingList* list : compounds) {
+        candidate_lists.push_back(&list->positions);
+        postings_touched += list->positions.size();
+    }
+
+    traceCount(TRACE_POSTINGS_TOUCHED, postings_touched);
+    pmr::vector<uint32_t> candidates(arena);
+    unionPostings(candidate_lists.data(), candidate_lists.size(), candidates);
+    traceCount(TRACE_CONCEPTS_SCANNED, candidates.size());
+
+    // 2. 对候选概念执行完整匹配，按概念位置（即ID）顺序输出，只保留有匹配的结果
+    size_t words = max<size_t>(1, (input_features.size() + 63) / 64);
+    pmr::vector<uint64_t> mask(words, arena);
+    out.reserve(out.size() + candidates.size());
+    for (uint32_t pos : candidates) {
+        int match_count = matchSnapshotMask(concept_snapshot, pos, query_ids.data(), input_features, mask.data());
+        if (match_count > 0) {
+            appendCompactMatch(out, pos, match_count, mask.data(), words);
+        }
+    }
+    return candidates.size();
+}
+
+template <typename FeatureT>
+static size_t scanSnapshotCompact(const ConceptSnapshot& concept_snapshot, const vector<FeatureT>& input_features, CompactMatchList& out);
+
+void ConceptDatabase::scanMatchingConceptsCompact(const ConceptSnapshot& concept_snapshot, const vector<Feature>& input_features, CompactMatchList& out) {
+    scanSnapshotCompact(concept_snapshot, input_features, out);
+}
+
+void ConceptDatabase::scanMatchingConceptsCompact(const ConceptSnapshot& concept_snapshot, const vector<FeatureView>& input_features, CompactMatchList& out) {
+    scanSnapshotCompact(concept_snapshot, input_features, out);
+}
+
+// 不使用倒排列表的精确匹配：逐个概念用特征ID内核比较，结果与matchSnapshotCompact相同，返回扫描的概念数
+template <typename FeatureT>
+static size_t scanSnapshotCompact(const ConceptSnapshot& concept_snapshot, const vector<FeatureT>& input_features, CompactMatchList& out) {
+    ScopedStageTimer timer(TRACE_STAGE_EXACT_MATCH);
+    pmr::memory_resource* arena = out.get_allocator().resource();
+
+    // 1. 输入特征的ID（字典中没有的特征不可能匹配）和字典中存在的复合词的ID：
+    //    没有直接匹配的概念只有包含其中之一时才可能通过复合词匹配
+    pmr::vector<const PostingList*> lists(arena);
+    pmr::vector<const PostingList*> compounds(arena);
+    lookupQueryPostings(concept_snapshot, input_features, lists, compounds);
+
+    pmr::vector<uint32_t> query_ids(input_features.size(), NO_FEATURE_ID, arena);
+    for (size_t i = 0; i < lists.size(); i++) {
+        if (lists[i]) {
+            query_ids[i] = lists[i]->id;
+        }
+    }
+    pmr::vector<uint32_t> compound_ids(arena);
+    for (const PostingList* list : compounds) {
+        compound_ids.push_back(list->id);
+    }
+
+    // 2. 逐个概念匹配，按位置（即ID）顺序输出
+    size_t words = max<size_t>(1, (input_features.size() + 63) / 64);
+    pmr::vector<uint64_t> mask(words, arena);
+    for (uint32_t pos = 0; pos < concept_snapshot.conceptCount(); pos++) {
+        const uint32_t* concept_ids = concept_snapshot.featureIds(pos);
+        size_t concept_id_count = concept_snapshot.featureIdCount(pos);
+        int match_count = matchFeatureIdMask(query_ids.data(), query_ids.size(), concept_ids, concept_id_count, mask.data());
+        if (match_count == 0) {
+            bool has_compound = false;
+            for (size_t begin = 0; begin < compound_ids.size() && !has_compound; begin += ID_MATCH_BLOCK) {
+                int block_count = (int)min<size_t>(ID_MATCH_BLOCK, compound_ids.size() - begin);
+                has_compound = matchFeatureIds(compound_ids.data() + begin, block_count, concept_ids, concept_id_count) != 0;
+            }
+            if (!has_compound) continue;
+        }
+        match_count = matchCompoundMask(input_features, SnapshotConcept{concept_snapshot, pos}, mask.data(), match_count);
+        if (match_count > 0) {
+            appendCompactMatch(out, pos, match_count, mask.data(), words);
+        }
+    }
+    traceCount(TRACE_CONCEPTS_SCANNED, concept_snapshot.conceptCount());
+    return concept_snapshot.conceptCount();
+}
+
+// 探测：只在probe_matches（另一侧的匹配，按位置升序）中的概念上验证本侧特征，匹配的追加到out（与
+// matchSnapshotCompact结果中这些位置的项相同）；返回本侧在整个快照上的匹配数
+// 直接列表中的概念一定匹配（特征ID相同），匹配数为直接列表的并集大小，加上只出现在复合词列表中、验证后匹配的概念数
+template <typename FeatureT>
+static size_t probeSnapshotCompact(const ConceptSnapshot& concept_snapshot, const vector<FeatureT>& input_features,
+                                   const CompactMatchList& probe_matches, CompactMatchList& out, size_t* verified = nullptr) {
+    ScopedStageTimer timer(TRACE_STAGE_EXACT_MATCH);
+    pmr::memory_resource* arena = out.get_allocator().resource();
+
+    pmr::vector<const PostingList*> lists(arena);
+    pmr::vector<const PostingList*> compounds(arena);
+    lookupQueryPostings(concept_snapshot, input_features, lists, compounds);
+
+    pmr::vector<uint32_t> query_ids(input_features.size(), NO_FEATURE_ID, arena);
+    pmr::vector<const CompressedPostings*> direct_lists(arena);
+    pmr::vector<const CompressedPostings*> compound_lists(arena);
+    size_t postings_touched = 0;
+    for (size_t i = 0; i < lists.size(); i++) {
+        if (lists[i]) {
+            query_ids[i] = lists[i]->id;
+            direct_lists.push_back(&lists[i]->positions);
+            postings_touched += lists[i]->positions.size();
+        }
+    }
+    for (const PostingList* list : compounds) {
+        compound_lists.push_back(&list->positions);
+        postings_touched += list->positions.size();
+    }
+    traceCount(TRACE_POSTINGS_TOUCHED, postings_touched);
+
+    // 1. 本侧的匹配数
+    pmr::vector<uint32_t> direct_positions(arena);
+    unionPostings(direct_lists.data(), direct_lists.size(), direct_positions);
+    size_t match_total = direct_positions.size();
+    size_t words = max<size_t>(1, (input_features.size() + 63) / 64);
+    pmr::vector<uint64_t> mask(words, arena);
+    size_t verified_count = 0;
+    if (!compound_lists.empty()) {
+        pmr::vector<uint32_t> compound_positions(arena);
+        unionPostings(compound_lists.data(), compound_lists.size(), compound_positions);
+        for (uint32_t pos : compound_positions) {
+            if (binary_search(direct_positions.begin(), direct_positions.end(), pos)) continue;
+            verified_count++;
+            if (matchSnapshotMask(concept_snapshot, pos, query_ids.data(), input_features, mask.data()) > 0) {
+                match_total++;
+            }
+        }
+    }
+
+    // 2. 另一侧匹配的概念上的本侧匹配
+    out.reserve(out.size() + probe_matches.size());
+    for (const CompactMatch& probe : probe_matches) {
+        int match_count = matchSnapshotMask(concept_snapshot, probe.position, query_ids.data(), input_features, mask.data());
+        if (match_count > 0) {
+            appendCompactMatch(out, probe.position, match_count, mask.data(), words);
+        }
+    }
+    verified_count += probe_matches.size();
+    traceCount(TRACE_CONCEPTS_SCANNED, verified_count);
+    if (verified) *verified = verified_count;
+    return match_total;
+}
+
+// 精确匹配一侧的计划：特征和复合词的频率估计候选数，在倒排合并和全量扫描之间选择
+template <typename FeatureT>
+static void planExactSide(const ConceptSnapshot& concept_snapshot, const vector<FeatureT>& input_features,
+                          const QueryPlan& plan, SidePlan& side, bool detailed) {
+    thread_local vector<const PostingList*> lists;
+    thread_local vector<const PostingList*> compounds;
+    thread_local vector<size_t> frequencies;
+    vector<string> compound_words;
+    compounds.clear();
+    frequencies.clear();
+    side.feature_count = input_features.size();
+    side.compound_lookups = lookupQueryPostings(concept_snapshot, input_features, lists, compounds,
+                                                detailed ? &compound_words : nullptr);
+    for (size_t i = 0; i < lists.size(); i++) {
+        size_t frequency = lists[i] ? lists[i]->positions.size() : 0;
+        if (lists[i]) {
+            side.direct_lists++;
+            side.direct_postings += frequency;
+            frequencies.push_back(frequency);
+        }
+        if (detailed) {
+            PlanTerm term;
+            term.text = input_features[i].key.empty() ? string(input_features[i].value)
+                : string(input_features[i].key) + ":" + string(input_features[i].value);
+            term.frequency = frequency;
+            side.terms.push_back(term);
+        }
+    }
+    for (size_t i = 0; i < compounds.size(); i++) {
+        side.compound_lists++;
+        side.compound_postings += compounds[i]->positions.size();
+        frequencies.push_back(compounds[i]->positions.size());
+        if (detailed) {
+            PlanTerm term;
+            term.text = compound_words[i];
+            term.frequency = compounds[i]->positions.size();
+            term.compound = true;
+            side.terms.push_back(term);
+        }
+    }
+    side.estimated_candidates = estimateUnionSize(frequencies, concept_snapshot.conceptCount());
+    chooseSidePlan(side, plan, concept_snapshot.frequency.average_signature_bits);
+}
+
+// 精确匹配的相似度计划：两侧各自选择策略后，再考虑探测候选较多的一侧
+template <typename FeatureT>
+static void planExactPair(const ConceptSnapshot& concept_snapshot, const vector<FeatureT>& features_A,
+                          const vector<FeatureT>& features_B, QueryPlan& plan, bool detailed) {
+    plan.concept_count = concept_snapshot.conceptCount();
+    plan.side_count = 2;
+    planExactSide(concept_snapshot, features_A, plan, plan.sides[0], detailed);
+    planExactSide(concept_snapshot, features_B, plan, plan.sides[1], detailed);
+    choosePairPlan(plan);
+}
+
+// 按一侧的计划执行精确匹配（倒排合并或全量扫描），返回验证过的概念数
+template <typename FeatureT>
+static size_t matchSidePlanned(const ConceptSnapshot& concept_snapshot, const vector<FeatureT>& input_features,
+                               const SidePlan& side, CompactMatchList& out) {
+    if (side.strategy == PLAN_SCAN) {
+        traceCount(TRACE_PLAN_SCAN);
+        return scanSnapshotCompact(concept_snapshot, input_features, out);
+    }
+    return matchSnapshotCompact(concept_snapshot, input_features, out);
+}
+
+// 按计划计算两侧的匹配直方图；measure为true时记录各侧的实际耗时和工作量（explain）
+template <typename FeatureT>
+static MatchHistogram matchHistogramPlanned(ConceptDatabase& database, const ConceptSnapshot& concept_snapshot,
+                                            const vector<FeatureT>& features_A, const vector<FeatureT>& features_B,
+                                            QueryPlan& plan, bool measure) {
+    QueryArenaScope arena_scope;
+    CompactMatchList matches[2] = {CompactMatchList(arena_scope.resource()), CompactMatchList(arena_scope.resource())};
+    const vector<FeatureT>* features[2] = {&features_A, &features_B};
+    size_t match_totals[2] = {0, 0};
+
+    // 被探测的一侧要用到另一侧的匹配，放在最后执行
+    int probed = plan.sides[0].strategy == PLAN_PROBE ? 0 : (plan.sides[1].strategy == PLAN_PROBE ? 1 : -1);
+    int order[2] = {probed == 0 ? 1 : 0, probed == 0 ? 0 : 1};
+    for (int side_index : order) {
+        SidePlan& side = plan.sides[side_index];
+        auto start_time = measure ? chrono::steady_clock::now() : chrono::steady_clock::time_point();
+        if (side.strategy == PLAN_PROBE) {
+            traceCount(TRACE_PLAN_PROBE);
+            match_totals[side_index] = probeSnapshotCompact(concept_snapshot, *features[side_index], matches[1 - side_index],
+                                                            matches[side_index], &side.actual_candidates);
+        } else {
+            side.actual_candidates = matchSidePlanned(concept_snapshot, *features[side_index], side, matches[side_index]);
+            match_totals[side_index] = matches[side_index].size();
+        }
+        if (measure) {
+            side.actual_us = chrono::duration<double, micro>(chrono::steady_clock::now() - start_time).count();
+            side.actual_matches = match_totals[side_index];
+        }
+    }
+
+    ScopedStageTimer timer(TRACE_STAGE_OVERLAP);
+    MatchHistogram histogram = database.computeMatchHistogram(matches[0], matches[1], features_A.size(), features_B.size());
+    histogram.matches_A_count = match_totals[0];
+    histogram.matches_B_count = match_totals[1];
+    return histogram;
+}
+
+vector<ScoredConcept> ConceptDatabase::findTopKConcepts(const vector<Feature>& query_features, size_t k, TopKStats* stats) {
+    try {
+        auto current_snapshot = getSnapshot();
+        return findTopKConcepts(*current_snapshot, query_features, k, stats);
+    } catch (const exception& e) {
+        LOG_ERROR("Top-K检索失败", {"error", e.what()});
+        return vector<ScoredConcept>();
+    }
+}
+
+vector<ScoredConcept> ConceptDatabase::findTopKConcepts(const ConceptSnapshot& concept_snapshot, const vector<Feature>& query_features, size_t k, TopKStats* stats) {
+    ScopedStageTimer timer(TRACE_STAGE_TOPK);
+    TopKStats local_stats;
+    k = min<size_t>(k, concept_snapshot.conceptCount());
+    if (k == 0 || query_features.empty()) {
+        if (stats) *stats = local_stats;
+        return vector<ScoredConcept>();
+    }
+
+    // 查询项的倒排列表游标
+    struct TermCursor {
+        CompressedPostings::Cursor postings;
+        double upper_bound;  // 该项对任一概念得分的贡献上界
+
+        uint32_t current() const { return postings.current(); }
+        bool exhausted() const { return postings.exhausted(); }
+    };
+
+    // 1. 特征权重：出现越少的特征越有区分度
+    double concept_count = concept_snapshot.conceptCount();
+    vector<double> weights(query_features.size());
+    vector<uint32_t> query_ids(query_features.size(), NO_FEATURE_ID);
+    vector<TermCursor> cursors;
+    vector<int> fuzzy_indices;
+    for (size_t i = 0; i < query_features.size(); i++) {
+        const Feature& feature = query_features[i];
+        const PostingList* list = feature.key.empty()
+            ? concept_snapshot.findValueList(feature.value)
+            : concept_snapshot.findKeyValueList(feature.key, feature.value);
+        if (list) {
+            query_ids[i] = list->id;
+        }
+        double document_frequency = list ? list->positions.size() : 1.0;
+        weights[i] = log(1.0 + concept_count / document_frequency);
+
+        if (list && !list->positions.empty()) {
+            cursors.push_back({list->positions.cursor(), weights[i]});
+        }
+        if (feature.key.empty() && !feature.value.empty()) {
+            fuzzy_indices.push_back(i);
+        }
+    }
+
+    // 2. 复合词项：命中时覆盖其中每个特征，上界为各特征权重之和
+    //    评分时复合词取前10个尚未匹配的无键特征（matchCompoundMask）；无键特征不超过10个时，
+    //    它们的任一子序列都是这里枚举的子序列，否则可能组成没有游标的复合词，改为逐个概念完整评分
+    bool exhaustive = fuzzy_indices.size() > 10;
+    if (fuzzy_indices.size() >= 2 && !exhaustive) {
+        for (const auto& subseq : generateSubsequenceIndices(fuzzy_indices.size())) {
+            if (subseq.size() < 2) continue;
+            string compound_word;
+            double upper_bound = 0.0;
+            for (size_t i = 0; i < subseq.size(); i++) {
+                if (i > 0) compound_word += "_";
+                compound_word += query_features[fuzzy_indices[subseq[i]]].value;
+                upper_bound += weights[fuzzy_indices[subseq[i]]];
+            }
+            const PostingList* list = concept_snapshot.findValueList(compound_word);
+            if (list && !list->positions.empty()) {
+                cursors.push_back({list->positions.cursor(), upper_bound});
+            }
+        }
+    }
+
+    local_stats.terms = cursors.size();
+    for (const TermCursor& cursor : cursors) {
+        local_stats.postings_total += cursor.postings.size();
+    }
+
+    // 3. 前k个结果保存在小顶堆中（堆顶为当前第k名：得分最低、同分时ID最大）
+    auto better = [](const ScoredConcept& a, const ScoredConcept& b) {
+        if (a.score != b.score) return a.score > b.score;
+        return a.concept_id < b.concept_id;
+    };
+    vector<ScoredConcept> heap;
+    heap.reserve(k + 1);
+    vector<uint64_t> match_mask(max<size_t>(1, (query_features.size() + 63) / 64));  // 完整评分时的匹配位图
+
+    // 完整评分一个概念位置，得分足够高时放入堆
+    auto score_position = [&](uint32_t position) {
+        int match_count = matchSnapshotMask(concept_snapshot, position, query_ids.data(), query_features, match_mask.data());
+        local_stats.candidates_scored++;
+        if (match_count <= 0) return;
+        double matched_weight = 0.0;
+        for (size_t w = 0; w < match_mask.size(); w++) {
+            for (uint64_t bits = match_mask[w]; bits != 0; bits &= bits - 1) {
+                matched_weight += weights[w * 64 + __builtin_ctzll(bits)];
+            }
+        }
+        size_t value_count = concept_snapshot.conceptValueCount(position);
+        double coverage = value_count == 0 ? 1.0 : min(1.0, (double)match_count / value_count);
+
+        ScoredConcept scored;
+        scored.concept_id = concept_snapshot.conceptId(position);
+        scored.score = matched_weight * sqrt(coverage);
+        scored.match_count = match_count;
+
+        if (heap.size() < k) {
+            heap.push_back(scored);
+            push_heap(heap.begin(), heap.end(), better);
+        } else if (better(scored, heap.front())) {
+            pop_heap(heap.begin(), heap.end(), better);
+            heap.back() = scored;
+            push_heap(heap.begin(), heap.end(), better);
+        }
+    };
+
+    if (exhaustive) {
+        for (uint32_t position = 0; position < concept_snapshot.conceptCount(); position++) {
+            score_position(position);
+        }
+        cursors.clear();
+    }
+
+    // 4. WAND：游标按当前位置排序，累加上界直到超过第k名得分，得到枢轴位置；
+    //    枢轴之前的游标直接跳到枢轴位置，只有所有前序游标都在枢轴上时才完整评分
+    while (true) {
+        cursors.erase(remove_if(cursors.begin(), cursors.end(),
+                                [](const TermCursor& cursor) { return cursor.exhausted(); }),
+                      cursors.end());
+        if (cursors.empty()) break;
+
+        sort(cursors.begin(), cursors.end(),
+             [](const TermCursor& a, const TermCursor& b) { return a.current() < b.current(); });
+
+        // 位置按概念ID升序遍历，同分的后来者ID更大，必须严格超过第k名才可能入选
+        // 上界按游标顺序累加，舍入可能比按特征顺序累加的实际得分略小，放宽相对1e-9，由完整评分决定是否入选
+        double threshold = heap.size() < k ? 0.0 : heap.front().score;
+        double accumulated = 0.0;
+        size_t pivot = cursors.size();
+        for (size_t i = 0; i < cursors.size(); i++) {
+            accumulated += cursors[i].upper_bound;
+            if (accumulated * (1.0 + 1e-9) > threshold) {
+                pivot = i;
+                break;
+            }
+        }
+        if (pivot == cursors.size()) break;  // 剩余概念都不可能进入前k
+
+        uint32_t pivot_position = cursors[pivot].current();
+        if (cursors[0].current() != pivot_position) {
+            // 跳过枢轴之前的位置（先按跳表跳到所在的块）
+            for (size_t i = 0; i < pivot; i++) {
+                cursors[i].postings.seek(pivot_position);
+            }
+            continue;
+        }
+
+        score_position(pivot_position);
+
+        for (TermCursor& cursor : cursors) {
+            if (cursor.current() == pivot_position) {
+                cursor.postings.next();
+            } else {
+                break;
+            }
+        }
+    }
+
+    sort_heap(heap.begin(), heap.end(), better);
+    traceCount(TRACE_POSTINGS_TOUCHED, local_stats.postings_total);
+    traceCount(TRACE_CONCEPTS_SCANNED, local_stats.candidates_scored);
+    if (stats) *stats = local_stats;
+    return heap;
+}
+
 vector<MatchResult> ConceptDatabase::findMatchingConcepts(const vector<Feature>& input_features, bool use_fuzzy_matching, double fuzzy_threshold, int max_recursive_depth) {
     if (!use_fuzzy_matching) {
         // 使用精确匹配
@@ -421,47 +1428,62 @@ vector<MatchResult> ConceptDatabase::findMatchingConcepts(const vector<Feature>&
         // 使用递归模糊匹配
         return recursiveMatch(input_features, max_recursive_depth, fuzzy_threshold);
     } else {
-        // 使用简单模糊匹配
-        vector<MatchResult> results;
-
+        // 使用简单模糊匹配：按查询计划展开相似值的倒排列表，或逐概念扫描并用值签名跳过
         try {
-            auto all_concepts = conceptBox->getAll();
-
-            for (auto& concept : all_concepts) {
-                MatchResult match_result = matchConceptFuzzy(input_features, concept, fuzzy_threshold);
-
-                if (match_result.match_count > 0) {
-                    results.push_back(match_result);
-                }
-            }
+            auto current_snapshot = getSnapshot();
+            SimilarityOptions options;
+            options.use_fuzzy_matching = true;
+            options.fuzzy_threshold = fuzzy_threshold;
+            options.max_recursive_depth = max_recursive_depth;
+            QueryPlan plan = planQuery(*current_snapshot, input_features, vector<Feature>(), options);
+            return matchFuzzyPlanned(*current_snapshot, input_features, fuzzy_threshold, plan.sides[0]);
         } catch (const exception& e) {
-            cerr << "模糊匹配查找失败: " << e.what() << endl;
+            LOG_ERROR("模糊匹配查找失败", {"error", e.what()});
         }
-
-        return results;
+        return vector<MatchResult>();
     }
 }
 
 // 工具函数：解析用户输入特征列表
 vector<Feature> parseFeatureList(const vector<string>& input_list) {
     vector<Feature> features;
+    features.reserve(input_list.size());
 
     for (const string& input : input_list) {
-        size_t colon_pos = input.find(':');
-        if (colon_pos != string::npos) {
-            // 有冒号，是键值对，精确匹配
-            string key = input.substr(0, colon_pos);
-            string value = input.substr(colon_pos + 1);
-            features.emplace_back(key, value);
-        } else {
-            // 无冒号，是纯值，模糊匹配
-            features.emplace_back("", input);
-        }
+        // 有冒号是键值对（精确匹配），无冒号是纯值（模糊匹配）
+        FeatureView view = parseFeatureView(input);
+        features.emplace_back(string(view.key), string(view.value));
     }
 
     return features;
 }
 
+void parseFeatureViews(string_view input, vector<FeatureView>& out) {
+    forEachCommaItem(input, [&](string_view item) {
+        out.push_back(parseFeatureView(item));
+    });
+}
+
+vector<Feature> toFeatureList(const vector<FeatureView>& views) {
+    vector<Feature> features;
+    features.reserve(views.size());
+    for (const FeatureView& view : views) {
+        features.emplace_back(string(view.key), string(view.value));
+    }
+    return features;
+}
+
+QueryContext makeQueryContext(const vector<string>& input_a, const vector<string>& input_b, const SimilarityOptions& options) {
+    QueryContext context;
+    context.input_a = input_a;
+    context.input_b = input_b;
+    context.features_A = parseFeatureList(input_a);
+    context.features_B = parseFeatureList(input_b);
+    context.options = options;
+    context.params = getPublishedParameters();
+    return context;
+}
+
 map<pair<int,int>, int> ConceptDatabase::analyzeOverlap(const vector<MatchResult>& matches_A, const vector<MatchResult>& matches_B, int total_features_A, int total_features_B, int& total_matches) {
     map<pair<int,int>, int> overlap_map;
     total_matches = 0;
@@ -526,59 +1548,448 @@ int ConceptDatabase::calculateMatchLevel(int matched_features, int total_feature
         return 1; // 默认最低等级
     }
 
-    // 计算重合度百分比
-    double match_percentage = (double)matched_features / total_features * 100.0;
+    // 计算重合度百分比
+    double match_percentage = (double)matched_features / total_features * 100.0;
+
+    // 向上取整到最近的20%档次，返回对应等级1-5
+    if (match_percentage <= 20.0) return 1;    // 0%-20% → 等级1
+    else if (match_percentage <= 40.0) return 2;    // 20%-40% → 等级2
+    else if (match_percentage <= 60.0) return 3;    // 40%-60% → 等级3
+    else if (match_percentage <= 80.0) return 4;    // 60%-80% → 等级4
+    else return 5;    // 80%-100% → 等级5
+}
+
+double ConceptDatabase::calculateMainSimilarity(const vector<Feature>& features_A, const vector<Feature>& features_B, const unordered_map<string, double>& params) {
+    // 1. 匹配并统计重合度等级直方图
+    MatchHistogram histogram = computeMatchHistogram(features_A, features_B);
+
+    // 2. 由直方图计算分相似度和主相似度
+    return calculateSimilarityFromHistogram(histogram, params);
+}
+
+template <typename FeatureT>
+static void planExactPair(const ConceptSnapshot& concept_snapshot, const vector<FeatureT>& features_A,
+                          const vector<FeatureT>& features_B, QueryPlan& plan, bool detailed);
+template <typename FeatureT>
+static MatchHistogram matchHistogramPlanned(ConceptDatabase& database, const ConceptSnapshot& concept_snapshot,
+                                            const vector<FeatureT>& features_A, const vector<FeatureT>& features_B,
+                                            QueryPlan& plan, bool measure);
+
+MatchHistogram ConceptDatabase::computeMatchHistogram(const vector<Feature>& features_A, const vector<Feature>& features_B) {
+    // 按查询计划获取两个特征列表的匹配结果：紧凑结果分配在本线程的查询arena中，稳定后不调用malloc
+    try {
+        auto current_snapshot = getSnapshot();
+        QueryPlan plan;
+        planExactPair(*current_snapshot, features_A, features_B, plan, false);
+        return matchHistogramPlanned(*this, *current_snapshot, features_A, features_B, plan, false);
+    } catch (const exception& e) {
+        LOG_ERROR("查找匹配概念失败", {"error", e.what()});
+    }
+    return MatchHistogram();
+}
+
+MatchHistogram ConceptDatabase::computeMatchHistogram(const vector<FeatureView>& features_A, const vector<FeatureView>& features_B) {
+    // 与Feature版本相同，匹配直接在视图上进行
+    try {
+        auto current_snapshot = getSnapshot();
+        QueryPlan plan;
+        planExactPair(*current_snapshot, features_A, features_B, plan, false);
+        return matchHistogramPlanned(*this, *current_snapshot, features_A, features_B, plan, false);
+    } catch (const exception& e) {
+        LOG_ERROR("查找匹配概念失败", {"error", e.what()});
+    }
+    return MatchHistogram();
+}
+
+MatchHistogram ConceptDatabase::computeMatchHistogram(const CompactMatchList& matches_A, const CompactMatchList& matches_B, int total_features_A, int total_features_B) {
+    MatchHistogram histogram;
+    histogram.matches_A_count = matches_A.size();
+    histogram.matches_B_count = matches_B.size();
+
+    // 两侧均按概念位置升序，归并找出重合概念
+    size_t i = 0, j = 0;
+    while (i < matches_A.size() && j < matches_B.size()) {
+        if (matches_A[i].position < matches_B[j].position) {
+            i++;
+        } else if (matches_B[j].position < matches_A[i].position) {
+            j++;
+        } else {
+            int level_A = calculateMatchLevel(matches_A[i].match_count, total_features_A);
+            int level_B = calculateMatchLevel(matches_B[j].match_count, total_features_B);
+            histogram.level_counts[level_A - 1][level_B - 1]++;
+            histogram.total_matches++;
+            i++;
+            j++;
+        }
+    }
+
+    return histogram;
+}
+
+MatchHistogram ConceptDatabase::computeMatchHistogram(const MatchSet& matches_A, const MatchSet& matches_B) {
+    MatchHistogram histogram;
+    histogram.matches_A_count = matches_A.matches.size();
+    histogram.matches_B_count = matches_B.matches.size();
+
+    // 两侧均按概念ID升序；大小相近时归并，一侧远小于另一侧时在大的一侧中倍增查找小的一侧的各项
+    const vector<MatchSetEntry>& a = matches_A.matches;
+    const vector<MatchSetEntry>& b = matches_B.matches;
+    auto count = [&](const MatchSetEntry& entry_A, const MatchSetEntry& entry_B) {
+        histogram.level_counts[entry_A.level() - 1][entry_B.level() - 1]++;
+        histogram.total_matches++;
+    };
+    if (a.size() * 16 < b.size() || b.size() * 16 < a.size()) {
+        bool a_smaller = a.size() < b.size();
+        const vector<MatchSetEntry>& small = a_smaller ? a : b;
+        const vector<MatchSetEntry>& large = a_smaller ? b : a;
+        size_t low = 0;
+        for (const MatchSetEntry& entry : small) {
+            obx_id concept_id = entry.conceptId();
+            size_t step = 1;
+            size_t high = low;
+            while (high < large.size() && large[high].conceptId() < concept_id) {
+                low = high + 1;
+                high += step;
+                step *= 2;
+            }
+            high = min(high, large.size());
+            low = lower_bound(large.begin() + low, large.begin() + high, concept_id,
+                              [](const MatchSetEntry& e, obx_id id) { return e.conceptId() < id; }) - large.begin();
+            if (low == large.size()) break;
+            if (large[low].conceptId() == concept_id) {
+                if (a_smaller) count(entry, large[low]);
+                else count(large[low], entry);
+                low++;
+            }
+        }
+        return histogram;
+    }
+
+    size_t i = 0, j = 0;
+    while (i < a.size() && j < b.size()) {
+        obx_id id_A = a[i].conceptId();
+        obx_id id_B = b[j].conceptId();
+        if (id_A < id_B) {
+            i++;
+        } else if (id_B < id_A) {
+            j++;
+        } else {
+            count(a[i], b[j]);
+            i++;
+            j++;
+        }
+    }
+
+    return histogram;
+}
+
+MatchHistogram ConceptDatabase::computeMatchHistogram(const vector<MatchResult>& matches_A, const vector<MatchResult>& matches_B, int total_features_A, int total_features_B) {
+    MatchHistogram histogram;
+
+    // 分析重合（基于重合度等级）
+    int total_matches = 0;
+    auto overlap_map = analyzeOverlap(matches_A, matches_B, total_features_A, total_features_B, total_matches);
+
+    for (const auto& entry : overlap_map) {
+        histogram.level_counts[entry.first.first - 1][entry.first.second - 1] = entry.second;
+    }
+    histogram.matches_A_count = matches_A.size();
+    histogram.matches_B_count = matches_B.size();
+    histogram.total_matches = total_matches;
+
+    return histogram;
+}
+
+double ConceptDatabase::calculateSimilarityFromHistogram(const MatchHistogram& histogram, const unordered_map<string, double>& params) {
+    return calculateSimilarityFromHistogram(histogram, resolveParameterGrid(params));
+}
+
+double ConceptDatabase::calculateSimilarityFromHistogram(const MatchHistogram& histogram, const ParameterGrid& grid) {
+    // 如果没有重合，相似度为0
+    if (histogram.total_matches == 0) {
+        return 0.0;
+    }
+
+    double partial_similarity_A = 0.0;
+    double partial_similarity_B = 0.0;
+    calculatePartialSimilaritiesFromHistogram(histogram, grid, partial_similarity_A, partial_similarity_B);
+
+    // 主相似度：两个分相似度乘积的平方根（几何平均数）
+    return sqrt(partial_similarity_A * partial_similarity_B);
+}
+
+void ConceptDatabase::calculatePartialSimilaritiesFromHistogram(const MatchHistogram& histogram, const ParameterGrid& grid, double& partial_a_to_b, double& partial_b_to_a) {
+    // 分相似度：A = Σ c_ij * p_ij / |A|，B = Σ c_ij * p_ji / |B|
+    // 累加顺序与calculatePartialSimilarity遍历map的顺序一致（B视角交换i,j后按等级对排序）
+    double weighted_sum_A = 0.0;
+    double weighted_sum_B = 0.0;
+    for (int i = 0; i < 5; i++) {
+        for (int j = 0; j < 5; j++) {
+            int count_A = histogram.level_counts[i][j];
+            if (count_A > 0) {
+                weighted_sum_A += count_A * grid.values[i][j];
+            }
+            int count_B = histogram.level_counts[j][i];
+            if (count_B > 0) {
+                weighted_sum_B += count_B * grid.values[i][j];
+            }
+        }
+    }
+
+    partial_a_to_b = histogram.matches_A_count > 0 ? weighted_sum_A / histogram.matches_A_count : 0.0;
+    partial_b_to_a = histogram.matches_B_count > 0 ? weighted_sum_B / histogram.matches_B_count : 0.0;
+}
+
+// 匹配选项的散列：精确匹配与阈值和深度无关，单层模糊匹配与深度无关
+static uint64_t matchOptionsHash(const SimilarityOptions& options) {
+    if (!options.use_fuzzy_matching) return 1;
+    uint64_t threshold_bits;
+    memcpy(&threshold_bits, &options.fuzzy_threshold, sizeof(threshold_bits));
+    int depth = options.max_recursive_depth > 1 ? options.max_recursive_depth : 1;
+    return fingerprintMix(fingerprintMix(2, threshold_bits), depth);
+}
+
+// 精确匹配的结果是否可能与特征顺序有关：只有复合词与顺序有关（由无键特征按顺序以"_"连接）
+// 非空无键特征少于2个时无关；不超过5个时检查它们的各种排列组合是否在字典中出现，都不出现则无关；
+// 更多时（组合数过多，且只取前10个参与复合词）按有关处理
+template <typename FeatureT>
+static bool exactMatchOrderSensitive(const ConceptSnapshot& concept_snapshot, const vector<FeatureT>& input_features) {
+    string_view values[6];
+    int value_count = 0;
+    for (const FeatureT& feature : input_features) {
+        if (feature.key.empty() && !feature.value.empty()) {
+            if (value_count == 5) return true;
+            values[value_count++] = feature.value;
+        }
+    }
+    if (value_count < 2) return false;
+
+    // 深度优先枚举长度≥2的排列，复合词在线程局部缓冲区中拼接
+    thread_local string compound_word;
+    bool used[5] = {};
+    auto extend = [&](auto&& self, int length) -> bool {
+        size_t prefix_size = compound_word.size();
+        for (int i = 0; i < value_count; i++) {
+            if (used[i]) continue;
+            if (length > 0) compound_word += '_';
+            compound_word += values[i];
+            if (length >= 1 && concept_snapshot.findValueList(compound_word)) return true;
+            used[i] = true;
+            bool found = length + 1 < value_count && self(self, length + 1);
+            used[i] = false;
+            compound_word.resize(prefix_size);
+            if (found) return true;
+        }
+        return false;
+    };
+    compound_word.clear();
+    return extend(extend, 0);
+}
+
+template <typename FeatureT>
+shared_ptr<const MatchSet> ConceptDatabase::cachedMatchSet(const ConceptSnapshot& concept_snapshot, const vector<FeatureT>& input_features,
+                                                           const SimilarityOptions& options) {
+    MatchCacheKey key;
+    key.fingerprint = canonicalFeatureFingerprint(input_features);
+    key.options = matchOptionsHash(options);
+    key.snapshot_version = concept_snapshot.version;
+    uint64_t canonical_fingerprint = key.fingerprint;
+
+    // 递归模糊匹配读的是数据库而不是快照，结果不能按快照版本缓存：不查也不放缓存，只合并并发的相同请求
+    // （合并键不含快照版本；递归匹配按特征顺序替换，用有序指纹）
+    bool recursive = options.use_fuzzy_matching && options.max_recursive_depth > 1;
+    if (recursive) {
+        key.snapshot_version = 0;
+        key.fingerprint = orderedFeatureFingerprint(input_features, canonical_fingerprint);
+    }
+    shared_ptr<const MatchSet> cached = recursive ? nullptr : match_cache.find(key);
+    if (cached && cached->order_sensitive) {
+        key.fingerprint = orderedFeatureFingerprint(input_features, canonical_fingerprint);
+        cached = match_cache.find(key);
+    }
+    if (!recursive) {
+        match_cache.recordLookup(cached != nullptr);
+        traceCount(cached ? TRACE_MATCH_CACHE_HITS : TRACE_MATCH_CACHE_MISSES);
+    }
+    if (cached) {
+        return cached;
+    }
+
+    // 未命中：先确定结果是否与顺序有关，以便并发的相同请求按同一个键合并
+    // 单层模糊匹配逐个特征独立匹配，与顺序无关
+    if (!recursive && key.fingerprint == canonical_fingerprint) {
+        bool order_sensitive = !options.use_fuzzy_matching && exactMatchOrderSensitive(concept_snapshot, input_features);
+        if (order_sensitive) {
+            // 规范指纹下放一个标记项，同一组特征换个顺序时按有序指纹查找
+            auto marker = make_shared<MatchSet>();
+            marker->order_sensitive = true;
+            match_cache.insert(key, marker);
+            key.fingerprint = orderedFeatureFingerprint(input_features, canonical_fingerprint);
+        }
+    }
+
+    bool coalesced = false;
+    shared_ptr<const MatchSet> matches = match_flights.run(key, [&]() {
+        auto computed = make_shared<MatchSet>();
+        int total_features = input_features.size();
+        if (!options.use_fuzzy_matching) {
+            QueryArenaScope arena_scope;
+            CompactMatchList compact(arena_scope.resource());
+            QueryPlan plan;
+            plan.concept_count = concept_snapshot.conceptCount();
+            planExactSide(concept_snapshot, input_features, plan, plan.sides[0], false);
+            matchSidePlanned(concept_snapshot, input_features, plan.sides[0], compact);
+            computed->matches.reserve(compact.size());
+            for (const CompactMatch& match : compact) {
+                computed->matches.emplace_back(concept_snapshot.conceptId(match.position), calculateMatchLevel(match.match_count, total_features));
+            }
+        } else {
+            // 模糊匹配要保存候选值和复合词，FeatureView先转为Feature
+            auto fuzzy_match = [&](const vector<Feature>& features) {
+                if (recursive) {
+                    return recursiveMatch(features, options.max_recursive_depth, options.fuzzy_threshold);
+                }
+                QueryPlan plan = planQuery(concept_snapshot, features, vector<Feature>(), options);
+                return matchFuzzyPlanned(concept_snapshot, features, options.fuzzy_threshold, plan.sides[0]);
+            };
+            vector<MatchResult> results;
+            if constexpr (is_same<FeatureT, Feature>::value) {
+                results = fuzzy_match(input_features);
+            } else {
+                results = fuzzy_match(toFeatureList(input_features));
+            }
+            computed->matches.reserve(results.size());
+            for (const MatchResult& match : results) {
+                computed->matches.emplace_back(match.concept_id, calculateMatchLevel(match.match_count, total_features));
+            }
+            sort(computed->matches.begin(), computed->matches.end(),
+                 [](const MatchSetEntry& a, const MatchSetEntry& b) { return a.conceptId() < b.conceptId(); });
+        }
+        if (!recursive) {
+            match_cache.insert(key, computed);
+        }
+        return shared_ptr<const MatchSet>(computed);
+    }, &coalesced);
+    if (coalesced) {
+        traceCount(TRACE_SINGLE_FLIGHT_WAITS);
+    }
+    return matches;
+}
+
+template <typename FeatureT>
+SimilarityResult ConceptDatabase::computeSimilarityCached(const vector<FeatureT>& features_A, const vector<FeatureT>& features_B,
+                                                          const SimilarityOptions& options, const unordered_map<string, double>& params) {
+    // 不在此处吞掉异常：bad_alloc或合并请求重抛的错误若变成默认结果，会被调用方当作相似度0
+    auto current_snapshot = getSnapshot();
+    auto matches_A = cachedMatchSet(*current_snapshot, features_A, options);
+    auto matches_B = cachedMatchSet(*current_snapshot, features_B, options);
+    MatchHistogram histogram;
+    {
+        ScopedStageTimer timer(TRACE_STAGE_OVERLAP);
+        histogram = computeMatchHistogram(*matches_A, *matches_B);
+    }
+    SimilarityResult result = scoreHistogram(histogram, params);
+
+    // 主相似度基于精确匹配，精确匹配集合同样经过缓存
+    if (options.use_fuzzy_matching) {
+        SimilarityOptions exact_options;
+        auto exact_A = cachedMatchSet(*current_snapshot, features_A, exact_options);
+        auto exact_B = cachedMatchSet(*current_snapshot, features_B, exact_options);
+        MatchHistogram exact_histogram = computeMatchHistogram(*exact_A, *exact_B);
+        result.main_similarity = calculateSimilarityFromHistogram(exact_histogram, params);
+    }
+    return result;
+}
+
+SimilarityResult ConceptDatabase::computeSimilarity(const vector<Feature>& features_A, const vector<Feature>& features_B, const SimilarityOptions& options, const unordered_map<string, double>& params) {
+    // 缓存禁用时，模糊匹配（代价高）仍经过同一路径以合并并发的相同请求
+    if (match_cache.enabled() || (options.use_fuzzy_matching && match_flights.enabled())) {
+        return computeSimilarityCached(features_A, features_B, options, params);
+    }
+    if (!options.use_fuzzy_matching) {
+        // 精确匹配：在查询arena中匹配并统计直方图，不展开为MatchResult
+        return scoreHistogram(computeMatchHistogram(features_A, features_B), params);
+    }
+
+    // 1. 按选项匹配两个特征列表
+    auto matches_A = findMatchingConcepts(features_A, options.use_fuzzy_matching, options.fuzzy_threshold, options.max_recursive_depth);
+    auto matches_B = findMatchingConcepts(features_B, options.use_fuzzy_matching, options.fuzzy_threshold, options.max_recursive_depth);
+
+    return scoreSimilarity(features_A, features_B, matches_A, matches_B, options, params);
+}
 
-    // 向上取整到最近的20%档次，返回对应等级1-5
-    if (match_percentage <= 20.0) return 1;    // 0%-20% → 等级1
-    else if (match_percentage <= 40.0) return 2;    // 20%-40% → 等级2
-    else if (match_percentage <= 60.0) return 3;    // 40%-60% → 等级3
-    else if (match_percentage <= 80.0) return 4;    // 60%-80% → 等级4
-    else return 5;    // 80%-100% → 等级5
+SimilarityResult ConceptDatabase::computeSimilarity(const vector<FeatureView>& features_A, const vector<FeatureView>& features_B, const SimilarityOptions& options, const unordered_map<string, double>& params) {
+    if (!options.use_fuzzy_matching) {
+        if (match_cache.enabled()) {
+            return computeSimilarityCached(features_A, features_B, options, params);
+        }
+        return scoreHistogram(computeMatchHistogram(features_A, features_B), params);
+    }
+    // 模糊匹配要保存候选值和复合词，转为Feature后按原路径计算
+    return computeSimilarity(toFeatureList(features_A), toFeatureList(features_B), options, params);
 }
 
-double ConceptDatabase::calculateMainSimilarity(const vector<Feature>& features_A, const vector<Feature>& features_B, const unordered_map<string, double>& params) {
-    // 1. 获取两个特征列表的匹配结果
-    auto matches_A = findMatchingConcepts(features_A);
-    auto matches_B = findMatchingConcepts(features_B);
+SimilarityResult ConceptDatabase::scoreSimilarity(const vector<Feature>& features_A, const vector<Feature>& features_B, const vector<MatchResult>& matches_A, const vector<MatchResult>& matches_B, const SimilarityOptions& options, const unordered_map<string, double>& params) {
+    // 2. 统计重合度等级直方图
+    MatchHistogram histogram;
+    {
+        ScopedStageTimer timer(TRACE_STAGE_OVERLAP);
+        histogram = computeMatchHistogram(matches_A, matches_B, features_A.size(), features_B.size());
+    }
+    SimilarityResult result = scoreHistogram(histogram, params);
 
-    // 获取总特征数
-    int total_features_A = features_A.size();
-    int total_features_B = features_B.size();
+    // 4. 主相似度与calculateMainSimilarity一致（基于精确匹配），模糊模式下需要重新做一次精确匹配
+    if (options.use_fuzzy_matching) {
+        result.main_similarity = calculateMainSimilarity(features_A, features_B, params);
+    }
+    return result;
+}
 
-    // 2. 分析重合（基于重合度等级）
-    int total_matches = 0;
-    auto overlap_map = analyzeOverlap(matches_A, matches_B, total_features_A, total_features_B, total_matches);
+SimilarityResult ConceptDatabase::scoreHistogram(const MatchHistogram& histogram, const unordered_map<string, double>& params) {
+    ScopedStageTimer timer(TRACE_STAGE_SCORING);
+    SimilarityResult result;
+    result.histogram = histogram;
+    result.matches_A_count = result.histogram.matches_A_count;
+    result.matches_B_count = result.histogram.matches_B_count;
+    result.total_matches = result.histogram.total_matches;
 
-    // 如果没有重合，相似度为0
-    if (total_matches == 0) {
-        return 0.0;
-    }
+    // 3. 分相似度
+    ParameterGrid grid = resolveParameterGrid(params);
+    calculatePartialSimilaritiesFromHistogram(result.histogram, grid, result.partial_a_to_b, result.partial_b_to_a);
 
-    // 获取A和B各自的匹配概念数
-    int matches_A_count = matches_A.size();
-    int matches_B_count = matches_B.size();
+    // 4. 主相似度：精确匹配的直方图直接复用
+    result.main_similarity = calculateSimilarityFromHistogram(result.histogram, grid);
 
-    // 3. 计算A的分相似度（除以A的匹配概念数）
-    double partial_similarity_A = calculatePartialSimilarity(overlap_map, matches_A_count, params);
+    return result;
+}
 
-    // 4. 计算B的分相似度（需要交换i,j的视角，除以B的匹配概念数）
-    map<pair<int,int>, int> overlap_map_B;
-    for (const auto& entry : overlap_map) {
-        pair<int,int> swapped_pair(entry.first.second, entry.first.first);  // 交换i,j
-        overlap_map_B[swapped_pair] = entry.second;
+const SimilarityResult& ConceptDatabase::computeSimilarity(QueryContext& context) {
+    QueryTraceScope trace("similarity");
+    if (!context.params) {
+        context.params = getPublishedParameters();
     }
-    double partial_similarity_B = calculatePartialSimilarity(overlap_map_B, matches_B_count, params);
+    context.result = computeSimilarity(context.features_A, context.features_B, context.options, *context.params);
+    return context.result;
+}
 
-    // 5. 计算主相似度：两个分相似度乘积的平方根（几何平均数）
-    return sqrt(partial_similarity_A * partial_similarity_B);
+ParameterGrid resolveParameterGrid(const unordered_map<string, double>& params) {
+    ParameterGrid grid;
+    for (int i = 1; i <= 5; i++) {
+        for (int j = 1; j <= 5; j++) {
+            auto it = params.find("p" + to_string(i) + to_string(j));
+            grid.values[i - 1][j - 1] = it != params.end() ? it->second : 1.0;
+        }
+    }
+    return grid;
 }
 
 // Stage 3: 模糊匹配和参数学习功能
 
-int ConceptDatabase::calculateStringDistance(const string& str1, const string& str2) {
+int ConceptDatabase::calculateStringDistance(string_view str1, string_view str2) {
     int m = str1.length();
     int n = str2.length();
+    traceCount(TRACE_EDIT_DISTANCE_CALLS);
+    traceCount(TRACE_DP_CELLS, (uint64_t)m * n);
 
     // 创建动态规划矩阵
     vector<vector<int>> dp(m + 1, vector<int>(n + 1));
@@ -609,7 +2020,7 @@ int ConceptDatabase::calculateStringDistance(const string& str1, const string& s
     return dp[m][n];
 }
 
-double ConceptDatabase::calculateStringSimilarity(const string& str1, const string& str2) {
+double ConceptDatabase::calculateStringSimilarity(string_view str1, string_view str2) {
     if (str1.empty() && str2.empty()) {
         return 1.0;  // 两个空字符串相似度为1
     }
@@ -625,19 +2036,19 @@ double ConceptDatabase::calculateStringSimilarity(const string& str1, const stri
 }
 
 vector<pair<string, double>> ConceptDatabase::findSimilarValues(const string& query_value, double min_similarity) {
+    ScopedStageTimer timer(TRACE_STAGE_SIMILAR_VALUES);
     vector<pair<string, double>> similar_values;
 
     try {
-        // 获取所有概念
-        auto all_concepts = conceptBox->getAll();
-
-        // 用集合去重
+        // 流式读取全部概念，用集合去重
         set<string> unique_values;
-        for (auto& concept : all_concepts) {
-            for (const auto& value : concept->feature_values) {
+        uint64_t scanned = forEachConcept([&unique_values](const Concept& concept) {
+            for (const auto& value : concept.feature_values) {
                 unique_values.insert(value);
             }
-        }
+            return true;
+        });
+        traceCount(TRACE_CONCEPTS_SCANNED, scanned);
 
         // 计算每个值的相似度
         for (const string& value : unique_values) {
@@ -647,22 +2058,203 @@ vector<pair<string, double>> ConceptDatabase::findSimilarValues(const string& qu
             }
         }
 
-        // 按相似度降序排列
-        sort(similar_values.begin(), similar_values.end(),
+        // 按相似度降序排列，同相似度的值保持字典序（递归匹配按此顺序尝试替换，顺序必须确定）
+        stable_sort(similar_values.begin(), similar_values.end(),
              [](const pair<string, double>& a, const pair<string, double>& b) {
                  return a.second > b.second;
              });
 
     } catch (const exception& e) {
-        cerr << "模糊查找失败: " << e.what() << endl;
+        LOG_ERROR("模糊查找失败", {"error", e.what()});
     }
 
     return similar_values;
 }
 
 MatchResult ConceptDatabase::matchConceptFuzzy(const vector<Feature>& input_features, const unique_ptr<Concept>& concept, double fuzzy_threshold) {
+    return matchConceptFuzzy(input_features, *concept, fuzzy_threshold);
+}
+
+template <typename ConceptT>
+static MatchResult matchFuzzy(ConceptDatabase& database, const vector<Feature>& input_features, const ConceptT& concept, double fuzzy_threshold);
+
+// 模糊匹配查字典：对快照中与某个输入值相似度达到阈值的每个值（有键的输入为该键下的键值对）
+// 调用visitor(倒排列表, 签名位)，visitor返回false时停止；返回计算过相似度的字典项数
+// 每个不重复的值（或键值对）对每个输入只比较一次，逐概念扫描时同一个值在每个包含它的概念中都要比较一次
+template <typename Visitor>
+static size_t visitSimilarFeatures(ConceptDatabase& database, const ConceptSnapshot& concept_snapshot,
+                                   const vector<Feature>& input_features, double fuzzy_threshold, Visitor&& visitor) {
+    size_t compares = 0;
+    for (const Feature& input_feature : input_features) {
+        for (const PostingList& list : concept_snapshot.posting_lists) {
+            string_view text = concept_snapshot.term(list.id);
+            if (input_feature.key.empty()) {
+                if (list.key_value) continue;
+                compares++;
+                if (database.calculateStringSimilarity(input_feature.value, text) >= fuzzy_threshold &&
+                    !visitor(list, valueSignatureBit(text))) {
+                    return compares;
+                }
+                continue;
+            }
+
+            // 有键：只比较该键下的值（键中没有冒号，第一个冒号之后是值）
+            if (!list.key_value || text.size() <= input_feature.key.size() || text[input_feature.key.size()] != ':' ||
+                text.compare(0, input_feature.key.size(), input_feature.key) != 0) {
+                continue;
+            }
+            compares++;
+            string_view value = text.substr(input_feature.key.size() + 1);
+            if (database.calculateStringSimilarity(input_feature.value, value) >= fuzzy_threshold &&
+                !visitor(list, keyValueSignatureBit(input_feature.key, value))) {
+                return compares;
+            }
+        }
+    }
+    return compares;
+}
+
+uint64_t ConceptDatabase::fuzzyQuerySignature(const ConceptSnapshot& concept_snapshot, const vector<Feature>& input_features, double fuzzy_threshold) {
+    uint64_t signature = 0;
+    visitSimilarFeatures(*this, concept_snapshot, input_features, fuzzy_threshold,
+                         [&signature](const PostingList&, uint64_t bit) {
+                             signature |= bit;
+                             return signature != ~0ULL;  // 已全部置位，不再有概念会被跳过
+                         });
+    return signature;
+}
+
+void ConceptDatabase::planFuzzySide(const ConceptSnapshot& concept_snapshot, const vector<Feature>& input_features,
+                                    const QueryPlan& plan, SidePlan& side, bool detailed) {
+    side.feature_count = input_features.size();
+    if (plan.recursive_depth <= 1) {
+        // 查字典得到相似值的倒排列表和查询签名，两种策略都使用，执行时不再查字典
+        vector<size_t> frequencies;
+        side.fuzzy_compares = visitSimilarFeatures(*this, concept_snapshot, input_features, plan.fuzzy_threshold,
+            [&side, &frequencies](const PostingList& list, uint64_t bit) {
+                side.fuzzy_lists.push_back(&list.positions);
+                side.fuzzy_postings += list.positions.size();
+                side.fuzzy_signature |= bit;
+                frequencies.push_back(list.positions.size());
+                return true;
+            });
+        side.estimated_candidates = estimateUnionSize(frequencies, concept_snapshot.conceptCount());
+    }
+    if (detailed) {
+        for (const Feature& feature : input_features) {
+            PlanTerm term;
+            term.text = feature.key.empty() ? feature.value : feature.key + ":" + feature.value;
+            const PostingList* list = feature.key.empty() ? concept_snapshot.findValueList(feature.value)
+                                                          : concept_snapshot.findKeyValueList(feature.key, feature.value);
+            term.frequency = list ? list->positions.size() : 0;
+            side.terms.push_back(term);
+        }
+    }
+    chooseSidePlan(side, plan, concept_snapshot.frequency.average_signature_bits);
+}
+
+vector<MatchResult> ConceptDatabase::matchFuzzyPlanned(const ConceptSnapshot& concept_snapshot, const vector<Feature>& input_features,
+                                                       double fuzzy_threshold, const SidePlan& side, size_t* verified) {
+    ScopedStageTimer timer(TRACE_STAGE_FUZZY_MATCH);
+    vector<MatchResult> results;
+    size_t scanned = 0;
+
+    if (side.strategy == PLAN_FUZZY_EXPAND) {
+        // 匹配的概念必然包含某个相似值（或键值对），相似值倒排列表的并集就是全部候选
+        traceCount(TRACE_PLAN_FUZZY_EXPAND);
+        traceCount(TRACE_POSTINGS_TOUCHED, side.fuzzy_postings);
+        vector<uint32_t> candidates;
+        unionPostings(side.fuzzy_lists.data(), side.fuzzy_lists.size(), candidates);
+        for (uint32_t pos : candidates) {
+            MatchResult match_result = matchFuzzy(*this, input_features, SnapshotConcept{concept_snapshot, pos}, fuzzy_threshold);
+            if (match_result.match_count > 0) {
+                results.push_back(match_result);
+            }
+        }
+        scanned = candidates.size();
+    } else {
+        // 逐概念扫描，值签名与查询签名不相交的概念直接跳过
+        for (uint32_t pos = 0; pos < concept_snapshot.conceptCount(); pos++) {
+            if (!concept_snapshot.mayMatch(pos, side.fuzzy_signature)) continue;
+            scanned++;
+            MatchResult match_result = matchFuzzy(*this, input_features, SnapshotConcept{concept_snapshot, pos}, fuzzy_threshold);
+            if (match_result.match_count > 0) {
+                results.push_back(match_result);
+            }
+        }
+        traceCount(TRACE_SIGNATURE_CHECKED, concept_snapshot.conceptCount());
+        traceCount(TRACE_SIGNATURE_SKIPPED, concept_snapshot.conceptCount() - scanned);
+    }
+    traceCount(TRACE_CONCEPTS_SCANNED, scanned);
+    if (verified) *verified = scanned;
+    return results;
+}
+
+QueryPlan ConceptDatabase::planQuery(const ConceptSnapshot& concept_snapshot, const vector<Feature>& features_A,
+                                     const vector<Feature>& features_B, const SimilarityOptions& options, bool detailed) {
+    QueryPlan plan;
+    plan.fuzzy = options.use_fuzzy_matching;
+    plan.recursive_depth = options.max_recursive_depth;
+    plan.fuzzy_threshold = options.fuzzy_threshold;
+    plan.concept_count = concept_snapshot.conceptCount();
+    if (!plan.fuzzy) {
+        if (features_B.empty()) {
+            planExactSide(concept_snapshot, features_A, plan, plan.sides[0], detailed);
+        } else {
+            planExactPair(concept_snapshot, features_A, features_B, plan, detailed);
+        }
+        return plan;
+    }
+    plan.side_count = features_B.empty() ? 1 : 2;
+    planFuzzySide(concept_snapshot, features_A, plan, plan.sides[0], detailed);
+    if (plan.side_count == 2) {
+        planFuzzySide(concept_snapshot, features_B, plan, plan.sides[1], detailed);
+    }
+    return plan;
+}
+
+QueryPlan ConceptDatabase::explainQuery(const vector<Feature>& features_A, const vector<Feature>& features_B, const SimilarityOptions& options) {
+    auto current_snapshot = getSnapshot();
+    auto start_time = chrono::steady_clock::now();
+    QueryPlan plan = planQuery(*current_snapshot, features_A, features_B, options, true);
+    double plan_us = chrono::duration<double, micro>(chrono::steady_clock::now() - start_time).count();
+
+    if (!plan.fuzzy && plan.side_count == 2) {
+        matchHistogramPlanned(*this, *current_snapshot, features_A, features_B, plan, true);
+    } else {
+        const vector<Feature>* features[2] = {&features_A, &features_B};
+        for (int s = 0; s < plan.side_count; s++) {
+            SidePlan& side = plan.sides[s];
+            auto side_start = chrono::steady_clock::now();
+            if (!plan.fuzzy) {
+                QueryArenaScope arena_scope;
+                CompactMatchList matches(arena_scope.resource());
+                side.actual_candidates = matchSidePlanned(*current_snapshot, *features[s], side, matches);
+                side.actual_matches = matches.size();
+            } else if (side.strategy == PLAN_RECURSIVE) {
+                side.actual_matches = recursiveMatch(*features[s], plan.recursive_depth, plan.fuzzy_threshold).size();
+            } else {
+                side.actual_matches = matchFuzzyPlanned(*current_snapshot, *features[s], plan.fuzzy_threshold, side,
+                                                        &side.actual_candidates).size();
+            }
+            side.actual_us = chrono::duration<double, micro>(chrono::steady_clock::now() - side_start).count();
+        }
+    }
+    plan.actual_total_us = chrono::duration<double, micro>(chrono::steady_clock::now() - start_time).count();
+    if (plan.fuzzy) {
+        // 模糊匹配查字典在计划阶段完成，两种策略都包含这部分代价，计入实际耗时
+        for (int s = 0; s < plan.side_count; s++) {
+            plan.sides[s].actual_us += plan_us / plan.side_count;
+        }
+    }
+    return plan;
+}
+
+// 模糊匹配一个概念（ConceptT为Concept或SnapshotConcept）
+template <typename ConceptT>
+static MatchResult matchFuzzy(ConceptDatabase& database, const vector<Feature>& input_features, const ConceptT& concept, double fuzzy_threshold) {
     MatchResult result;
-    result.concept_id = concept->id;
+    result.concept_id = conceptIdOf(concept);
     result.match_count = 0;
 
     // 遍历每个输入特征
@@ -673,24 +2265,26 @@ MatchResult ConceptDatabase::matchConceptFuzzy(const vector<Feature>& input_feat
 
         if (input_feature.key.empty()) {
             // 模糊匹配：在所有值中找最相似的
-            for (const auto& concept_value : concept->feature_values) {
-                double similarity = calculateStringSimilarity(input_feature.value, concept_value);
+            forEachConceptValue(concept, [&](string_view concept_value) {
+                double similarity = database.calculateStringSimilarity(input_feature.value, concept_value);
                 if (similarity >= fuzzy_threshold && similarity > best_similarity) {
                     best_similarity = similarity;
                     matched = true;
                 }
-            }
+                return true;
+            });
         } else {
             // 精确匹配键，模糊匹配值
-            for (size_t j = 0; j < concept->feature_keys.size(); j++) {
-                if (concept->feature_keys[j] == input_feature.key) {
-                    double similarity = calculateStringSimilarity(input_feature.value, concept->feature_values[j]);
+            forEachConceptKeyValue(concept, [&](string_view concept_key, string_view concept_value) {
+                if (concept_key == input_feature.key) {
+                    double similarity = database.calculateStringSimilarity(input_feature.value, concept_value);
                     if (similarity >= fuzzy_threshold && similarity > best_similarity) {
                         best_similarity = similarity;
                         matched = true;
                     }
                 }
-            }
+                return true;
+            });
         }
 
         if (matched) {
@@ -702,14 +2296,18 @@ MatchResult ConceptDatabase::matchConceptFuzzy(const vector<Feature>& input_feat
     return result;
 }
 
+MatchResult ConceptDatabase::matchConceptFuzzy(const vector<Feature>& input_features, const Concept& concept, double fuzzy_threshold) {
+    return matchFuzzy(*this, input_features, concept, fuzzy_threshold);
+}
+
 vector<MatchResult> ConceptDatabase::recursiveMatch(const vector<Feature>& input_features, int max_depth, double fuzzy_threshold) {
+    ScopedStageTimer timer(TRACE_STAGE_RECURSIVE_MATCH);
     vector<MatchResult> results;
 
     try {
-        // 获取所有概念
-        auto all_concepts = conceptBox->getAll();
-
-        for (auto& concept : all_concepts) {
+        // 流式读取全部概念（递归调用各自在同一读事务中打开嵌套的流）
+        ConceptStream stream = streamConcepts();
+        for (const Concept& concept : stream) {
             // 第一层：直接匹配
             MatchResult direct_match = matchConceptFuzzy(input_features, concept, fuzzy_threshold);
 
@@ -735,6 +2333,7 @@ vector<MatchResult> ConceptDatabase::recursiveMatch(const vector<Feature>& input
                         }
 
                         // 递归匹配（深度减1）
+                        traceCount(TRACE_RECURSION_EXPANSIONS);
                         auto recursive_results = recursiveMatch(modified_features, max_depth - 1, fuzzy_threshold);
 
                         if (!recursive_results.empty()) {
@@ -752,6 +2351,8 @@ vector<MatchResult> ConceptDatabase::recursiveMatch(const vector<Feature>& input
             }
         }
 
+        traceCount(TRACE_CONCEPTS_SCANNED, stream.conceptsRead());
+
         // 去重和排序
         sort(results.begin(), results.end(),
              [](const MatchResult& a, const MatchResult& b) {
@@ -769,37 +2370,373 @@ vector<MatchResult> ConceptDatabase::recursiveMatch(const vector<Feature>& input
         results.erase(last, results.end());
 
     } catch (const exception& e) {
-        cerr << "递归匹配失败: " << e.what() << endl;
+        LOG_ERROR("递归匹配失败", {"error", e.what()});
     }
 
     return results;
 }
 
-// 训练样本管理
+// 训练样本管理（样本表由online_mutex保护，直方图在锁外计算）
+void ConceptDatabase::refreshSampleHistogram(TrainingSample& sample, uint64_t snapshot_version) {
+    if (sample.has_histogram && sample.histogram_version == snapshot_version) {
+        return;
+    }
+    // 版本在匹配之前读取：期间快照若被替换，记下的版本偏旧，下次只会多算一次
+    sample.histogram = computeMatchHistogram(sample.features_A, sample.features_B);
+    sample.histogram_version = snapshot_version;
+    sample.has_histogram = true;
+}
+
 void ConceptDatabase::addTrainingSample(const TrainingSample& sample) {
-    training_samples.push_back(sample);
+    // 缓存匹配直方图，之后评估参数时不再重复匹配
+    TrainingSample stored = sample;
+    refreshSampleHistogram(stored, getSnapshot()->version);
+
+    lock_guard<mutex> lock(online_mutex);
+    training_samples.push_back(move(stored));
 }
 
 vector<TrainingSample> ConceptDatabase::getTrainingSamples() {
+    lock_guard<mutex> lock(online_mutex);
     return training_samples;
 }
 
+vector<TrainingSample> ConceptDatabase::trainingSamplesForCurrentSnapshot() {
+    vector<TrainingSample> samples;
+    uint64_t generation;
+    {
+        lock_guard<mutex> lock(online_mutex);
+        samples = training_samples;
+        generation = training_generation;
+    }
+
+    // reload、apply或加载快照文件之后，旧快照上的直方图不再对应当前概念库
+    uint64_t version = getSnapshot()->version;
+    size_t refreshed = 0;
+    for (TrainingSample& sample : samples) {
+        if (!sample.has_histogram || sample.histogram_version != version) {
+            refreshSampleHistogram(sample, version);
+            refreshed++;
+        }
+    }
+    if (refreshed == 0) {
+        return samples;
+    }
+
+    // 期间只可能追加样本（清空会改变generation），前samples.size()个与副本一一对应
+    {
+        lock_guard<mutex> lock(online_mutex);
+        if (generation == training_generation && training_samples.size() >= samples.size()) {
+            for (size_t i = 0; i < samples.size(); i++) {
+                TrainingSample& stored = training_samples[i];
+                if (!stored.has_histogram || stored.histogram_version != version) {
+                    stored.histogram = samples[i].histogram;
+                    stored.histogram_version = version;
+                    stored.has_histogram = true;
+                }
+            }
+        }
+    }
+    LOG_INFO("按当前概念库快照重新计算了 " << refreshed << " 个训练样本的匹配直方图",
+             {"refreshed", refreshed}, {"snapshot_version", version});
+    return samples;
+}
+
 void ConceptDatabase::clearTrainingSamples() {
+    lock_guard<mutex> lock(online_mutex);
     training_samples.clear();
+    training_generation++;
+}
+
+// 将逗号分隔的特征字符串拆分为去除首尾空格的片段（与交互输入的解析规则一致）
+vector<string> splitCommaList(const string& input) {
+    vector<string> result;
+    forEachCommaItem(input, [&](string_view item) {
+        result.emplace_back(item);
+    });
+    return result;
+}
+
+// 从JSON值中读取特征列表：支持逗号分隔字符串或字符串数组
+static bool readJsonFeatureList(const JsonValue* value, vector<string>& out) {
+    if (!value) return false;
+    if (value->isString()) {
+        out = splitCommaList(value->string_value);
+        return true;
+    }
+    if (value->isArray()) {
+        for (const JsonValue& item : value->array_items) {
+            if (!item.isString()) return false;
+            vector<string> parts = splitCommaList(item.string_value);
+            out.insert(out.end(), parts.begin(), parts.end());
+        }
+        return true;
+    }
+    return false;
+}
+
+// 按制表符切分一行
+static vector<string> splitTabColumns(const string& line) {
+    vector<string> columns;
+    size_t begin = 0;
+    while (true) {
+        size_t tab = line.find('\t', begin);
+        columns.push_back(line.substr(begin, tab == string::npos ? string::npos : tab - begin));
+        if (tab == string::npos) break;
+        begin = tab + 1;
+    }
+    return columns;
+}
+
+// 整个字符串（允许前后空白）是一个数
+static bool parseSampleNumber(const string& text, double& value) {
+    size_t used = 0;
+    try {
+        value = stod(text, &used);
+    } catch (const exception&) {
+        return false;
+    }
+    return text.find_first_not_of(" \t", used) == string::npos;
+}
+
+// TSV表头：第三列为期望相似度的列名（a/b/expected/confidence 或 expected_similarity、similarity）
+static bool isTsvSampleHeader(const string& line) {
+    vector<string> columns = splitTabColumns(line);
+    if (columns.size() < 3) return false;
+    auto name = [](string column) {
+        size_t begin = column.find_first_not_of(" ");
+        size_t end = column.find_last_not_of(" ");
+        column = begin == string::npos ? string() : column.substr(begin, end - begin + 1);
+        transform(column.begin(), column.end(), column.begin(), [](unsigned char c) { return tolower(c); });
+        return column;
+    };
+    string expected = name(columns[2]);
+    if (expected != "expected" && expected != "expected_similarity" && expected != "similarity") return false;
+    return columns.size() < 4 || name(columns[3]) == "confidence";
+}
+
+// 解析一行TSV训练样本：A<TAB>B<TAB>期望相似度[<TAB>信心度]
+static bool parseTsvSampleRow(const string& line, vector<string>& list_a, vector<string>& list_b, double& expected, double& confidence) {
+    vector<string> columns = splitTabColumns(line);
+    if (columns.size() < 3) return false;
+
+    if (!parseSampleNumber(columns[2], expected)) return false;
+    confidence = 1.0;
+    if (columns.size() > 3 && !columns[3].empty() && !parseSampleNumber(columns[3], confidence)) return false;
+    list_a = splitCommaList(columns[0]);
+    list_b = splitCommaList(columns[1]);
+    return true;
+}
+
+// 解析一行JSONL训练样本
+static bool parseJsonSampleRow(const string& line, vector<string>& list_a, vector<string>& list_b, double& expected, double& confidence) {
+    JsonValue row;
+    string error;
+    JsonParser parser(line);
+    if (!parser.parse(row, error) || !row.isObject()) return false;
+
+    const JsonValue* a = row.get("a") ? row.get("a") : row.get("A");
+    const JsonValue* b = row.get("b") ? row.get("b") : row.get("B");
+    const JsonValue* expected_value = row.get("expected") ? row.get("expected") : row.get("expected_similarity");
+    const JsonValue* confidence_value = row.get("confidence");
+
+    if (!readJsonFeatureList(a, list_a) || !readJsonFeatureList(b, list_b)) return false;
+    if (!expected_value || !expected_value->isNumber()) return false;
+    expected = expected_value->number_value;
+    confidence = 1.0;
+    if (confidence_value && !confidence_value->isNull()) {
+        if (!confidence_value->isNumber()) return false;
+        confidence = confidence_value->number_value;
+    }
+    return true;
+}
+
+// 特征列表对的序列化键，用于样本去重
+static string samplePairKey(const vector<Feature>& features_A, const vector<Feature>& features_B) {
+    string key;
+    for (const Feature& feature : features_A) {
+        key += feature.key + '\x1f' + feature.value + '\x1e';
+    }
+    key += '\x1d';
+    for (const Feature& feature : features_B) {
+        key += feature.key + '\x1f' + feature.value + '\x1e';
+    }
+    return key;
+}
+
+size_t ConceptDatabase::importTrainingSamples(const string& filename, int thread_count) {
+    ifstream file(filename);
+    if (!file.is_open()) {
+        LOG_ERROR("无法打开训练样本文件", {"file", filename});
+        return 0;
+    }
+
+    auto start_time = chrono::steady_clock::now();
+
+    // 扩展名为.jsonl/.json时按JSONL解析，否则按行首字符判断
+    bool jsonl_file = (filename.size() >= 6 && filename.compare(filename.size() - 6, 6, ".jsonl") == 0) ||
+                      (filename.size() >= 5 && filename.compare(filename.size() - 5, 5, ".json") == 0);
+
+    // 已有样本也参与去重
+    unordered_set<string> seen_pairs;
+    {
+        lock_guard<mutex> lock(online_mutex);
+        for (const TrainingSample& sample : training_samples) {
+            seen_pairs.insert(samplePairKey(sample.features_A, sample.features_B));
+        }
+    }
+
+    vector<TrainingSample> samples;
+    size_t row_count = 0;
+    size_t error_count = 0;
+    size_t duplicate_count = 0;
+    int line_number = 0;
+    string line;
+
+    // 1. 流式解析
+    while (getline(file, line)) {
+        line_number++;
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        size_t first = line.find_first_not_of(" \t");
+        if (first == string::npos || line[first] == '#') {
+            continue;
+        }
+        row_count++;
+
+        vector<string> list_a, list_b;
+        double expected = 0.0;
+        double confidence = 1.0;
+        bool parsed = (jsonl_file || line[first] == '{')
+            ? parseJsonSampleRow(line, list_a, list_b, expected, confidence)
+            : parseTsvSampleRow(line, list_a, list_b, expected, confidence);
+
+        // 期望相似度在[0,1]之内，信心度为正数（NaN同样拒绝）
+        const char* problem = nullptr;
+        if (!parsed || list_a.empty() || list_b.empty()) {
+            // TSV第一行只有列名与表头相符时才当作表头
+            if (row_count == 1 && !jsonl_file && line[first] != '{' && isTsvSampleHeader(line)) {
+                row_count--;
+                continue;
+            }
+            problem = "训练样本格式错误，跳过";
+        } else if (!(expected >= 0.0 && expected <= 1.0)) {
+            problem = "训练样本的期望相似度不在[0,1]之内，跳过";
+        } else if (!(confidence > 0.0 && isfinite(confidence))) {
+            problem = "训练样本的信心度必须为正数，跳过";
+        }
+        if (problem) {
+            error_count++;
+            if (error_count <= 10) {
+                LOG_WARN(problem, {"line", line_number}, {"content", line});
+            }
+            continue;
+        }
+
+        TrainingSample sample(expected, confidence);
+        sample.features_A = parseFeatureList(list_a);
+        sample.features_B = parseFeatureList(list_b);
+
+        if (!seen_pairs.insert(samplePairKey(sample.features_A, sample.features_B)).second) {
+            duplicate_count++;
+            continue;
+        }
+        samples.push_back(move(sample));
+    }
+    file.close();
+
+    auto parse_end_time = chrono::steady_clock::now();
+
+    // 2. 并行预计算匹配直方图（快照只读，可被多个线程共享）
+    //    同一特征列表在样本中反复出现，每个线程缓存自己算过的匹配结果
+    auto current_snapshot = getSnapshot();
+    unsigned int worker_count = thread_count > 0 ? thread_count : max(1u, thread::hardware_concurrency());
+    worker_count = max<size_t>(1, min<size_t>(worker_count, samples.size()));
+
+    const size_t batch_size = 256;
+    atomic<size_t> next_index(0);
+    vector<thread> workers;
+    for (unsigned int w = 0; w < worker_count; w++) {
+        workers.emplace_back([this, &samples, &next_index, &current_snapshot, batch_size]() {
+            unordered_map<string, vector<MatchResult>> match_cache;
+            auto cached_matches = [&](const vector<Feature>& features) -> const vector<MatchResult>& {
+                string key = samplePairKey(features, {});
+                auto it = match_cache.find(key);
+                if (it == match_cache.end()) {
+                    it = match_cache.emplace(key, findMatchingConcepts(*current_snapshot, features)).first;
+                }
+                return it->second;
+            };
+
+            while (true) {
+                size_t begin = next_index.fetch_add(batch_size);
+                if (begin >= samples.size()) break;
+                size_t end = min(samples.size(), begin + batch_size);
+                for (size_t i = begin; i < end; i++) {
+                    TrainingSample& sample = samples[i];
+                    const vector<MatchResult>& matches_A = cached_matches(sample.features_A);
+                    const vector<MatchResult>& matches_B = cached_matches(sample.features_B);
+                    sample.histogram = computeMatchHistogram(matches_A, matches_B, sample.features_A.size(), sample.features_B.size());
+                    sample.histogram_version = current_snapshot->version;
+                    sample.has_histogram = true;
+                }
+            }
+        });
+    }
+    for (thread& worker : workers) {
+        worker.join();
+    }
+
+    auto end_time = chrono::steady_clock::now();
+
+    size_t imported_count = samples.size();
+    {
+        lock_guard<mutex> lock(online_mutex);
+        training_samples.insert(training_samples.end(),
+                                make_move_iterator(samples.begin()), make_move_iterator(samples.end()));
+    }
+
+    double parse_ms = chrono::duration<double, milli>(parse_end_time - start_time).count();
+    double histogram_ms = chrono::duration<double, milli>(end_time - parse_end_time).count();
+    double total_seconds = chrono::duration<double>(end_time - start_time).count();
+
+    LOG_INFO("从 " << filename << " 导入训练样本：读取 " << row_count << " 行，导入 " << imported_count
+             << " 个，重复 " << duplicate_count << " 个，无效（格式错误或取值超出范围） " << error_count << " 个",
+             {"file", filename}, {"rows", row_count}, {"imported", imported_count},
+             {"duplicates", duplicate_count}, {"errors", error_count});
+    LOG_INFO("  解析耗时 " << parse_ms << " ms，直方图预计算耗时 " << histogram_ms << " ms（"
+             << worker_count << " 线程），速率 " << (total_seconds > 0 ? row_count / total_seconds : 0.0) << " 行/秒",
+             {"parse_ms", parse_ms}, {"histogram_ms", histogram_ms}, {"threads", worker_count});
+
+    return imported_count;
 }
 
 // 参数优化
 double ConceptDatabase::evaluateParameters(const unordered_map<string, double>& params) {
-    if (training_samples.empty()) {
+    return evaluateParameters(trainingSamplesForCurrentSnapshot(), params);
+}
+
+double ConceptDatabase::evaluateParameters(const vector<TrainingSample>& samples, const unordered_map<string, double>& params) {
+    if (samples.empty()) {
         return 1.0;  // 没有训练样本，返回默认评分
     }
 
+    // 返回平均加权误差的倒数（越小越好，所以取倒数）
+    double average_error = calculateWeightedError(samples, params);
+    return 1.0 / (1.0 + average_error);  // 转换为0-1之间的评分
+}
+
+double ConceptDatabase::calculateWeightedError(const vector<TrainingSample>& samples, const unordered_map<string, double>& params) {
     double total_error = 0.0;
     double total_weight = 0.0;
+    ParameterGrid grid = resolveParameterGrid(params);
 
-    for (const TrainingSample& sample : training_samples) {
-        // 计算当前参数下的相似度
-        double calculated_similarity = calculateMainSimilarity(sample.features_A, sample.features_B, params);
+    for (const TrainingSample& sample : samples) {
+        // 计算当前参数下的相似度（优先使用缓存的直方图）
+        double calculated_similarity = sample.has_histogram
+            ? calculateSimilarityFromHistogram(sample.histogram, grid)
+            : calculateMainSimilarity(sample.features_A, sample.features_B, params);
 
         // 计算误差（考虑信心度权重）
         double error = abs(calculated_similarity - sample.expected_similarity);
@@ -809,41 +2746,43 @@ double ConceptDatabase::evaluateParameters(const unordered_map<string, double>&
         total_weight += weight;
     }
 
-    // 返回平均加权误差的倒数（越小越好，所以取倒数）
-    double average_error = total_weight > 0 ? total_error / total_weight : 1.0;
-    return 1.0 / (1.0 + average_error);  // 转换为0-1之间的评分
+    return total_weight > 0 ? total_error / total_weight : 1.0;
 }
 
-void ConceptDatabase::optimizeParameters(int max_iterations, double learning_rate) {
-    if (training_samples.empty()) {
-        cout << "没有训练样本，无法优化参数" << endl;
-        return;
-    }
+unordered_map<string, double> ConceptDatabase::trainParameters(const vector<TrainingSample>& samples, const unordered_map<string, double>& initial_params, int max_iterations, double learning_rate, bool verbose) {
+    // 工作参数表只属于本次训练，不触碰全局参数
+    unordered_map<string, double> params = initial_params;
 
-    cout << "开始参数优化，迭代次数: " << max_iterations << endl;
+    // 固定参数更新顺序，保证同样的输入得到同样的结果
+    vector<string> param_names;
+    for (const auto& param_pair : params) {
+        param_names.push_back(param_pair.first);
+    }
+    sort(param_names.begin(), param_names.end());
 
     // 备份当前参数
-    unordered_map<string, double> best_params = g_similarity_params;
-    double best_score = evaluateParameters(best_params);
+    unordered_map<string, double> best_params = params;
+    double best_score = evaluateParameters(samples, best_params);
 
-    cout << "初始评分: " << best_score << endl;
+    if (verbose) {
+        LOG_INFO("初始评分: " << best_score);
+    }
 
     for (int iteration = 0; iteration < max_iterations; iteration++) {
         // 对每个参数进行梯度下降
-        for (auto& param_pair : g_similarity_params) {
-            string param_name = param_pair.first;
-            double current_value = param_pair.second;
+        for (const string& param_name : param_names) {
+            double current_value = params[param_name];
 
             // 计算数值梯度
             const double epsilon = 0.001;
 
             // 正向扰动
-            g_similarity_params[param_name] = current_value + epsilon;
-            double score_plus = evaluateParameters(g_similarity_params);
+            params[param_name] = current_value + epsilon;
+            double score_plus = evaluateParameters(samples, params);
 
             // 负向扰动
-            g_similarity_params[param_name] = current_value - epsilon;
-            double score_minus = evaluateParameters(g_similarity_params);
+            params[param_name] = current_value - epsilon;
+            double score_minus = evaluateParameters(samples, params);
 
             // 计算梯度
             double gradient = (score_plus - score_minus) / (2.0 * epsilon);
@@ -854,57 +2793,292 @@ void ConceptDatabase::optimizeParameters(int max_iterations, double learning_rat
             // 约束参数在合理范围内
             new_value = max(0.1, min(5.0, new_value));
 
-            g_similarity_params[param_name] = new_value;
+            params[param_name] = new_value;
         }
 
         // 评估新参数
-        double current_score = evaluateParameters(g_similarity_params);
+        double current_score = evaluateParameters(samples, params);
 
         // 如果有改进，更新最佳参数
         if (current_score > best_score) {
-            best_params = g_similarity_params;
+            best_params = params;
             best_score = current_score;
         }
 
         // 每10次迭代输出进度
-        if ((iteration + 1) % 10 == 0) {
-            cout << "迭代 " << (iteration + 1) << " - 当前评分: " << current_score
-                 << " - 最佳评分: " << best_score << endl;
+        if (verbose && (iteration + 1) % 10 == 0) {
+            LOG_INFO("迭代 " << (iteration + 1) << " - 当前评分: " << current_score << " - 最佳评分: " << best_score,
+                     {"iteration", iteration + 1}, {"score", current_score}, {"best", best_score});
+        }
+    }
+
+    if (verbose) {
+        LOG_INFO("参数优化完成，最终评分: " << best_score);
+    }
+    return best_params;
+}
+
+void ConceptDatabase::optimizeParameters(int max_iterations, double learning_rate) {
+    // 复制样本，训练期间不受新样本加入的影响；直方图都基于当前快照
+    vector<TrainingSample> samples = trainingSamplesForCurrentSnapshot();
+    if (samples.empty()) {
+        LOG_WARN("没有训练样本，无法优化参数");
+        return;
+    }
+
+    LOG_INFO("开始参数优化，迭代次数: " << max_iterations);
+
+    // 从当前发布的参数表开始优化，完成后整表发布
+    unordered_map<string, double> best_params = trainParameters(samples, *getPublishedParameters(), max_iterations, learning_rate, true);
+    publishParameters(best_params, "optimize");
+}
+
+vector<CrossValidationFold> ConceptDatabase::crossValidate(int fold_count, int max_iterations, double learning_rate) {
+    vector<CrossValidationFold> folds;
+
+    // 复制样本，训练期间不受新样本加入的影响；直方图都基于当前快照，训练时不再访问数据库
+    vector<TrainingSample> samples = trainingSamplesForCurrentSnapshot();
+
+    if (fold_count < 2 || samples.size() < (size_t)fold_count) {
+        cout << "训练样本不足，无法进行" << fold_count << "折交叉验证（当前样本数: " << samples.size() << "）" << endl;
+        return folds;
+    }
+
+    // 固定种子打乱后按余数分折，结果可复现
+    vector<size_t> order(samples.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        order[i] = i;
+    }
+    shuffle(order.begin(), order.end(), mt19937(42));
+
+    // 所有折从同一个不可变的初始参数表出发
+    auto initial_params = getPublishedParameters();
+
+    cout << "开始" << fold_count << "折交叉验证，样本数: " << samples.size()
+         << "，迭代次数: " << max_iterations << endl;
+
+    auto start_time = chrono::steady_clock::now();
+    folds.resize(fold_count);
+
+    // 工作线程数不超过CPU核数，各线程从共享下标依次取折
+    unsigned int worker_count = min<unsigned int>(fold_count, max(1u, thread::hardware_concurrency()));
+    atomic<int> next_fold(0);
+    vector<thread> workers;
+
+    for (unsigned int w = 0; w < worker_count; w++) {
+        workers.emplace_back([this, fold_count, max_iterations, learning_rate, &next_fold, &samples, &order, &initial_params, &folds]() {
+            for (int fold = next_fold++; fold < fold_count; fold = next_fold++) {
+                auto fold_start = chrono::steady_clock::now();
+
+                vector<TrainingSample> train_set;
+                vector<TrainingSample> test_set;
+                for (size_t i = 0; i < order.size(); i++) {
+                    if ((int)(i % fold_count) == fold) {
+                        test_set.push_back(samples[order[i]]);
+                    } else {
+                        train_set.push_back(samples[order[i]]);
+                    }
+                }
+
+                // 每折使用自己的参数表
+                unordered_map<string, double> fold_params = trainParameters(train_set, *initial_params, max_iterations, learning_rate, false);
+
+                CrossValidationFold& result = folds[fold];
+                result.fold = fold + 1;
+                result.train_count = train_set.size();
+                result.test_count = test_set.size();
+                result.baseline_error = calculateWeightedError(test_set, *initial_params);
+                result.train_error = calculateWeightedError(train_set, fold_params);
+                result.test_error = calculateWeightedError(test_set, fold_params);
+                result.seconds = chrono::duration<double>(chrono::steady_clock::now() - fold_start).count();
+            }
+        });
+    }
+    for (thread& worker : workers) {
+        worker.join();
+    }
+
+    double wall_seconds = chrono::duration<double>(chrono::steady_clock::now() - start_time).count();
+
+    // 输出每折和汇总结果
+    double sum_train = 0.0, sum_test = 0.0, sum_baseline = 0.0, sum_test_sq = 0.0;
+    for (const CrossValidationFold& result : folds) {
+        cout << "  折 " << result.fold << ": 训练 " << result.train_count << " / 验证 " << result.test_count
+             << "，训练误差 " << result.train_error << "，验证误差 " << result.test_error
+             << "（初始参数 " << result.baseline_error << "），耗时 " << result.seconds << " 秒" << endl;
+        sum_train += result.train_error;
+        sum_test += result.test_error;
+        sum_baseline += result.baseline_error;
+        sum_test_sq += result.test_error * result.test_error;
+    }
+
+    double mean_test = sum_test / fold_count;
+    double stddev_test = sqrt(max(0.0, sum_test_sq / fold_count - mean_test * mean_test));
+    cout << "交叉验证完成：平均训练误差 " << sum_train / fold_count
+         << "，平均验证误差 " << mean_test << " ± " << stddev_test
+         << "（初始参数 " << sum_baseline / fold_count << "），总耗时 " << wall_seconds << " 秒" << endl;
+
+    return folds;
+}
+
+// 在线更新的比较发布最多尝试的次数
+const int ONLINE_PUBLISH_ATTEMPTS = 3;
+
+double ConceptDatabase::onlineUpdate(const TrainingSample& sample) {
+    // 直方图在锁外计算，更新本身只依赖直方图，是常数时间
+    TrainingSample stored = sample;
+    refreshSampleHistogram(stored, getSnapshot()->version);
+
+    lock_guard<mutex> lock(online_mutex);
+    training_samples.push_back(stored);
+
+    // 在读到的参数表上算一步梯度，按读到的版本比较后发布：其间其他发布者（参数文件、optimize）换了表时，
+    // 在新表上重算，多次冲突则放弃这一步，不覆盖别人发布的参数
+    const MatchHistogram& h = stored.histogram;
+    for (int attempt = 0;; attempt++) {
+        auto current_table = getPublishedParameterTable();
+        const unordered_map<string, double>& current = current_table->values;
+        ParameterGrid grid = resolveParameterGrid(current);
+        double calculated_similarity = calculateSimilarityFromHistogram(h, grid);
+        double error = calculated_similarity - stored.expected_similarity;
+
+        // 没有重合概念时相似度恒为0，与参数无关，无需更新
+        if (h.total_matches == 0 || calculated_similarity <= 0.0) {
+            return abs(error);
+        }
+
+        auto param_value = [&grid](int i, int j) {
+            return grid.values[i - 1][j - 1];
+        };
+
+        // 分相似度：A = Σ c_ij * p_ij / |A|，B = Σ c_ij * p_ji / |B|
+        double partial_A = 0.0, partial_B = 0.0;
+        for (int i = 1; i <= 5; i++) {
+            for (int j = 1; j <= 5; j++) {
+                int count = h.level_counts[i - 1][j - 1];
+                if (count > 0) {
+                    partial_A += count * param_value(i, j);
+                    partial_B += count * param_value(j, i);
+                }
+            }
+        }
+        partial_A /= h.matches_A_count;
+        partial_B /= h.matches_B_count;
+
+        // 损失 = conf * (sim - expected)^2 / 2，sim = sqrt(A * B)
+        // ∂sim/∂p_kl = (B * c_kl / |A| + A * c_lk / |B|) / (2 * sim)
+        double learning_rate = online_base_learning_rate / (1.0 + online_decay * online_step_count);
+        double scale = stored.confidence * error / (2.0 * calculated_similarity);
+
+        unordered_map<string, double> updated = current;
+        for (int k = 1; k <= 5; k++) {
+            for (int l = 1; l <= 5; l++) {
+                int count_kl = h.level_counts[k - 1][l - 1];
+                int count_lk = h.level_counts[l - 1][k - 1];
+                if (count_kl == 0 && count_lk == 0) {
+                    continue;
+                }
+
+                double gradient = scale * (partial_B * count_kl / h.matches_A_count +
+                                           partial_A * count_lk / h.matches_B_count);
+                double new_value = param_value(k, l) - learning_rate * gradient;
+
+                // 约束参数在合理范围内（与批量优化一致）
+                updated["p" + to_string(k) + to_string(l)] = max(0.1, min(5.0, new_value));
+            }
+        }
+
+        if (publishParametersIfCurrent(updated, "online", current_table->version) != 0) {
+            online_step_count++;
+            return abs(error);
+        }
+        if (attempt + 1 >= ONLINE_PUBLISH_ATTEMPTS) {
+            LOG_WARN("参数表持续被其他发布者更新，放弃本次在线更新", {"attempts", attempt + 1});
+            return abs(error);
         }
     }
+}
+
+void ConceptDatabase::resetOnlineLearning(double base_learning_rate, double decay) {
+    lock_guard<mutex> lock(online_mutex);
+    online_step_count = 0;
+    online_base_learning_rate = base_learning_rate;
+    online_decay = decay;
+}
+
+// 原子写文件：写入同目录下的临时文件并fsync，再rename替换目标文件，最后fsync目录
+static bool writeFileAtomically(const string& path, string_view content, string& error) {
+    // 目标是符号链接时替换链接指向的文件，保留链接本身
+    char resolved[PATH_MAX];
+    string filename = realpath(path.c_str(), resolved) ? string(resolved) : path;
+    string temp_name = filename + ".tmp." + to_string(getpid());
+    int fd = open(temp_name.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        error = strerror(errno);
+        return false;
+    }
+
+    size_t written = 0;
+    while (written < content.size()) {
+        ssize_t n = write(fd, content.data() + written, content.size() - written);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        written += n;
+    }
+    bool ok = written == content.size() && fsync(fd) == 0;
+    if (!ok) error = strerror(errno);
+    if (close(fd) != 0 && ok) {
+        ok = false;
+        error = strerror(errno);
+    }
+    if (ok && rename(temp_name.c_str(), filename.c_str()) != 0) {
+        ok = false;
+        error = strerror(errno);
+    }
+    if (!ok) {
+        unlink(temp_name.c_str());
+        return false;
+    }
 
-    // 应用最佳参数
-    g_similarity_params = best_params;
-    cout << "参数优化完成，最终评分: " << best_score << endl;
+    // 持久化目录项，保证rename本身在崩溃后可见
+    size_t slash = filename.find_last_of('/');
+    string directory = slash == string::npos ? "." : (slash == 0 ? "/" : filename.substr(0, slash));
+    int dir_fd = open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dir_fd >= 0) {
+        fsync(dir_fd);
+        close(dir_fd);
+    }
+    return true;
 }
 
 // 参数持久化
 bool ConceptDatabase::saveParameters(const string& filename) {
     try {
-        ofstream file(filename);
-        if (!file.is_open()) {
-            cerr << "无法打开文件进行写入: " << filename << endl;
-            return false;
-        }
+        auto published = getPublishedParameterTable();
 
+        ostringstream file;
         file << "# Approacher相似度参数文件" << endl;
         file << "# 格式: 参数名=值" << endl;
         file << endl;
 
         // 按参数名排序保存
-        vector<pair<string, double>> sorted_params(g_similarity_params.begin(), g_similarity_params.end());
+        vector<pair<string, double>> sorted_params(published->values.begin(), published->values.end());
         sort(sorted_params.begin(), sorted_params.end());
 
         for (const auto& param : sorted_params) {
             file << param.first << "=" << param.second << endl;
         }
 
-        file.close();
-        cout << "参数已保存到 " << filename << endl;
+        string error;
+        if (!writeFileAtomically(filename, file.str(), error)) {
+            LOG_ERROR("无法写入参数文件", {"file", filename}, {"error", error});
+            return false;
+        }
+        LOG_INFO("参数已保存到 " << filename, {"file", filename}, {"version", published->version});
         return true;
 
     } catch (const exception& e) {
-        cerr << "保存参数失败: " << e.what() << endl;
+        LOG_ERROR("保存参数失败", {"error", e.what()});
         return false;
     }
 }
@@ -913,12 +3087,13 @@ bool ConceptDatabase::loadParameters(const string& filename) {
     try {
         ifstream file(filename);
         if (!file.is_open()) {
-            cerr << "无法打开参数文件: " << filename << endl;
+            LOG_ERROR("无法打开参数文件", {"file", filename});
             return false;
         }
 
         string line;
         int loaded_count = 0;
+        unordered_map<string, double> loaded_params = *getPublishedParameters();
 
         while (getline(file, line)) {
             // 跳过注释和空行
@@ -942,19 +3117,27 @@ bool ConceptDatabase::loadParameters(const string& filename) {
 
             try {
                 double value = stod(value_str);
-                g_similarity_params[param_name] = value;
+                loaded_params[param_name] = value;
                 loaded_count++;
             } catch (const invalid_argument& e) {
-                cerr << "警告：参数值格式错误，跳过：" << line << endl;
+                LOG_WARN("参数值格式错误，跳过", {"content", line});
             }
         }
 
         file.close();
-        cout << "从 " << filename << " 成功加载了 " << loaded_count << " 个参数" << endl;
-        return loaded_count > 0;
+
+        if (loaded_count == 0) {
+            LOG_WARN("参数文件中没有有效参数，保持当前参数表", {"file", filename});
+            return false;
+        }
+
+        // 整表发布，评分线程不会看到更新到一半的参数
+        uint64_t version = publishParameters(loaded_params, filename);
+        LOG_INFO("从 " << filename << " 成功加载了 " << loaded_count << " 个参数", {"file", filename}, {"count", loaded_count}, {"version", version});
+        return true;
 
     } catch (const exception& e) {
-        cerr << "加载参数失败: " << e.what() << endl;
+        LOG_ERROR("加载参数失败", {"error", e.what()});
         return false;
     }
 }
\ No newline at end of file
@@ -2,13 +2,20 @@
 
 #include <vector>
 #include <string>
+#include <string_view>
 #include <memory>
 #include <map>
 #include <unordered_map>
 #include <algorithm>
+#include <mutex>
 #include "objectbox.hpp"
 #include "concepts.obx.hpp"
 #include "objectbox-model.h"
+#include "ConceptSnapshot.hpp"
+#include "ConceptStream.hpp"
+#include "MatchCache.hpp"
+#include "QueryArena.hpp"
+#include "QueryPlanner.hpp"
 
 using namespace std;
 
@@ -21,33 +28,164 @@ struct Feature {
         : key(k), value(v) {}
 };
 
-// 匹配结果结构
+// 特征视图：键和值指向输入缓冲区（请求文本、输入行），不复制字符串
+// 缓冲区在视图使用期间必须保持有效且不被移动（短字符串移动时内容会搬家）
+struct FeatureView {
+    string_view key;    // 空表示无键特征
+    string_view value;
+
+    FeatureView(string_view k = string_view(), string_view v = string_view())
+        : key(k), value(v) {}
+};
+
+// 匹配结果结构（对外接口使用；查询内部的精确匹配使用CompactMatch）
 struct MatchResult {
     obx_id concept_id;
     int match_count;
-    vector<int> matched_indices;  // 匹配的特征索引
+    vector<int> matched_indices;  // 匹配的特征索引（升序）
 
     MatchResult(obx_id id = 0, int count = 0)
         : concept_id(id), match_count(count) {}
 };
 
+// 匹配直方图：一对特征列表在各重合度等级组合(i,j)上的重合概念数
+// 相似度对pij参数是线性的，缓存直方图后评估任意参数表只需O(25)
+struct MatchHistogram {
+    int level_counts[5][5] = {};  // [A等级-1][B等级-1] → 重合概念数
+    int matches_A_count = 0;      // A匹配的概念总数
+    int matches_B_count = 0;      // B匹配的概念总数
+    int total_matches = 0;        // 重合概念总数
+};
+
+// pij参数网格：values[i-1][j-1] = pij，参数表中缺失的项为1.0
+// 批量评估时预先解析，避免逐样本按字符串查找参数
+struct ParameterGrid {
+    double values[5][5];
+};
+
 // 训练样本结构
 struct TrainingSample {
     vector<Feature> features_A;
     vector<Feature> features_B;
     double expected_similarity;
     double confidence;
+    MatchHistogram histogram;     // 缓存的匹配直方图
+    bool has_histogram = false;   // 直方图是否已计算
+    uint64_t histogram_version = 0;  // 计算直方图时的概念库快照版本，快照替换后重新计算
 
     TrainingSample(double similarity = 0.0, double conf = 1.0)
         : expected_similarity(similarity), confidence(conf) {}
 };
 
+// 相似度计算选项
+struct SimilarityOptions {
+    bool use_fuzzy_matching = false;  // 是否使用模糊匹配
+    double fuzzy_threshold = 0.6;     // 模糊匹配阈值
+    int max_recursive_depth = 2;      // 递归匹配深度
+};
+
+// 一次相似度计算的结构化结果
+struct SimilarityResult {
+    double partial_a_to_b = 0.0;   // A的分相似度 [A]->[B]
+    double partial_b_to_a = 0.0;   // B的分相似度 [A]<-[B]
+    double main_similarity = 0.0;  // 主相似度 [A]<->[B]（与calculateMainSimilarity一致）
+    int matches_A_count = 0;       // A匹配的概念数
+    int matches_B_count = 0;       // B匹配的概念数
+    int total_matches = 0;         // 重合概念数
+    MatchHistogram histogram;      // 分相似度对应的匹配直方图
+};
+
+// 单次查询的上下文：输入、选项、参数表和结果随请求显式传递，不读写可变的全局状态
+// 参数表在请求开始时取得不可变快照，训练过程中发布的新参数不影响进行中的请求
+struct QueryContext {
+    vector<string> input_a;                                  // 原始输入A（已按逗号切分）
+    vector<string> input_b;                                  // 原始输入B
+    vector<Feature> features_A;                              // 解析后的特征列表A
+    vector<Feature> features_B;                              // 解析后的特征列表B
+    SimilarityOptions options;                               // 模糊匹配、阈值、递归深度
+    shared_ptr<const unordered_map<string, double>> params;  // 本次查询使用的参数表
+    SimilarityResult result;                                 // 计算结果
+};
+
+// Top-K检索中的一个概念
+struct ScoredConcept {
+    obx_id concept_id = 0;
+    double score = 0.0;   // 命中查询特征的权重和 × sqrt(命中数 / 概念特征数)
+    int match_count = 0;  // 命中的查询特征数
+};
+
+// Top-K检索统计
+struct TopKStats {
+    size_t terms = 0;              // 查询项数（含复合词项）
+    size_t postings_total = 0;     // 各查询项倒排列表长度之和
+    size_t candidates_scored = 0;  // 完整评分的概念数（其余被上界剪枝跳过）
+};
+
+// 交叉验证单折结果（误差均为信心度加权的平均绝对误差）
+struct CrossValidationFold {
+    int fold = 0;
+    size_t train_count = 0;
+    size_t test_count = 0;
+    double train_error = 0.0;     // 训练集误差
+    double test_error = 0.0;      // 验证集误差
+    double baseline_error = 0.0;  // 训练前参数在验证集上的误差
+    double seconds = 0.0;         // 本折耗时
+};
+
 // ObjectBox数据库管理类
 class ConceptDatabase {
 private:
     unique_ptr<obx::Store> store;
     unique_ptr<obx::Box<Concept>> conceptBox;
-    vector<TrainingSample> training_samples;  // 训练样本存储
+    vector<TrainingSample> training_samples;  // 训练样本存储（由online_mutex保护）
+    uint64_t training_generation = 0;         // 清空样本时加一（由online_mutex保护）
+
+    // 直方图没有计算或基于旧快照时按当前快照重新计算（snapshot_version为计算前读到的当前版本）
+    void refreshSampleHistogram(TrainingSample& sample, uint64_t snapshot_version);
+
+    // 训练样本的副本，各样本的直方图都基于当前快照；重新计算过的直方图写回样本表
+    vector<TrainingSample> trainingSamplesForCurrentSnapshot();
+
+    // 概念库内存快照（含倒排索引），只通过atomic_load/atomic_store访问
+    shared_ptr<const ConceptSnapshot> snapshot;
+    mutex reload_mutex;                        // 串行化快照构建和概念库修改（读者不使用）
+
+    // 重建快照并原子替换（调用方持有reload_mutex）
+    shared_ptr<const ConceptSnapshot> publishRebuiltSnapshot();
+
+    // 映射快照文件并与数据库的概念数核对（调用方持有reload_mutex），失败返回nullptr
+    shared_ptr<const ConceptSnapshot> openSnapshotForDatabase(const string& path);
+
+    // 匹配结果缓存：一侧特征列表的匹配集合，键含快照版本，快照替换时清空
+    MatchCache match_cache{MatchCache::capacityFromEnvironment()};
+
+    // 合并并发的相同匹配：缓存未命中的一侧同时只匹配一次，键与匹配结果缓存相同
+    MatchFlightGroup match_flights{MatchFlightGroup::enabledFromEnvironment()};
+
+    // 一侧的匹配集合（按options匹配）：先查缓存，未命中时在快照上匹配并放入缓存（并发的相同请求只匹配一次）
+    // 递归模糊匹配读数据库而不是快照，不经过缓存，只合并并发的相同请求
+    template <typename FeatureT>
+    shared_ptr<const MatchSet> cachedMatchSet(const ConceptSnapshot& concept_snapshot, const vector<FeatureT>& input_features,
+                                              const SimilarityOptions& options);
+
+    // 经过匹配结果缓存的相似度计算，结果与不使用缓存时相同
+    template <typename FeatureT>
+    SimilarityResult computeSimilarityCached(const vector<FeatureT>& features_A, const vector<FeatureT>& features_B,
+                                             const SimilarityOptions& options, const unordered_map<string, double>& params);
+
+    // 在线学习状态
+    mutex online_mutex;                        // 串行化在线更新，保护training_samples
+    long online_step_count = 0;                // 已执行的在线更新步数
+    double online_base_learning_rate = 0.05;   // 初始学习率
+    double online_decay = 0.01;                // 学习率衰减系数
+
+    // 模糊匹配一侧的计划：查字典得到相似值的倒排列表和查询签名，估计展开和签名扫描的代价
+    void planFuzzySide(const ConceptSnapshot& concept_snapshot, const vector<Feature>& input_features,
+                       const QueryPlan& plan, SidePlan& side, bool detailed);
+
+    // 按计划执行单层模糊匹配（相似值倒排展开或值签名扫描），verified不为空时写入验证过的概念数
+    vector<MatchResult> matchFuzzyPlanned(const ConceptSnapshot& concept_snapshot, const vector<Feature>& input_features,
+                                          double fuzzy_threshold, const SidePlan& side, size_t* verified = nullptr);
 
 public:
     // 初始化数据库
@@ -65,28 +203,96 @@ public:
     // 按键值对精确查找概念（用于精确匹配）
     vector<unique_ptr<Concept>> findByKeyValue(const string& key, const string& value);
 
-    // 获取所有概念
+    // 获取所有概念（一次性读成对象，内存随概念库增长；遍历全部概念请用forEachConcept）
     vector<unique_ptr<Concept>> getAllConcepts();
 
+    // 按ID升序读出数据库中的概念：在一个读事务中分批读取，内存中只有一批概念（见ConceptStream）
+    ConceptStream streamConcepts(size_t batch_size = ConceptStream::DEFAULT_BATCH_SIZE);
+
+    // 按ID升序对每个概念调用visitor(const Concept&)，visitor返回false时停止，返回访问的概念数
+    // 概念对象只在回调期间有效；回调中不能写数据库（读事务仍打开着）
+    template <typename Visitor>
+    uint64_t forEachConcept(Visitor&& visitor) {
+        ConceptStream stream = streamConcepts();
+        uint64_t visited = 0;
+        for (const Concept& concept : stream) {
+            visited++;
+            if (!visitor(concept)) break;
+        }
+        return visited;
+    }
+
     // 获取数据库统计信息
     void printStatistics();
 
+    // 由数据库构建新快照（流式读取概念），不替换当前快照
+    shared_ptr<const ConceptSnapshot> buildSnapshot();
+
+    // 获取概念库内存快照（首次调用时构建；设置了环境变量 APPROACHER_SNAPSHOT 时先尝试映射该快照文件）
+    shared_ptr<const ConceptSnapshot> getSnapshot();
+
+    // 只读映射导出的快照文件并替换当前快照，不读数据库、不重建索引；失败时保留当前快照并返回false
+    // 快照文件与数据库内容不一致时（导出后数据库被修改）只警告，reload/apply会由数据库重建快照
+    bool loadSnapshotFile(const string& path);
+
+    // 把当前快照的映像原子写入文件（写临时文件后rename，已映射旧文件的进程不受影响）
+    bool exportSnapshot(const string& path);
+
+    // 重新读取数据库并构建新快照，建好后原子替换
+    // 读者不会等待：进行中的查询继续使用旧快照，旧快照在最后一个持有者释放后回收
+    shared_ptr<const ConceptSnapshot> reloadSnapshot();
+
+    // 在一个写事务中应用增量文件，然后重建并替换快照；返回修改的概念数，失败返回-1（不做任何修改）
+    // 每行一个操作: +[key:value,...] 新增；-ID 删除；=ID.[key:value,...] 替换；#开头为注释
+    int applyDelta(const string& filename);
+
     // Stage 2: 概念匹配和相似度计算功能
 
     // 根据特征列表查找匹配的概念（精确匹配）
     vector<MatchResult> findMatchingConcepts(const vector<Feature>& input_features);
 
+    // 在指定快照上查找匹配的概念（精确匹配，通过倒排索引只检查候选概念）
+    vector<MatchResult> findMatchingConcepts(const ConceptSnapshot& concept_snapshot, const vector<Feature>& input_features);
+
+    // 检索与查询特征最接近的k个概念（精确匹配语义），按得分降序、同分按ID升序
+    // 特征权重为 log(1 + 概念数 / 包含该特征的概念数)，用WAND上界剪枝跳过不可能进入前k的概念
+    vector<ScoredConcept> findTopKConcepts(const vector<Feature>& query_features, size_t k, TopKStats* stats = nullptr);
+    vector<ScoredConcept> findTopKConcepts(const ConceptSnapshot& concept_snapshot, const vector<Feature>& query_features, size_t k, TopKStats* stats = nullptr);
+
+    // 在指定快照上精确匹配，结果以紧凑形式追加到out（按概念位置升序），只在out的arena中分配内存
+    void findMatchingConceptsCompact(const ConceptSnapshot& concept_snapshot, const vector<Feature>& input_features, CompactMatchList& out);
+    void findMatchingConceptsCompact(const ConceptSnapshot& concept_snapshot, const vector<FeatureView>& input_features, CompactMatchList& out);
+
+    // 同上，但不使用倒排列表：逐个概念用特征ID内核（FeatureIdMatch）比较，适合输入特征出现在大部分概念中的查询
+    void scanMatchingConceptsCompact(const ConceptSnapshot& concept_snapshot, const vector<Feature>& input_features, CompactMatchList& out);
+    void scanMatchingConceptsCompact(const ConceptSnapshot& concept_snapshot, const vector<FeatureView>& input_features, CompactMatchList& out);
+
+    // 查询计划：按快照的特征频率估计各执行策略的代价并选择（features_B为空时只计划一侧）
+    // 精确匹配在倒排合并、全量扫描和探测另一侧的匹配之间选择，单层模糊匹配在相似值倒排展开和值签名扫描之间选择
+    // detailed为true时记下各特征和复合词的频率（explain用）
+    QueryPlan planQuery(const ConceptSnapshot& concept_snapshot, const vector<Feature>& features_A, const vector<Feature>& features_B,
+                        const SimilarityOptions& options, bool detailed = false);
+
+    // explain：在当前快照上生成计划并按计划执行匹配，填写各侧的实际耗时和工作量（不计算相似度）
+    QueryPlan explainQuery(const vector<Feature>& features_A, const vector<Feature>& features_B, const SimilarityOptions& options);
+
     // 根据特征列表查找匹配的概念（支持模糊匹配）
     vector<MatchResult> findMatchingConcepts(const vector<Feature>& input_features, bool use_fuzzy_matching, double fuzzy_threshold = 0.6, int max_recursive_depth = 2);
 
     // 计算单个概念的匹配结果
     MatchResult matchConceptExact(const vector<Feature>& input_features, const unique_ptr<Concept>& concept);
+    MatchResult matchConceptExact(const vector<Feature>& input_features, const Concept& concept);
+
+    // 精确匹配的核心：匹配位写入mask（(输入特征数+63)/64个字），返回匹配数，不分配内存
+    static int matchConceptExactMask(const vector<Feature>& input_features, const Concept& concept, uint64_t* mask);
+    static int matchConceptExactMask(const vector<FeatureView>& input_features, const Concept& concept, uint64_t* mask);
 
     // 复合词匹配辅助函数：生成所有保持顺序的子序列组合
     vector<vector<int>> generateSubsequenceIndices(int n);
 
     // 复合词匹配辅助函数：检查复合词匹配
     int checkCompoundWordMatches(const vector<Feature>& input_features, const unique_ptr<Concept>& concept, vector<int>& matched_indices);
+    int checkCompoundWordMatches(const vector<Feature>& input_features, const Concept& concept, vector<int>& matched_indices);
 
     // 分析两个匹配结果的重合情况（基于重合度等级）
     map<pair<int,int>, int> analyzeOverlap(const vector<MatchResult>& matches_A, const vector<MatchResult>& matches_B, int total_features_A, int total_features_B, int& total_matches);
@@ -100,19 +306,50 @@ public:
     // 计算主相似度
     double calculateMainSimilarity(const vector<Feature>& features_A, const vector<Feature>& features_B, const unordered_map<string, double>& params);
 
+    // 一次完成匹配、重合分析和分/主相似度计算，返回结构化结果；计算失败（如内存不足）时抛出异常，不返回相似度0
+    SimilarityResult computeSimilarity(const vector<Feature>& features_A, const vector<Feature>& features_B, const SimilarityOptions& options, const unordered_map<string, double>& params);
+
+    // 同上，输入为特征视图：精确模式下直接在视图上匹配，不复制特征；模糊模式先转为Feature
+    SimilarityResult computeSimilarity(const vector<FeatureView>& features_A, const vector<FeatureView>& features_B, const SimilarityOptions& options, const unordered_map<string, double>& params);
+
+    // 由两侧已有的匹配结果完成重合分析和分/主相似度计算（computeSimilarity的后半部分）
+    SimilarityResult scoreSimilarity(const vector<Feature>& features_A, const vector<Feature>& features_B, const vector<MatchResult>& matches_A, const vector<MatchResult>& matches_B, const SimilarityOptions& options, const unordered_map<string, double>& params);
+
+    // 匹配结果缓存的统计；修改容量（字节，0为禁用）会清空缓存
+    MatchCacheStats matchCacheStats() const;
+    void resetMatchCacheStats();
+    void setMatchCacheCapacity(size_t capacity_bytes);
+    void clearMatchCache();
+
+    // 并发相同查询合并的统计和开关
+    MatchFlightStats singleFlightStats() const;
+    void resetSingleFlightStats();
+    void setSingleFlightEnabled(bool enabled);
+
+    // 由匹配直方图计算分相似度和主相似度（精确匹配语义；模糊模式的主相似度由调用方另行计算）
+    SimilarityResult scoreHistogram(const MatchHistogram& histogram, const unordered_map<string, double>& params);
+
+    // 按查询上下文计算相似度，结果写入context.result（只读数据库，可在多个线程上并发调用）
+    const SimilarityResult& computeSimilarity(QueryContext& context);
+
     // Stage 3: 模糊匹配和参数学习功能
 
     // 计算字符串编辑距离（Levenshtein距离）
-    int calculateStringDistance(const string& str1, const string& str2);
+    int calculateStringDistance(string_view str1, string_view str2);
 
     // 计算字符串相似度（0-1之间）
-    double calculateStringSimilarity(const string& str1, const string& str2);
+    double calculateStringSimilarity(string_view str1, string_view str2);
 
     // 模糊查找相似值
     vector<pair<string, double>> findSimilarValues(const string& query_value, double min_similarity = 0.6);
 
     // 支持模糊匹配的概念匹配
     MatchResult matchConceptFuzzy(const vector<Feature>& input_features, const unique_ptr<Concept>& concept, double fuzzy_threshold = 0.6);
+    MatchResult matchConceptFuzzy(const vector<Feature>& input_features, const Concept& concept, double fuzzy_threshold = 0.6);
+
+    // 模糊匹配的查询签名：快照中与某个输入值相似度达到阈值的值（有键的输入为该键下的键值对）的签名位之并
+    // 签名与之不相交的概念在matchConceptFuzzy中不会有任何输入特征匹配
+    uint64_t fuzzyQuerySignature(const ConceptSnapshot& concept_snapshot, const vector<Feature>& input_features, double fuzzy_threshold);
 
     // 递归匹配功能（支持深度限制）
     vector<MatchResult> recursiveMatch(const vector<Feature>& input_features, int max_depth = 2, double fuzzy_threshold = 0.6);
@@ -122,17 +359,128 @@ public:
     vector<TrainingSample> getTrainingSamples();
     void clearTrainingSamples();
 
+    // 从TSV或JSONL文件批量导入训练样本（去重，并行预计算匹配直方图），返回导入数量
+    // TSV每行: A<TAB>B<TAB>期望相似度[<TAB>信心度]，A/B为逗号分隔特征
+    // JSONL每行: {"a": "red,apple", "b": ["apple"], "expected": 0.7, "confidence": 0.9}
+    size_t importTrainingSamples(const string& filename, int thread_count = 0);
+
+    // 计算两个特征列表的匹配直方图（精确匹配，与calculateMainSimilarity一致）
+    MatchHistogram computeMatchHistogram(const vector<Feature>& features_A, const vector<Feature>& features_B);
+    MatchHistogram computeMatchHistogram(const vector<FeatureView>& features_A, const vector<FeatureView>& features_B);
+
+    // 由已有的匹配结果统计匹配直方图
+    MatchHistogram computeMatchHistogram(const vector<MatchResult>& matches_A, const vector<MatchResult>& matches_B, int total_features_A, int total_features_B);
+
+    // 由两侧的紧凑匹配结果统计匹配直方图（两侧均按概念位置升序，归并即可，不建哈希表）
+    MatchHistogram computeMatchHistogram(const CompactMatchList& matches_A, const CompactMatchList& matches_B, int total_features_A, int total_features_B);
+
+    // 由两侧的匹配集合统计匹配直方图（两侧均按概念ID升序，等级已在匹配时算好）
+    MatchHistogram computeMatchHistogram(const MatchSet& matches_A, const MatchSet& matches_B);
+
+    // 根据匹配直方图计算主相似度，无需重新匹配
+    double calculateSimilarityFromHistogram(const MatchHistogram& histogram, const unordered_map<string, double>& params);
+    double calculateSimilarityFromHistogram(const MatchHistogram& histogram, const ParameterGrid& grid);
+
+    // 根据匹配直方图计算A、B两个方向的分相似度
+    void calculatePartialSimilaritiesFromHistogram(const MatchHistogram& histogram, const ParameterGrid& grid, double& partial_a_to_b, double& partial_b_to_a);
+
+    // 在线学习：对单个样本执行一次梯度步，按读到的参数表版本比较后发布（其间其他发布者换了表时在新表上重算，
+    // 最多尝试3次，仍冲突则放弃这一步），返回更新前的误差
+    double onlineUpdate(const TrainingSample& sample);
+
+    // 重置在线学习的步数和学习率（学习率 = base / (1 + decay * 步数)）
+    void resetOnlineLearning(double base_learning_rate = 0.05, double decay = 0.01);
+
     // 参数优化
     void optimizeParameters(int max_iterations = 100, double learning_rate = 0.01);
     double evaluateParameters(const unordered_map<string, double>& params);
+    double evaluateParameters(const vector<TrainingSample>& samples, const unordered_map<string, double>& params);
 
-    // 参数持久化
+    // 计算样本集上信心度加权的平均绝对误差
+    double calculateWeightedError(const vector<TrainingSample>& samples, const unordered_map<string, double>& params);
+
+    // 在给定样本上从初始参数训练，返回最佳参数表（不读写全局参数，可并发调用）
+    unordered_map<string, double> trainParameters(const vector<TrainingSample>& samples, const unordered_map<string, double>& initial_params, int max_iterations = 100, double learning_rate = 0.01, bool verbose = false);
+
+    // k折交叉验证：每折在独立线程上用独立参数表训练，输出每折和汇总误差
+    vector<CrossValidationFold> crossValidate(int fold_count = 5, int max_iterations = 100, double learning_rate = 0.01);
+
+    // 参数持久化：保存时先写临时文件、fsync后rename替换，中途崩溃不会留下截断的参数文件
+    // 加载时整表解析后一次发布，没有任何有效参数时保持当前参数表
     bool saveParameters(const string& filename = "parameters.txt");
     bool loadParameters(const string& filename = "parameters.txt");
 };
 
-// 全局pij参数配置
-extern unordered_map<string, double> g_similarity_params;
+// 内置的默认pij参数表（只读）
+const unordered_map<string, double>& getDefaultParameters();
+
+// 已发布的参数表：发布后不可变，每次发布版本号递增
+struct ParameterTable {
+    uint64_t version = 0;                   // 版本号，内置默认表为0
+    string source;                          // 来源（文件名、optimize、online等）
+    unordered_map<string, double> values;   // 参数名 → 值
+};
+
+// 获取当前发布的参数表（不可变快照，评分线程可安全持有）
+shared_ptr<const unordered_map<string, double>> getPublishedParameters();
+
+// 获取当前发布的参数表及其版本信息
+shared_ptr<const ParameterTable> getPublishedParameterTable();
+
+// 原子发布新的参数表，持有旧表的评分线程不受影响；返回新版本号
+uint64_t publishParameters(const unordered_map<string, double>& params, const string& source = "");
+
+// 比较后发布：当前版本仍为expected_version时才发布（与publishParameters在同一把锁下），返回新版本号；
+// 其间已有其他发布者换了表时不发布，返回0（基于读到的表计算新参数的发布者用它避免覆盖别人的更新）
+uint64_t publishParametersIfCurrent(const unordered_map<string, double>& params, const string& source, uint64_t expected_version);
+
+// 将参数表解析为pij参数网格
+ParameterGrid resolveParameterGrid(const unordered_map<string, double>& params);
+
+// 工具函数：去除前后的空格和制表符
+inline string_view trimBlank(string_view text) {
+    size_t start = text.find_first_not_of(" \t");
+    if (start == string_view::npos) return string_view();
+    size_t end = text.find_last_not_of(" \t");
+    return text.substr(start, end - start + 1);
+}
+
+// 工具函数：单遍切分逗号分隔的输入，对每个去除前后空白后的非空项调用callback(string_view)
+// 视图指向input，不分配内存
+template <typename Callback>
+void forEachCommaItem(string_view input, Callback&& callback) {
+    size_t begin = 0;
+    while (begin <= input.size()) {
+        size_t comma = input.find(',', begin);
+        if (comma == string_view::npos) comma = input.size();
+        string_view item = trimBlank(input.substr(begin, comma - begin));
+        if (!item.empty()) {
+            callback(item);
+        }
+        begin = comma + 1;
+    }
+}
+
+// 工具函数：解析一项特征文本，第一个冒号之前为键（"key:value"），没有冒号时为无键特征
+inline FeatureView parseFeatureView(string_view item) {
+    size_t colon_pos = item.find(':');
+    if (colon_pos == string_view::npos) {
+        return FeatureView(string_view(), item);
+    }
+    return FeatureView(item.substr(0, colon_pos), item.substr(colon_pos + 1));
+}
+
+// 工具函数：把逗号分隔的特征输入解析为视图，追加到out（out重复使用时容量保留，稳定后不分配内存）
+void parseFeatureViews(string_view input, vector<FeatureView>& out);
+
+// 工具函数：按逗号切分特征输入（去除前后空白，跳过空项）
+vector<string> splitCommaList(const string& input);
 
 // 工具函数：解析用户输入特征列表
-vector<Feature> parseFeatureList(const vector<string>& input_list);
\ No newline at end of file
+vector<Feature> parseFeatureList(const vector<string>& input_list);
+
+// 工具函数：把特征视图复制为Feature（需要在缓冲区之外保存特征时使用）
+vector<Feature> toFeatureList(const vector<FeatureView>& views);
+
+// 创建查询上下文：解析输入并取得当前发布的参数表
+QueryContext makeQueryContext(const vector<string>& input_a, const vector<string>& input_b, const SimilarityOptions& options = SimilarityOptions());
\ No newline at end of file
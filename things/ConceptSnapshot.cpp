@@ -0,0 +1,239 @@
+#include "ConceptSnapshot.hpp"
+#include "SnapshotFile.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <ctime>
+#include <new>
+#include <unordered_map>
+
+using namespace std;
+
+// 全局快照版本计数器
+static atomic<uint64_t> g_snapshot_version(0);
+
+const PostingList* ConceptSnapshot::findValueList(string_view value) const {
+    size_t mask = term_slots.size() - 1;
+    for (size_t slot = termHashMix(valueTermHash(value)) & mask;; slot = (slot + 1) & mask) {
+        uint32_t id = term_slots[slot];
+        if (id == EMPTY_TERM_SLOT) return nullptr;
+        if (!posting_lists[id].key_value && term(id) == value) return &posting_lists[id];
+    }
+}
+
+const PostingList* ConceptSnapshot::findKeyValueList(string_view key, string_view value) const {
+    size_t mask = term_slots.size() - 1;
+    for (size_t slot = termHashMix(keyValueTermHash(key, value)) & mask;; slot = (slot + 1) & mask) {
+        uint32_t id = term_slots[slot];
+        if (id == EMPTY_TERM_SLOT) return nullptr;
+        if (!posting_lists[id].key_value) continue;
+        string_view key_value = term(id);
+        if (key_value.size() == key.size() + 1 + value.size() && key_value[key.size()] == ':' &&
+            key_value.compare(0, key.size(), key) == 0 && key_value.compare(key.size() + 1, value.size(), value) == 0) {
+            return &posting_lists[id];
+        }
+    }
+}
+
+void ConceptSnapshot::postingStatistics(size_t& position_count, size_t& memory_bytes) const {
+    position_count = 0;
+    memory_bytes = 0;
+    for (const PostingList& list : posting_lists) {
+        position_count += list.positions.size();
+        memory_bytes += list.positions.memoryBytes();
+    }
+}
+
+size_t ConceptSnapshot::conceptValueCount(uint32_t position) const {
+    size_t count = 0;
+    const uint32_t* ids = featureIds(position);
+    for (size_t i = 0, n = featureIdCount(position); i < n; i++) {
+        if (!posting_lists[ids[i]].key_value) count++;
+    }
+    return count;
+}
+
+Concept ConceptSnapshot::conceptAt(uint32_t position) const {
+    Concept concept;
+    concept.id = conceptId(position);
+    const uint32_t* ids = featureIds(position);
+    size_t value_count = conceptValueCount(position);
+    concept.feature_values.reserve(value_count);
+    concept.feature_keys.reserve(featureIdCount(position) - value_count);
+    for (size_t i = 0, n = featureIdCount(position); i < n; i++) {
+        string_view text = term(ids[i]);
+        if (posting_lists[ids[i]].key_value) {
+            concept.feature_keys.emplace_back(text.substr(0, text.find(':')));
+        } else {
+            concept.feature_values.emplace_back(text);
+        }
+    }
+    return concept;
+}
+
+uint64_t computeConceptSignature(const Concept& concept) {
+    uint64_t signature = 0;
+    for (size_t i = 0; i < concept.feature_values.size(); i++) {
+        signature |= valueSignatureBit(concept.feature_values[i]);
+        if (i < concept.feature_keys.size()) {
+            signature |= keyValueSignatureBit(concept.feature_keys[i], concept.feature_values[i]);
+        }
+    }
+    return signature;
+}
+
+// 1. 为特征编号并收集各列：特征第一次出现时分配ID并记下文本，概念的特征ID按特征顺序写入feature_ids；
+//    倒排位置按升序追加，同一概念内重复的值只记录一次，先按特征ID收集到未压缩的列表
+void ConceptSnapshotBuilder::addTerm(uint32_t kind, const string& text, uint32_t position) {
+    auto inserted = term_ids[kind].try_emplace(text, (uint32_t)raw_positions.size());
+    uint32_t id = inserted.first->second;
+    if (inserted.second) {
+        term_bytes.insert(term_bytes.end(), text.begin(), text.end());
+        term_offsets.push_back(term_bytes.size());
+        term_kinds.push_back(kind);
+        raw_positions.emplace_back();
+    }
+    vector<uint32_t>& positions = raw_positions[id];
+    if (positions.empty() || positions.back() != position) {
+        positions.push_back(position);
+    }
+    feature_ids.push_back(id);
+}
+
+void ConceptSnapshotBuilder::add(const Concept& concept) {
+    uint32_t position = concept_ids.size();
+    concept_ids.push_back(concept.id);
+    signatures.push_back(computeConceptSignature(concept));
+    feature_offsets.push_back(feature_ids.size());
+    for (size_t i = 0; i < concept.feature_values.size(); i++) {
+        addTerm(0, concept.feature_values[i], position);
+        if (i < concept.feature_keys.size()) {
+            key_value_text.assign(concept.feature_keys[i]);
+            key_value_text += ':';
+            key_value_text += concept.feature_values[i];
+            addTerm(1, key_value_text, position);
+        }
+    }
+}
+
+shared_ptr<const ConceptSnapshot> ConceptSnapshotBuilder::finish() {
+    feature_offsets.push_back(feature_ids.size());
+    term_ids[0].clear();
+    term_ids[1].clear();
+    uint32_t feature_count = raw_positions.size();
+
+    // 2. 压缩倒排列表（全部列表的跳表和差值各自连续存放），同时统计特征频率
+    FrequencyStats frequency;
+    vector<CompressedPostings::SkipEntry> skips;
+    vector<uint8_t> bytes;
+    vector<uint32_t> skip_begin(feature_count + 1, 0), byte_begin(feature_count + 1, 0);
+    for (uint32_t id = 0; id < feature_count; id++) {
+        const vector<uint32_t>& positions = raw_positions[id];
+        CompressedPostings::encode(positions, skips, bytes);
+        skip_begin[id + 1] = skips.size();
+        byte_begin[id + 1] = bytes.size();
+        uint32_t count = positions.size();
+        frequency.total_postings += count;
+        frequency.max_frequency = max(frequency.max_frequency, count);
+        frequency.frequency_buckets[count == 0 ? 0 : 32 - __builtin_clz(count)]++;
+    }
+    size_t signature_bits = 0;
+    for (uint64_t signature : signatures) {
+        signature_bits += __builtin_popcountll(signature);
+    }
+    if (!signatures.empty()) {
+        frequency.average_signature_bits = (double)signature_bits / signatures.size();
+    }
+
+    // 3. 字典散列表：槽数为不小于特征数两倍的2的幂
+    size_t slot_count = 8;
+    while (slot_count < 2 * (size_t)feature_count) slot_count *= 2;
+    vector<uint32_t> term_slots(slot_count, EMPTY_TERM_SLOT);
+    for (uint32_t id = 0; id < feature_count; id++) {
+        string_view text(term_bytes.data() + term_offsets[id], term_offsets[id + 1] - term_offsets[id]);
+        // "key:value"的散列与keyValueTermHash(key, value)相同
+        uint64_t hash = term_kinds[id] ? signatureFnv(text, 0x84222325CBF29CE4ULL) : valueTermHash(text);
+        size_t slot = termHashMix(hash) & (slot_count - 1);
+        while (term_slots[slot] != EMPTY_TERM_SLOT) {
+            slot = (slot + 1) & (slot_count - 1);
+        }
+        term_slots[slot] = id;
+    }
+
+    // 4. 写入映像
+    size_t section_sizes[SNAPSHOT_SECTION_COUNT] = {};
+    section_sizes[SECTION_CONCEPT_IDS] = concept_ids.size() * sizeof(uint64_t);
+    section_sizes[SECTION_SIGNATURES] = signatures.size() * sizeof(uint64_t);
+    section_sizes[SECTION_FEATURE_OFFSETS] = feature_offsets.size() * sizeof(uint32_t);
+    section_sizes[SECTION_FEATURE_IDS] = feature_ids.size() * sizeof(uint32_t);
+    section_sizes[SECTION_POSTING_LISTS] = feature_count * sizeof(PostingList);
+    section_sizes[SECTION_POSTING_SKIPS] = skips.size() * sizeof(CompressedPostings::SkipEntry);
+    section_sizes[SECTION_POSTING_BYTES] = bytes.size();
+    section_sizes[SECTION_TERM_OFFSETS] = term_offsets.size() * sizeof(uint32_t);
+    section_sizes[SECTION_TERM_BYTES] = term_bytes.size();
+    section_sizes[SECTION_TERM_SLOTS] = term_slots.size() * sizeof(uint32_t);
+    shared_ptr<SnapshotImage> image = SnapshotImage::allocate(section_sizes);
+
+    auto write_section = [&image](SnapshotSectionId id, const void* data, size_t size) {
+        if (size > 0) memcpy(image->mutableSection<uint8_t>(id), data, size);
+    };
+    write_section(SECTION_CONCEPT_IDS, concept_ids.data(), section_sizes[SECTION_CONCEPT_IDS]);
+    write_section(SECTION_SIGNATURES, signatures.data(), section_sizes[SECTION_SIGNATURES]);
+    write_section(SECTION_FEATURE_OFFSETS, feature_offsets.data(), section_sizes[SECTION_FEATURE_OFFSETS]);
+    write_section(SECTION_FEATURE_IDS, feature_ids.data(), section_sizes[SECTION_FEATURE_IDS]);
+    write_section(SECTION_POSTING_SKIPS, skips.data(), section_sizes[SECTION_POSTING_SKIPS]);
+    write_section(SECTION_POSTING_BYTES, bytes.data(), section_sizes[SECTION_POSTING_BYTES]);
+    write_section(SECTION_TERM_OFFSETS, term_offsets.data(), section_sizes[SECTION_TERM_OFFSETS]);
+    write_section(SECTION_TERM_BYTES, term_bytes.data(), section_sizes[SECTION_TERM_BYTES]);
+    write_section(SECTION_TERM_SLOTS, term_slots.data(), section_sizes[SECTION_TERM_SLOTS]);
+
+    PostingList* lists = image->mutableSection<PostingList>(SECTION_POSTING_LISTS);
+    const CompressedPostings::SkipEntry* image_skips = image->mutableSection<CompressedPostings::SkipEntry>(SECTION_POSTING_SKIPS);
+    const uint8_t* image_bytes = image->mutableSection<uint8_t>(SECTION_POSTING_BYTES);
+    for (uint32_t id = 0; id < feature_count; id++) {
+        PostingList* list = new (&lists[id]) PostingList();
+        list->id = id;
+        list->key_value = term_kinds[id];
+        list->positions.attach(raw_positions[id].size(), image_skips + skip_begin[id], skip_begin[id + 1] - skip_begin[id],
+                               image_bytes + byte_begin[id], byte_begin[id + 1] - byte_begin[id]);
+    }
+
+    SnapshotFileHeader& header = image->mutableHeader();
+    header.concept_count = concept_ids.size();
+    header.feature_id_count = feature_count;
+    header.created_at = time(nullptr);
+    header.frequency = frequency;
+    image->seal();
+
+    return attachConceptSnapshot(image);
+}
+
+shared_ptr<const ConceptSnapshot> buildConceptSnapshot(vector<unique_ptr<Concept>> concepts) {
+    sort(concepts.begin(), concepts.end(),
+         [](const unique_ptr<Concept>& a, const unique_ptr<Concept>& b) {
+             return a->id < b->id;
+         });
+    ConceptSnapshotBuilder builder;
+    for (const auto& concept : concepts) {
+        builder.add(*concept);
+    }
+    return builder.finish();
+}
+
+shared_ptr<const ConceptSnapshot> attachConceptSnapshot(shared_ptr<const SnapshotImage> image) {
+    auto snapshot = make_shared<ConceptSnapshot>();
+    snapshot->version = ++g_snapshot_version;
+    const SnapshotFileHeader& header = image->header();
+    snapshot->concept_ids = image->section<uint64_t>(SECTION_CONCEPT_IDS);
+    snapshot->signatures = image->section<uint64_t>(SECTION_SIGNATURES);
+    snapshot->feature_offsets = image->section<uint32_t>(SECTION_FEATURE_OFFSETS);
+    snapshot->feature_ids = image->section<uint32_t>(SECTION_FEATURE_IDS);
+    snapshot->posting_lists = image->section<PostingList>(SECTION_POSTING_LISTS);
+    snapshot->term_offsets = image->section<uint32_t>(SECTION_TERM_OFFSETS);
+    snapshot->term_bytes = image->section<char>(SECTION_TERM_BYTES);
+    snapshot->term_slots = image->section<uint32_t>(SECTION_TERM_SLOTS);
+    snapshot->feature_id_count = header.feature_id_count;
+    snapshot->frequency = header.frequency;
+    snapshot->image = move(image);
+    return snapshot;
+}
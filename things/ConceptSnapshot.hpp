@@ -0,0 +1,196 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <string_view>
+#include <memory>
+#include <unordered_map>
+#include <cstdint>
+#include "concepts.obx.hpp"
+#include "CompressedPostings.hpp"
+
+using namespace std;
+
+// 倒排列表：特征ID和包含该特征的概念位置
+struct PostingList {
+    uint32_t id = 0;               // 特征ID：值和键值对在同一个编号空间中连续编号，也是本项在posting_lists中的下标
+    uint32_t key_value = 0;        // 1为键值对（文本为"key:value"），0为值
+    CompressedPostings positions;  // 包含该特征的概念位置（升序，差值压缩）
+};
+
+// 特征频率统计：构建快照时计算，供查询计划估计各执行策略的代价（随快照映像一起保存）
+// 单个值或键值对的频率就是其倒排列表的长度（PostingList::positions.size()）
+struct FrequencyStats {
+    uint64_t total_postings = 0;                       // 倒排列表位置总数
+    uint32_t max_frequency = 0;                        // 最常见的值或键值对出现在多少个概念中
+    uint32_t frequency_buckets[33] = {};               // 按频率分桶的特征数：第b桶为频率在[2^(b-1), 2^b)的特征（第0桶为0）
+    double average_signature_bits = 0.0;               // 概念值签名的平均置位数（估计签名扫描的误判率）
+};
+
+// 快照映像中一段的只读视图
+template <typename T>
+class SnapshotArray {
+public:
+    SnapshotArray() = default;
+    SnapshotArray(const T* items, size_t count) : items(items), count(count) {}
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    const T* data() const { return items; }
+    const T& operator[](size_t i) const { return items[i]; }
+    const T* begin() const { return items; }
+    const T* end() const { return items + count; }
+
+private:
+    const T* items = nullptr;
+    size_t count = 0;
+};
+
+class SnapshotImage;
+
+const uint32_t EMPTY_TERM_SLOT = 0xFFFFFFFFu;  // 字典散列表的空槽
+
+// 概念库快照
+// 全部数据在一块快照映像中（见SnapshotFile.hpp）：在内存中构建，或从导出的快照文件映射；
+// 构建后只读，可被多个线程同时用于匹配；概念库变化时整体重建
+// 概念按列存放：概念的特征只以特征ID的形式保存，文本在字典中，按特征顺序为"值ID[, 键值对ID]"，
+// 有键的特征值ID之后紧跟其键值对ID
+struct ConceptSnapshot {
+    uint64_t version = 0;                      // 快照版本号，每次构建或加载递增
+    shared_ptr<const SnapshotImage> image;     // 持有以下各列指向的数据
+    SnapshotArray<uint64_t> concept_ids;       // 概念位置 → 概念ID（按ID升序）
+    SnapshotArray<uint64_t> signatures;        // 概念位置 → 值签名
+    SnapshotArray<uint32_t> feature_offsets;   // 概念位置 → 在feature_ids中的起始下标（长度为概念数+1）
+    SnapshotArray<uint32_t> feature_ids;       // 各概念的值ID和键值对ID，按位置连续存放
+    SnapshotArray<PostingList> posting_lists;  // 特征ID → 倒排列表
+    SnapshotArray<uint32_t> term_offsets;      // 特征ID → 文本在term_bytes中的起始偏移（长度为特征数+1）
+    SnapshotArray<char> term_bytes;            // 特征文本：值，或"key:value"（键中没有冒号，第一个冒号分隔键和值）
+    SnapshotArray<uint32_t> term_slots;        // 字典散列表：开放寻址、线性探测，槽中为特征ID，负载不超过一半
+    uint32_t feature_id_count = 0;             // 已编号的特征数
+    FrequencyStats frequency;                  // 特征频率统计
+
+    size_t conceptCount() const { return concept_ids.size(); }
+    obx_id conceptId(uint32_t position) const { return concept_ids[position]; }
+
+    // 特征ID的文本
+    string_view term(uint32_t id) const {
+        return string_view(term_bytes.data() + term_offsets[id], term_offsets[id + 1] - term_offsets[id]);
+    }
+
+    // 查找某个值的倒排列表，不存在时返回nullptr
+    const PostingList* findValueList(string_view value) const;
+
+    // 查找某个键值对的倒排列表，不存在时返回nullptr（不拼接字符串）
+    const PostingList* findKeyValueList(string_view key, string_view value) const;
+
+    // 倒排列表的位置总数和压缩后占用的字节数（统计用）
+    void postingStatistics(size_t& position_count, size_t& memory_bytes) const;
+
+    // 概念的特征ID列表
+    const uint32_t* featureIds(uint32_t position) const { return feature_ids.data() + feature_offsets[position]; }
+    size_t featureIdCount(uint32_t position) const { return feature_offsets[position + 1] - feature_offsets[position]; }
+
+    // 概念签名与查询签名不相交时，该位置的概念不可能匹配
+    bool mayMatch(uint32_t position, uint64_t query_signature) const {
+        return (signatures[position] & query_signature) != 0;
+    }
+
+    // 按特征顺序访问概念的值：visitor(string_view value)返回false时停止，返回是否访问完全部值
+    template <typename Visitor>
+    bool forEachConceptValue(uint32_t position, Visitor&& visitor) const {
+        const uint32_t* ids = featureIds(position);
+        for (size_t i = 0, n = featureIdCount(position); i < n; i++) {
+            if (!posting_lists[ids[i]].key_value && !visitor(term(ids[i]))) return false;
+        }
+        return true;
+    }
+
+    // 按特征顺序访问概念有键的特征：visitor(string_view key, string_view value)返回false时停止
+    template <typename Visitor>
+    bool forEachConceptKeyValue(uint32_t position, Visitor&& visitor) const {
+        const uint32_t* ids = featureIds(position);
+        for (size_t i = 0, n = featureIdCount(position); i < n; i++) {
+            if (!posting_lists[ids[i]].key_value) continue;
+            string_view key_value = term(ids[i]);
+            size_t colon = key_value.find(':');
+            if (!visitor(key_value.substr(0, colon), key_value.substr(colon + 1))) return false;
+        }
+        return true;
+    }
+
+    // 概念的值个数
+    size_t conceptValueCount(uint32_t position) const;
+
+    // 还原完整的概念对象（复制字符串，用于对外返回概念）
+    Concept conceptAt(uint32_t position) const;
+};
+
+// 值签名：64位Bloom过滤器，概念的每个值和每个"key:value"各置一位
+// 查询先求出可能匹配的值/键值对的签名，与概念签名按位与为0的概念不可能匹配，不必逐个比较特征
+// 不会漏判，只会误判为可能匹配（之后仍做完整匹配）
+// 签名位和字典散列表的槽位由同一个特征散列得到
+inline uint64_t signatureFnv(string_view text, uint64_t hash) {
+    for (char c : text) {
+        hash ^= (unsigned char)c;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+inline uint64_t valueTermHash(string_view value) {
+    return signatureFnv(value, 14695981039346656037ULL);
+}
+
+// 相当于"key:value"的散列（不拼接字符串）；起始值与值不同，避免同名的值和键值对总落在同一位
+inline uint64_t keyValueTermHash(string_view key, string_view value) {
+    return signatureFnv(value, signatureFnv(":", signatureFnv(key, 0x84222325CBF29CE4ULL)));
+}
+
+// 散列值混合：最高6位作为签名位号，低位作为字典槽号
+inline uint64_t termHashMix(uint64_t hash) {
+    hash ^= hash >> 29;
+    hash *= 0xBF58476D1CE4E5B9ULL;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+inline uint64_t signatureBit(uint64_t hash) {
+    return 1ULL << (termHashMix(hash) >> 58);
+}
+
+inline uint64_t valueSignatureBit(string_view value) {
+    return signatureBit(valueTermHash(value));
+}
+
+inline uint64_t keyValueSignatureBit(string_view key, string_view value) {
+    return signatureBit(keyValueTermHash(key, value));
+}
+
+// 一个概念的值签名
+uint64_t computeConceptSignature(const Concept& concept);
+
+// 快照构建器：按ID升序逐个加入概念（即概念流的顺序），finish()生成内存中的映像并建立快照
+// 只保留快照本身的各列，不需要先把整个库读成概念对象；每个构建器只能finish()一次
+class ConceptSnapshotBuilder {
+public:
+    void add(const Concept& concept);
+    shared_ptr<const ConceptSnapshot> finish();
+
+private:
+    void addTerm(uint32_t kind, const string& text, uint32_t position);
+
+    vector<uint64_t> concept_ids, signatures;
+    vector<uint32_t> feature_offsets, feature_ids;
+    vector<uint32_t> term_offsets = vector<uint32_t>(1, 0);
+    vector<char> term_bytes;
+    vector<uint32_t> term_kinds;
+    vector<vector<uint32_t>> raw_positions;       // 特征ID → 未压缩的倒排位置
+    unordered_map<string, uint32_t> term_ids[2];  // 值、"key:value" → 特征ID
+    string key_value_text;                        // 拼接"key:value"的缓冲区
+};
+
+// 由一组概念构建快照（概念会按ID排序），映像在内存中
+shared_ptr<const ConceptSnapshot> buildConceptSnapshot(vector<unique_ptr<Concept>> concepts);
+
+// 在已检查过文件头的映像上建立快照：各列直接指向映像，不复制数据
+shared_ptr<const ConceptSnapshot> attachConceptSnapshot(shared_ptr<const SnapshotImage> image);
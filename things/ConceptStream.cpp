@@ -0,0 +1,54 @@
+#include "ConceptStream.hpp"
+#include "QueryTrace.hpp"
+
+using namespace std;
+
+ConceptStream::ConceptStream(obx::Store& store, size_t batch_size)
+    : transaction(store, obx::TxMode::READ),
+      cursor(obx_cursor(transaction.cPtr(), Concept::_OBX_MetaInfo::entityId())),
+      buffer(max<size_t>(batch_size, 1)) {
+    obx::internal::checkPtrOrThrow(cursor, "无法打开概念游标");
+}
+
+ConceptStream::~ConceptStream() {
+    if (cursor) obx_cursor_close(cursor);
+}
+
+ConceptStream::ConceptStream(ConceptStream&& source) noexcept
+    : transaction(move(source.transaction)),
+      cursor(source.cursor),
+      buffer(move(source.buffer)),
+      batch_count(source.batch_count),
+      read_count(source.read_count),
+      started(source.started),
+      exhausted(source.exhausted) {
+    source.cursor = nullptr;
+    source.batch_count = 0;
+    source.exhausted = true;
+}
+
+bool ConceptStream::nextBatch() {
+    batch_count = 0;
+    if (exhausted) return false;
+
+    ScopedStageTimer load_timer(TRACE_STAGE_LOAD_CONCEPTS);
+    const void* data;
+    size_t size;
+    while (batch_count < buffer.size()) {
+        obx_err err = started ? obx_cursor_next(cursor, &data, &size) : obx_cursor_first(cursor, &data, &size);
+        started = true;
+        if (err == OBX_NOT_FOUND) {
+            exhausted = true;
+            break;
+        }
+        obx::internal::checkErrOrThrow(err);
+
+        // fromFlatBuffer向特征向量追加，先清空（保留容量）
+        Concept& concept = buffer[batch_count++];
+        concept.feature_keys.clear();
+        concept.feature_values.clear();
+        Concept::_OBX_MetaInfo::fromFlatBuffer(data, size, concept);
+    }
+    read_count += batch_count;
+    return batch_count > 0;
+}
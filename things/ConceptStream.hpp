@@ -0,0 +1,85 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <iterator>
+#include "objectbox.hpp"
+#include "concepts.obx.hpp"
+
+using namespace std;
+
+// 概念流：在一个读事务中按ID升序分批读出数据库中的概念，每批反序列化到复用的缓冲区
+// 同一时刻只有一批概念在内存中，占用与概念库大小无关（getAll()要把整个库一次性读成对象）
+// 读事务在流销毁时关闭，期间看到的是打开时的数据库版本；同一线程上可以嵌套多个流（读事务可以嵌套），
+// 但流打开期间本线程不能写数据库
+//
+// 用法：for (const Concept& concept : stream) {...}，或者循环调用nextBatch()逐批处理
+class ConceptStream {
+public:
+    static const size_t DEFAULT_BATCH_SIZE = 256;
+
+    explicit ConceptStream(obx::Store& store, size_t batch_size = DEFAULT_BATCH_SIZE);
+    ~ConceptStream();
+    ConceptStream(ConceptStream&& source) noexcept;
+    ConceptStream(const ConceptStream&) = delete;
+    ConceptStream& operator=(const ConceptStream&) = delete;
+
+    // 读出下一批（最多batch_size个），没有更多概念时返回false
+    bool nextBatch();
+
+    // 当前批次的概念，下一次nextBatch()之后失效
+    const Concept* batchBegin() const { return buffer.data(); }
+    const Concept* batchEnd() const { return buffer.data() + batch_count; }
+    size_t batchCount() const { return batch_count; }
+
+    // 已读出的概念数
+    uint64_t conceptsRead() const { return read_count; }
+
+    // 单遍输入迭代器，递增时按需读取下一批；同一个流只能遍历一次
+    class iterator {
+    public:
+        typedef input_iterator_tag iterator_category;
+        typedef Concept value_type;
+        typedef ptrdiff_t difference_type;
+        typedef const Concept* pointer;
+        typedef const Concept& reference;
+
+        iterator() = default;
+        explicit iterator(ConceptStream* owner) : stream(owner) { advance(); }
+
+        reference operator*() const { return stream->buffer[index]; }
+        pointer operator->() const { return &stream->buffer[index]; }
+        iterator& operator++() {
+            index++;
+            advance();
+            return *this;
+        }
+        bool operator==(const iterator& other) const { return stream == other.stream && index == other.index; }
+        bool operator!=(const iterator& other) const { return !(*this == other); }
+
+    private:
+        // 当前批次用完时读下一批，流读完后变为end()
+        void advance() {
+            if (stream && index >= stream->batch_count) {
+                index = 0;
+                if (!stream->nextBatch()) stream = nullptr;
+            }
+        }
+
+        ConceptStream* stream = nullptr;
+        size_t index = 0;
+    };
+
+    iterator begin() { return iterator(this); }
+    iterator end() { return iterator(); }
+
+private:
+    obx::Transaction transaction;
+    OBX_cursor* cursor;
+    vector<Concept> buffer;        // 批次缓冲区，各概念的特征向量在批次之间复用
+    size_t batch_count = 0;
+    uint64_t read_count = 0;
+    bool started = false;          // 是否已定位到第一个概念
+    bool exhausted = false;
+};
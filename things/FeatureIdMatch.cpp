@@ -0,0 +1,160 @@
+#include "FeatureIdMatch.hpp"
+#include <atomic>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define FEATURE_ID_MATCH_X86 1
+#endif
+
+using namespace std;
+
+typedef uint32_t (*IdMatchFunction)(const uint32_t* query_ids, int query_count, const uint32_t* concept_ids, size_t concept_count);
+
+// 逐个比较（任何平台可用，也是其他实现的参照）
+static uint32_t matchIdsScalar(const uint32_t* query_ids, int query_count, const uint32_t* concept_ids, size_t concept_count) {
+    uint32_t result = 0;
+    for (size_t c = 0; c < concept_count; c++) {
+        for (int q = 0; q < query_count; q++) {
+            if (query_ids[q] == concept_ids[c]) {
+                result |= 1u << q;
+            }
+        }
+    }
+    return result;
+}
+
+#ifdef FEATURE_ID_MATCH_X86
+
+// AVX2：概念ID每8个一块；不足一块的尾部用掩码加载，掩掉的通道不参与比较
+__attribute__((target("avx2")))
+static uint32_t matchIdsAvx2(const uint32_t* query_ids, int query_count, const uint32_t* concept_ids, size_t concept_count) {
+    size_t full = concept_count / 8 * 8;
+    __m256i tail_lanes = _mm256_cmpgt_epi32(_mm256_set1_epi32((int)(concept_count - full)),
+                                            _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+    __m256i tail = _mm256_maskload_epi32((const int*)(concept_ids + full), tail_lanes);
+
+    uint32_t result = 0;
+    for (int q = 0; q < query_count; q++) {
+        __m256i needle = _mm256_set1_epi32((int)query_ids[q]);
+        __m256i hits = _mm256_and_si256(_mm256_cmpeq_epi32(needle, tail), tail_lanes);
+        for (size_t c = 0; c < full; c += 8) {
+            __m256i block = _mm256_loadu_si256((const __m256i*)(concept_ids + c));
+            hits = _mm256_or_si256(hits, _mm256_cmpeq_epi32(needle, block));
+        }
+        if (!_mm256_testz_si256(hits, hits)) {
+            result |= 1u << q;
+        }
+    }
+    return result;
+}
+
+// AVX-512：概念ID每16个一块，比较结果直接是掩码寄存器
+__attribute__((target("avx512f")))
+static uint32_t matchIdsAvx512(const uint32_t* query_ids, int query_count, const uint32_t* concept_ids, size_t concept_count) {
+    size_t full = concept_count / 16 * 16;
+    __mmask16 tail_lanes = (__mmask16)((1u << (concept_count - full)) - 1);
+    __m512i tail = _mm512_maskz_loadu_epi32(tail_lanes, concept_ids + full);
+
+    uint32_t result = 0;
+    for (int q = 0; q < query_count; q++) {
+        __m512i needle = _mm512_set1_epi32((int)query_ids[q]);
+        __mmask16 hits = _mm512_mask_cmpeq_epi32_mask(tail_lanes, needle, tail);
+        for (size_t c = 0; c < full; c += 16) {
+            hits |= _mm512_cmpeq_epi32_mask(needle, _mm512_loadu_si512(concept_ids + c));
+        }
+        if (hits) {
+            result |= 1u << q;
+        }
+    }
+    return result;
+}
+
+#endif
+
+static IdMatchFunction kernelFunction(IdMatchKernel kernel) {
+#ifdef FEATURE_ID_MATCH_X86
+    if (kernel == ID_KERNEL_AVX512) return matchIdsAvx512;
+    if (kernel == ID_KERNEL_AVX2) return matchIdsAvx2;
+#endif
+    return matchIdsScalar;
+}
+
+static uint32_t matchIdsFirstCall(const uint32_t* query_ids, int query_count, const uint32_t* concept_ids, size_t concept_count);
+
+// 当前内核：首次调用经过matchIdsFirstCall完成选择，之后直接调用选中的实现
+static atomic<IdMatchFunction> g_kernel_function(matchIdsFirstCall);
+static atomic<int> g_kernel(-1);
+
+bool idMatchKernelSupported(IdMatchKernel kernel) {
+    switch (kernel) {
+        case ID_KERNEL_SCALAR: return true;
+#ifdef FEATURE_ID_MATCH_X86
+        case ID_KERNEL_AVX2:   return __builtin_cpu_supports("avx2");
+        case ID_KERNEL_AVX512: return __builtin_cpu_supports("avx512f");
+#endif
+        default:               return false;
+    }
+}
+
+const char* idMatchKernelName(IdMatchKernel kernel) {
+    switch (kernel) {
+        case ID_KERNEL_SCALAR: return "scalar";
+        case ID_KERNEL_AVX2:   return "avx2";
+        case ID_KERNEL_AVX512: return "avx512";
+        default:               return "unknown";
+    }
+}
+
+bool selectIdMatchKernel(IdMatchKernel kernel) {
+    if (!idMatchKernelSupported(kernel)) return false;
+    g_kernel_function.store(kernelFunction(kernel), memory_order_relaxed);
+    g_kernel.store(kernel, memory_order_relaxed);
+    return true;
+}
+
+IdMatchKernel activeIdMatchKernel() {
+    int kernel = g_kernel.load(memory_order_relaxed);
+    if (kernel >= 0) return (IdMatchKernel)kernel;
+
+    // 环境变量指定的内核优先，否则选CPU支持的最快实现
+    const char* simd_env = getenv("APPROACHER_SIMD");
+    if (simd_env) {
+        for (int k = 0; k < ID_KERNEL_COUNT; k++) {
+            if (strcmp(simd_env, idMatchKernelName((IdMatchKernel)k)) == 0 && selectIdMatchKernel((IdMatchKernel)k)) {
+                return (IdMatchKernel)k;
+            }
+        }
+    }
+    for (int k = ID_KERNEL_COUNT - 1; k >= 0; k--) {
+        if (selectIdMatchKernel((IdMatchKernel)k)) {
+            return (IdMatchKernel)k;
+        }
+    }
+    return ID_KERNEL_SCALAR;
+}
+
+static uint32_t matchIdsFirstCall(const uint32_t* query_ids, int query_count, const uint32_t* concept_ids, size_t concept_count) {
+    activeIdMatchKernel();
+    return g_kernel_function.load(memory_order_relaxed)(query_ids, query_count, concept_ids, concept_count);
+}
+
+uint32_t matchFeatureIds(const uint32_t* query_ids, int query_count, const uint32_t* concept_ids, size_t concept_count) {
+    return g_kernel_function.load(memory_order_relaxed)(query_ids, query_count, concept_ids, concept_count);
+}
+
+int matchFeatureIdMask(const uint32_t* query_ids, size_t query_count, const uint32_t* concept_ids, size_t concept_count, uint64_t* mask) {
+    fill(mask, mask + (query_count + 63) / 64, 0);
+    IdMatchFunction kernel = g_kernel_function.load(memory_order_relaxed);
+    int match_count = 0;
+    for (size_t begin = 0; begin < query_count; begin += ID_MATCH_BLOCK) {
+        int block_count = (int)min<size_t>(ID_MATCH_BLOCK, query_count - begin);
+        uint64_t bits = kernel(query_ids + begin, block_count, concept_ids, concept_count);
+        // 16个一块，64位字内的偏移是16的倍数，块不会跨字
+        mask[begin / 64] |= bits << (begin % 64);
+        match_count += __builtin_popcountll(bits);
+    }
+    return match_count;
+}
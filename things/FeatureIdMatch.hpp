@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+using namespace std;
+
+// 特征ID匹配内核：快照把每个概念的值和键值对编号为uint32特征ID（ConceptSnapshot::feature_ids），
+// 精确匹配的第一步就变成"查询的这些ID中哪些出现在概念的ID列表里"
+// 内核把每个查询ID广播到向量寄存器，与概念ID按块比较；运行时按CPU选择AVX-512/AVX2实现，
+// 其他CPU或平台使用逐个比较的实现，各实现结果完全相同
+
+const int ID_MATCH_BLOCK = 16;               // 内核一次处理的查询ID上限
+const uint32_t NO_FEATURE_ID = 0xFFFFFFFFu;  // 字典中不存在的查询特征，不会与任何概念ID相等
+
+enum IdMatchKernel {
+    ID_KERNEL_SCALAR = 0,
+    ID_KERNEL_AVX2,
+    ID_KERNEL_AVX512,
+    ID_KERNEL_COUNT
+};
+
+// 一组查询ID（最多ID_MATCH_BLOCK个）的匹配：返回位图，第i位表示query_ids[i]出现在concept_ids中
+uint32_t matchFeatureIds(const uint32_t* query_ids, int query_count, const uint32_t* concept_ids, size_t concept_count);
+
+// 任意数量的查询ID：按块调用内核，结果写入mask（(query_count+63)/64个字，先清零），返回匹配的查询ID数
+int matchFeatureIdMask(const uint32_t* query_ids, size_t query_count, const uint32_t* concept_ids, size_t concept_count, uint64_t* mask);
+
+// 当前使用的内核：首次使用时选择CPU支持的最快实现，
+// 可用环境变量 APPROACHER_SIMD=scalar|avx2|avx512 指定（CPU不支持时忽略）
+IdMatchKernel activeIdMatchKernel();
+
+// 切换内核（基准测试和差分测试用），CPU不支持时返回false且不切换
+bool selectIdMatchKernel(IdMatchKernel kernel);
+
+// CPU是否支持该内核
+bool idMatchKernelSupported(IdMatchKernel kernel);
+
+const char* idMatchKernelName(IdMatchKernel kernel);
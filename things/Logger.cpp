@@ -0,0 +1,250 @@
+#include "Logger.hpp"
+#include "SimpleJson.hpp"
+#include <cstdlib>
+#include <ctime>
+
+using namespace std;
+
+Logger::Logger()
+    : runtime_level(LOG_LEVEL_INFO), json_format(false), async_enabled(false), stderr_only(false), dropped_count(0) {
+    // 从环境变量读取初始配置
+    const char* level_env = getenv("APPROACHER_LOG_LEVEL");
+    LogLevel level;
+    if (level_env && parseLevel(level_env, level)) {
+        runtime_level = level;
+    }
+
+    const char* format_env = getenv("APPROACHER_LOG_FORMAT");
+    if (format_env && string(format_env) == "json") {
+        json_format = true;
+    }
+
+    const char* file_env = getenv("APPROACHER_LOG_FILE");
+    if (file_env && *file_env) {
+        setOutputFile(file_env);
+    }
+
+    const char* async_env = getenv("APPROACHER_LOG_ASYNC");
+    if (async_env && string(async_env) == "1") {
+        enableAsync();
+    }
+}
+
+Logger::~Logger() {
+    disableAsync();
+    lock_guard<mutex> lock(write_mutex);
+    if (output_file) {
+        fclose(output_file);
+        output_file = nullptr;
+    }
+}
+
+Logger& Logger::instance() {
+    static Logger logger;
+    return logger;
+}
+
+void Logger::setLevel(LogLevel level) {
+    runtime_level = level;
+}
+
+LogLevel Logger::getLevel() const {
+    return (LogLevel)runtime_level.load();
+}
+
+void Logger::setJsonFormat(bool enabled) {
+    json_format = enabled;
+}
+
+bool Logger::setOutputFile(const string& path) {
+    FILE* file = nullptr;
+    if (!path.empty()) {
+        file = fopen(path.c_str(), "a");
+        if (!file) {
+            return false;
+        }
+    }
+
+    lock_guard<mutex> lock(write_mutex);
+    if (output_file) {
+        fclose(output_file);
+    }
+    output_file = file;
+    return true;
+}
+
+void Logger::setStderrOnly(bool enabled) {
+    stderr_only = enabled;
+}
+
+void Logger::enableAsync(size_t capacity) {
+    lock_guard<mutex> lock(ring_mutex);
+    if (async_enabled) {
+        return;
+    }
+    ring.assign(max<size_t>(capacity, 16), LogRecord());
+    ring_head = 0;
+    ring_count = 0;
+    stopping = false;
+    writer_thread = thread(&Logger::writerLoop, this);
+    async_enabled = true;
+}
+
+void Logger::disableAsync() {
+    {
+        lock_guard<mutex> lock(ring_mutex);
+        if (!async_enabled) {
+            return;
+        }
+        stopping = true;
+    }
+    ring_cv.notify_all();
+    writer_thread.join();
+
+    lock_guard<mutex> lock(ring_mutex);
+    async_enabled = false;
+    ring.clear();
+}
+
+void Logger::log(LogLevel level, const string& message, initializer_list<LogField> fields) {
+    LogRecord record;
+    record.level = level;
+    record.time = chrono::system_clock::now();
+    record.message = message;
+    record.fields.assign(fields.begin(), fields.end());
+
+    if (async_enabled.load(memory_order_acquire)) {
+        {
+            lock_guard<mutex> lock(ring_mutex);
+            if (async_enabled && !stopping) {
+                // 缓冲区满时丢弃新记录，调用方永不阻塞在I/O上
+                if (ring_count == ring.size()) {
+                    dropped_count++;
+                    return;
+                }
+                ring[(ring_head + ring_count) % ring.size()] = move(record);
+                ring_count++;
+                ring_cv.notify_one();
+                return;
+            }
+        }
+    }
+
+    writeRecord(record);
+}
+
+void Logger::flush() {
+    if (async_enabled) {
+        unique_lock<mutex> lock(ring_mutex);
+        drained_cv.wait(lock, [this]() { return (ring_count == 0 && !writer_busy) || !async_enabled; });
+    }
+
+    lock_guard<mutex> lock(write_mutex);
+    if (output_file) {
+        fflush(output_file);
+    } else {
+        fflush(stdout);
+        fflush(stderr);
+    }
+}
+
+uint64_t Logger::getDroppedCount() const {
+    return dropped_count.load();
+}
+
+bool Logger::parseLevel(const string& name, LogLevel& level) {
+    if (name == "trace") level = LOG_LEVEL_TRACE;
+    else if (name == "debug") level = LOG_LEVEL_DEBUG;
+    else if (name == "info") level = LOG_LEVEL_INFO;
+    else if (name == "warn") level = LOG_LEVEL_WARN;
+    else if (name == "error") level = LOG_LEVEL_ERROR;
+    else if (name == "off") level = LOG_LEVEL_OFF;
+    else return false;
+    return true;
+}
+
+const char* Logger::levelName(LogLevel level) {
+    switch (level) {
+        case LOG_LEVEL_TRACE: return "trace";
+        case LOG_LEVEL_DEBUG: return "debug";
+        case LOG_LEVEL_INFO: return "info";
+        case LOG_LEVEL_WARN: return "warn";
+        case LOG_LEVEL_ERROR: return "error";
+        default: return "off";
+    }
+}
+
+string Logger::formatRecord(const LogRecord& record) const {
+    string line;
+
+    if (json_format) {
+        // 每行一个JSON对象，字段与ts/level/msg平级
+        long long millis = chrono::duration_cast<chrono::milliseconds>(record.time.time_since_epoch()).count();
+        line = "{\"ts\":" + to_string(millis) + ",\"level\":\"" + levelName(record.level) + "\",\"msg\":" + jsonEscape(record.message);
+        for (const LogField& field : record.fields) {
+            line += "," + jsonEscape(field.key) + ":" + jsonEscape(field.value);
+        }
+        line += "}\n";
+        return line;
+    }
+
+    // 文本格式：警告和错误加前缀，字段以key=value附在消息后
+    if (record.level == LOG_LEVEL_WARN) {
+        line = "警告：";
+    } else if (record.level == LOG_LEVEL_ERROR) {
+        line = "错误：";
+    }
+    line += record.message;
+    for (size_t i = 0; i < record.fields.size(); i++) {
+        line += i == 0 ? " | " : " ";
+        line += record.fields[i].key + "=" + record.fields[i].value;
+    }
+    line += "\n";
+    return line;
+}
+
+void Logger::writeRecord(const LogRecord& record) {
+    string line = formatRecord(record);
+
+    lock_guard<mutex> lock(write_mutex);
+    FILE* target = output_file ? output_file : (record.level >= LOG_LEVEL_WARN || stderr_only ? stderr : stdout);
+    fwrite(line.data(), 1, line.size(), target);
+}
+
+void Logger::writerLoop() {
+    vector<LogRecord> batch;
+    while (true) {
+        {
+            unique_lock<mutex> lock(ring_mutex);
+            writer_busy = false;
+            drained_cv.notify_all();
+            ring_cv.wait(lock, [this]() { return ring_count > 0 || stopping; });
+            if (ring_count == 0 && stopping) {
+                break;
+            }
+
+            // 一次取出缓冲区中的全部记录，在锁外写出
+            batch.clear();
+            while (ring_count > 0) {
+                batch.push_back(move(ring[ring_head]));
+                ring_head = (ring_head + 1) % ring.size();
+                ring_count--;
+            }
+            writer_busy = true;
+        }
+
+        for (const LogRecord& record : batch) {
+            writeRecord(record);
+        }
+
+        lock_guard<mutex> lock(write_mutex);
+        if (output_file) {
+            fflush(output_file);
+        } else {
+            fflush(stdout);
+            fflush(stderr);
+        }
+    }
+
+    drained_cv.notify_all();
+}
@@ -0,0 +1,175 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <sstream>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <initializer_list>
+#include <chrono>
+#include <cstdio>
+#include <cstdint>
+
+using namespace std;
+
+// 日志级别（数值用于编译期比较）
+enum LogLevel {
+    LOG_LEVEL_TRACE = 0,  // 热路径逐条跟踪（如逐词词性查询）
+    LOG_LEVEL_DEBUG = 1,  // 调试细节（如名词段解析结果）
+    LOG_LEVEL_INFO  = 2,  // 常规运行信息
+    LOG_LEVEL_WARN  = 3,  // 可恢复的问题（如数据行格式错误）
+    LOG_LEVEL_ERROR = 4,  // 操作失败
+    LOG_LEVEL_OFF   = 5
+};
+
+// 编译期最低日志级别：低于该级别的日志宏展开为空语句，参数不会被求值
+// 例如 -DAPPROACHER_LOG_MIN_LEVEL=0 打开TRACE，=2 去掉TRACE和DEBUG
+#ifndef APPROACHER_LOG_MIN_LEVEL
+#define APPROACHER_LOG_MIN_LEVEL 1
+#endif
+
+// 结构化键值字段
+struct LogField {
+    string key;
+    string value;
+
+    LogField(const string& k, const string& v) : key(k), value(v) {}
+    LogField(const string& k, const char* v) : key(k), value(v) {}
+
+    template <typename T>
+    LogField(const string& k, const T& v) : key(k) {
+        ostringstream ss;
+        ss << v;
+        value = ss.str();
+    }
+};
+
+// 一条日志记录
+struct LogRecord {
+    LogLevel level = LOG_LEVEL_INFO;
+    chrono::system_clock::time_point time;
+    string message;
+    vector<LogField> fields;
+};
+
+// 日志器（进程内单例）
+// 同步模式直接写出；异步模式写入有界环形缓冲区，由后台线程写出，缓冲区满时丢弃并计数
+// 环境变量: APPROACHER_LOG_LEVEL=trace|debug|info|warn|error|off
+//          APPROACHER_LOG_FORMAT=text|json
+//          APPROACHER_LOG_FILE=<路径>（默认INFO及以下写stdout，WARN及以上写stderr）
+//          APPROACHER_LOG_ASYNC=1
+class Logger {
+private:
+    atomic<int> runtime_level;
+    atomic<bool> json_format;
+    atomic<bool> async_enabled;
+    atomic<bool> stderr_only;
+    atomic<uint64_t> dropped_count;
+
+    mutex write_mutex;           // 串行化实际写出
+    FILE* output_file = nullptr; // 为空时写stdout/stderr
+
+    // 异步环形缓冲区
+    mutex ring_mutex;
+    condition_variable ring_cv;
+    condition_variable drained_cv;
+    vector<LogRecord> ring;
+    size_t ring_head = 0;        // 最早一条记录的位置
+    size_t ring_count = 0;       // 缓冲区中的记录数
+    bool writer_busy = false;    // 后台线程正在写出已取出的记录
+    bool stopping = false;
+    thread writer_thread;
+
+    Logger();
+    ~Logger();
+
+    string formatRecord(const LogRecord& record) const;
+    void writeRecord(const LogRecord& record);
+    void writerLoop();
+
+public:
+    Logger(const Logger&) = delete;
+    Logger& operator=(const Logger&) = delete;
+
+    static Logger& instance();
+
+    // 运行期级别判断（编译期级别之上的第二道过滤）
+    bool isEnabled(LogLevel level) const {
+        return level >= runtime_level.load(memory_order_relaxed);
+    }
+
+    void setLevel(LogLevel level);
+    LogLevel getLevel() const;
+
+    // 输出格式：文本（默认）或每行一个JSON对象
+    void setJsonFormat(bool enabled);
+
+    // 输出到文件（追加），路径为空则恢复stdout/stderr
+    bool setOutputFile(const string& path);
+
+    // 所有级别都写stderr（标准输出用于数据输出时使用）
+    void setStderrOnly(bool enabled);
+
+    // 开启异步写出，capacity为环形缓冲区容量（条）
+    void enableAsync(size_t capacity = 8192);
+
+    // 关闭异步写出（先写完缓冲区中的记录）
+    void disableAsync();
+
+    // 记录一条日志
+    void log(LogLevel level, const string& message, initializer_list<LogField> fields = {});
+
+    // 等待异步缓冲区写完并刷新输出
+    void flush();
+
+    // 异步缓冲区满时丢弃的记录数
+    uint64_t getDroppedCount() const;
+
+    // 解析级别名称（trace/debug/info/warn/error/off）
+    static bool parseLevel(const string& name, LogLevel& level);
+    static const char* levelName(LogLevel level);
+};
+
+// 日志宏：message支持流式拼接，后面可跟若干LogField
+#define APPROACHER_LOG(level, message, ...)                                    \
+    do {                                                                       \
+        if (Logger::instance().isEnabled(level)) {                             \
+            ostringstream approacher_log_stream_;                              \
+            approacher_log_stream_ << message;                                 \
+            Logger::instance().log(level, approacher_log_stream_.str(), {__VA_ARGS__}); \
+        }                                                                      \
+    } while (0)
+
+#define APPROACHER_LOG_DISABLED do { } while (0)
+
+#if APPROACHER_LOG_MIN_LEVEL <= 0
+#define LOG_TRACE(message, ...) APPROACHER_LOG(LOG_LEVEL_TRACE, message, ##__VA_ARGS__)
+#else
+#define LOG_TRACE(message, ...) APPROACHER_LOG_DISABLED
+#endif
+
+#if APPROACHER_LOG_MIN_LEVEL <= 1
+#define LOG_DEBUG(message, ...) APPROACHER_LOG(LOG_LEVEL_DEBUG, message, ##__VA_ARGS__)
+#else
+#define LOG_DEBUG(message, ...) APPROACHER_LOG_DISABLED
+#endif
+
+#if APPROACHER_LOG_MIN_LEVEL <= 2
+#define LOG_INFO(message, ...) APPROACHER_LOG(LOG_LEVEL_INFO, message, ##__VA_ARGS__)
+#else
+#define LOG_INFO(message, ...) APPROACHER_LOG_DISABLED
+#endif
+
+#if APPROACHER_LOG_MIN_LEVEL <= 3
+#define LOG_WARN(message, ...) APPROACHER_LOG(LOG_LEVEL_WARN, message, ##__VA_ARGS__)
+#else
+#define LOG_WARN(message, ...) APPROACHER_LOG_DISABLED
+#endif
+
+#if APPROACHER_LOG_MIN_LEVEL <= 4
+#define LOG_ERROR(message, ...) APPROACHER_LOG(LOG_LEVEL_ERROR, message, ##__VA_ARGS__)
+#else
+#define LOG_ERROR(message, ...) APPROACHER_LOG_DISABLED
+#endif
@@ -0,0 +1,132 @@
+#include "MatchCache.hpp"
+#include <cstdlib>
+#include <string>
+
+using namespace std;
+
+MatchCache::MatchCache(size_t capacity_bytes)
+    : capacity(capacity_bytes), shard_capacity(capacity_bytes / SHARD_COUNT) {}
+
+shared_ptr<const MatchSet> MatchCache::find(const MatchCacheKey& key) {
+    if (!enabled()) return nullptr;
+    Shard& shard = shardFor(key);
+    lock_guard<mutex> guard(shard.lock);
+    auto it = shard.index.find(key);
+    if (it == shard.index.end()) return nullptr;
+    shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+    return it->second->second;
+}
+
+void MatchCache::insert(const MatchCacheKey& key, shared_ptr<const MatchSet> value) {
+    size_t value_bytes = value->memoryBytes();
+    size_t limit = shard_capacity.load(memory_order_relaxed);
+    if (value_bytes > limit) return;
+
+    // 被淘汰的集合在锁外释放
+    vector<shared_ptr<const MatchSet>> evicted;
+    Shard& shard = shardFor(key);
+    {
+        lock_guard<mutex> guard(shard.lock);
+        auto it = shard.index.find(key);
+        if (it != shard.index.end()) {
+            shard.bytes -= it->second->second->memoryBytes();
+            evicted.push_back(move(it->second->second));
+            shard.lru.erase(it->second);
+            shard.index.erase(it);
+        }
+        shard.lru.emplace_front(key, move(value));
+        shard.index.emplace(key, shard.lru.begin());
+        shard.bytes += value_bytes;
+        while (shard.bytes > limit) {
+            auto& oldest = shard.lru.back();
+            shard.bytes -= oldest.second->memoryBytes();
+            evicted.push_back(move(oldest.second));
+            shard.index.erase(oldest.first);
+            shard.lru.pop_back();
+            evictions.fetch_add(1, memory_order_relaxed);
+        }
+    }
+    inserts.fetch_add(1, memory_order_relaxed);
+}
+
+void MatchCache::setCapacity(size_t capacity_bytes) {
+    capacity = capacity_bytes;
+    shard_capacity = capacity_bytes / SHARD_COUNT;
+    clear();
+}
+
+void MatchCache::clear() {
+    for (Shard& shard : shards) {
+        LruList released;
+        {
+            lock_guard<mutex> guard(shard.lock);
+            released.swap(shard.lru);
+            shard.index.clear();
+            shard.bytes = 0;
+        }
+    }
+    invalidations.fetch_add(1, memory_order_relaxed);
+}
+
+MatchCacheStats MatchCache::stats() const {
+    MatchCacheStats result;
+    result.hits = hits.load(memory_order_relaxed);
+    result.misses = misses.load(memory_order_relaxed);
+    result.inserts = inserts.load(memory_order_relaxed);
+    result.evictions = evictions.load(memory_order_relaxed);
+    result.invalidations = invalidations.load(memory_order_relaxed);
+    result.capacity_bytes = capacity.load(memory_order_relaxed);
+    for (const Shard& shard : shards) {
+        lock_guard<mutex> guard(shard.lock);
+        result.entries += shard.index.size();
+        result.bytes += shard.bytes;
+    }
+    return result;
+}
+
+void MatchCache::resetStats() {
+    hits = 0;
+    misses = 0;
+    inserts = 0;
+    evictions = 0;
+    invalidations = 0;
+}
+
+size_t MatchCache::capacityFromEnvironment() {
+    const char* value = getenv("APPROACHER_MATCH_CACHE_MB");
+    if (!value || !*value) return DEFAULT_CAPACITY_MB << 20;
+    char* end = nullptr;
+    long megabytes = strtol(value, &end, 10);
+    if (end == value || megabytes < 0) return DEFAULT_CAPACITY_MB << 20;
+    return (size_t)megabytes << 20;
+}
+
+void MatchFlightGroup::finish(const MatchCacheKey& key) {
+    Shard& shard = shardFor(key);
+    {
+        lock_guard<mutex> guard(shard.lock);
+        shard.flights.erase(key);
+    }
+    flights.fetch_add(1, memory_order_relaxed);
+}
+
+MatchFlightStats MatchFlightGroup::stats() const {
+    MatchFlightStats result;
+    result.flights = flights.load(memory_order_relaxed);
+    result.coalesced = coalesced_count.load(memory_order_relaxed);
+    result.saved_ns = saved_ns.load(memory_order_relaxed);
+    result.waited_ns = waited_ns.load(memory_order_relaxed);
+    return result;
+}
+
+void MatchFlightGroup::resetStats() {
+    flights = 0;
+    coalesced_count = 0;
+    saved_ns = 0;
+    waited_ns = 0;
+}
+
+bool MatchFlightGroup::enabledFromEnvironment() {
+    const char* value = getenv("APPROACHER_SINGLE_FLIGHT");
+    return !(value && string(value) == "0");
+}
@@ -0,0 +1,254 @@
+#pragma once
+
+#include <vector>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <future>
+#include <chrono>
+#include <unordered_map>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include "objectbox.hpp"
+#include "ConceptSnapshot.hpp"
+
+using namespace std;
+
+// 匹配结果缓存：同一个特征列表（"red,apple"与"apple, red"）在流量中反复出现，
+// 以规范化特征列表的64位指纹、匹配选项和快照版本为键缓存一侧的匹配集合，重复查询只需查一次散列表
+
+// 特征列表的规范形式：每个特征按快照字典的散列标识（有键的特征与"key:value"、无键的与值相同），
+// 散列排序后依次合并；同一个特征出现多次时按出现次数合并（重复特征影响重合度等级，不能去掉）
+// 列表项的前后空白和空项在解析时已去除，指纹与特征顺序无关
+// 结果与顺序有关时（复合词、递归匹配）由调用方改用合并了特征顺序的指纹，见orderedFeatureFingerprint
+
+inline uint64_t fingerprintMix(uint64_t hash, uint64_t value) {
+    return termHashMix(hash ^ value) + 0x9E3779B97F4A7C15ULL;
+}
+
+template <typename FeatureT>
+inline uint64_t featureTermHash(const FeatureT& feature) {
+    return termHashMix(feature.key.empty() ? valueTermHash(feature.value) : keyValueTermHash(feature.key, feature.value));
+}
+
+// 与顺序无关的指纹（排序缓冲区为线程局部，稳定后不分配内存）
+template <typename FeatureT>
+uint64_t canonicalFeatureFingerprint(const vector<FeatureT>& features) {
+    thread_local vector<uint64_t> hashes;
+    hashes.clear();
+    for (const FeatureT& feature : features) {
+        hashes.push_back(featureTermHash(feature));
+    }
+    sort(hashes.begin(), hashes.end());
+    uint64_t fingerprint = fingerprintMix(0, features.size());
+    for (uint64_t hash : hashes) {
+        fingerprint = fingerprintMix(fingerprint, hash);
+    }
+    return fingerprint;
+}
+
+// 在规范指纹上按原顺序合并各特征（结果与顺序有关时使用）
+template <typename FeatureT>
+uint64_t orderedFeatureFingerprint(const vector<FeatureT>& features, uint64_t canonical_fingerprint) {
+    uint64_t fingerprint = fingerprintMix(canonical_fingerprint, 0x6F72646572ULL);
+    for (const FeatureT& feature : features) {
+        fingerprint = fingerprintMix(fingerprint, featureTermHash(feature));
+    }
+    return fingerprint;
+}
+
+// 一侧的匹配集合：匹配的概念及其重合度等级，按概念ID升序；重合度统计只需要这两项
+// 等级（1-5）放在概念ID的高3位，每项8字节（分开存放要16字节，缓存能容纳的集合数少一半）
+struct MatchSetEntry {
+    static const int LEVEL_SHIFT = 61;
+    static const uint64_t ID_MASK = (1ULL << LEVEL_SHIFT) - 1;
+
+    uint64_t packed;
+
+    MatchSetEntry(obx_id concept_id, int level) : packed(concept_id | ((uint64_t)level << LEVEL_SHIFT)) {}
+    obx_id conceptId() const { return packed & ID_MASK; }
+    int level() const { return (int)(packed >> LEVEL_SHIFT); }
+};
+
+struct MatchSet {
+    vector<MatchSetEntry> matches;
+    bool order_sensitive = false;  // 标记项：该规范指纹下结果与顺序有关，要按有序指纹再查（此时matches为空）
+
+    size_t memoryBytes() const { return sizeof(MatchSet) + matches.capacity() * sizeof(MatchSetEntry); }
+};
+
+struct MatchCacheKey {
+    uint64_t fingerprint = 0;        // 规范指纹或有序指纹
+    uint64_t options = 0;            // 匹配选项（模式、模糊阈值、递归深度）的散列
+    uint64_t snapshot_version = 0;
+
+    bool operator==(const MatchCacheKey& other) const {
+        return fingerprint == other.fingerprint && options == other.options && snapshot_version == other.snapshot_version;
+    }
+};
+
+struct MatchCacheKeyHash {
+    size_t operator()(const MatchCacheKey& key) const {
+        return fingerprintMix(fingerprintMix(key.fingerprint, key.options), key.snapshot_version);
+    }
+};
+
+struct MatchCacheStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t inserts = 0;
+    uint64_t evictions = 0;        // 超出容量淘汰的项数
+    uint64_t invalidations = 0;    // 快照替换时清空的次数
+    uint64_t entries = 0;
+    uint64_t bytes = 0;
+    uint64_t capacity_bytes = 0;
+
+    double hitRate() const { return hits + misses > 0 ? (double)hits / (hits + misses) : 0.0; }
+};
+
+// 分片LRU缓存：按键的散列分到各分片，每个分片一把锁、一条LRU链表，容量按匹配集合的字节数计
+// 值为不可变的shared_ptr，查到后在锁外使用；快照替换后旧版本的键不会再命中，clear()释放其内存
+class MatchCache {
+public:
+    static const size_t SHARD_COUNT = 16;
+    static const size_t DEFAULT_CAPACITY_MB = 64;
+
+    // capacity_bytes为0时禁用缓存
+    explicit MatchCache(size_t capacity_bytes = DEFAULT_CAPACITY_MB << 20);
+    MatchCache(const MatchCache&) = delete;
+    MatchCache& operator=(const MatchCache&) = delete;
+
+    bool enabled() const { return capacity.load(memory_order_relaxed) > 0; }
+
+    // 修改容量并清空缓存（0为禁用）
+    void setCapacity(size_t capacity_bytes);
+
+    // 命中时移到LRU链表头部；不计入命中率，一次查询的结果由调用方用recordLookup记录
+    shared_ptr<const MatchSet> find(const MatchCacheKey& key);
+    void recordLookup(bool hit) { (hit ? hits : misses).fetch_add(1, memory_order_relaxed); }
+
+    // 插入（已存在时替换），超出分片容量时从链表尾部淘汰；比分片容量还大的集合不缓存
+    void insert(const MatchCacheKey& key, shared_ptr<const MatchSet> value);
+
+    // 清空全部分片（快照替换时调用）
+    void clear();
+
+    MatchCacheStats stats() const;
+    void resetStats();
+
+    // 环境变量 APPROACHER_MATCH_CACHE_MB 指定的容量（未设置为默认值，0为禁用）
+    static size_t capacityFromEnvironment();
+
+private:
+    typedef list<pair<MatchCacheKey, shared_ptr<const MatchSet>>> LruList;
+
+    struct Shard {
+        mutable mutex lock;
+        LruList lru;                                                  // 头部最近使用
+        unordered_map<MatchCacheKey, LruList::iterator, MatchCacheKeyHash> index;
+        size_t bytes = 0;
+    };
+
+    Shard& shardFor(const MatchCacheKey& key) { return shards[MatchCacheKeyHash()(key) % SHARD_COUNT]; }
+
+    atomic<size_t> capacity;
+    atomic<size_t> shard_capacity;
+    Shard shards[SHARD_COUNT];
+    atomic<uint64_t> hits{0}, misses{0}, inserts{0}, evictions{0}, invalidations{0};
+};
+
+struct MatchFlightStats {
+    uint64_t flights = 0;       // 实际执行的匹配次数（各键的第一个请求）
+    uint64_t coalesced = 0;     // 等待同键匹配结果、自己没有匹配的请求数
+    uint64_t saved_ns = 0;      // 合并省下的匹配时间（各等待者所等那次匹配的耗时之和）
+    uint64_t waited_ns = 0;     // 等待者实际等待的时间之和
+};
+
+// 合并并发的相同匹配（single-flight）：同一个键同时只有第一个请求在匹配，
+// 其余请求等待它的结果（shared_future），匹配失败时异常同样传给等待者
+// 结果先由执行者放入匹配结果缓存，再撤下进行中的记录，之后到达的请求直接命中缓存
+class MatchFlightGroup {
+public:
+    static const size_t SHARD_COUNT = 16;
+
+    explicit MatchFlightGroup(bool enabled_initially = true) : is_enabled(enabled_initially) {}
+    MatchFlightGroup(const MatchFlightGroup&) = delete;
+    MatchFlightGroup& operator=(const MatchFlightGroup&) = delete;
+
+    bool enabled() const { return is_enabled.load(memory_order_relaxed); }
+    void setEnabled(bool enabled) { is_enabled = enabled; }
+
+    // 执行compute()或等待同键正在进行的匹配；coalesced非空时返回本次是否等待了别人的结果
+    template <typename Compute>
+    shared_ptr<const MatchSet> run(const MatchCacheKey& key, Compute&& compute, bool* coalesced = nullptr);
+
+    MatchFlightStats stats() const;
+    void resetStats();
+
+    // 环境变量 APPROACHER_SINGLE_FLIGHT=0 时关闭合并
+    static bool enabledFromEnvironment();
+
+private:
+    struct FlightResult {
+        shared_ptr<const MatchSet> matches;
+        uint64_t compute_ns = 0;
+    };
+
+    struct Shard {
+        mutex lock;
+        unordered_map<MatchCacheKey, shared_future<FlightResult>, MatchCacheKeyHash> flights;
+    };
+
+    Shard& shardFor(const MatchCacheKey& key) { return shards[MatchCacheKeyHash()(key) % SHARD_COUNT]; }
+    void finish(const MatchCacheKey& key);
+
+    atomic<bool> is_enabled;
+    Shard shards[SHARD_COUNT];
+    atomic<uint64_t> flights{0}, coalesced_count{0}, saved_ns{0}, waited_ns{0};
+};
+
+template <typename Compute>
+shared_ptr<const MatchSet> MatchFlightGroup::run(const MatchCacheKey& key, Compute&& compute, bool* coalesced) {
+    if (coalesced) *coalesced = false;
+    if (!enabled()) return compute();
+
+    using clock = chrono::steady_clock;
+    promise<FlightResult> leader;
+    shared_future<FlightResult> pending;
+    {
+        Shard& shard = shardFor(key);
+        lock_guard<mutex> guard(shard.lock);
+        auto it = shard.flights.find(key);
+        if (it != shard.flights.end()) {
+            pending = it->second;
+        } else {
+            shard.flights.emplace(key, leader.get_future().share());
+        }
+    }
+
+    if (pending.valid()) {
+        auto wait_start = clock::now();
+        const FlightResult& result = pending.get();
+        coalesced_count.fetch_add(1, memory_order_relaxed);
+        saved_ns.fetch_add(result.compute_ns, memory_order_relaxed);
+        waited_ns.fetch_add(chrono::duration_cast<chrono::nanoseconds>(clock::now() - wait_start).count(), memory_order_relaxed);
+        if (coalesced) *coalesced = true;
+        return result.matches;
+    }
+
+    auto start = clock::now();
+    try {
+        FlightResult result;
+        result.matches = compute();
+        result.compute_ns = chrono::duration_cast<chrono::nanoseconds>(clock::now() - start).count();
+        leader.set_value(result);
+        finish(key);
+        return result.matches;
+    } catch (...) {
+        leader.set_exception(current_exception());
+        finish(key);
+        throw;
+    }
+}
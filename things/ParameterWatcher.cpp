@@ -0,0 +1,79 @@
+#include "ParameterWatcher.hpp"
+#include "Logger.hpp"
+#include <chrono>
+#include <cstring>
+#include <climits>
+#include <cstdlib>
+
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+
+using namespace std;
+
+ParameterFileWatcher::ParameterFileWatcher(const string& filename, function<void(const string&)> callback)
+    : on_change(move(callback)) {
+    // 与saveParameters一致：符号链接解析为目标文件，监视目标所在的目录（原子保存在那里rename）
+    char resolved[PATH_MAX];
+    string target = realpath(filename.c_str(), resolved) ? string(resolved) : filename;
+    size_t slash = target.find_last_of('/');
+    directory = slash == string::npos ? "." : (slash == 0 ? "/" : target.substr(0, slash));
+    file_name = slash == string::npos ? target : target.substr(slash + 1);
+
+    inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotify_fd < 0) {
+        LOG_WARN("无法初始化inotify，参数文件不会自动重新加载", {"error", strerror(errno)});
+        return;
+    }
+    if (inotify_add_watch(inotify_fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        LOG_WARN("无法监视参数文件目录，参数文件不会自动重新加载", {"dir", directory}, {"error", strerror(errno)});
+        close(inotify_fd);
+        inotify_fd = -1;
+        return;
+    }
+
+    watch_thread = thread(&ParameterFileWatcher::watchLoop, this);
+    LOG_INFO("监视参数文件 " << filename, {"file", filename}, {"target", target});
+}
+
+ParameterFileWatcher::~ParameterFileWatcher() {
+    stop_requested = true;
+    if (watch_thread.joinable()) {
+        watch_thread.join();
+    }
+    if (inotify_fd >= 0) {
+        close(inotify_fd);
+    }
+}
+
+void ParameterFileWatcher::watchLoop() {
+    const string path = directory + "/" + file_name;
+    alignas(inotify_event) char buffer[4096];
+
+    while (!stop_requested) {
+        pollfd poll_fd = {inotify_fd, POLLIN, 0};
+        int ready = poll(&poll_fd, 1, 200);
+        if (ready <= 0) continue;
+
+        // 读出所有事件，只关心目标文件
+        bool changed = false;
+        ssize_t n;
+        while ((n = read(inotify_fd, buffer, sizeof(buffer))) > 0) {
+            for (char* p = buffer; p < buffer + n;) {
+                const inotify_event* event = (const inotify_event*)p;
+                if (event->len > 0 && file_name == event->name) {
+                    changed = true;
+                }
+                p += sizeof(inotify_event) + event->len;
+            }
+        }
+        if (!changed) continue;
+
+        // 短暂合并连续写入（例如编辑器先写后改名）产生的多个事件
+        this_thread::sleep_for(chrono::milliseconds(50));
+        while (read(inotify_fd, buffer, sizeof(buffer)) > 0) {}
+
+        LOG_INFO("参数文件已变化，重新加载", {"file", path});
+        on_change(path);
+    }
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <string>
+#include <thread>
+#include <atomic>
+#include <functional>
+
+using namespace std;
+
+// 参数文件监视器：用inotify监视参数文件所在目录，文件被写完关闭或被rename替换时调用回调
+// （监视目录而不是文件本身，原子保存会用新文件替换旧inode）
+// 参数文件是符号链接时在构造时解析为目标文件，监视目标所在的目录；之后链接改指别处不会跟随
+// 回调在监视线程上执行；析构时停止监视线程
+class ParameterFileWatcher {
+private:
+    string directory;
+    string file_name;
+    function<void(const string&)> on_change;
+    atomic<bool> stop_requested{false};
+    int inotify_fd = -1;
+    thread watch_thread;
+
+    void watchLoop();
+
+public:
+    ParameterFileWatcher(const string& filename, function<void(const string&)> callback);
+    ~ParameterFileWatcher();
+
+    ParameterFileWatcher(const ParameterFileWatcher&) = delete;
+    ParameterFileWatcher& operator=(const ParameterFileWatcher&) = delete;
+
+    // 是否在监视（inotify初始化失败时为false）
+    bool isWatching() const { return inotify_fd >= 0; }
+};
@@ -0,0 +1,48 @@
+#include "QueryArena.hpp"
+#include <algorithm>
+
+using namespace std;
+
+void* QueryArena::OverflowResource::do_allocate(size_t size, size_t alignment) {
+    bytes += size;
+    count++;
+    return pmr::new_delete_resource()->allocate(size, alignment);
+}
+
+void QueryArena::OverflowResource::do_deallocate(void* pointer, size_t size, size_t alignment) {
+    pmr::new_delete_resource()->deallocate(pointer, size, alignment);
+}
+
+QueryArena::QueryArena() : buffer(new std::byte[INITIAL_SIZE]), buffer_size(INITIAL_SIZE) {
+    monotonic.emplace(buffer.get(), buffer_size, &overflow);
+}
+
+QueryArena& QueryArena::current() {
+    static thread_local QueryArena arena;
+    return arena;
+}
+
+void QueryArena::leave() {
+    if (--depth == 0) {
+        reset();
+    }
+}
+
+void QueryArena::reset() {
+    // 先释放向堆申请的块（monotonic_buffer_resource析构时归还给上游）
+    monotonic.reset();
+
+    if (overflow.bytes > 0) {
+        overflow_count += overflow.count;
+        // 本次查询的总用量不超过缓冲区加溢出字节数，按此扩大（不超过常驻上限）
+        size_t wanted = min(MAX_RETAINED_SIZE, buffer_size + overflow.bytes);
+        if (wanted > buffer_size) {
+            buffer.reset(new std::byte[wanted]);
+            buffer_size = wanted;
+        }
+        overflow.bytes = 0;
+        overflow.count = 0;
+    }
+
+    monotonic.emplace(buffer.get(), buffer_size, &overflow);
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <memory_resource>
+#include <memory>
+#include <vector>
+#include <optional>
+#include <cstdint>
+#include <cstddef>
+
+using namespace std;
+
+// 紧凑的匹配结果（24字节，不含堆分配）：快照内的概念位置、匹配数和输入位置位图
+// 位图前64位内联；输入特征超过64个时，其余的位（每64位一个字）分配在查询arena中
+struct CompactMatch {
+    uint32_t position = 0;                 // 概念在快照中的位置（快照按ID升序，位置顺序即ID顺序）
+    uint32_t match_count = 0;              // 匹配的输入特征数
+    uint64_t matched_mask = 0;             // 输入位置0-63是否匹配
+    const uint64_t* spill_mask = nullptr;  // 输入位置64起的位图，不超过64个特征时为nullptr
+
+    bool isMatched(size_t index) const {
+        if (index < 64) return (matched_mask >> index) & 1;
+        return spill_mask && ((spill_mask[index / 64 - 1] >> (index % 64)) & 1);
+    }
+};
+
+// 分配在查询arena中的匹配结果列表
+typedef pmr::vector<CompactMatch> CompactMatchList;
+
+// 查询arena：每个线程一块，单调分配（释放是空操作），最外层查询结束时整体重置
+// 缓冲区用尽时向堆申请，重置时把缓冲区扩大到本次查询的用量，稳定后查询过程不再调用malloc
+class QueryArena {
+public:
+    static const size_t INITIAL_SIZE = 64 * 1024;        // 初始缓冲区
+    static const size_t MAX_RETAINED_SIZE = 64 << 20;    // 常驻缓冲区上限，超出部分每次查询向堆申请
+
+    QueryArena();
+    QueryArena(const QueryArena&) = delete;
+    QueryArena& operator=(const QueryArena&) = delete;
+
+    // 当前线程的arena
+    static QueryArena& current();
+
+    pmr::memory_resource* resource() { return &*monotonic; }
+
+    // 进入/离开一层查询作用域，最外层离开时重置
+    void enter() { depth++; }
+    void leave();
+
+    size_t capacity() const { return buffer_size; }
+    uint64_t overflowCount() const { return overflow_count; }  // 超出缓冲区、向堆申请的次数
+
+private:
+    // 缓冲区用尽后的分配转给operator new，同时统计字节数
+    class OverflowResource : public pmr::memory_resource {
+    public:
+        size_t bytes = 0;
+        uint64_t count = 0;
+
+    protected:
+        void* do_allocate(size_t size, size_t alignment) override;
+        void do_deallocate(void* pointer, size_t size, size_t alignment) override;
+        bool do_is_equal(const pmr::memory_resource& other) const noexcept override { return this == &other; }
+    };
+
+    unique_ptr<std::byte[]> buffer;
+    size_t buffer_size = 0;
+    OverflowResource overflow;
+    optional<pmr::monotonic_buffer_resource> monotonic;
+    int depth = 0;
+    uint64_t overflow_count = 0;
+
+    void reset();
+};
+
+// 查询作用域：构造时进入本线程的arena，最外层作用域结束时重置arena
+// 在arena中分配的对象不能带出最外层作用域
+class QueryArenaScope {
+private:
+    QueryArena& arena;
+
+public:
+    QueryArenaScope() : arena(QueryArena::current()) { arena.enter(); }
+    ~QueryArenaScope() { arena.leave(); }
+
+    QueryArenaScope(const QueryArenaScope&) = delete;
+    QueryArenaScope& operator=(const QueryArenaScope&) = delete;
+
+    pmr::memory_resource* resource() { return arena.resource(); }
+};
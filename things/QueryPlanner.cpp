@@ -0,0 +1,187 @@
+#include "QueryPlanner.hpp"
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <iomanip>
+
+using namespace std;
+
+double estimateUnionSize(const vector<size_t>& frequencies, size_t concept_count) {
+    if (concept_count == 0) return 0.0;
+    double absent = 1.0;  // 一个概念不在任何列表中的概率
+    for (size_t frequency : frequencies) {
+        absent *= 1.0 - min(1.0, (double)frequency / concept_count);
+    }
+    return concept_count * (1.0 - absent);
+}
+
+// 多个列表求并（解码并归并去重）的代价
+static double unionCost(size_t postings, size_t lists) {
+    return PLAN_COST_DECODE * postings + (lists > 1 ? PLAN_COST_UNION * postings : 0.0);
+}
+
+void chooseSidePlan(SidePlan& side, const QueryPlan& plan, double average_signature_bits) {
+    fill(side.costs, side.costs + PLAN_STRATEGY_COUNT, -1.0);
+    double concept_count = plan.concept_count;
+
+    if (plan.fuzzy && plan.recursive_depth > 1) {
+        side.strategy = PLAN_RECURSIVE;
+        side.estimated_us = -1.0;
+        return;
+    }
+
+    if (plan.fuzzy) {
+        // 两种策略都要先查字典求相似值（同时得到查询签名和相似值的倒排列表）
+        double dictionary = PLAN_COST_STRING_SIMILARITY * side.fuzzy_compares;
+        double verify = PLAN_COST_FUZZY_VERIFY * side.feature_count;
+        side.costs[PLAN_FUZZY_EXPAND] = (dictionary + unionCost(side.fuzzy_postings, side.fuzzy_lists.size())
+                                         + verify * side.estimated_candidates) / PLAN_NANOSECONDS_PER_MICROSECOND;
+        // 签名扫描：候选之外的概念签名按各位独立估计误判
+        double query_bits = __builtin_popcountll(side.fuzzy_signature);
+        double false_positive = 1.0 - pow(1.0 - query_bits / 64.0, average_signature_bits);
+        double passed = side.estimated_candidates + false_positive * (concept_count - side.estimated_candidates);
+        side.costs[PLAN_FUZZY_SCAN] = (dictionary + PLAN_COST_SIGNATURE * concept_count + verify * passed) / PLAN_NANOSECONDS_PER_MICROSECOND;
+    } else {
+        double lookups = PLAN_COST_LOOKUP * (side.feature_count + side.compound_lookups);
+        size_t postings = side.direct_postings + side.compound_postings;
+        size_t lists = side.direct_lists + side.compound_lists;
+        side.costs[PLAN_POSTINGS_MERGE] = (lookups + unionCost(postings, lists)
+                                           + PLAN_COST_VERIFY * side.estimated_candidates) / PLAN_NANOSECONDS_PER_MICROSECOND;
+        side.costs[PLAN_SCAN] = (lookups + PLAN_COST_SCAN * concept_count
+                                 + PLAN_COST_SCAN_MATCH * side.estimated_candidates) / PLAN_NANOSECONDS_PER_MICROSECOND;
+    }
+
+    PlanStrategy forced = forcedPlanStrategy();
+    if (forced != PLAN_STRATEGY_COUNT && forced != PLAN_PROBE && side.costs[forced] >= 0) {
+        side.strategy = forced;
+    } else {
+        side.strategy = plan.fuzzy ? PLAN_FUZZY_EXPAND : PLAN_POSTINGS_MERGE;
+        for (int s = 0; s < PLAN_STRATEGY_COUNT; s++) {
+            if (side.costs[s] >= 0 && s != PLAN_PROBE && side.costs[s] < side.costs[side.strategy]) {
+                side.strategy = (PlanStrategy)s;
+            }
+        }
+    }
+    side.estimated_us = side.costs[side.strategy];
+}
+
+void choosePairPlan(QueryPlan& plan) {
+    if (plan.fuzzy || plan.side_count != 2) return;
+
+    // 探测一侧：本侧的匹配数由倒排列表求并得到（直接列表中的概念必然匹配，只有复合词列表中的要验证），
+    // 各重合等级只在另一侧的匹配概念上验证本侧
+    for (int s = 0; s < 2; s++) {
+        SidePlan& side = plan.sides[s];
+        const SidePlan& other = plan.sides[1 - s];
+        double lookups = PLAN_COST_LOOKUP * (side.feature_count + side.compound_lookups);
+        size_t postings = side.direct_postings + side.compound_postings;
+        side.costs[PLAN_PROBE] = (lookups + unionCost(postings, side.direct_lists + side.compound_lists)
+                                  + PLAN_COST_VERIFY * (other.estimated_candidates + side.compound_postings)) / PLAN_NANOSECONDS_PER_MICROSECOND;
+    }
+
+    int probed = -1;
+    PlanStrategy forced = forcedPlanStrategy();
+    if (forced == PLAN_PROBE) {
+        probed = plan.sides[1].estimated_candidates >= plan.sides[0].estimated_candidates ? 1 : 0;
+    } else if (forced == PLAN_STRATEGY_COUNT) {
+        double best = plan.sides[0].estimated_us + plan.sides[1].estimated_us;
+        for (int s = 0; s < 2; s++) {
+            double cost = plan.sides[1 - s].estimated_us + plan.sides[s].costs[PLAN_PROBE];
+            if (cost < best) {
+                best = cost;
+                probed = s;
+            }
+        }
+    }
+    if (probed >= 0) {
+        plan.sides[probed].strategy = PLAN_PROBE;
+        plan.sides[probed].estimated_us = plan.sides[probed].costs[PLAN_PROBE];
+    }
+}
+
+PlanStrategy forcedPlanStrategy() {
+    static const PlanStrategy forced = []() {
+        const char* plan_env = getenv("APPROACHER_PLAN");
+        if (!plan_env) return PLAN_STRATEGY_COUNT;
+        if (strcmp(plan_env, "merge") == 0) return PLAN_POSTINGS_MERGE;
+        if (strcmp(plan_env, "probe") == 0) return PLAN_PROBE;
+        if (strcmp(plan_env, "scan") == 0) return PLAN_SCAN;
+        if (strcmp(plan_env, "expand") == 0) return PLAN_FUZZY_EXPAND;
+        if (strcmp(plan_env, "signature") == 0) return PLAN_FUZZY_SCAN;
+        return PLAN_STRATEGY_COUNT;
+    }();
+    return forced;
+}
+
+const char* planStrategyName(PlanStrategy strategy) {
+    switch (strategy) {
+        case PLAN_POSTINGS_MERGE: return "倒排合并";
+        case PLAN_PROBE:          return "探测另一侧的匹配";
+        case PLAN_SCAN:           return "全量扫描";
+        case PLAN_FUZZY_EXPAND:   return "相似值倒排展开";
+        case PLAN_FUZZY_SCAN:     return "值签名扫描";
+        case PLAN_RECURSIVE:      return "递归匹配";
+        default:                  return "unknown";
+    }
+}
+
+static void formatSidePlan(ostringstream& out, const char* name, const SidePlan& side, bool fuzzy) {
+    out << name << ": " << side.feature_count << " 个特征";
+    if (side.strategy == PLAN_RECURSIVE) {
+        out << endl;
+    } else if (fuzzy) {
+        out << "，比较字典项 " << side.fuzzy_compares << " 个，相似值倒排 " << side.fuzzy_lists.size()
+            << " 个共 " << side.fuzzy_postings << " 项，查询签名置位 " << __builtin_popcountll(side.fuzzy_signature)
+            << "/64，估计候选 " << (size_t)side.estimated_candidates << endl;
+    } else {
+        out << "，直接倒排 " << side.direct_lists << " 个共 " << side.direct_postings << " 项，复合词 "
+            << side.compound_lookups << " 个（存在 " << side.compound_lists << " 个，共 " << side.compound_postings
+            << " 项），估计候选 " << (size_t)side.estimated_candidates << endl;
+    }
+    for (const PlanTerm& term : side.terms) {
+        out << "    " << (term.compound ? "复合词 " : "") << term.text << "  频率 " << term.frequency << endl;
+    }
+
+    if (side.strategy != PLAN_RECURSIVE) {
+        out << "  估计代价:";
+        for (int s = 0; s < PLAN_STRATEGY_COUNT; s++) {
+            if (side.costs[s] >= 0) {
+                out << " " << planStrategyName((PlanStrategy)s) << " " << side.costs[s] << " us";
+            }
+        }
+        out << endl;
+    }
+    out << "  选择: " << planStrategyName(side.strategy);
+    if (side.estimated_us >= 0) {
+        out << "，估计 " << side.estimated_us << " us";
+    }
+    out << "，实际 " << side.actual_us << " us（验证 " << side.actual_candidates << " 个概念，匹配 "
+        << side.actual_matches << " 个）" << endl;
+}
+
+string formatQueryPlan(const QueryPlan& plan) {
+    ostringstream out;
+    out << fixed << setprecision(1);
+    out << "=== 查询计划（" << (plan.fuzzy ? "模糊匹配" : "精确匹配");
+    if (plan.fuzzy) {
+        out << "，阈值 " << plan.fuzzy_threshold << "，递归深度 " << plan.recursive_depth;
+    }
+    out << "，概念 " << plan.concept_count << " 个） ===" << endl;
+    formatSidePlan(out, plan.side_count == 2 ? "A" : "查询", plan.sides[0], plan.fuzzy);
+    if (plan.side_count == 2) {
+        formatSidePlan(out, "B", plan.sides[1], plan.fuzzy);
+    }
+    double estimated = 0.0;
+    bool has_estimate = true;
+    for (int s = 0; s < plan.side_count; s++) {
+        if (plan.sides[s].estimated_us < 0) has_estimate = false;
+        estimated += plan.sides[s].estimated_us;
+    }
+    out << "合计: ";
+    if (has_estimate) {
+        out << "估计 " << estimated << " us，";
+    }
+    out << "实际 " << plan.actual_total_us << " us" << endl;
+    return out.str();
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+#include "CompressedPostings.hpp"
+
+using namespace std;
+
+// 查询计划：按快照中的特征频率估计各执行策略的代价，为每一侧特征列表选择最便宜的策略
+// 各策略的结果完全相同，只是工作量不同；下面的单次操作代价以纳秒计（在20000个概念的合成库上测得），
+// 汇总出的各策略估计代价换算为微秒（costs、estimated_us），只用于比较策略的相对大小
+
+enum PlanStrategy {
+    PLAN_POSTINGS_MERGE = 0,  // 精确：合并倒排列表得到候选，逐个验证
+    PLAN_PROBE,               // 精确（相似度）：只在另一侧的匹配概念上验证，本侧的匹配数由倒排列表求并得到
+    PLAN_SCAN,                // 精确：不用倒排列表，逐个概念用特征ID内核比较
+    PLAN_FUZZY_EXPAND,        // 模糊：相似值的倒排列表求并得到候选，逐个模糊匹配
+    PLAN_FUZZY_SCAN,          // 模糊：逐概念扫描，值签名与查询签名不相交的跳过
+    PLAN_RECURSIVE,           // 递归模糊匹配（深度>1），不做计划
+    PLAN_STRATEGY_COUNT
+};
+
+// 代价模型：单次操作的纳秒数
+const double PLAN_COST_LOOKUP = 80.0;            // 查找一个特征或复合词的倒排列表
+const double PLAN_COST_DECODE = 2.5;             // 解码一个倒排位置
+const double PLAN_COST_UNION = 5.0;              // 多个列表求并时每个位置的归并去重
+const double PLAN_COST_VERIFY = 40.0;            // 验证一个候选概念（特征ID内核和复合词）并输出
+const double PLAN_COST_SCAN = 14.0;              // 全量扫描中比较一个概念
+const double PLAN_COST_SCAN_MATCH = 20.0;        // 全量扫描中输出一个匹配
+const double PLAN_COST_STRING_SIMILARITY = 500.0;  // 计算一次字符串相似度（模糊匹配查字典）
+const double PLAN_COST_SIGNATURE = 1.0;          // 检查一个概念的值签名
+const double PLAN_COST_FUZZY_VERIFY = 1300.0;    // 对一个概念模糊匹配一个输入特征
+const double PLAN_NANOSECONDS_PER_MICROSECOND = 1000.0;
+
+// 计划中的一项特征（只在explain时填写）
+struct PlanTerm {
+    string text;            // 特征文本（复合词为用下划线连接的值）
+    size_t frequency = 0;   // 包含该特征的概念数，字典中不存在为0
+    bool compound = false;  // 是否为复合词
+};
+
+// 一侧特征列表的统计、各策略的估计代价和选择的策略
+struct SidePlan {
+    size_t feature_count = 0;
+    size_t direct_lists = 0;              // 字典中存在的输入特征数
+    size_t direct_postings = 0;           // 其倒排列表长度之和
+    size_t compound_lookups = 0;          // 查找的复合词数
+    size_t compound_lists = 0;            // 字典中存在的复合词数
+    size_t compound_postings = 0;         // 其倒排列表长度之和
+    size_t fuzzy_compares = 0;            // 模糊：与输入比较过的字典项数
+    size_t fuzzy_postings = 0;            // 模糊：相似值倒排列表长度之和
+    uint64_t fuzzy_signature = 0;         // 模糊：查询签名
+    vector<const CompressedPostings*> fuzzy_lists;  // 模糊：相似值的倒排列表（执行时直接求并，不再查字典）
+    double estimated_candidates = 0.0;    // 估计的候选概念数（各列表按独立出现估计并集大小）
+
+    double costs[PLAN_STRATEGY_COUNT];    // 各策略的估计代价（微秒），不适用的为负
+    PlanStrategy strategy = PLAN_POSTINGS_MERGE;
+    double estimated_us = 0.0;            // 所选策略的估计代价（微秒）
+
+    // 执行后填写（explain）
+    size_t actual_candidates = 0;         // 实际验证的概念数
+    size_t actual_matches = 0;            // 实际匹配的概念数
+    double actual_us = 0.0;               // 实际耗时
+    vector<PlanTerm> terms;               // 各输入特征和复合词的频率
+
+    SidePlan() { fill(costs, costs + PLAN_STRATEGY_COUNT, -1.0); }
+};
+
+// 一次查询（一侧的匹配或两侧的相似度）的计划
+struct QueryPlan {
+    bool fuzzy = false;
+    int recursive_depth = 1;
+    double fuzzy_threshold = 0.6;
+    size_t concept_count = 0;
+    int side_count = 1;
+    SidePlan sides[2];
+    double actual_total_us = 0.0;         // explain：整个查询的实际耗时
+};
+
+// 假设各列表独立出现，估计频率为frequencies的各列表并集的大小
+double estimateUnionSize(const vector<size_t>& frequencies, size_t concept_count);
+
+// 由统计填写一侧的各策略代价并选择策略（精确或模糊）
+void chooseSidePlan(SidePlan& side, const QueryPlan& plan, double average_signature_bits);
+
+// 精确匹配的两侧：在各自选好的策略和"探测较大的一侧"之间选择
+void choosePairPlan(QueryPlan& plan);
+
+// 强制使用的策略：环境变量 APPROACHER_PLAN=merge|probe|scan|expand|signature（测试和对比用），
+// 未设置或为auto时返回PLAN_STRATEGY_COUNT；强制的策略对该查询不适用时仍按代价选择
+PlanStrategy forcedPlanStrategy();
+
+const char* planStrategyName(PlanStrategy strategy);
+
+// explain的文本输出
+string formatQueryPlan(const QueryPlan& plan);
@@ -0,0 +1,564 @@
+#include "QueryTrace.hpp"
+#include "SimpleJson.hpp"
+#include "Logger.hpp"
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <algorithm>
+#include <cstdlib>
+#include <cstdio>
+
+#include <unistd.h>
+
+using namespace std;
+
+// 查询trace中最多保留的阶段事件数（递归匹配可能产生大量事件）
+static const size_t MAX_TRACE_EVENTS = 20000;
+
+// 一个阶段事件
+struct TraceEvent {
+    TraceStage stage;
+    uint64_t start;
+    uint64_t end;
+};
+
+// 正在进行的顶层查询
+struct ActiveQueryTrace {
+    string label;
+    uint64_t start = 0;
+    uint64_t counters_at_start[TRACE_COUNTER_COUNT] = {};
+    bool record_events = false;
+    vector<TraceEvent> events;
+    size_t dropped_events = 0;
+};
+
+// 交给后台线程写出的慢查询trace（事件从线程数据中移出，计数器已算成增量）
+struct PendingChromeTrace {
+    string label;
+    int thread_index = 0;
+    uint64_t start = 0;
+    uint64_t end = 0;
+    uint64_t counter_deltas[TRACE_COUNTER_COUNT] = {};
+    vector<TraceEvent> events;
+    size_t dropped_events = 0;
+    uint64_t sequence = 0;
+};
+
+// 每个线程的统计数据：只由本线程写入
+struct ThreadTraceData {
+    LatencyHistogram histograms[TRACE_STAGE_COUNT];
+    atomic<uint64_t> stage_ticks[TRACE_STAGE_COUNT] = {};
+    atomic<uint64_t> counters[TRACE_COUNTER_COUNT] = {};
+    int thread_index = 0;
+    bool in_query = false;
+    ActiveQueryTrace query;
+
+    ThreadTraceData();
+    ~ThreadTraceData();
+};
+
+// 合并后的统计（非原子，只在registry_mutex下使用）
+struct TraceTotals {
+    uint64_t buckets[TRACE_STAGE_COUNT][LatencyHistogram::BUCKET_COUNT] = {};
+    uint64_t stage_ticks[TRACE_STAGE_COUNT] = {};
+    uint64_t counters[TRACE_COUNTER_COUNT] = {};
+
+    void add(const ThreadTraceData& data) {
+        for (int s = 0; s < TRACE_STAGE_COUNT; s++) {
+            for (int b = 0; b < LatencyHistogram::BUCKET_COUNT; b++) {
+                buckets[s][b] += data.histograms[s].bucketCount(b);
+            }
+            stage_ticks[s] += data.stage_ticks[s].load(memory_order_relaxed);
+        }
+        for (int c = 0; c < TRACE_COUNTER_COUNT; c++) {
+            counters[c] += data.counters[c].load(memory_order_relaxed);
+        }
+    }
+
+    void add(const TraceTotals& other) {
+        for (int s = 0; s < TRACE_STAGE_COUNT; s++) {
+            for (int b = 0; b < LatencyHistogram::BUCKET_COUNT; b++) {
+                buckets[s][b] += other.buckets[s][b];
+            }
+            stage_ticks[s] += other.stage_ticks[s];
+        }
+        for (int c = 0; c < TRACE_COUNTER_COUNT; c++) {
+            counters[c] += other.counters[c];
+        }
+    }
+
+    void subtract(const TraceTotals& other) {
+        for (int s = 0; s < TRACE_STAGE_COUNT; s++) {
+            for (int b = 0; b < LatencyHistogram::BUCKET_COUNT; b++) {
+                buckets[s][b] -= min(buckets[s][b], other.buckets[s][b]);
+            }
+            stage_ticks[s] -= min(stage_ticks[s], other.stage_ticks[s]);
+        }
+        for (int c = 0; c < TRACE_COUNTER_COUNT; c++) {
+            counters[c] -= min(counters[c], other.counters[c]);
+        }
+    }
+};
+
+// 直方图分格
+
+int LatencyHistogram::bucketIndex(uint64_t ticks) {
+    if (ticks < (uint64_t)SUB_BUCKETS) {
+        return (int)ticks;
+    }
+    int exponent = 63 - __builtin_clzll(ticks);
+    if (exponent > MAX_EXPONENT) {
+        return BUCKET_COUNT - 1;
+    }
+    int sub_bucket = (int)((ticks >> (exponent - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1));
+    return (exponent - SUB_BUCKET_BITS + 1) * SUB_BUCKETS + sub_bucket;
+}
+
+uint64_t LatencyHistogram::bucketLowerBound(int index) {
+    int block = index / SUB_BUCKETS;
+    int sub_bucket = index % SUB_BUCKETS;
+    if (block == 0) {
+        return sub_bucket;
+    }
+    int exponent = block + SUB_BUCKET_BITS - 1;
+    return (uint64_t)(SUB_BUCKETS + sub_bucket) << (exponent - SUB_BUCKET_BITS);
+}
+
+uint64_t LatencyHistogram::bucketUpperBound(int index) {
+    int block = index / SUB_BUCKETS;
+    if (block == 0) {
+        return bucketLowerBound(index);
+    }
+    int exponent = block + SUB_BUCKET_BITS - 1;
+    return bucketLowerBound(index) + ((uint64_t)1 << (exponent - SUB_BUCKET_BITS)) - 1;
+}
+
+// 线程数据注册：线程第一次计时时注册，退出时把数据并入retired
+
+ThreadTraceData::ThreadTraceData() {
+    QueryProfiler& profiler = QueryProfiler::instance();
+    lock_guard<mutex> lock(profiler.registry_mutex);
+    thread_index = profiler.next_thread_index++;
+    profiler.threads.push_back(this);
+}
+
+ThreadTraceData::~ThreadTraceData() {
+    QueryProfiler& profiler = QueryProfiler::instance();
+    lock_guard<mutex> lock(profiler.registry_mutex);
+    profiler.retired->add(*this);
+    profiler.threads.erase(remove(profiler.threads.begin(), profiler.threads.end(), this), profiler.threads.end());
+}
+
+// 同时读取TSC和steady_clock：TSC夹在两次时钟读数之间，取两者的中点
+static void sampleClocks(uint64_t& ticks, chrono::steady_clock::time_point& time) {
+    auto before = chrono::steady_clock::now();
+    ticks = traceTicks();
+    auto after = chrono::steady_clock::now();
+    time = before + (after - before) / 2;
+}
+
+QueryProfiler::QueryProfiler()
+    : enabled(true), slow_threshold_ticks(0), slow_traces_written(0),
+      retired(new TraceTotals()), baseline(new TraceTotals()) {
+    chrono::steady_clock::now();  // 第一次读时钟可能较慢（vDSO缺页），不计入采样
+    sampleClocks(start_ticks, start_time);
+    reset_time = start_time;
+#if defined(__x86_64__) || defined(__i386__)
+    // 忙等约50微秒后取第二个采样点（只在构造时一次）；采样误差在几十纳秒，换算误差约千分之一
+    while (chrono::steady_clock::now() - start_time < chrono::microseconds(50)) {}
+    uint64_t end_ticks;
+    chrono::steady_clock::time_point end_time;
+    sampleClocks(end_ticks, end_time);
+    if (end_ticks > start_ticks) {
+        initial_ns_per_tick = chrono::duration<double, nano>(end_time - start_time).count() / (end_ticks - start_ticks);
+    }
+#endif
+
+    const char* enabled_env = getenv("APPROACHER_TRACE");
+    if (enabled_env && string(enabled_env) == "0") {
+        enabled = false;
+    }
+
+    const char* directory_env = getenv("APPROACHER_TRACE_DIR");
+    const char* slow_env = getenv("APPROACHER_TRACE_SLOW_MS");
+    if (slow_env && *slow_env) {
+        setSlowQueryTrace(atof(slow_env), directory_env ? directory_env : "");
+    } else if (directory_env && *directory_env) {
+        trace_directory = directory_env;
+    }
+}
+
+QueryProfiler::~QueryProfiler() {
+    // 写完已排队的trace再退出
+    {
+        lock_guard<mutex> lock(trace_writer_mutex);
+        trace_writer_stop = true;
+    }
+    trace_writer_cv.notify_all();
+    if (trace_writer_thread.joinable()) {
+        trace_writer_thread.join();
+    }
+    delete retired;
+    delete baseline;
+}
+
+QueryProfiler& QueryProfiler::instance() {
+    static QueryProfiler profiler;
+    return profiler;
+}
+
+ThreadTraceData& QueryProfiler::threadData() {
+    thread_local ThreadTraceData data;
+    return data;
+}
+
+void QueryProfiler::setEnabled(bool value) {
+    enabled = value;
+}
+
+double QueryProfiler::ticksToNanoseconds(double ticks) {
+    // 启动10毫秒以后用启动以来的TSC增量与steady_clock增量之比换算，之前用构造时的校准值
+    auto elapsed = chrono::steady_clock::now() - start_time;
+    if (elapsed < chrono::milliseconds(10)) {
+        return ticks * initial_ns_per_tick;
+    }
+    double elapsed_ns = chrono::duration<double, nano>(elapsed).count();
+    double elapsed_ticks = (double)(traceTicks() - start_ticks);
+    return elapsed_ticks > 0 ? ticks * elapsed_ns / elapsed_ticks : ticks * initial_ns_per_tick;
+}
+
+void QueryProfiler::setSlowQueryTrace(double threshold_ms, const string& directory) {
+    {
+        lock_guard<mutex> lock(registry_mutex);
+        if (!directory.empty()) {
+            trace_directory = directory;
+        }
+    }
+    if (threshold_ms <= 0) {
+        slow_threshold_ticks = 0;
+        return;
+    }
+    double ticks_per_ns = 1.0 / ticksToNanoseconds(1.0);
+    slow_threshold_ticks = max<uint64_t>(1, (uint64_t)(threshold_ms * 1e6 * ticks_per_ns));
+}
+
+double QueryProfiler::getSlowQueryThresholdMs() {
+    uint64_t threshold = slow_threshold_ticks.load();
+    return threshold == 0 ? 0.0 : ticksToNanoseconds((double)threshold) / 1e6;
+}
+
+void QueryProfiler::recordStage(TraceStage stage, uint64_t start, uint64_t end) {
+    ThreadTraceData& data = threadData();
+    uint64_t ticks = end > start ? end - start : 0;
+    data.histograms[stage].record(ticks);
+    data.stage_ticks[stage].store(data.stage_ticks[stage].load(memory_order_relaxed) + ticks, memory_order_relaxed);
+
+    if (data.in_query && data.query.record_events) {
+        if (data.query.events.size() < MAX_TRACE_EVENTS) {
+            data.query.events.push_back({stage, start, end});
+        } else {
+            data.query.dropped_events++;
+        }
+    }
+}
+
+void traceCount(TraceCounter counter, uint64_t amount) {
+    if (!QueryProfiler::instance().isEnabled()) return;
+    atomic<uint64_t>& value = QueryProfiler::threadData().counters[counter];
+    value.store(value.load(memory_order_relaxed) + amount, memory_order_relaxed);
+}
+
+void QueryProfiler::collect(TraceTotals& totals) {
+    totals.add(*retired);
+    for (ThreadTraceData* data : threads) {
+        totals.add(*data);
+    }
+}
+
+TraceSummary QueryProfiler::summarize() {
+    unique_ptr<TraceTotals> totals(new TraceTotals());
+    TraceSummary summary;
+    {
+        lock_guard<mutex> lock(registry_mutex);
+        collect(*totals);
+        totals->subtract(*baseline);
+        summary.seconds = chrono::duration<double>(chrono::steady_clock::now() - reset_time).count();
+    }
+
+    double ns_per_tick = ticksToNanoseconds(1.0);
+    auto to_us = [ns_per_tick](double ticks) { return ticks * ns_per_tick / 1000.0; };
+
+    for (int s = 0; s < TRACE_STAGE_COUNT; s++) {
+        StageSummary& stage = summary.stages[s];
+        const uint64_t* buckets = totals->buckets[s];
+        for (int b = 0; b < LatencyHistogram::BUCKET_COUNT; b++) {
+            stage.count += buckets[b];
+        }
+        if (stage.count == 0) continue;
+        stage.total_us = to_us((double)totals->stage_ticks[s]);
+
+        // 百分位取所在格的中点，最大值取最高非空格的上界
+        auto percentile = [&](double p) {
+            uint64_t rank = max<uint64_t>(1, (uint64_t)(p * stage.count + 0.5));
+            uint64_t seen = 0;
+            for (int b = 0; b < LatencyHistogram::BUCKET_COUNT; b++) {
+                seen += buckets[b];
+                if (seen >= rank) {
+                    return to_us((LatencyHistogram::bucketLowerBound(b) + LatencyHistogram::bucketUpperBound(b)) / 2.0);
+                }
+            }
+            return 0.0;
+        };
+        stage.p50_us = percentile(0.50);
+        stage.p90_us = percentile(0.90);
+        stage.p99_us = percentile(0.99);
+        for (int b = LatencyHistogram::BUCKET_COUNT - 1; b >= 0; b--) {
+            if (buckets[b]) {
+                stage.max_us = to_us((double)LatencyHistogram::bucketUpperBound(b));
+                break;
+            }
+        }
+    }
+
+    for (int c = 0; c < TRACE_COUNTER_COUNT; c++) {
+        summary.counters[c] = totals->counters[c];
+    }
+    summary.slow_traces_written = slow_traces_written.load();
+    summary.slow_traces_dropped = slow_traces_dropped.load();
+    return summary;
+}
+
+void QueryProfiler::reset() {
+    lock_guard<mutex> lock(registry_mutex);
+    unique_ptr<TraceTotals> current(new TraceTotals());
+    collect(*current);
+    *baseline = *current;
+    reset_time = chrono::steady_clock::now();
+    slow_traces_written = 0;
+    slow_traces_dropped = 0;
+}
+
+const char* QueryProfiler::stageName(TraceStage stage) {
+    switch (stage) {
+        case TRACE_STAGE_QUERY:           return "query";
+        case TRACE_STAGE_LOAD_CONCEPTS:   return "load_concepts";
+        case TRACE_STAGE_EXACT_MATCH:     return "exact_match";
+        case TRACE_STAGE_FUZZY_MATCH:     return "fuzzy_match";
+        case TRACE_STAGE_RECURSIVE_MATCH: return "recursive_match";
+        case TRACE_STAGE_SIMILAR_VALUES:  return "similar_values";
+        case TRACE_STAGE_OVERLAP:         return "overlap";
+        case TRACE_STAGE_SCORING:         return "scoring";
+        case TRACE_STAGE_TOPK:            return "topk";
+        default:                          return "unknown";
+    }
+}
+
+const char* QueryProfiler::counterName(TraceCounter counter) {
+    switch (counter) {
+        case TRACE_CONCEPTS_SCANNED:     return "concepts_scanned";
+        case TRACE_EDIT_DISTANCE_CALLS:  return "edit_distance_calls";
+        case TRACE_DP_CELLS:             return "dp_cells";
+        case TRACE_RECURSION_EXPANSIONS: return "recursion_expansions";
+        case TRACE_POSTINGS_TOUCHED:     return "postings_touched";
+        case TRACE_SIGNATURE_CHECKED:    return "signature_checked";
+        case TRACE_SIGNATURE_SKIPPED:    return "signature_skipped";
+        case TRACE_PLAN_SCAN:            return "plan_scan";
+        case TRACE_PLAN_PROBE:           return "plan_probe";
+        case TRACE_PLAN_FUZZY_EXPAND:    return "plan_fuzzy_expand";
+        case TRACE_MATCH_CACHE_HITS:     return "match_cache_hits";
+        case TRACE_MATCH_CACHE_MISSES:   return "match_cache_misses";
+        case TRACE_SINGLE_FLIGHT_WAITS:  return "single_flight_waits";
+        default:                         return "unknown";
+    }
+}
+
+string QueryProfiler::formatText() {
+    TraceSummary summary = summarize();
+    ostringstream out;
+    char line[256];
+
+    out << "=== 查询阶段耗时（微秒，统计 " << summary.seconds << " 秒" << (isEnabled() ? "" : "，计时已关闭") << "） ===" << endl;
+    snprintf(line, sizeof(line), "%-16s %10s %12s %10s %10s %10s %10s\n", "stage", "count", "mean", "p50", "p90", "p99", "max");
+    out << line;
+    for (int s = 0; s < TRACE_STAGE_COUNT; s++) {
+        const StageSummary& stage = summary.stages[s];
+        if (stage.count == 0) continue;
+        snprintf(line, sizeof(line), "%-16s %10llu %12.2f %10.2f %10.2f %10.2f %10.2f\n",
+                 stageName((TraceStage)s), (unsigned long long)stage.count, stage.total_us / stage.count,
+                 stage.p50_us, stage.p90_us, stage.p99_us, stage.max_us);
+        out << line;
+    }
+
+    uint64_t queries = summary.stages[TRACE_STAGE_QUERY].count;
+    out << "=== 工作量计数 ===" << endl;
+    for (int c = 0; c < TRACE_COUNTER_COUNT; c++) {
+        snprintf(line, sizeof(line), "%-22s %14llu", counterName((TraceCounter)c), (unsigned long long)summary.counters[c]);
+        out << line;
+        if (queries > 0) {
+            snprintf(line, sizeof(line), "   每查询 %.1f", (double)summary.counters[c] / queries);
+            out << line;
+        }
+        out << endl;
+    }
+    uint64_t signature_checked = summary.counters[TRACE_SIGNATURE_CHECKED];
+    if (signature_checked > 0) {
+        snprintf(line, sizeof(line), "值签名跳过率 %.1f%%", 100.0 * summary.counters[TRACE_SIGNATURE_SKIPPED] / signature_checked);
+        out << line << endl;
+    }
+
+    double threshold_ms = getSlowQueryThresholdMs();
+    if (threshold_ms > 0) {
+        out << "慢查询trace: 阈值 " << threshold_ms << " ms，已导出 " << summary.slow_traces_written << " 个";
+        if (summary.slow_traces_dropped > 0) {
+            out << "，待写出过多丢弃 " << summary.slow_traces_dropped << " 个";
+        }
+        out << endl;
+    }
+    return out.str();
+}
+
+static string formatJsonDouble(double value) {
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%.3f", value);
+    return buffer;
+}
+
+string QueryProfiler::formatJson() {
+    TraceSummary summary = summarize();
+    string out = "{\"seconds\":" + formatJsonDouble(summary.seconds) + ",\"enabled\":" + (isEnabled() ? "true" : "false") + ",\"stages\":{";
+    bool first = true;
+    for (int s = 0; s < TRACE_STAGE_COUNT; s++) {
+        const StageSummary& stage = summary.stages[s];
+        if (!first) out += ",";
+        first = false;
+        out += string("\"") + stageName((TraceStage)s) + "\":{\"count\":" + to_string(stage.count) +
+               ",\"total_us\":" + formatJsonDouble(stage.total_us) +
+               ",\"p50_us\":" + formatJsonDouble(stage.p50_us) +
+               ",\"p90_us\":" + formatJsonDouble(stage.p90_us) +
+               ",\"p99_us\":" + formatJsonDouble(stage.p99_us) +
+               ",\"max_us\":" + formatJsonDouble(stage.max_us) + "}";
+    }
+    out += "},\"counters\":{";
+    for (int c = 0; c < TRACE_COUNTER_COUNT; c++) {
+        if (c > 0) out += ",";
+        out += string("\"") + counterName((TraceCounter)c) + "\":" + to_string(summary.counters[c]);
+    }
+    out += "},\"slow_traces_written\":" + to_string(summary.slow_traces_written) +
+           ",\"slow_traces_dropped\":" + to_string(summary.slow_traces_dropped) + "}";
+    return out;
+}
+
+void QueryProfiler::enqueueChromeTrace(unique_ptr<PendingChromeTrace> trace) {
+    {
+        lock_guard<mutex> lock(trace_writer_mutex);
+        if (trace_writer_stop) return;
+        if (pending_traces.size() >= MAX_PENDING_TRACES) {
+            slow_traces_dropped++;
+            return;
+        }
+        trace->sequence = ++slow_trace_sequence;
+        pending_traces.push_back(move(trace));
+        if (!trace_writer_thread.joinable()) {
+            trace_writer_thread = thread(&QueryProfiler::traceWriterLoop, this);
+        }
+    }
+    trace_writer_cv.notify_one();
+}
+
+void QueryProfiler::traceWriterLoop() {
+    unique_lock<mutex> lock(trace_writer_mutex);
+    while (true) {
+        trace_writer_cv.wait(lock, [this]() { return trace_writer_stop || !pending_traces.empty(); });
+        if (pending_traces.empty()) return;  // 停止且已写完
+        unique_ptr<PendingChromeTrace> trace = move(pending_traces.front());
+        pending_traces.pop_front();
+        lock.unlock();
+        writeChromeTrace(*trace);
+        lock.lock();
+    }
+}
+
+// 慢查询导出为Chrome trace-event格式（chrome://tracing 或 Perfetto 打开），在后台写出线程上执行
+void QueryProfiler::writeChromeTrace(const PendingChromeTrace& trace) {
+    double ns_per_tick = ticksToNanoseconds(1.0);
+    auto to_us = [&](uint64_t ticks) { return (double)(ticks - trace.start) * ns_per_tick / 1000.0; };
+
+    string directory;
+    {
+        lock_guard<mutex> lock(registry_mutex);
+        directory = trace_directory;
+    }
+    string filename = directory + "/approacher-trace-" + to_string(getpid()) + "-" + to_string(trace.sequence) + ".json";
+
+    string out = "{\"traceEvents\":[\n";
+    string tid = to_string(trace.thread_index);
+    out += "{\"name\":" + jsonEscape(trace.label) + ",\"ph\":\"X\",\"pid\":1,\"tid\":" + tid +
+           ",\"ts\":0,\"dur\":" + formatJsonDouble(to_us(trace.end)) + ",\"args\":{";
+    for (int c = 0; c < TRACE_COUNTER_COUNT; c++) {
+        if (c > 0) out += ",";
+        out += string("\"") + counterName((TraceCounter)c) + "\":" + to_string(trace.counter_deltas[c]);
+    }
+    out += ",\"dropped_events\":" + to_string(trace.dropped_events) + "}}";
+
+    for (const TraceEvent& event : trace.events) {
+        out += ",\n{\"name\":\"" + string(stageName(event.stage)) + "\",\"ph\":\"X\",\"pid\":1,\"tid\":" + tid +
+               ",\"ts\":" + formatJsonDouble(to_us(event.start)) +
+               ",\"dur\":" + formatJsonDouble((double)(event.end - event.start) * ns_per_tick / 1000.0) + "}";
+    }
+    out += "\n]}\n";
+
+    ofstream file(filename);
+    if (!file.is_open()) {
+        LOG_WARN("无法写出慢查询trace", {"file", filename});
+        return;
+    }
+    file << out;
+    slow_traces_written++;
+    LOG_INFO("慢查询trace已写出: " << filename, {"file", filename}, {"events", trace.events.size()});
+}
+
+QueryTraceScope::QueryTraceScope(const string& label) {
+    QueryProfiler& profiler = QueryProfiler::instance();
+    if (!profiler.isEnabled()) return;
+
+    ThreadTraceData& data = QueryProfiler::threadData();
+    if (data.in_query) return;  // 嵌套查询并入外层
+
+    data.in_query = true;
+    query = &data.query;
+    query->label = label;
+    query->events.clear();
+    query->dropped_events = 0;
+    query->record_events = profiler.slow_threshold_ticks.load(memory_order_relaxed) > 0;
+    for (int c = 0; c < TRACE_COUNTER_COUNT; c++) {
+        query->counters_at_start[c] = data.counters[c].load(memory_order_relaxed);
+    }
+    query->start = traceTicks();
+}
+
+QueryTraceScope::~QueryTraceScope() {
+    if (!query) return;
+
+    uint64_t end = traceTicks();
+    QueryProfiler::threadData().in_query = false;
+    QueryProfiler::recordStage(TRACE_STAGE_QUERY, query->start, end);
+
+    QueryProfiler& profiler = QueryProfiler::instance();
+    uint64_t threshold = profiler.slow_threshold_ticks.load(memory_order_relaxed);
+    if (query->record_events && threshold > 0 && end - query->start >= threshold) {
+        // 事件移交给后台写出线程，本线程不做序列化和文件I/O
+        const ThreadTraceData& data = QueryProfiler::threadData();
+        unique_ptr<PendingChromeTrace> trace(new PendingChromeTrace());
+        trace->label = query->label;
+        trace->thread_index = data.thread_index;
+        trace->start = query->start;
+        trace->end = end;
+        for (int c = 0; c < TRACE_COUNTER_COUNT; c++) {
+            trace->counter_deltas[c] = data.counters[c].load(memory_order_relaxed) - query->counters_at_start[c];
+        }
+        trace->events = move(query->events);
+        trace->dropped_events = query->dropped_events;
+        profiler.enqueueChromeTrace(move(trace));
+    }
+    query->events.clear();
+}
@@ -0,0 +1,224 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <deque>
+#include <memory>
+#include <chrono>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+using namespace std;
+
+// 查询流水线阶段（嵌套阶段的耗时包含在外层阶段中）
+enum TraceStage {
+    TRACE_STAGE_QUERY = 0,          // 一次完整的相似度查询
+    TRACE_STAGE_LOAD_CONCEPTS,      // 从ObjectBox分批读取并反序列化概念（ConceptStream）
+    TRACE_STAGE_EXACT_MATCH,        // 快照倒排索引上的精确匹配
+    TRACE_STAGE_FUZZY_MATCH,        // 逐概念模糊匹配（matchConceptFuzzy）
+    TRACE_STAGE_RECURSIVE_MATCH,    // 递归模糊匹配（每次递归调用记一次）
+    TRACE_STAGE_SIMILAR_VALUES,     // 相似值查找（findSimilarValues）
+    TRACE_STAGE_OVERLAP,            // 重合度等级统计
+    TRACE_STAGE_SCORING,            // 分相似度和主相似度计算
+    TRACE_STAGE_TOPK,               // Top-K概念检索
+    TRACE_STAGE_COUNT
+};
+
+// 工作量计数器
+enum TraceCounter {
+    TRACE_CONCEPTS_SCANNED = 0,     // 完整匹配或扫描过的概念数
+    TRACE_EDIT_DISTANCE_CALLS,      // 编辑距离计算次数
+    TRACE_DP_CELLS,                 // 编辑距离动态规划单元格数
+    TRACE_RECURSION_EXPANSIONS,     // 递归匹配中用相似值替换后展开的次数
+    TRACE_POSTINGS_TOUCHED,         // 读取的倒排列表项数
+    TRACE_SIGNATURE_CHECKED,        // 全量扫描中用值签名检查过的概念数
+    TRACE_SIGNATURE_SKIPPED,        // 其中签名不相交、直接跳过的概念数
+    TRACE_PLAN_SCAN,                // 查询计划选择全量扫描的次数（精确匹配的一侧）
+    TRACE_PLAN_PROBE,               // 查询计划选择探测另一侧匹配的次数
+    TRACE_PLAN_FUZZY_EXPAND,        // 查询计划选择相似值倒排展开的次数
+    TRACE_MATCH_CACHE_HITS,         // 一侧的匹配集合在匹配结果缓存中命中的次数
+    TRACE_MATCH_CACHE_MISSES,       // 未命中、重新匹配的次数
+    TRACE_SINGLE_FLIGHT_WAITS,      // 等待并发的相同匹配、自己没有匹配的次数
+    TRACE_COUNTER_COUNT
+};
+
+// 读取时间戳计数器（x86上为TSC，其他平台为steady_clock纳秒），换算在汇总时进行
+inline uint64_t traceTicks() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+// HDR风格的对数-线性直方图：每个2的幂区间再等分16格，相对误差不超过1/16
+// 只由所属线程写入（relaxed读改写，不加锁），其他线程可随时读取
+class LatencyHistogram {
+public:
+    static const int SUB_BUCKET_BITS = 4;
+    static const int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    static const int MAX_EXPONENT = 44;  // 超过2^44个tick的值计入最后一格
+    static const int BUCKET_COUNT = (MAX_EXPONENT - SUB_BUCKET_BITS + 2) * SUB_BUCKETS;
+
+    void record(uint64_t ticks) {
+        atomic<uint64_t>& bucket = buckets[bucketIndex(ticks)];
+        bucket.store(bucket.load(memory_order_relaxed) + 1, memory_order_relaxed);
+    }
+
+    uint64_t bucketCount(int index) const { return buckets[index].load(memory_order_relaxed); }
+
+    static int bucketIndex(uint64_t ticks);
+    static uint64_t bucketLowerBound(int index);
+    static uint64_t bucketUpperBound(int index);
+
+private:
+    atomic<uint64_t> buckets[BUCKET_COUNT] = {};
+};
+
+// 单个阶段的汇总（时间单位：微秒）
+struct StageSummary {
+    uint64_t count = 0;
+    double total_us = 0.0;
+    double p50_us = 0.0;
+    double p90_us = 0.0;
+    double p99_us = 0.0;
+    double max_us = 0.0;
+};
+
+// 全部阶段和计数器的汇总
+struct TraceSummary {
+    StageSummary stages[TRACE_STAGE_COUNT];
+    uint64_t counters[TRACE_COUNTER_COUNT] = {};
+    uint64_t slow_traces_written = 0;
+    uint64_t slow_traces_dropped = 0;  // 待写出的trace过多时丢弃的个数
+    double seconds = 0.0;  // 统计时长（自启动或上次reset）
+};
+
+struct ThreadTraceData;
+struct ActiveQueryTrace;
+struct TraceTotals;
+struct PendingChromeTrace;
+
+// 查询性能剖析器（进程内单例）
+// 每个线程有自己的直方图和计数器，汇总时合并；慢查询可导出为Chrome trace-event JSON
+// 环境变量: APPROACHER_TRACE=0 关闭计时
+//          APPROACHER_TRACE_SLOW_MS=<毫秒> 超过该耗时的查询导出trace
+//          APPROACHER_TRACE_DIR=<目录>（默认/tmp）
+class QueryProfiler {
+private:
+    atomic<bool> enabled;
+    atomic<uint64_t> slow_threshold_ticks;  // 0表示不导出
+    atomic<uint64_t> slow_traces_written;
+    atomic<uint64_t> slow_traces_dropped{0};
+    atomic<uint64_t> slow_trace_sequence{0};   // trace文件编号（reset不清零，避免覆盖之前的文件）
+
+    mutex registry_mutex;
+    vector<ThreadTraceData*> threads;          // 活跃线程的数据
+    TraceTotals* retired = nullptr;            // 已退出线程合并后的数据
+    TraceTotals* baseline = nullptr;           // reset时的快照，汇总时扣除
+    int next_thread_index = 1;
+    string trace_directory = "/tmp";
+
+    // tick与纳秒的换算基准：构造时由间隔约50微秒的两次采样得到初值，
+    // 运行10毫秒以后改用启动以来的累计比值（越久越准确），换算时不等待
+    uint64_t start_ticks = 0;
+    chrono::steady_clock::time_point start_time;
+    chrono::steady_clock::time_point reset_time;
+    double initial_ns_per_tick = 1.0;
+
+    // 慢查询trace由后台线程序列化并写文件（第一次导出时启动），查询线程只移交事件
+    static const size_t MAX_PENDING_TRACES = 64;
+    mutex trace_writer_mutex;
+    condition_variable trace_writer_cv;
+    deque<unique_ptr<PendingChromeTrace>> pending_traces;
+    thread trace_writer_thread;
+    bool trace_writer_stop = false;
+
+    QueryProfiler();
+    ~QueryProfiler();
+
+    void collect(TraceTotals& totals);  // 调用方持有registry_mutex
+    void enqueueChromeTrace(unique_ptr<PendingChromeTrace> trace);
+    void traceWriterLoop();
+    void writeChromeTrace(const PendingChromeTrace& trace);
+
+    friend struct ThreadTraceData;
+    friend class QueryTraceScope;
+
+public:
+    QueryProfiler(const QueryProfiler&) = delete;
+    QueryProfiler& operator=(const QueryProfiler&) = delete;
+
+    static QueryProfiler& instance();
+
+    bool isEnabled() const { return enabled.load(memory_order_relaxed); }
+    void setEnabled(bool value);
+
+    // 耗时不少于threshold_ms的查询写出Chrome trace文件；threshold_ms <= 0 关闭
+    void setSlowQueryTrace(double threshold_ms, const string& directory = "");
+    double getSlowQueryThresholdMs();
+
+    // tick换算为纳秒
+    double ticksToNanoseconds(double ticks);
+
+    // 汇总所有线程（含已退出线程）的统计
+    TraceSummary summarize();
+
+    // 从当前时刻重新开始统计
+    void reset();
+
+    // 人类可读的表格和机器可读的JSON
+    string formatText();
+    string formatJson();
+
+    static const char* stageName(TraceStage stage);
+    static const char* counterName(TraceCounter counter);
+
+    // 供计时器和计数函数使用
+    static ThreadTraceData& threadData();
+    static void recordStage(TraceStage stage, uint64_t start_ticks, uint64_t end_ticks);
+};
+
+// 增加当前线程的计数器
+void traceCount(TraceCounter counter, uint64_t amount = 1);
+
+// 作用域计时器：构造时读TSC，析构时记入阶段直方图（处于查询跟踪中时同时记录trace事件）
+class ScopedStageTimer {
+private:
+    TraceStage stage;
+    uint64_t start;
+    bool active;
+
+public:
+    explicit ScopedStageTimer(TraceStage trace_stage)
+        : stage(trace_stage), start(0), active(QueryProfiler::instance().isEnabled()) {
+        if (active) start = traceTicks();
+    }
+    ~ScopedStageTimer() {
+        if (active) QueryProfiler::recordStage(stage, start, traceTicks());
+    }
+
+    ScopedStageTimer(const ScopedStageTimer&) = delete;
+    ScopedStageTimer& operator=(const ScopedStageTimer&) = delete;
+};
+
+// 一次顶层查询的跟踪范围：记录本线程在范围内的阶段事件和计数器增量，
+// 结束时记入TRACE_STAGE_QUERY，超过慢查询阈值时导出Chrome trace（嵌套使用时只有最外层生效）
+class QueryTraceScope {
+private:
+    ActiveQueryTrace* query = nullptr;
+
+public:
+    explicit QueryTraceScope(const string& label = "similarity");
+    ~QueryTraceScope();
+
+    QueryTraceScope(const QueryTraceScope&) = delete;
+    QueryTraceScope& operator=(const QueryTraceScope&) = delete;
+};
@@ -0,0 +1,317 @@
+#include "ReferenceEngine.hpp"
+#include <set>
+#include <cmath>
+#include <algorithm>
+
+using namespace std;
+
+ReferenceEngine::ReferenceEngine(vector<Concept> library) : concepts(move(library)) {
+    sort(concepts.begin(), concepts.end(),
+         [](const Concept& a, const Concept& b) { return a.id < b.id; });
+}
+
+int ReferenceEngine::stringDistance(const string& str1, const string& str2) {
+    int m = str1.length();
+    int n = str2.length();
+    vector<vector<int>> dp(m + 1, vector<int>(n + 1));
+
+    for (int i = 0; i <= m; i++) dp[i][0] = i;
+    for (int j = 0; j <= n; j++) dp[0][j] = j;
+
+    for (int i = 1; i <= m; i++) {
+        for (int j = 1; j <= n; j++) {
+            if (str1[i-1] == str2[j-1]) {
+                dp[i][j] = dp[i-1][j-1];
+            } else {
+                dp[i][j] = 1 + min({dp[i-1][j], dp[i][j-1], dp[i-1][j-1]});
+            }
+        }
+    }
+    return dp[m][n];
+}
+
+double ReferenceEngine::stringSimilarity(const string& str1, const string& str2) {
+    if (str1.empty() && str2.empty()) return 1.0;
+    if (str1.empty() || str2.empty()) return 0.0;
+
+    int edit_distance = stringDistance(str1, str2);
+    int max_length = max(str1.length(), str2.length());
+    return 1.0 - (double)edit_distance / max_length;
+}
+
+MatchResult ReferenceEngine::matchConceptExact(const vector<Feature>& input_features, const Concept& concept) {
+    MatchResult result(concept.id, 0);
+
+    // 第一步：单个特征匹配（无键特征只比较值，有键特征要求键和值都相同）
+    for (size_t i = 0; i < input_features.size(); i++) {
+        const Feature& input_feature = input_features[i];
+        bool matched = false;
+        for (size_t j = 0; j < concept.feature_values.size(); j++) {
+            bool key_ok = input_feature.key.empty() || concept.feature_keys[j] == input_feature.key;
+            if (key_ok && concept.feature_values[j] == input_feature.value) {
+                matched = true;
+                break;
+            }
+        }
+        if (matched) {
+            result.match_count++;
+            result.matched_indices.push_back(i);
+        }
+    }
+
+    // 第二步：复合词匹配。尚未匹配的非空无键特征（最多前10个）按原顺序取长度≥2的子集，
+    // 以"_"连接后与概念的值比较；子集按位掩码从小到大枚举，命中时新匹配的特征依次记入
+    vector<int> fuzzy_indices;
+    for (size_t i = 0; i < input_features.size(); i++) {
+        bool already = find(result.matched_indices.begin(), result.matched_indices.end(), (int)i) != result.matched_indices.end();
+        if (input_features[i].key.empty() && !already && !input_features[i].value.empty()) {
+            fuzzy_indices.push_back(i);
+        }
+    }
+    if (fuzzy_indices.size() < 2) {
+        return result;  // 只有第一步的匹配，下标已是升序
+    }
+
+    int n = min<int>(fuzzy_indices.size(), 10);
+    for (int mask = 1; mask < (1 << n); mask++) {
+        vector<int> subset;
+        for (int i = 0; i < n; i++) {
+            if (mask & (1 << i)) subset.push_back(fuzzy_indices[i]);
+        }
+        if (subset.size() < 2) continue;
+
+        string compound_word;
+        for (size_t i = 0; i < subset.size(); i++) {
+            if (i > 0) compound_word += "_";
+            compound_word += input_features[subset[i]].value;
+        }
+
+        if (find(concept.feature_values.begin(), concept.feature_values.end(), compound_word) == concept.feature_values.end()) {
+            continue;
+        }
+        for (int index : subset) {
+            if (find(result.matched_indices.begin(), result.matched_indices.end(), index) == result.matched_indices.end()) {
+                result.matched_indices.push_back(index);
+                result.match_count++;
+            }
+        }
+    }
+
+    // 匹配的特征下标按升序给出
+    sort(result.matched_indices.begin(), result.matched_indices.end());
+    return result;
+}
+
+MatchResult ReferenceEngine::matchConceptFuzzy(const vector<Feature>& input_features, const Concept& concept, double fuzzy_threshold) {
+    MatchResult result(concept.id, 0);
+
+    for (size_t i = 0; i < input_features.size(); i++) {
+        const Feature& input_feature = input_features[i];
+        bool matched = false;
+        for (size_t j = 0; j < concept.feature_values.size(); j++) {
+            if (!input_feature.key.empty() && concept.feature_keys[j] != input_feature.key) continue;
+            // 相似度为0的值不算匹配（阈值≤0时也一样）
+            double similarity = stringSimilarity(input_feature.value, concept.feature_values[j]);
+            if (similarity >= fuzzy_threshold && similarity > 0.0) {
+                matched = true;
+                break;
+            }
+        }
+        if (matched) {
+            result.match_count++;
+            result.matched_indices.push_back(i);
+        }
+    }
+
+    return result;
+}
+
+int ReferenceEngine::matchLevel(int matched_features, int total_features) {
+    if (total_features == 0 || matched_features <= 0) return 1;
+
+    double match_percentage = (double)matched_features / total_features * 100.0;
+    if (match_percentage <= 20.0) return 1;
+    if (match_percentage <= 40.0) return 2;
+    if (match_percentage <= 60.0) return 3;
+    if (match_percentage <= 80.0) return 4;
+    return 5;
+}
+
+vector<MatchResult> ReferenceEngine::findMatchingConcepts(const vector<Feature>& input_features) const {
+    vector<MatchResult> results;
+    for (const Concept& concept : concepts) {
+        MatchResult result = matchConceptExact(input_features, concept);
+        if (result.match_count > 0) {
+            results.push_back(result);
+        }
+    }
+    return results;
+}
+
+vector<MatchResult> ReferenceEngine::fuzzyMatch(const vector<Feature>& input_features, double fuzzy_threshold) const {
+    vector<MatchResult> results;
+    for (const Concept& concept : concepts) {
+        MatchResult result = matchConceptFuzzy(input_features, concept, fuzzy_threshold);
+        if (result.match_count > 0) {
+            results.push_back(result);
+        }
+    }
+    return results;
+}
+
+vector<pair<string, double>> ReferenceEngine::findSimilarValues(const string& query_value, double min_similarity) const {
+    set<string> unique_values;
+    for (const Concept& concept : concepts) {
+        unique_values.insert(concept.feature_values.begin(), concept.feature_values.end());
+    }
+
+    vector<pair<string, double>> similar_values;
+    for (const string& value : unique_values) {
+        double similarity = stringSimilarity(query_value, value);
+        if (similarity >= min_similarity) {
+            similar_values.push_back(make_pair(value, similarity));
+        }
+    }
+    // 同相似度的值保持字典序
+    stable_sort(similar_values.begin(), similar_values.end(),
+                [](const pair<string, double>& a, const pair<string, double>& b) { return a.second > b.second; });
+    return similar_values;
+}
+
+vector<MatchResult> ReferenceEngine::recursiveMatch(const vector<Feature>& input_features, int max_depth, double fuzzy_threshold) const {
+    vector<MatchResult> results;
+
+    for (const Concept& concept : concepts) {
+        MatchResult direct_match = matchConceptFuzzy(input_features, concept, fuzzy_threshold);
+        if (direct_match.match_count > 0) {
+            results.push_back(direct_match);
+            continue;
+        }
+        if (max_depth <= 1) continue;
+
+        // 直接匹配失败：依次把某个输入值（所有相同的值一起）替换成库中的相似值，
+        // 第一个能递归匹配到概念的替换被采用，匹配数减半（至少为1）
+        bool found_recursive_match = false;
+        for (const Feature& input_feature : input_features) {
+            if (found_recursive_match) break;
+
+            for (const auto& similar_pair : findSimilarValues(input_feature.value, fuzzy_threshold)) {
+                vector<Feature> modified_features = input_features;
+                for (Feature& feature : modified_features) {
+                    if (feature.value == input_feature.value) {
+                        feature.value = similar_pair.first;
+                    }
+                }
+
+                vector<MatchResult> recursive_results = recursiveMatch(modified_features, max_depth - 1, fuzzy_threshold);
+                if (!recursive_results.empty()) {
+                    for (MatchResult& recursive_result : recursive_results) {
+                        recursive_result.match_count = max(1, recursive_result.match_count / 2);
+                        results.push_back(recursive_result);
+                    }
+                    found_recursive_match = true;
+                    break;
+                }
+            }
+        }
+    }
+
+    // 每个概念只保留匹配数最大的一项，按ID升序
+    map<obx_id, MatchResult> best;
+    for (const MatchResult& result : results) {
+        auto it = best.find(result.concept_id);
+        if (it == best.end() || result.match_count > it->second.match_count) {
+            best[result.concept_id] = result;
+        }
+    }
+    vector<MatchResult> deduplicated;
+    for (auto& entry : best) {
+        deduplicated.push_back(entry.second);
+    }
+    return deduplicated;
+}
+
+vector<MatchResult> ReferenceEngine::match(const vector<Feature>& input_features, const SimilarityOptions& options) const {
+    if (!options.use_fuzzy_matching) {
+        return findMatchingConcepts(input_features);
+    }
+    if (options.max_recursive_depth > 1) {
+        return recursiveMatch(input_features, options.max_recursive_depth, options.fuzzy_threshold);
+    }
+    return fuzzyMatch(input_features, options.fuzzy_threshold);
+}
+
+map<pair<int,int>, int> ReferenceEngine::analyzeOverlap(const vector<MatchResult>& matches_A, const vector<MatchResult>& matches_B, int total_features_A, int total_features_B, int& total_matches) {
+    map<pair<int,int>, int> overlap_map;
+    total_matches = 0;
+    for (const MatchResult& match_A : matches_A) {
+        for (const MatchResult& match_B : matches_B) {
+            if (match_A.concept_id != match_B.concept_id) continue;
+            int level_A = matchLevel(match_A.match_count, total_features_A);
+            int level_B = matchLevel(match_B.match_count, total_features_B);
+            overlap_map[make_pair(level_A, level_B)]++;
+            total_matches++;
+            break;
+        }
+    }
+    return overlap_map;
+}
+
+double ReferenceEngine::partialSimilarity(const map<pair<int,int>, int>& overlap_map, int divisor, const unordered_map<string, double>& params) {
+    if (divisor == 0) return 0.0;
+
+    double weighted_sum = 0.0;
+    for (const auto& entry : overlap_map) {
+        string param_key = "p" + to_string(entry.first.first) + to_string(entry.first.second);
+        auto it = params.find(param_key);
+        double param_value = it != params.end() ? it->second : 1.0;
+        weighted_sum += entry.second * param_value;
+    }
+    return weighted_sum / divisor;
+}
+
+double ReferenceEngine::calculateMainSimilarity(const vector<Feature>& features_A, const vector<Feature>& features_B, const unordered_map<string, double>& params) const {
+    vector<MatchResult> matches_A = findMatchingConcepts(features_A);
+    vector<MatchResult> matches_B = findMatchingConcepts(features_B);
+
+    int total_matches = 0;
+    auto overlap_map = analyzeOverlap(matches_A, matches_B, features_A.size(), features_B.size(), total_matches);
+    if (total_matches == 0) return 0.0;
+
+    // B的视角：交换等级对
+    map<pair<int,int>, int> overlap_map_B;
+    for (const auto& entry : overlap_map) {
+        overlap_map_B[make_pair(entry.first.second, entry.first.first)] = entry.second;
+    }
+
+    double partial_A = partialSimilarity(overlap_map, matches_A.size(), params);
+    double partial_B = partialSimilarity(overlap_map_B, matches_B.size(), params);
+    return sqrt(partial_A * partial_B);
+}
+
+SimilarityResult ReferenceEngine::computeSimilarity(const vector<Feature>& features_A, const vector<Feature>& features_B, const SimilarityOptions& options, const unordered_map<string, double>& params) const {
+    SimilarityResult result;
+    vector<MatchResult> matches_A = match(features_A, options);
+    vector<MatchResult> matches_B = match(features_B, options);
+
+    int total_matches = 0;
+    auto overlap_map = analyzeOverlap(matches_A, matches_B, features_A.size(), features_B.size(), total_matches);
+    map<pair<int,int>, int> overlap_map_B;
+    for (const auto& entry : overlap_map) {
+        result.histogram.level_counts[entry.first.first - 1][entry.first.second - 1] = entry.second;
+        overlap_map_B[make_pair(entry.first.second, entry.first.first)] = entry.second;
+    }
+
+    result.matches_A_count = matches_A.size();
+    result.matches_B_count = matches_B.size();
+    result.total_matches = total_matches;
+    result.histogram.matches_A_count = result.matches_A_count;
+    result.histogram.matches_B_count = result.matches_B_count;
+    result.histogram.total_matches = total_matches;
+
+    result.partial_a_to_b = partialSimilarity(overlap_map, matches_A.size(), params);
+    result.partial_b_to_a = partialSimilarity(overlap_map_B, matches_B.size(), params);
+    // 主相似度总是基于精确匹配
+    result.main_similarity = calculateMainSimilarity(features_A, features_B, params);
+    return result;
+}
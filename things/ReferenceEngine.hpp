@@ -0,0 +1,65 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <map>
+#include <unordered_map>
+#include "ConceptDatabase.hpp"
+
+using namespace std;
+
+// 参考引擎：核心匹配和相似度函数最直接的实现，作为差分测试的基准
+// 概念库是内存中的概念列表（按ID升序），每次查询都完整扫描，不使用倒排索引、快照、直方图或缓存
+// 语义以最初的实现为准：ConceptDatabase中的优化实现必须与这里给出完全相同的结果
+// 这里的代码只追求简单可读，不要为了性能修改它
+class ReferenceEngine {
+private:
+    vector<Concept> concepts;
+
+public:
+    explicit ReferenceEngine(vector<Concept> library);
+
+    const vector<Concept>& getConcepts() const { return concepts; }
+
+    // 编辑距离：完整的(m+1)×(n+1)动态规划矩阵
+    static int stringDistance(const string& str1, const string& str2);
+
+    // 字符串相似度 = 1 - 编辑距离 / 较长字符串长度
+    static double stringSimilarity(const string& str1, const string& str2);
+
+    // 单个概念的精确匹配（含无键特征的复合词匹配），匹配的特征下标为升序
+    static MatchResult matchConceptExact(const vector<Feature>& input_features, const Concept& concept);
+
+    // 单个概念的模糊匹配
+    static MatchResult matchConceptFuzzy(const vector<Feature>& input_features, const Concept& concept, double fuzzy_threshold);
+
+    // 重合度等级（1-5）
+    static int matchLevel(int matched_features, int total_features);
+
+    // 精确匹配：逐个概念调用matchConceptExact，保留匹配数大于0的概念
+    vector<MatchResult> findMatchingConcepts(const vector<Feature>& input_features) const;
+
+    // 深度为1的模糊匹配：逐个概念调用matchConceptFuzzy
+    vector<MatchResult> fuzzyMatch(const vector<Feature>& input_features, double fuzzy_threshold) const;
+
+    // 相似值查找：全部不重复的值中相似度不低于min_similarity的，按相似度降序
+    vector<pair<string, double>> findSimilarValues(const string& query_value, double min_similarity) const;
+
+    // 递归模糊匹配
+    vector<MatchResult> recursiveMatch(const vector<Feature>& input_features, int max_depth, double fuzzy_threshold) const;
+
+    // 按选项匹配（与ConceptDatabase::findMatchingConcepts的模糊匹配重载语义相同）
+    vector<MatchResult> match(const vector<Feature>& input_features, const SimilarityOptions& options) const;
+
+    // 重合度等级统计：(A等级, B等级) → 重合概念数
+    static map<pair<int,int>, int> analyzeOverlap(const vector<MatchResult>& matches_A, const vector<MatchResult>& matches_B, int total_features_A, int total_features_B, int& total_matches);
+
+    // 分相似度：Σ 重合概念数 × pij / divisor
+    static double partialSimilarity(const map<pair<int,int>, int>& overlap_map, int divisor, const unordered_map<string, double>& params);
+
+    // 主相似度：精确匹配下两个方向分相似度的几何平均
+    double calculateMainSimilarity(const vector<Feature>& features_A, const vector<Feature>& features_B, const unordered_map<string, double>& params) const;
+
+    // 完整的相似度计算（直方图按重合度等级统计填入）
+    SimilarityResult computeSimilarity(const vector<Feature>& features_A, const vector<Feature>& features_B, const SimilarityOptions& options, const unordered_map<string, double>& params) const;
+};
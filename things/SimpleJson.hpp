@@ -0,0 +1,216 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <cstdlib>
+#include <cstdio>
+
+using namespace std;
+
+// 极简JSON值（用于JSONL导入等行级数据交换，不追求完整性）
+struct JsonValue {
+    enum Type { JSON_NULL, JSON_BOOL, JSON_NUMBER, JSON_STRING, JSON_ARRAY, JSON_OBJECT };
+
+    Type type = JSON_NULL;
+    bool bool_value = false;
+    double number_value = 0.0;
+    string string_value;
+    vector<JsonValue> array_items;
+    map<string, JsonValue> object_items;
+
+    bool isNull() const { return type == JSON_NULL; }
+    bool isNumber() const { return type == JSON_NUMBER; }
+    bool isString() const { return type == JSON_STRING; }
+    bool isArray() const { return type == JSON_ARRAY; }
+    bool isObject() const { return type == JSON_OBJECT; }
+
+    // 查找对象成员，不存在时返回nullptr
+    const JsonValue* get(const string& key) const {
+        if (type != JSON_OBJECT) return nullptr;
+        auto it = object_items.find(key);
+        return it != object_items.end() ? &it->second : nullptr;
+    }
+};
+
+// JSON解析器：失败时parse返回false，error说明原因
+class JsonParser {
+private:
+    const string& text;
+    size_t pos = 0;
+
+    void skipWhitespace() {
+        while (pos < text.size() && (text[pos] == ' ' || text[pos] == '\t' || text[pos] == '\r' || text[pos] == '\n')) {
+            pos++;
+        }
+    }
+
+    bool parseString(string& out) {
+        if (pos >= text.size() || text[pos] != '"') return false;
+        pos++;
+        out.clear();
+        while (pos < text.size()) {
+            char c = text[pos++];
+            if (c == '"') return true;
+            if (c != '\\') {
+                out += c;
+                continue;
+            }
+            if (pos >= text.size()) return false;
+            char esc = text[pos++];
+            switch (esc) {
+                case '"': out += '"'; break;
+                case '\\': out += '\\'; break;
+                case '/': out += '/'; break;
+                case 'b': out += '\b'; break;
+                case 'f': out += '\f'; break;
+                case 'n': out += '\n'; break;
+                case 'r': out += '\r'; break;
+                case 't': out += '\t'; break;
+                case 'u': {
+                    if (pos + 4 > text.size()) return false;
+                    unsigned int code = strtoul(text.substr(pos, 4).c_str(), nullptr, 16);
+                    pos += 4;
+                    // 代理对合并为一个码点
+                    if (code >= 0xD800 && code <= 0xDBFF && pos + 6 <= text.size() &&
+                        text[pos] == '\\' && text[pos + 1] == 'u') {
+                        unsigned int low = strtoul(text.substr(pos + 2, 4).c_str(), nullptr, 16);
+                        if (low >= 0xDC00 && low <= 0xDFFF) {
+                            code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                            pos += 6;
+                        }
+                    }
+                    appendUtf8(out, code);
+                    break;
+                }
+                default: return false;
+            }
+        }
+        return false;
+    }
+
+    static void appendUtf8(string& out, unsigned int code) {
+        if (code < 0x80) {
+            out += (char)code;
+        } else if (code < 0x800) {
+            out += (char)(0xC0 | (code >> 6));
+            out += (char)(0x80 | (code & 0x3F));
+        } else if (code < 0x10000) {
+            out += (char)(0xE0 | (code >> 12));
+            out += (char)(0x80 | ((code >> 6) & 0x3F));
+            out += (char)(0x80 | (code & 0x3F));
+        } else {
+            out += (char)(0xF0 | (code >> 18));
+            out += (char)(0x80 | ((code >> 12) & 0x3F));
+            out += (char)(0x80 | ((code >> 6) & 0x3F));
+            out += (char)(0x80 | (code & 0x3F));
+        }
+    }
+
+    bool parseValue(JsonValue& out, int depth) {
+        if (depth > 64) return false;
+        skipWhitespace();
+        if (pos >= text.size()) return false;
+
+        char c = text[pos];
+        if (c == '{') {
+            out.type = JsonValue::JSON_OBJECT;
+            pos++;
+            skipWhitespace();
+            if (pos < text.size() && text[pos] == '}') { pos++; return true; }
+            while (true) {
+                skipWhitespace();
+                string key;
+                if (!parseString(key)) return false;
+                skipWhitespace();
+                if (pos >= text.size() || text[pos] != ':') return false;
+                pos++;
+                if (!parseValue(out.object_items[key], depth + 1)) return false;
+                skipWhitespace();
+                if (pos < text.size() && text[pos] == ',') { pos++; continue; }
+                if (pos < text.size() && text[pos] == '}') { pos++; return true; }
+                return false;
+            }
+        } else if (c == '[') {
+            out.type = JsonValue::JSON_ARRAY;
+            pos++;
+            skipWhitespace();
+            if (pos < text.size() && text[pos] == ']') { pos++; return true; }
+            while (true) {
+                out.array_items.emplace_back();
+                if (!parseValue(out.array_items.back(), depth + 1)) return false;
+                skipWhitespace();
+                if (pos < text.size() && text[pos] == ',') { pos++; continue; }
+                if (pos < text.size() && text[pos] == ']') { pos++; return true; }
+                return false;
+            }
+        } else if (c == '"') {
+            out.type = JsonValue::JSON_STRING;
+            return parseString(out.string_value);
+        } else if (text.compare(pos, 4, "true") == 0) {
+            out.type = JsonValue::JSON_BOOL;
+            out.bool_value = true;
+            pos += 4;
+            return true;
+        } else if (text.compare(pos, 5, "false") == 0) {
+            out.type = JsonValue::JSON_BOOL;
+            pos += 5;
+            return true;
+        } else if (text.compare(pos, 4, "null") == 0) {
+            out.type = JsonValue::JSON_NULL;
+            pos += 4;
+            return true;
+        } else {
+            const char* start = text.c_str() + pos;
+            char* end = nullptr;
+            out.number_value = strtod(start, &end);
+            if (end == start) return false;
+            out.type = JsonValue::JSON_NUMBER;
+            pos += end - start;
+            return true;
+        }
+    }
+
+public:
+    explicit JsonParser(const string& input) : text(input) {}
+
+    bool parse(JsonValue& out, string& error) {
+        pos = 0;
+        out = JsonValue();
+        if (!parseValue(out, 0)) {
+            error = "JSON格式错误，位置 " + to_string(pos);
+            return false;
+        }
+        skipWhitespace();
+        if (pos != text.size()) {
+            error = "JSON末尾有多余内容，位置 " + to_string(pos);
+            return false;
+        }
+        return true;
+    }
+};
+
+// 将字符串转义为JSON字符串字面量（含引号）
+inline string jsonEscape(const string& input) {
+    string out = "\"";
+    for (unsigned char c : input) {
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (c < 0x20) {
+                    char buffer[8];
+                    snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+                    out += buffer;
+                } else {
+                    out += (char)c;
+                }
+        }
+    }
+    out += "\"";
+    return out;
+}
@@ -0,0 +1,264 @@
+#include "SnapshotFile.hpp"
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <cstddef>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+static size_t roundUpToPage(size_t size) {
+    return (size + SNAPSHOT_PAGE_SIZE - 1) / SNAPSHOT_PAGE_SIZE * SNAPSHOT_PAGE_SIZE;
+}
+
+// 各段的元素大小（检查段长度是否为整数个元素）
+static size_t sectionElementSize(int id) {
+    switch (id) {
+        case SECTION_CONCEPT_IDS:
+        case SECTION_SIGNATURES:      return sizeof(uint64_t);
+        case SECTION_POSTING_LISTS:   return sizeof(PostingList);
+        case SECTION_POSTING_SKIPS:   return sizeof(CompressedPostings::SkipEntry);
+        case SECTION_POSTING_BYTES:
+        case SECTION_TERM_BYTES:      return 1;
+        default:                      return sizeof(uint32_t);
+    }
+}
+
+uint64_t snapshotChecksum(const void* data, size_t size) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    uint64_t hash = 0x9E3779B97F4A7C15ULL ^ size;
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        memcpy(&word, bytes + i, 8);
+        hash = (hash ^ word) * 0xFF51AFD7ED558CCDULL;
+        hash ^= hash >> 29;
+    }
+    uint64_t tail = 0;
+    memcpy(&tail, bytes + i, size - i);
+    hash = (hash ^ tail) * 0xC4CEB9FE1A85EC53ULL;
+    return hash ^ (hash >> 32);
+}
+
+static uint64_t headerChecksum(const SnapshotFileHeader& header) {
+    return snapshotChecksum(&header, offsetof(SnapshotFileHeader, header_checksum));
+}
+
+shared_ptr<SnapshotImage> SnapshotImage::allocate(const size_t section_sizes[SNAPSHOT_SECTION_COUNT]) {
+    SnapshotFileHeader layout{};
+    size_t offset = SNAPSHOT_PAGE_SIZE;
+    for (int id = 0; id < SNAPSHOT_SECTION_COUNT; id++) {
+        layout.sections[id].offset = offset;
+        layout.sections[id].size = section_sizes[id];
+        offset = roundUpToPage(offset + section_sizes[id]);
+    }
+
+    shared_ptr<SnapshotImage> image(new SnapshotImage());
+    image->bytes = static_cast<uint8_t*>(aligned_alloc(SNAPSHOT_PAGE_SIZE, offset));
+    if (!image->bytes) throw bad_alloc();
+    image->length = offset;
+    memset(image->bytes, 0, offset);  // 段间填充为0，导出的文件内容确定
+
+    SnapshotFileHeader& header = image->mutableHeader();
+    header = layout;
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.format_version = SNAPSHOT_FORMAT_VERSION;
+    header.byte_order = SNAPSHOT_BYTE_ORDER;
+    header.page_size = SNAPSHOT_PAGE_SIZE;
+    header.section_count = SNAPSHOT_SECTION_COUNT;
+    header.file_size = offset;
+    return image;
+}
+
+// 检查文件头：只读第一页，与文件大小无关
+static bool validateHeader(const uint8_t* data, size_t size, string& error) {
+    if (size < sizeof(SnapshotFileHeader)) {
+        error = "文件太短";
+        return false;
+    }
+    const SnapshotFileHeader& header = *reinterpret_cast<const SnapshotFileHeader*>(data);
+    if (memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) != 0) {
+        error = "不是快照文件";
+        return false;
+    }
+    if (header.byte_order != SNAPSHOT_BYTE_ORDER) {
+        error = "字节序与本机不同";
+        return false;
+    }
+    if (header.format_version != SNAPSHOT_FORMAT_VERSION) {
+        error = "格式版本 " + to_string(header.format_version) + " 不受支持（当前为 " + to_string(SNAPSHOT_FORMAT_VERSION) + "）";
+        return false;
+    }
+    if (header.header_checksum != headerChecksum(header)) {
+        error = "文件头校验和不符";
+        return false;
+    }
+    if (header.page_size != SNAPSHOT_PAGE_SIZE || header.section_count != SNAPSHOT_SECTION_COUNT || header.file_size != size) {
+        error = "文件头与文件不符（文件可能被截断）";
+        return false;
+    }
+    for (int id = 0; id < SNAPSHOT_SECTION_COUNT; id++) {
+        const SnapshotSectionEntry& entry = header.sections[id];
+        if (entry.offset % SNAPSHOT_PAGE_SIZE != 0 || entry.offset > size || entry.size > size - entry.offset ||
+            entry.size % sectionElementSize(id) != 0) {
+            error = "第 " + to_string(id) + " 段的范围无效";
+            return false;
+        }
+    }
+
+    // 各列长度与概念数、特征数一致，散列表槽数为2的幂且有空槽
+    auto count = [&header](int id) { return header.sections[id].size / sectionElementSize(id); };
+    uint64_t slots = count(SECTION_TERM_SLOTS);
+    if (count(SECTION_CONCEPT_IDS) != header.concept_count || count(SECTION_SIGNATURES) != header.concept_count ||
+        count(SECTION_FEATURE_OFFSETS) != header.concept_count + 1 ||
+        count(SECTION_POSTING_LISTS) != header.feature_id_count ||
+        count(SECTION_TERM_OFFSETS) != (uint64_t)header.feature_id_count + 1 ||
+        slots == 0 || (slots & (slots - 1)) != 0 || slots <= header.feature_id_count) {
+        error = "各段长度与概念数或特征数不一致";
+        return false;
+    }
+    return true;
+}
+
+// 检查各段之间的引用（只读偏移数组、倒排列表描述项、跳表和散列表，不解码差值）：
+// 偏移数组单调且不超出所指的段，倒排列表描述项指向跳表段和差值段之内，散列表槽中为有效特征ID且有空槽
+bool SnapshotImage::verifyStructure(string& error) const {
+    const SnapshotImage& image = *this;
+    const SnapshotFileHeader& header = image.header();
+    auto monotonic = [](const SnapshotArray<uint32_t>& offsets, size_t limit) {
+        if (offsets.size() == 0 || offsets[0] != 0) return false;
+        for (size_t i = 1; i < offsets.size(); i++) {
+            if (offsets[i] < offsets[i - 1]) return false;
+        }
+        return offsets[offsets.size() - 1] <= limit;
+    };
+
+    SnapshotArray<uint32_t> feature_offsets = image.section<uint32_t>(SECTION_FEATURE_OFFSETS);
+    SnapshotArray<uint32_t> feature_ids = image.section<uint32_t>(SECTION_FEATURE_IDS);
+    if (!monotonic(feature_offsets, feature_ids.size())) {
+        error = "特征偏移不单调或超出特征ID段";
+        return false;
+    }
+    for (size_t i = 0; i < feature_ids.size(); i++) {
+        if (feature_ids[i] >= header.feature_id_count) {
+            error = "特征ID段中有超出范围的特征ID";
+            return false;
+        }
+    }
+
+    SnapshotArray<uint32_t> term_offsets = image.section<uint32_t>(SECTION_TERM_OFFSETS);
+    if (!monotonic(term_offsets, header.sections[SECTION_TERM_BYTES].size)) {
+        error = "文本偏移不单调或超出文本段";
+        return false;
+    }
+
+    SnapshotArray<PostingList> posting_lists = image.section<PostingList>(SECTION_POSTING_LISTS);
+    SnapshotArray<CompressedPostings::SkipEntry> skips = image.section<CompressedPostings::SkipEntry>(SECTION_POSTING_SKIPS);
+    SnapshotArray<uint8_t> bytes = image.section<uint8_t>(SECTION_POSTING_BYTES);
+    for (size_t id = 0; id < posting_lists.size(); id++) {
+        const PostingList& list = posting_lists[id];
+        if (list.id != id || list.key_value > 1 || list.positions.size() > header.concept_count ||
+            !list.positions.withinSections(skips.begin(), skips.size(), bytes.begin(), bytes.size())) {
+            error = "特征 " + to_string(id) + " 的倒排列表描述项无效";
+            return false;
+        }
+    }
+
+    SnapshotArray<uint32_t> term_slots = image.section<uint32_t>(SECTION_TERM_SLOTS);
+    size_t empty_slots = 0;
+    for (size_t slot = 0; slot < term_slots.size(); slot++) {
+        if (term_slots[slot] == EMPTY_TERM_SLOT) {
+            empty_slots++;
+        } else if (term_slots[slot] >= header.feature_id_count) {
+            error = "字典散列表中有超出范围的特征ID";
+            return false;
+        }
+    }
+    if (empty_slots == 0) {
+        error = "字典散列表没有空槽";
+        return false;
+    }
+    return true;
+}
+
+shared_ptr<const SnapshotImage> SnapshotImage::map(const string& path, string& error) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        error = strerror(errno);
+        return nullptr;
+    }
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0) {
+        error = strerror(errno);
+        close(fd);
+        return nullptr;
+    }
+    size_t size = file_stat.st_size;
+    if (size < sizeof(SnapshotFileHeader)) {
+        error = "文件太短";
+        close(fd);
+        return nullptr;
+    }
+
+    // 共享的只读映射：同一文件在各进程中共用页缓存；导出新文件是rename替换，已映射的旧文件不受影响
+    void* data = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        error = strerror(errno);
+        return nullptr;
+    }
+
+    shared_ptr<SnapshotImage> image(new SnapshotImage());
+    image->bytes = static_cast<uint8_t*>(data);
+    image->length = size;
+    image->is_mapped = true;
+    image->file_path = path;
+    if (!validateHeader(image->bytes, size, error)) {
+        return nullptr;
+    }
+    return image;
+}
+
+SnapshotImage::~SnapshotImage() {
+    if (!bytes) return;
+    if (is_mapped) {
+        munmap(bytes, length);
+    } else {
+        free(bytes);
+    }
+}
+
+void SnapshotImage::seal() {
+    SnapshotFileHeader& header = mutableHeader();
+    for (int id = 0; id < SNAPSHOT_SECTION_COUNT; id++) {
+        header.sections[id].checksum = snapshotChecksum(bytes + header.sections[id].offset, header.sections[id].size);
+    }
+    header.header_checksum = headerChecksum(header);
+}
+
+bool SnapshotImage::verifyChecksums(string& error) const {
+    for (int id = 0; id < SNAPSHOT_SECTION_COUNT; id++) {
+        const SnapshotSectionEntry& entry = header().sections[id];
+        if (snapshotChecksum(bytes + entry.offset, entry.size) != entry.checksum) {
+            error = "第 " + to_string(id) + " 段校验和不符";
+            return false;
+        }
+    }
+    return true;
+}
+
+shared_ptr<const ConceptSnapshot> openSnapshotFile(const string& path, bool verify, string& error) {
+    shared_ptr<const SnapshotImage> image = SnapshotImage::map(path, error);
+    if (!image || (verify && (!image->verifyChecksums(error) || !image->verifyStructure(error)))) {
+        return nullptr;
+    }
+    return attachConceptSnapshot(image);
+}
+
+bool snapshotVerifyRequested() {
+    const char* verify_env = getenv("APPROACHER_SNAPSHOT_VERIFY");
+    return verify_env && strcmp(verify_env, "1") == 0;
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <string>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+#include "ConceptSnapshot.hpp"
+
+using namespace std;
+
+// 快照映像：概念库快照的全部数据（列式概念、字典、倒排列表）按固定格式放在一块连续内存中
+// 构建快照时在内存中生成映像；导出就是把映像原样写入文件，启动时把文件只读映射（mmap）进来直接使用，
+// 不读数据库、不重建索引，耗时与概念库大小无关；多个进程映射同一个文件时共享页缓存
+//
+// 文件格式：第一页为文件头，之后各段依次存放，每段从页边界开始
+// 各段都是定长元素的数组，段内引用用下标或相对偏移表示，映射到任意地址都可以直接使用
+// 格式按本机字节序写出，字节序或格式版本不同的文件拒绝加载
+
+const char SNAPSHOT_MAGIC[8] = {'A', 'P', 'P', 'R', 'S', 'N', 'A', 'P'};
+const uint32_t SNAPSHOT_FORMAT_VERSION = 1;
+const uint32_t SNAPSHOT_BYTE_ORDER = 0x01020304;
+const uint32_t SNAPSHOT_PAGE_SIZE = 4096;
+
+enum SnapshotSectionId {
+    SECTION_CONCEPT_IDS = 0,   // uint64：概念位置 → 概念ID
+    SECTION_SIGNATURES,        // uint64：概念位置 → 值签名
+    SECTION_FEATURE_OFFSETS,   // uint32：概念位置 → 在特征ID列中的起始下标（概念数+1个）
+    SECTION_FEATURE_IDS,       // uint32：各概念的特征ID
+    SECTION_POSTING_LISTS,     // PostingList：特征ID → 倒排列表描述项
+    SECTION_POSTING_SKIPS,     // CompressedPostings::SkipEntry：全部倒排列表的跳表
+    SECTION_POSTING_BYTES,     // uint8：全部倒排列表的差值
+    SECTION_TERM_OFFSETS,      // uint32：特征ID → 文本起始偏移（特征数+1个）
+    SECTION_TERM_BYTES,        // char：特征文本
+    SECTION_TERM_SLOTS,        // uint32：字典散列表
+    SNAPSHOT_SECTION_COUNT
+};
+
+struct SnapshotSectionEntry {
+    uint64_t offset;     // 段在文件中的偏移（页对齐）
+    uint64_t size;       // 段的字节数
+    uint64_t checksum;   // 段内容的校验和
+};
+
+struct SnapshotFileHeader {
+    char magic[8];
+    uint32_t format_version;
+    uint32_t byte_order;
+    uint32_t page_size;
+    uint32_t section_count;
+    uint64_t file_size;
+    uint64_t concept_count;
+    uint32_t feature_id_count;
+    uint32_t reserved;
+    int64_t created_at;                                   // 构建时间（Unix秒）
+    FrequencyStats frequency;
+    SnapshotSectionEntry sections[SNAPSHOT_SECTION_COUNT];
+    uint64_t header_checksum;                             // 以上各字段的校验和
+};
+
+static_assert(sizeof(SnapshotFileHeader) <= SNAPSHOT_PAGE_SIZE, "快照文件头必须放在第一页中");
+
+// 映像所在的内存：构建时分配的页对齐缓冲区，或只读映射的文件；快照通过shared_ptr持有，
+// 最后一个引用该快照的查询结束后释放（解除映射）
+class SnapshotImage {
+public:
+    // 按各段大小分配映像并写好文件头中的布局字段，各段内容和其余字段由调用者填写后seal()
+    static shared_ptr<SnapshotImage> allocate(const size_t section_sizes[SNAPSHOT_SECTION_COUNT]);
+
+    // 只读映射快照文件并检查文件头（格式、版本、字节序、文件头校验和、各段范围），不读各段内容；
+    // 失败时返回nullptr并设置error
+    static shared_ptr<const SnapshotImage> map(const string& path, string& error);
+
+    ~SnapshotImage();
+    SnapshotImage(const SnapshotImage&) = delete;
+    SnapshotImage& operator=(const SnapshotImage&) = delete;
+
+    const uint8_t* data() const { return bytes; }
+    size_t size() const { return length; }
+    bool mapped() const { return is_mapped; }
+    const string& path() const { return file_path; }
+    const SnapshotFileHeader& header() const { return *reinterpret_cast<const SnapshotFileHeader*>(bytes); }
+    SnapshotFileHeader& mutableHeader() { return *reinterpret_cast<SnapshotFileHeader*>(bytes); }
+
+    template <typename T>
+    SnapshotArray<T> section(SnapshotSectionId id) const {
+        const SnapshotSectionEntry& entry = header().sections[id];
+        return SnapshotArray<T>(reinterpret_cast<const T*>(bytes + entry.offset), entry.size / sizeof(T));
+    }
+
+    template <typename T>
+    T* mutableSection(SnapshotSectionId id) {
+        return reinterpret_cast<T*>(bytes + header().sections[id].offset);
+    }
+
+    // 计算各段和文件头的校验和（内容填写完之后调用）
+    void seal();
+
+    // 逐段核对校验和，要读遍整个映像（加载时默认不做，见openSnapshotFile）
+    bool verifyChecksums(string& error) const;
+
+    // 结构检查：偏移数组单调且不超出所指的段，特征ID和散列表槽在范围内，倒排列表描述项指向跳表段和差值段之内；
+    // 耗时与概念库大小成正比，与校验和一起按需进行（校验和相符但内容不合法的文件也会被拒绝）
+    bool verifyStructure(string& error) const;
+
+private:
+    SnapshotImage() = default;
+
+    uint8_t* bytes = nullptr;
+    size_t length = 0;
+    bool is_mapped = false;
+    string file_path;
+};
+
+// 校验和：按8字节分组乘法散列，比逐字节的FNV快得多
+uint64_t snapshotChecksum(const void* data, size_t size);
+
+// 打开快照文件：映射、检查文件头，verify为true时再核对各段校验和并做结构检查，然后在映像上建立快照
+// 不校验时为O(1)，不复制数据；失败时返回nullptr并设置error
+shared_ptr<const ConceptSnapshot> openSnapshotFile(const string& path, bool verify, string& error);
+
+// 环境变量 APPROACHER_SNAPSHOT_VERIFY=1 时加载快照文件也核对各段校验和并做结构检查
+bool snapshotVerifyRequested();
@@ -0,0 +1,222 @@
+#include "SyntheticLibrary.hpp"
+#include <fstream>
+#include <algorithm>
+#include <unordered_set>
+#include <set>
+#include <cmath>
+
+using namespace std;
+
+ZipfSampler::ZipfSampler(size_t n, double exponent) {
+    cumulative.reserve(n);
+    double total = 0.0;
+    for (size_t r = 0; r < n; r++) {
+        total += 1.0 / pow((double)(r + 1), exponent);
+        cumulative.push_back(total);
+    }
+    for (double& value : cumulative) {
+        value /= total;
+    }
+}
+
+size_t ZipfSampler::sample(SyntheticRandom& random) const {
+    if (cumulative.empty()) return 0;
+    auto it = lower_bound(cumulative.begin(), cumulative.end(), random.uniform());
+    return min<size_t>(it - cumulative.begin(), cumulative.size() - 1);
+}
+
+// 由音节拼成可读的伪单词，词表内不重复
+static vector<string> generateWords(size_t count, int min_syllables, int max_syllables, SyntheticRandom& random) {
+    static const char consonants[] = "bcdfghjklmnprstvwz";
+    static const char vowels[] = "aeiou";
+
+    vector<string> words;
+    unordered_set<string> seen;
+    words.reserve(count);
+    while (words.size() < count) {
+        int syllables = min_syllables + (int)random.below(max_syllables - min_syllables + 1);
+        string word;
+        for (int i = 0; i < syllables; i++) {
+            word += consonants[random.below(sizeof(consonants) - 1)];
+            word += vowels[random.below(sizeof(vowels) - 1)];
+        }
+        // 音节组合用尽时加序号保证唯一
+        if (seen.count(word)) {
+            word += to_string(words.size());
+        }
+        seen.insert(word);
+        words.push_back(word);
+    }
+    return words;
+}
+
+SyntheticLibraryGenerator::SyntheticLibraryGenerator(const SyntheticConfig& synthetic_config)
+    : config(synthetic_config),
+      key_sampler(max<size_t>(1, synthetic_config.key_vocabulary), synthetic_config.zipf_exponent),
+      value_sampler(max<size_t>(1, synthetic_config.value_vocabulary), synthetic_config.zipf_exponent) {
+    SyntheticRandom random(config.seed ^ 0x5157A11CE5ULL);
+    key_words = generateWords(max<size_t>(1, config.key_vocabulary), 2, 3, random);
+    value_words = generateWords(max<size_t>(1, config.value_vocabulary), 2, 4, random);
+}
+
+string SyntheticLibraryGenerator::sampleValue(SyntheticRandom& random) {
+    if (!random.chance(config.compound_rate)) {
+        return value_words[value_sampler.sample(random)];
+    }
+    int parts = random.chance(0.7) ? 2 : 3;
+    string compound;
+    for (int i = 0; i < parts; i++) {
+        if (i > 0) compound += "_";
+        compound += value_words[value_sampler.sample(random)];
+    }
+    return compound;
+}
+
+vector<SyntheticConcept> SyntheticLibraryGenerator::generateConcepts() {
+    SyntheticRandom random(config.seed);
+    int min_features = max(1, config.min_features);
+    int max_features = max(min_features, config.max_features);
+
+    vector<SyntheticConcept> concepts(config.concept_count);
+    for (SyntheticConcept& concept : concepts) {
+        int feature_count = min_features + (int)random.below(max_features - min_features + 1);
+        set<pair<string, string>> used;
+        for (int attempt = 0; (int)concept.keys.size() < feature_count && attempt < feature_count * 4; attempt++) {
+            string key = key_words[key_sampler.sample(random)];
+            string value = sampleValue(random);
+            if (used.insert(make_pair(key, value)).second) {
+                concept.keys.push_back(key);
+                concept.values.push_back(value);
+            }
+        }
+    }
+    return concepts;
+}
+
+string SyntheticLibraryGenerator::addTypo(const string& word, SyntheticRandom& random) {
+    static const char letters[] = "abcdefghijklmnopqrstuvwxyz";
+    if (word.empty()) return word;
+
+    string result = word;
+    size_t pos = random.below(result.size());
+    switch (random.below(4)) {
+        case 0:  // 替换
+            result[pos] = letters[random.below(sizeof(letters) - 1)];
+            break;
+        case 1:  // 删除（保留至少一个字符）
+            if (result.size() > 1) result.erase(pos, 1);
+            break;
+        case 2:  // 插入
+            result.insert(result.begin() + pos, letters[random.below(sizeof(letters) - 1)]);
+            break;
+        default: // 交换相邻字符
+            if (pos + 1 < result.size()) swap(result[pos], result[pos + 1]);
+            break;
+    }
+    return result;
+}
+
+vector<SyntheticQuery> SyntheticLibraryGenerator::generateQueries(const vector<SyntheticConcept>& concepts, size_t count, uint64_t stream) {
+    vector<SyntheticQuery> queries;
+    if (concepts.empty()) return queries;
+
+    SyntheticRandom random(config.seed * 0x9E3779B97F4A7C15ULL + stream);
+    queries.reserve(count);
+
+    // 从概念中抽取一部分特征，返回查询特征和来源（概念序号, 特征序号）
+    auto take_features = [&](size_t concept_index, vector<string>& out, set<pair<size_t, size_t>>& sources) {
+        const SyntheticConcept& concept = concepts[concept_index];
+        size_t n = concept.values.size();
+        if (n == 0) return;
+        size_t take = 1 + random.below(n);
+        vector<size_t> order(n);
+        for (size_t i = 0; i < n; i++) order[i] = i;
+        for (size_t i = 0; i < take; i++) {
+            swap(order[i], order[i + random.below(n - i)]);
+        }
+
+        for (size_t t = 0; t < take; t++) {
+            size_t f = order[t];
+            sources.insert(make_pair(concept_index, f));
+            string value = concept.values[f];
+            bool keyless = random.chance(config.keyless_rate);
+
+            // 无键的复合词有一半拆成分量，走复合词匹配
+            if (keyless && value.find('_') != string::npos && random.chance(0.5)) {
+                size_t start = 0;
+                while (start <= value.size()) {
+                    size_t end = value.find('_', start);
+                    if (end == string::npos) end = value.size();
+                    out.push_back(value.substr(start, end - start));
+                    start = end + 1;
+                }
+                continue;
+            }
+
+            if (random.chance(config.typo_rate)) {
+                value = addTypo(value, random);
+            }
+            out.push_back(keyless ? value : concept.keys[f] + ":" + value);
+        }
+    };
+
+    for (size_t q = 0; q < count; q++) {
+        SyntheticQuery query;
+        set<pair<size_t, size_t>> sources_a, sources_b;
+
+        size_t concept_a = random.below(concepts.size());
+        size_t concept_b = random.chance(0.5) ? concept_a : random.below(concepts.size());
+        take_features(concept_a, query.a, sources_a);
+        take_features(concept_b, query.b, sources_b);
+        if (query.a.empty() || query.b.empty()) continue;
+
+        // 期望相似度：来源特征的Jaccard系数
+        size_t shared = 0;
+        for (const auto& source : sources_a) {
+            shared += sources_b.count(source);
+        }
+        size_t combined = sources_a.size() + sources_b.size() - shared;
+        query.expected = combined > 0 ? (double)shared / combined : 0.0;
+        queries.push_back(move(query));
+    }
+    return queries;
+}
+
+bool writeSyntheticConcepts(const vector<SyntheticConcept>& concepts, const string& filename, bool delta_format) {
+    ofstream file(filename);
+    if (!file.is_open()) return false;
+
+    for (size_t i = 0; i < concepts.size(); i++) {
+        const SyntheticConcept& concept = concepts[i];
+        if (concept.keys.empty()) continue;
+        if (delta_format) {
+            file << "+[";
+        } else {
+            file << (i + 1) << ".[";
+        }
+        for (size_t j = 0; j < concept.keys.size(); j++) {
+            if (j > 0) file << ",";
+            file << concept.keys[j] << ":" << concept.values[j];
+        }
+        file << "]\n";
+    }
+    return file.good();
+}
+
+bool writeSyntheticQueries(const vector<SyntheticQuery>& queries, const string& filename) {
+    ofstream file(filename);
+    if (!file.is_open()) return false;
+
+    auto join = [](const vector<string>& items) {
+        string joined;
+        for (size_t i = 0; i < items.size(); i++) {
+            if (i > 0) joined += ",";
+            joined += items[i];
+        }
+        return joined;
+    };
+    for (const SyntheticQuery& query : queries) {
+        file << join(query.a) << "\t" << join(query.b) << "\t" << query.expected << "\n";
+    }
+    return file.good();
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cstdint>
+
+using namespace std;
+
+// 合成概念库配置（同样的配置和种子总是生成同样的概念库和查询）
+struct SyntheticConfig {
+    size_t concept_count = 10000;    // 概念数
+    int min_features = 2;            // 每个概念的最少特征数
+    int max_features = 6;            // 每个概念的最多特征数
+    size_t key_vocabulary = 50;      // 键的词表大小
+    size_t value_vocabulary = 5000;  // 值的词表大小
+    double zipf_exponent = 1.1;      // 键和值按Zipf分布抽取的指数
+    double compound_rate = 0.05;     // 概念值为复合词 a_b 或 a_b_c 的比例
+    double typo_rate = 0.1;          // 查询特征带拼写错误的比例
+    double keyless_rate = 0.5;       // 查询特征只给值、不给键的比例
+    uint64_t seed = 42;
+};
+
+// 合成概念
+struct SyntheticConcept {
+    vector<string> keys;
+    vector<string> values;
+};
+
+// 合成查询：两侧特征为 "key:value" 或 "value"，expected为按来源特征重合度给出的期望相似度（0-1）
+struct SyntheticQuery {
+    vector<string> a;
+    vector<string> b;
+    double expected = 0.0;
+};
+
+// 确定性伪随机数（splitmix64）：不依赖标准库分布的实现，不同平台结果一致
+class SyntheticRandom {
+private:
+    uint64_t state;
+
+public:
+    explicit SyntheticRandom(uint64_t seed) : state(seed) {}
+
+    uint64_t next() {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+    // [0, 1)
+    double uniform() { return (next() >> 11) * (1.0 / 9007199254740992.0); }
+
+    // [0, n)
+    size_t below(size_t n) { return n == 0 ? 0 : (size_t)(next() % n); }
+
+    bool chance(double probability) { return uniform() < probability; }
+};
+
+// Zipf分布抽样：第r个（从0开始）元素的概率正比于 1/(r+1)^s
+class ZipfSampler {
+private:
+    vector<double> cumulative;
+
+public:
+    ZipfSampler(size_t n, double exponent);
+    size_t sample(SyntheticRandom& random) const;
+};
+
+// 合成概念库生成器
+class SyntheticLibraryGenerator {
+private:
+    SyntheticConfig config;
+    vector<string> key_words;
+    vector<string> value_words;
+    ZipfSampler key_sampler;
+    ZipfSampler value_sampler;
+
+    string sampleValue(SyntheticRandom& random);
+
+public:
+    explicit SyntheticLibraryGenerator(const SyntheticConfig& synthetic_config);
+
+    const SyntheticConfig& getConfig() const { return config; }
+    const vector<string>& keyWords() const { return key_words; }
+    const vector<string>& valueWords() const { return value_words; }
+
+    // 生成概念库
+    vector<SyntheticConcept> generateConcepts();
+
+    // 从概念库抽取查询对：A取某个概念的部分特征，B取同一概念的另一部分特征或另一个概念；
+    // 按配置比例去掉键、注入拼写错误，复合词有时拆成分量（用于测试复合词匹配）
+    vector<SyntheticQuery> generateQueries(const vector<SyntheticConcept>& concepts, size_t count, uint64_t stream = 1);
+
+    // 对单词做一次随机编辑（替换、删除、插入或交换相邻字符）
+    static string addTypo(const string& word, SyntheticRandom& random);
+};
+
+// 写出概念文件：delta_format为false时为 loadFromFile 格式 "ID.[key:value,...]"，为true时为 applyDelta 格式 "+[key:value,...]"
+bool writeSyntheticConcepts(const vector<SyntheticConcept>& concepts, const string& filename, bool delta_format);
+
+// 写出查询文件（TSV）：A<TAB>B<TAB>期望相似度，可直接用于批量模式和训练样本导入
+bool writeSyntheticQueries(const vector<SyntheticQuery>& queries, const string& filename);